@@ -0,0 +1,689 @@
+//
+// Bareflank Hypervisor
+//
+// Copyright (C) 2015 Assured Information Security, Inc.
+// Author: Rian Quinn        <quinnr@ainfosec.com>
+// Author: Brendan Kerrigan  <kerriganb@ainfosec.com>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <bfelf_loader.h>
+
+// -----------------------------------------------------------------------------
+// Overview
+// -----------------------------------------------------------------------------
+
+// The benchmark generates synthetic shared objects in memory, and times each
+// phase of the ELF loader (init, load, add, relocate and symbol lookup) as
+// the number of symbols grows. Nothing that is loaded is ever executed, so
+// this runs on any Linux machine (no VMX, no cross compiler, no driver). The
+// add phase includes bfelf_loader_init, which clears the loader's tables.
+//
+// Each generated module has no section header table (everything is located
+// through PT_DYNAMIC, just like a stripped module), and contains:
+//
+// - a single RWX PT_LOAD segment, and a PT_DYNAMIC segment
+// - "symbols" defined functions, and (when there is more than one module)
+//   imports of a quarter of the functions defined by the next module
+// - both a SysV and a GNU hash table (i.e. --hash-style=both)
+// - "relative", "glob_dat", "jump_slot" and "abs64" relocations per defined
+//   symbol, of type RELATIVE, GLOB_DAT, JUMP_SLOT and 64 respectively,
+//   which target both the defined and the imported symbols
+
+#define PAGE_SIZE 0x1000
+
+struct config
+{
+    uint64_t modules;
+    std::vector<uint64_t> symbols;
+
+    uint64_t relative;
+    uint64_t glob_dat;
+    uint64_t jump_slot;
+    uint64_t abs64;
+
+    uint64_t lookups;
+    uint64_t iterations;
+
+    config() :
+        modules(4),
+        symbols{64, 256, 1024, 2048},
+        relative(4),
+        glob_dat(1),
+        jump_slot(1),
+        abs64(1),
+        lookups(100000),
+        iterations(10)
+    {}
+};
+
+struct module
+{
+    std::vector<char> file;
+    std::vector<std::string> names;
+    uint64_t relocs;
+};
+
+struct result
+{
+    double init;
+    double load;
+    double add;
+    double relocate;
+    double lookup;
+
+    result() :
+        init(1e300),
+        load(1e300),
+        add(1e300),
+        relocate(1e300),
+        lookup(1e300)
+    {}
+};
+
+using clk = std::chrono::steady_clock;
+
+static double
+elapsed_ns(clk::time_point start, clk::time_point end)
+{
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+static uint64_t
+align(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint32_t
+elf_hash(const std::string &name)
+{
+    uint32_t h = 0;
+
+    for (auto c : name)
+    {
+        h = (h << 4) + static_cast<unsigned char>(c);
+
+        auto g = h & 0xF0000000;
+        if (g != 0)
+            h ^= g >> 24;
+
+        h &= ~g;
+    }
+
+    return h;
+}
+
+static uint32_t
+gnu_hash(const std::string &name)
+{
+    uint32_t h = 5381;
+
+    for (auto c : name)
+        h = (h << 5) + h + static_cast<unsigned char>(c);
+
+    return h;
+}
+
+static std::string
+symbol_name(uint64_t module, uint64_t symbol)
+{
+    return "bench" + std::to_string(module) + "_sym" + std::to_string(symbol);
+}
+
+// -----------------------------------------------------------------------------
+// Generator
+// -----------------------------------------------------------------------------
+
+template<typename T> T *
+at(std::vector<char> &file, uint64_t offset)
+{
+    return reinterpret_cast<T *>(&file[offset]);
+}
+
+static module
+generate_module(const config &cfg, uint64_t index, uint64_t symbols)
+{
+    module mod;
+
+    auto imports = cfg.modules > 1 ? std::max<uint64_t>(symbols / 4, 1) : 0;
+    auto defined = symbols;
+
+    // Symbol 0 is the null symbol, followed by the imports, followed by the
+    // defined symbols (which is the part covered by the GNU hash table, and
+    // must be sorted by GNU hash bucket).
+
+    auto nbucket = std::max<uint64_t>(defined / 4, 1);
+    auto bloom_size = 1ULL;
+
+    while (bloom_size < defined / 32)
+        bloom_size <<= 1;
+
+    std::vector<std::string> names(1);
+    std::vector<uint64_t> values(1);
+
+    for (auto i = 0ULL; i < imports; i++)
+    {
+        names.push_back(symbol_name((index + 1) % cfg.modules, i));
+        values.push_back(0);
+    }
+
+    std::vector<uint64_t> order(defined);
+    for (auto i = 0ULL; i < defined; i++)
+        order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b)
+    {
+        return gnu_hash(symbol_name(index, a)) % nbucket <
+               gnu_hash(symbol_name(index, b)) % nbucket;
+    });
+
+    for (auto i : order)
+    {
+        names.push_back(symbol_name(index, i));
+        values.push_back(i);
+        mod.names.push_back(names.back());
+    }
+
+    auto nsym = names.size();
+    auto symoffset = 1 + imports;
+
+    std::string dynstr(1, '\0');
+    std::vector<uint64_t> st_names(nsym, 0);
+
+    for (auto i = 1ULL; i < nsym; i++)
+    {
+        st_names[i] = dynstr.size();
+        dynstr += names[i];
+        dynstr.push_back('\0');
+    }
+
+    auto relative = defined * cfg.relative;
+    auto glob_dat = defined * cfg.glob_dat;
+    auto jump_slot = defined * cfg.jump_slot;
+    auto abs64 = defined * cfg.abs64;
+    auto reladyn = relative + glob_dat + abs64;
+
+    mod.relocs = reladyn + jump_slot;
+
+    // Layout
+
+    const auto ndyn = 16ULL;
+
+    auto phdr_offset = sizeof(bfelf64_ehdr);
+    auto dyn_offset = phdr_offset + 2 * sizeof(bfelf_phdr);
+    auto sym_offset = dyn_offset + ndyn * sizeof(bfelf_dyn);
+    auto str_offset = sym_offset + nsym * sizeof(bfelf_sym);
+    auto hash_offset = align(str_offset + dynstr.size(), 8);
+    auto gnu_hash_offset = align(hash_offset + (2 + nbucket + nsym) * 4, 8);
+    auto rela_offset = align(gnu_hash_offset + (4 + nbucket + (nsym - symoffset)) * 4 + bloom_size * 8, 8);
+    auto jmprel_offset = rela_offset + reladyn * sizeof(bfelf_rela);
+    auto text_offset = align(jmprel_offset + jump_slot * sizeof(bfelf_rela), 16);
+    auto got_offset = align(text_offset + defined * 16, 8);
+    auto size = got_offset + mod.relocs * sizeof(bfelf64_addr);
+
+    auto &file = mod.file;
+    file.assign(size, 0);
+
+    // ELF Header
+
+    auto ehdr = at<bfelf64_ehdr>(file, 0);
+
+    ehdr->e_ident[bfei_mag0] = 0x7F;
+    ehdr->e_ident[bfei_mag1] = 'E';
+    ehdr->e_ident[bfei_mag2] = 'L';
+    ehdr->e_ident[bfei_mag3] = 'F';
+    ehdr->e_ident[bfei_class] = bfelfclass64;
+    ehdr->e_ident[bfei_data] = bfelfdata2lsb;
+    ehdr->e_ident[bfei_version] = bfev_current;
+    ehdr->e_ident[bfei_osabi] = bfelfosabi_sysv;
+    ehdr->e_type = bfet_dyn;
+    ehdr->e_machine = bfem_x86_64;
+    ehdr->e_version = bfev_current;
+    ehdr->e_entry = text_offset;
+    ehdr->e_phoff = phdr_offset;
+    ehdr->e_ehsize = sizeof(bfelf64_ehdr);
+    ehdr->e_phentsize = sizeof(bfelf_phdr);
+    ehdr->e_phnum = 2;
+    ehdr->e_shentsize = sizeof(bfelf_shdr);
+
+    // Program Headers
+
+    auto phdr = at<bfelf_phdr>(file, phdr_offset);
+
+    phdr[0].p_type = bfpt_load;
+    phdr[0].p_flags = bfpf_r | bfpf_w | bfpf_x;
+    phdr[0].p_filesz = size;
+    phdr[0].p_memsz = size;
+    phdr[0].p_align = PAGE_SIZE;
+
+    phdr[1].p_type = bfpt_dynamic;
+    phdr[1].p_flags = bfpf_r | bfpf_w;
+    phdr[1].p_offset = dyn_offset;
+    phdr[1].p_vaddr = dyn_offset;
+    phdr[1].p_paddr = dyn_offset;
+    phdr[1].p_filesz = ndyn * sizeof(bfelf_dyn);
+    phdr[1].p_memsz = ndyn * sizeof(bfelf_dyn);
+    phdr[1].p_align = 8;
+
+    // Dynamic Section
+
+    auto dyn = at<bfelf_dyn>(file, dyn_offset);
+    auto d = 0;
+
+    dyn[d++] = {bfdt_symtab, sym_offset};
+    dyn[d++] = {bfdt_strtab, str_offset};
+    dyn[d++] = {bfdt_strsz, dynstr.size()};
+    dyn[d++] = {bfdt_hash, hash_offset};
+    dyn[d++] = {bfdt_gnu_hash, gnu_hash_offset};
+    dyn[d++] = {bfdt_rela, rela_offset};
+    dyn[d++] = {bfdt_relasz, reladyn * sizeof(bfelf_rela)};
+    dyn[d++] = {bfdt_relaent, sizeof(bfelf_rela)};
+    dyn[d++] = {bfdt_relacount, relative};
+    dyn[d++] = {bfdt_jmprel, jmprel_offset};
+    dyn[d++] = {bfdt_pltrelsz, jump_slot * sizeof(bfelf_rela)};
+    dyn[d++] = {bfdt_pltrel, static_cast<bfelf64_xword>(bfdt_rela)};
+    dyn[d++] = {bfdt_bind_now, 0};
+    dyn[d++] = {bfdt_null, 0};
+
+    // Symbols
+
+    auto symtab = at<bfelf_sym>(file, sym_offset);
+
+    for (auto i = 1ULL; i < nsym; i++)
+    {
+        symtab[i].st_name = st_names[i];
+
+        if (i < symoffset)
+        {
+            symtab[i].st_info = (bfstb_global << 4) | bfstt_notype;
+            continue;
+        }
+
+        symtab[i].st_info = (bfstb_global << 4) | bfstt_func;
+        symtab[i].st_shndx = 1;
+        symtab[i].st_value = text_offset + values[i] * 16;
+        symtab[i].st_size = 16;
+
+        // ret
+        file[symtab[i].st_value] = static_cast<char>(0xC3);
+    }
+
+    std::copy(dynstr.begin(), dynstr.end(), &file[str_offset]);
+
+    // SysV Hash Table
+
+    auto hash = at<uint32_t>(file, hash_offset);
+    auto hash_bucket = &hash[2];
+    auto hash_chain = &hash[2 + nbucket];
+
+    hash[0] = nbucket;
+    hash[1] = nsym;
+
+    for (auto i = 1ULL; i < nsym; i++)
+    {
+        auto b = elf_hash(names[i]) % nbucket;
+
+        hash_chain[i] = hash_bucket[b];
+        hash_bucket[b] = i;
+    }
+
+    // GNU Hash Table
+
+    auto gnu = at<uint32_t>(file, gnu_hash_offset);
+    auto bloom = at<uint64_t>(file, gnu_hash_offset + 16);
+    auto gnu_bucket = reinterpret_cast<uint32_t *>(&bloom[bloom_size]);
+    auto gnu_chain = &gnu_bucket[nbucket];
+
+    gnu[0] = nbucket;
+    gnu[1] = symoffset;
+    gnu[2] = bloom_size;
+    gnu[3] = 6;
+
+    for (auto i = symoffset; i < nsym; i++)
+    {
+        auto h = gnu_hash(names[i]);
+        auto b = h % nbucket;
+
+        bloom[(h / 64) & (bloom_size - 1)] |= (1ULL << (h % 64)) | (1ULL << ((h >> gnu[3]) % 64));
+
+        if (gnu_bucket[b] == 0)
+            gnu_bucket[b] = i;
+
+        if (i + 1 == nsym || gnu_hash(names[i + 1]) % nbucket != b)
+            h |= 1;
+        else
+            h &= ~1U;
+
+        gnu_chain[i - symoffset] = h;
+    }
+
+    // Relocations
+    //
+    // The symbol relocations cycle through every symbol (imports included),
+    // and each relocation gets its own GOT slot.
+
+    auto rela = at<bfelf_rela>(file, rela_offset);
+    auto slot = got_offset;
+    auto r = 0ULL;
+
+    auto symbol = [&](uint64_t i)
+    {
+        return static_cast<bfelf64_xword>(1 + i % (nsym - 1)) << 32;
+    };
+
+    for (auto i = 0ULL; i < relative; i++, r++, slot += 8)
+        rela[r] = {slot, BFR_X86_64_RELATIVE, static_cast<bfelf64_sxword>(text_offset + (i % defined) * 16)};
+
+    for (auto i = 0ULL; i < glob_dat; i++, r++, slot += 8)
+        rela[r] = {slot, symbol(i) | BFR_X86_64_GLOB_DAT, 0};
+
+    for (auto i = 0ULL; i < abs64; i++, r++, slot += 8)
+        rela[r] = {slot, symbol(i + 1) | BFR_X86_64_64, 8};
+
+    for (auto i = 0ULL; i < jump_slot; i++, r++, slot += 8)
+        rela[r] = {slot, symbol(i + 2) | BFR_X86_64_JUMP_SLOT, 0};
+
+    return mod;
+}
+
+// -----------------------------------------------------------------------------
+// Benchmark
+// -----------------------------------------------------------------------------
+
+static bool
+check(bfelf64_sword ret, const char *what)
+{
+    if (ret == BFELF_SUCCESS)
+        return true;
+
+    std::cerr << "error: " << what << " failed: " << bfelf_error(ret) << std::endl;
+    return false;
+}
+
+static bool
+run_once(const config &cfg,
+         std::vector<module> &mods,
+         const std::vector<e_string_t> &names,
+         result &res)
+{
+    auto ret = 0;
+    void *addr = nullptr;
+
+    std::vector<bfelf_file_t> efs(mods.size());
+    std::vector<char *> execs(mods.size(), nullptr);
+    std::vector<bfelf64_sword> esizes(mods.size(), 0);
+    std::vector<std::vector<bfelf_symcache_t>> caches(mods.size());
+    std::vector<char> symtab;
+
+    auto loader = std::make_unique<bfelf_loader_t>();
+    auto success = false;
+
+    auto t0 = clk::now();
+
+    for (auto i = 0U; i < mods.size(); i++)
+    {
+        ret = bfelf_file_init(mods[i].file.data(), mods[i].file.size(), &efs[i]);
+        if (check(ret, "bfelf_file_init") == false)
+            return false;
+    }
+
+    auto t1 = clk::now();
+
+    for (auto i = 0U; i < mods.size(); i++)
+    {
+        esizes[i] = bfelf_total_exec_size(&efs[i]);
+        if (posix_memalign(reinterpret_cast<void **>(&execs[i]), PAGE_SIZE, esizes[i]) != 0)
+        {
+            std::cerr << "error: out of memory" << std::endl;
+            goto done;
+        }
+
+        caches[i].resize(efs[i].symnum);
+    }
+
+    {
+        auto t2 = clk::now();
+
+        for (auto i = 0U; i < mods.size(); i++)
+        {
+            ret = bfelf_file_load(&efs[i], execs[i], esizes[i]);
+            if (check(ret, "bfelf_file_load") == false)
+                goto done;
+        }
+
+        auto t3 = clk::now();
+
+        ret = bfelf_loader_init(loader.get());
+        if (check(ret, "bfelf_loader_init") == false)
+            goto done;
+
+        for (auto i = 0U; i < mods.size(); i++)
+        {
+            ret = bfelf_loader_add(loader.get(), &efs[i]);
+            if (check(ret, "bfelf_loader_add") == false)
+                goto done;
+        }
+
+        symtab.resize(bfelf_loader_symtab_size(loader.get(), nullptr));
+
+        ret = bfelf_loader_set_symtab(loader.get(), symtab.data(), symtab.size());
+        if (check(ret, "bfelf_loader_set_symtab") == false)
+            goto done;
+
+        auto t4 = clk::now();
+
+        ret = bfelf_loader_relocate_begin(loader.get());
+        if (check(ret, "bfelf_loader_relocate_begin") == false)
+            goto done;
+
+        for (auto i = 0U; i < mods.size(); i++)
+        {
+            ret = bfelf_loader_relocate_file(&efs[i], caches[i].data(), caches[i].size());
+            if (check(ret, "bfelf_loader_relocate_file") == false)
+                goto done;
+        }
+
+        ret = bfelf_loader_relocate_end(loader.get());
+        if (check(ret, "bfelf_loader_relocate_end") == false)
+            goto done;
+
+        auto t5 = clk::now();
+
+        for (auto i = 0ULL; i < cfg.lookups; i++)
+        {
+            auto name = names[(i * 7919) % names.size()];
+
+            ret = bfelf_resolve_symbol(&efs[i % efs.size()], &name, &addr);
+            if (check(ret, "bfelf_resolve_symbol") == false)
+                goto done;
+        }
+
+        auto t6 = clk::now();
+
+        res.init = std::min(res.init, elapsed_ns(t0, t1));
+        res.load = std::min(res.load, elapsed_ns(t2, t3));
+        res.add = std::min(res.add, elapsed_ns(t3, t4));
+        res.relocate = std::min(res.relocate, elapsed_ns(t4, t5));
+        res.lookup = std::min(res.lookup, elapsed_ns(t5, t6));
+    }
+
+    success = true;
+
+done:
+
+    for (auto exec : execs)
+        free(exec);
+
+    return success;
+}
+
+static bool
+run(const config &cfg, uint64_t symbols)
+{
+    result res;
+    uint64_t relocs = 0;
+    std::vector<module> mods;
+    std::vector<e_string_t> names;
+
+    for (auto i = 0ULL; i < cfg.modules; i++)
+    {
+        mods.push_back(generate_module(cfg, i, symbols));
+        relocs += mods.back().relocs;
+    }
+
+    for (auto &mod : mods)
+    {
+        for (auto &name : mod.names)
+            names.push_back({name.c_str(), static_cast<bfelf64_sword>(name.size())});
+    }
+
+    for (auto i = 0ULL; i < cfg.iterations; i++)
+    {
+        if (run_once(cfg, mods, names, res) == false)
+            return false;
+    }
+
+    std::cout << std::setw(8) << cfg.modules
+              << std::setw(9) << symbols
+              << std::setw(9) << relocs
+              << std::setw(11) << res.init / 1000
+              << std::setw(11) << res.load / 1000
+              << std::setw(11) << res.add / 1000
+              << std::setw(11) << res.relocate / 1000
+              << std::setw(11) << res.relocate / relocs
+              << std::setw(11) << res.lookup / cfg.lookups
+              << std::endl;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Main
+// -----------------------------------------------------------------------------
+
+static void
+usage()
+{
+    std::cout << "Usage: bfbench [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Generates synthetic modules, and times each phase of the ELF loader." << std::endl;
+    std::cout << std::endl;
+    std::cout << "  --modules n           number of modules (default: 4)" << std::endl;
+    std::cout << "  --symbols n[,n...]    symbols per module, one row each (default: 64,256,1024,2048)" << std::endl;
+    std::cout << "  --relocs r,g,j,a      RELATIVE, GLOB_DAT, JUMP_SLOT and 64 relocations" << std::endl;
+    std::cout << "                        per symbol (default: 4,1,1,1)" << std::endl;
+    std::cout << "  --lookups n           number of bfelf_resolve_symbol calls (default: 100000)" << std::endl;
+    std::cout << "  --iterations n        best of n runs (default: 10)" << std::endl;
+}
+
+static bool
+parse_list(const std::string &str, std::vector<uint64_t> &list)
+{
+    std::string::size_type pos = 0;
+
+    list.clear();
+
+    while (pos <= str.size())
+    {
+        auto end = str.find(',', pos);
+        if (end == std::string::npos)
+            end = str.size();
+
+        auto item = str.substr(pos, end - pos);
+        if (item.empty() || item.find_first_not_of("0123456789") != std::string::npos)
+            return false;
+
+        list.push_back(std::stoull(item));
+        pos = end + 1;
+    }
+
+    return true;
+}
+
+static bool
+parse_args(int argc, const char *argv[], config &cfg)
+{
+    for (auto i = 1; i < argc; i += 2)
+    {
+        std::vector<uint64_t> list;
+        std::string arg = argv[i];
+
+        if (i + 1 >= argc || parse_list(argv[i + 1], list) == false)
+            return false;
+
+        if (arg == "--modules" && list.size() == 1)
+            cfg.modules = list[0];
+        else if (arg == "--symbols")
+            cfg.symbols = list;
+        else if (arg == "--relocs" && list.size() == 4)
+        {
+            cfg.relative = list[0];
+            cfg.glob_dat = list[1];
+            cfg.jump_slot = list[2];
+            cfg.abs64 = list[3];
+        }
+        else if (arg == "--lookups" && list.size() == 1)
+            cfg.lookups = list[0];
+        else if (arg == "--iterations" && list.size() == 1)
+            cfg.iterations = list[0];
+        else
+            return false;
+    }
+
+    if (cfg.modules == 0 || cfg.iterations == 0)
+        return false;
+
+    for (auto symbols : cfg.symbols)
+    {
+        if (symbols == 0)
+            return false;
+    }
+
+    return true;
+}
+
+int main(int argc, const char *argv[])
+{
+    config cfg;
+
+    if (parse_args(argc, argv, cfg) == false)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << " modules  symbols   relocs    init us    load us     add us   reloc us"
+              << "   ns/reloc  ns/lookup" << std::endl;
+
+    for (auto symbols : cfg.symbols)
+    {
+        if (run(cfg, symbols) == false)
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
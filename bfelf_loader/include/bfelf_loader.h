@@ -39,14 +39,30 @@ extern "C" {
 /* ELF Defines                                                                */
 /******************************************************************************/
 
-#ifndef BFELF_MAX_MODULES
-#define BFELF_MAX_MODULES 50
-#endif
-
+/*
+ * PT_DYNAMIC only describes DT_REL(A) and DT_JMPREL, but without it,
+ * bfelf_file_init_sections uses one table per SHT_REL(A) section
+ */
 #ifndef BFELF_MAX_RELTAB
 #define BFELF_MAX_RELTAB 10
 #endif
 
+#ifndef BFELF_STREAM_HEAD_SIZE
+#define BFELF_STREAM_HEAD_SIZE 0x400
+#endif
+
+/* The exec size of an ELF file must fit in a bfelf64_sword */
+#define BFELF_MAX_EXEC_SIZE ((bfelf64_xword)0x7FFFFFFF)
+
+#ifndef BFELF_PRELINK_MAX_EXEC_SIZE
+#define BFELF_PRELINK_MAX_EXEC_SIZE 0x40000000
+#endif
+
+/* Must be less than 2GB */
+#ifndef BFELF_LZ4_MAX_BLOCK_SIZE
+#define BFELF_LZ4_MAX_BLOCK_SIZE 0x10000
+#endif
+
 /******************************************************************************/
 /* ELF Data Types                                                             */
 /******************************************************************************/
@@ -129,9 +145,14 @@ typedef int64_t bfelf64_sxword;
 #define BFELF_ERROR_INVALID_STRING_TABLE ((bfelf64_sword)-400)
 #define BFELF_ERROR_NO_SUCH_SYMBOL ((bfelf64_sword)-500)
 #define BFELF_ERROR_SYMBOL_UNDEFINED ((bfelf64_sword)-501)
+#define BFELF_ERROR_DUPLICATE_SYMBOL ((bfelf64_sword)-502)
 #define BFELF_ERROR_LOADER_FULL ((bfelf64_sword)-600)
 #define BFELF_ERROR_INVALID_LOADER ((bfelf64_sword)-601)
+#define BFELF_ERROR_NOT_RELOCATED ((bfelf64_sword)-602)
 #define BFELF_ERROR_INVALID_RELOCATION_TYPE ((bfelf64_sword)-701)
+#define BFELF_ERROR_IFUNC_DISABLED ((bfelf64_sword)-702)
+#define BFELF_ERROR_INVALID_PRELINK ((bfelf64_sword)-800)
+#define BFELF_ERROR_INVALID_COMPRESSED ((bfelf64_sword)-900)
 
 /**
  * Convert ELF error -> const char *
@@ -142,6 +163,65 @@ typedef int64_t bfelf64_sxword;
 const char *
 bfelf_error(bfelf64_sword value);
 
+/******************************************************************************/
+/* ELF Loader Statistics                                                      */
+/******************************************************************************/
+
+/*
+ * Timestamp Callback
+ *
+ * Returns the current time, in any unit (e.g. ns in the kernel, or TSC
+ * ticks in the VMM). The statistics report time in the same unit.
+ */
+typedef bfelf64_xword(*bfelf_timestamp_t)(void);
+
+/*
+ * ELF Loader Statistics
+ *
+ * The following is used by this API to record where the time goes when ELF
+ * files are loaded. Once registered with bfelf_stats_init, the structure is
+ * added to by bfelf_file_init and bfelf_stream_finish (init), by
+ * bfelf_file_load and bfelf_stream_finish (load), and by
+ * bfelf_loader_relocate (relocate). Time is only measured if a timestamp
+ * callback is provided. The registration is global, so only one thread
+ * should be using this API while statistics are being recorded.
+ */
+struct bfelf_stats_t
+{
+    bfelf_timestamp_t timestamp;
+
+    bfelf64_xword init_time;
+    bfelf64_xword load_time;
+    bfelf64_xword relocate_time;
+
+    bfelf64_xword bytes_copied;
+    bfelf64_xword bytes_zeroed;
+
+    bfelf64_xword relocs_relative;
+    bfelf64_xword relocs_relr;
+    bfelf64_xword relocs_64;
+    bfelf64_xword relocs_glob_dat;
+    bfelf64_xword relocs_jump_slot;
+    bfelf64_xword relocs_irelative;
+
+    bfelf64_xword lookups;
+    bfelf64_xword symcache_hits;
+    bfelf64_xword strcmps;
+};
+
+/**
+ * Initialize ELF Loader Statistics
+ *
+ * Clears the statistics structure, and registers it so that the rest of
+ * this API records into it. Passing 0 for stats stops recording.
+ *
+ * @param stats the statistics structure to register, or 0
+ * @param timestamp the timestamp callback, or 0 to only record counters
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_stats_init(struct bfelf_stats_t *stats, bfelf_timestamp_t timestamp);
+
 /******************************************************************************/
 /* ELF File                                                                   */
 /******************************************************************************/
@@ -150,6 +230,8 @@ struct bfelf_sym;
 struct bfelf_rel;
 struct bfelf_shdr;
 struct bfelf64_ehdr;
+struct bfelf_loader_t;
+struct e_string_t;
 
 /*
  * Relocation Table
@@ -163,12 +245,71 @@ struct bfreltab_t
     struct bfelf_rel *tab;
 };
 
+/*
+ * Relocation Table (Addend)
+ *
+ * The first num_relative entries of the table are BFR_X86_64_RELATIVE
+ * relocations (linkers sort these to the front of the table, and report
+ * how many there are using DT_RELACOUNT), which do not need a symbol, and
+ * are applied without looking at each entry's type.
+ */
 struct bfrelatab_t
 {
     bfelf64_sword num;
+    bfelf64_sword num_relative;
     struct bfelf_rela *tab;
 };
 
+/*
+ * Hash Table
+ *
+ * The following is used by this API to store information about the SysV
+ * (.hash) symbol hash table, which covers every symbol in the .dynsym
+ * section. A table with nbucket == 0 is not present in the ELF file.
+ */
+struct bfhashtab_t
+{
+    bfelf64_word nbucket;
+    bfelf64_word nchain;
+    bfelf64_word *bucket;
+    bfelf64_word *chain;
+};
+
+/*
+ * GNU Hash Table
+ *
+ * The following is used by this API to store information about the GNU
+ * (.gnu.hash) symbol hash table. Unlike the SysV hash table, this table
+ * only covers the defined symbols (i.e. symoffset and above), and provides
+ * a Bloom filter that can be used to reject a missing symbol without
+ * walking a chain.
+ */
+struct bfgnuhashtab_t
+{
+    bfelf64_word nbucket;
+    bfelf64_word nchain;
+    bfelf64_word symoffset;
+    bfelf64_word bloom_size;
+    bfelf64_word bloom_shift;
+    bfelf64_xword *bloom;
+    bfelf64_word *bucket;
+    bfelf64_word *chain;
+};
+
+/*
+ * Resolved Symbol Cache
+ *
+ * The following is used by this API to remember the ELF file and symbol
+ * that a dynamic symbol index resolved to while an ELF file is being
+ * relocated, so that each symbol is only resolved once, no matter how many
+ * relocations reference it. An entry with sym == 0 has not been resolved.
+ */
+struct bfelf_symcache_t
+{
+    struct bfelf_file_t *ef;
+    struct bfelf_sym *sym;
+};
+
 /*
  * ELF File
  *
@@ -182,6 +323,10 @@ struct bfelf_file_t
     bfelf64_sword fsize;
     bfelf64_sword esize;
 
+    char *tail;
+    bfelf64_xword tail_offset;
+    bfelf64_xword tail_size;
+
     struct bfelf64_ehdr *ehdr;
     struct bfelf_shdr *shdrtab;
     struct bfelf_phdr *phdrtab;
@@ -193,8 +338,17 @@ struct bfelf_file_t
     bfelf64_sword symnum;
     struct bfelf_sym *symtab;
 
-    bfelf64_sword efnum;
-    struct bfelf_file_t *eftab[BFELF_MAX_MODULES];
+    struct bfhashtab_t hashtab;
+    struct bfgnuhashtab_t gnuhashtab;
+
+    struct bfelf_file_t *next;
+    struct bfelf_loader_t *loader;
+
+    bfelf64_sword symcache_num;
+    struct bfelf_symcache_t *symcache;
+    bfelf64_sword symcache_hits;
+    bfelf64_sword symcache_misses;
+    bfelf64_sword relocated;
 
     bfelf64_sword num_rel;
     struct bfreltab_t bfreltab[BFELF_MAX_RELTAB];
@@ -202,6 +356,32 @@ struct bfelf_file_t
     bfelf64_sword num_rela;
     struct bfrelatab_t bfrelatab[BFELF_MAX_RELTAB];
 
+    bfelf64_addr dynsymtab;
+    bfelf64_addr dynstrtab;
+    bfelf64_xword dynstrsz;
+    char *dynstr;
+    bfelf64_addr hash;
+    bfelf64_addr gnu_hash;
+
+    bfelf64_addr rel;
+    bfelf64_sword relnum;
+
+    bfelf64_addr rela;
+    bfelf64_sword relanum;
+    bfelf64_sword relacount;
+
+    bfelf64_addr relr;
+    bfelf64_sword relrnum;
+    bfelf64_sword relr_applied;
+
+    bfelf64_addr pltgot;
+    bfelf64_addr jmprel;
+    bfelf64_sword jmprelnum;
+    bfelf64_xword pltrel;
+    bfelf64_sword bind_now;
+    bfelf64_sword symbolic;
+
+    bfelf64_sword zeroed;
     bfelf64_sword valid;
 };
 
@@ -212,6 +392,13 @@ struct bfelf_file_t
  * in memory. The resulting structure will be used by all of the other
  * functions.
  *
+ * Like a dynamic loader, the dynamic symbol table, string table, hash tables
+ * and relocation tables are located using the PT_DYNAMIC segment, so the
+ * section header table is optional (i.e. e_shoff and e_shnum can be 0). The
+ * section header table is only used if the file does not have a PT_DYNAMIC
+ * segment, or its PT_DYNAMIC segment does not provide DT_SYMTAB, DT_STRTAB
+ * and either DT_HASH or DT_GNU_HASH.
+ *
  * @param file a character buffer containing the contents of the ELF file to
  *     be loaded.
  * @param fsize the size of the character buffer
@@ -230,6 +417,13 @@ bfelf_file_init(char *file, bfelf64_sword fsize, struct bfelf_file_t *ef);
  * ELF file, that is used by this function. This function will actually load
  * the ELF file into the allocated RAM.
  *
+ * If zeroed is set to BFELF_TRUE (after the ELF file is initialized), the
+ * allocated RAM is assumed to already be zeroed, and only the contents of
+ * the PT_LOAD segments are written to it. Nothing outside of the segments
+ * is touched, which allows more than one ELF file to be loaded into the
+ * same buffer, with the segments of one ELF file placed in the holes
+ * between the segments of another.
+ *
  * @param ef the ELF file
  * @param exec a character buffer to load the ELF file into
  * @param esize the size of the character buffer
@@ -238,14 +432,243 @@ bfelf_file_init(char *file, bfelf64_sword fsize, struct bfelf_file_t *ef);
 bfelf64_sword
 bfelf_file_load(struct bfelf_file_t *ef, char *exec, bfelf64_sword esize);
 
+/**
+ * Detach ELF file size
+ *
+ * @param ef the ELF file
+ * @return number of bytes needed by bfelf_file_detach, negative on error
+ */
+bfelf64_sword
+bfelf_file_detach_size(struct bfelf_file_t *ef);
+
+/**
+ * Detach ELF file
+ *
+ * Once an ELF file has been loaded, this function copies the little bit of
+ * the ELF file that is still needed (the ELF header, the program and
+ * section header tables, and the section names) into meta, and points
+ * the rest of the ELF file structure at the loaded image. From then on,
+ * the buffer that was given to bfelf_file_init (or the meta buffer of a
+ * stream) is no longer used, and can be freed. meta must remain valid for
+ * as long as the ELF file is in use. This must be done before the ELF file
+ * is added to an ELF loader.
+ *
+ * @param ef the ELF file
+ * @param meta a character buffer of bfelf_file_detach_size bytes
+ * @param msize the size of the character buffer
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_file_detach(struct bfelf_file_t *ef, char *meta, bfelf64_sword msize);
+
+/******************************************************************************/
+/* ELF File Stream                                                            */
+/******************************************************************************/
+
+/*
+ * ELF File Stream
+ *
+ * The following is used by this API to load an ELF file that is provided in
+ * chunks (in file order), instead of all at once. The ELF and program
+ * headers are validated as soon as they arrive, and the contents of each
+ * PT_LOAD segment are copied straight into the exec buffer, so the file
+ * itself is never resident. The only part of the file that is kept (in the
+ * meta buffer) is the headers, and the tail of the file that follows the
+ * last PT_LOAD segment, which is where the section header table lives. To
+ * keep the meta buffer small, strip the debug information from the file.
+ *
+ * The PT_LOAD segments must be sorted, and the section header table must
+ * follow all of the PT_LOAD segments, which is the case for any file
+ * produced by a standard linker.
+ */
+struct bfelf_stream_t
+{
+    struct bfelf_file_t *ef;
+
+    bfelf64_xword fsize;
+    bfelf64_xword offset;
+    bfelf64_xword hdr_size;
+    bfelf64_xword tail_offset;
+
+    char *exec;
+    char *meta;
+    bfelf64_sword esize;
+    bfelf64_sword msize;
+
+    char head[BFELF_STREAM_HEAD_SIZE];
+};
+
+/**
+ * Initialize an ELF file stream
+ *
+ * @param stream the ELF file stream to initialize
+ * @param ef the ELF file that the stream will initialize and load
+ * @param fsize the total size of the ELF file
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_stream_init(struct bfelf_stream_t *stream,
+                  struct bfelf_file_t *ef,
+                  bfelf64_sword fsize);
+
+/**
+ * Write to an ELF file stream
+ *
+ * Consumes the next chunk of the ELF file. Once the headers have been
+ * validated, this function returns 0 until bfelf_stream_set_buffers has
+ * been called, after which the rest of the chunk can be written again.
+ *
+ * @param stream the ELF file stream
+ * @param buf the next chunk of the ELF file
+ * @param len the size of the chunk
+ * @return number of bytes consumed, negative on error
+ */
+bfelf64_sword
+bfelf_stream_write(struct bfelf_stream_t *stream,
+                   const char *buf,
+                   bfelf64_sword len);
+
+/**
+ * ELF file stream exec size
+ *
+ * @param stream the ELF file stream
+ * @return number of bytes of RWE memory needed to load the ELF file, or
+ *     negative if the headers have not been validated yet
+ */
+bfelf64_sword
+bfelf_stream_exec_size(struct bfelf_stream_t *stream);
+
+/**
+ * ELF file stream meta size
+ *
+ * @param stream the ELF file stream
+ * @return number of bytes needed to store the headers and the tail of the
+ *     ELF file, or negative if the headers have not been validated yet
+ */
+bfelf64_sword
+bfelf_stream_meta_size(struct bfelf_stream_t *stream);
+
+/**
+ * Set ELF file stream buffers
+ *
+ * Provides the memory that the rest of the ELF file is streamed into. Both
+ * buffers belong to the ELF file once the stream is finished, and must
+ * remain valid for as long as the ELF file is in use.
+ *
+ * @param stream the ELF file stream
+ * @param exec RWE memory of bfelf_stream_exec_size bytes
+ * @param esize the size of exec
+ * @param meta memory of bfelf_stream_meta_size bytes
+ * @param msize the size of meta
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_stream_set_buffers(struct bfelf_stream_t *stream,
+                         char *exec,
+                         bfelf64_sword esize,
+                         char *meta,
+                         bfelf64_sword msize);
+
+/**
+ * Finish an ELF file stream
+ *
+ * Once the entire ELF file has been written, this function initializes the
+ * ELF file, and zeros the parts of the exec buffer that are not loaded from
+ * the file. The result is the same as calling bfelf_file_init and
+ * bfelf_file_load, and the stream is no longer needed.
+ *
+ * @param stream the ELF file stream
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_stream_finish(struct bfelf_stream_t *stream);
+
 /******************************************************************************/
 /* ELF Loader                                                                 */
 /******************************************************************************/
 
+/*
+ * Global Symbol
+ *
+ * The following is used by the ELF loader to store a defined, global symbol
+ * provided by one of the ELF files that were added to the ELF loader. These
+ * are stored in an open addressed hash table (using the GNU hash of the
+ * symbol's name) that is built once by bfelf_loader_relocate, so that each
+ * relocation can be resolved with a single lookup instead of a search of
+ * every ELF file. An entry with sym == 0 is empty.
+ */
+struct bfelf_global_sym_t
+{
+    bfelf64_word hash;
+    struct bfelf_file_t *ef;
+    struct bfelf_sym *sym;
+};
+
+/*
+ * Global Symbol Table
+ *
+ * The following is used by the ELF loader to store its global symbols. The
+ * table is stored at the start of the memory that is given to the ELF
+ * loader by bfelf_loader_set_symtab, and its entries follow it. size is the
+ * number of entries (a power of 2), and num is the number of entries that
+ * are in use, which is kept under 3/4 of size.
+ */
+struct bfelf_symtab_t
+{
+    bfelf64_sword num;
+    bfelf64_sword size;
+    struct bfelf_global_sym_t *tab;
+};
+
+/*
+ * Address Index Entry
+ *
+ * The following is used by the ELF loader's address index to store the
+ * absolute address range of a function or object that is defined by one of
+ * the ELF files that were added to the ELF loader. The address index is
+ * sorted by address (see bfelf_loader_index), so that an address can be
+ * turned back into a symbol with a binary search.
+ */
+struct bfelf_addr_sym_t
+{
+    bfelf64_addr addr;
+    bfelf64_xword size;
+    struct bfelf_file_t *ef;
+    struct bfelf_sym *sym;
+};
+
+/*
+ * ELF Loader
+ *
+ * The following is used by this API to store the ELF files that are being
+ * relocated together. The ELF files are kept in a list that is linked
+ * through the ELF files themselves, so there is no limit on the number of
+ * ELF files that can be added, and an ELF file can only be added to one
+ * ELF loader at a time. By default, every symbol is resolved by
+ * bfelf_loader_relocate (eager binding). If lazy is set to BFELF_TRUE
+ * (after bfelf_loader_init, and before bfelf_loader_relocate), calls through
+ * the PLT are instead resolved the first time they are made (lazy binding).
+ * ELF files that are linked with -z now, and builds without a resolver
+ * trampoline, are always bound eagerly. If no_ifunc is set to BFELF_TRUE,
+ * relocating an ELF file that uses IFUNCs fails, instead of calling their
+ * resolvers (see bfelf_ifunc_resolver_t).
+ */
 struct bfelf_loader_t
 {
     bfelf64_sword num;
-    struct bfelf_file_t *efs[BFELF_MAX_MODULES];
+    bfelf64_sword lazy;
+    bfelf64_sword no_ifunc;
+    struct bfelf_file_t *efs;
+    struct bfelf_file_t *last;
+
+    struct bfelf_symtab_t *symtab;
+    struct bfelf_symtab_t *next_symtab;
+
+    bfelf64_xword relocate_start;
+
+    bfelf64_sword addrnum;
+    bfelf64_xword addrmax;
+    struct bfelf_addr_sym_t *addrtab;
 };
 
 /**
@@ -275,6 +698,47 @@ bfelf_loader_init(struct bfelf_loader_t *loader);
 bfelf64_sword
 bfelf_loader_add(struct bfelf_loader_t *loader, struct bfelf_file_t *ef);
 
+/**
+ * ELF Loader global symbol table size
+ *
+ * Returns the number of bytes needed for a global symbol table that can
+ * hold every symbol of the ELF files that have been added to the ELF
+ * loader, and of ef, which is not added (e.g. to size the table for an ELF
+ * file that is about to be added with bfelf_loader_add_relocated).
+ *
+ * @param loader the ELF loader
+ * @param ef an ELF file that is not in the ELF loader yet, or 0
+ * @return number of bytes needed by bfelf_loader_set_symtab, negative on error
+ */
+bfelf64_sword
+bfelf_loader_symtab_size(struct bfelf_loader_t *loader, struct bfelf_file_t *ef);
+
+/**
+ * Set ELF Loader global symbol table
+ *
+ * Gives the ELF loader the memory that it builds its next global symbol
+ * table in (see bfelf_loader_relocate). The table is sized from the
+ * symbols of the ELF files (see bfelf_loader_symtab_size) instead of being
+ * a fixed size, so it must be set once every ELF file has been added, and
+ * before the ELF loader is relocated. If the table is too small,
+ * BFELF_ERROR_LOADER_FULL is returned when it is built.
+ *
+ * Once relocated, a table that is in use is never written to again, as
+ * another CPU may be looking up a symbol in it (e.g. lazy binding). Each
+ * bfelf_loader_add_relocated, bfelf_loader_replace and
+ * bfelf_loader_remove needs a new table instead, which is built and then
+ * swapped in with a single store. The table that it replaces must not be
+ * freed until nothing can be looking up a symbol in it.
+ *
+ * @param loader the ELF loader
+ * @param buf a character buffer of bfelf_loader_symtab_size bytes, which
+ *     must remain valid for as long as the ELF loader is in use
+ * @param size the size of the character buffer
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_loader_set_symtab(struct bfelf_loader_t *loader, char *buf, bfelf64_sword size);
+
 /**
  * Relocate ELF Loader
  *
@@ -282,12 +746,213 @@ bfelf_loader_add(struct bfelf_loader_t *loader, struct bfelf_file_t *ef);
  * Once all of the ELF files have been relocated, it's safe to resolve
  * symbols for execution.
  *
+ * Before any relocation is performed, the defined global and weak symbols
+ * from every ELF file are merged into the ELF loader's global symbol table.
+ * A global symbol overrides a weak symbol of the same name, and the first
+ * weak symbol that is seen wins over any other weak symbol. If two ELF files
+ * define the same global symbol, BFELF_ERROR_DUPLICATE_SYMBOL is returned
+ * (unless both are untyped and sizeless, like the _end markers that some
+ * linkers export from every shared object).
+ * The table is built in the memory given to bfelf_loader_set_symtab, and
+ * BFELF_ERROR_LOADER_FULL is returned if there is none (or not enough).
+ * Since the ELF files point to this table once relocated, the ELF loader
+ * must outlive the ELF files that were added to it.
+ *
+ * The symbols that are resolved are not cached. To cache them, relocate
+ * each ELF file with bfelf_loader_relocate_file instead, and give it a
+ * symcache of ef->symnum entries.
+ *
  * @param loader the ELF loader
  * @return BFELF_SUCCESS on success, negative on error
  */
 bfelf64_sword
 bfelf_loader_relocate(struct bfelf_loader_t *loader);
 
+/**
+ * Begin Relocating ELF Loader
+ *
+ * bfelf_loader_relocate is made up of three steps, which can be called
+ * individually so that the ELF files can be relocated in parallel (e.g.
+ * one ELF file per CPU):
+ *
+ * - bfelf_loader_relocate_begin builds the global symbol table (see
+ *   bfelf_loader_relocate), and marks every ELF file as not relocated
+ * - bfelf_loader_relocate_file relocates a single ELF file. Each ELF file
+ *   only writes to its own exec, and only reads the global symbol table
+ *   and the other ELF files' symbol tables, so any number of ELF files can
+ *   be relocated at the same time, as long as each call is given its own
+ *   symcache (or none)
+ * - bfelf_loader_relocate_end, once every call to bfelf_loader_relocate_file
+ *   has returned, reports the error from the first ELF file (in the order
+ *   they were added) that failed, or was never relocated
+ *
+ * Statistics are updated atomically when compiled with GCC, so they can be
+ * left enabled while relocating in parallel.
+ *
+ * @param loader the ELF loader
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_loader_relocate_begin(struct bfelf_loader_t *loader);
+
+/**
+ * Relocate ELF File
+ *
+ * Relocates one of the ELF files added to an ELF loader, once
+ * bfelf_loader_relocate_begin has been called. The result is also stored in
+ * the ELF file, for bfelf_loader_relocate_end. See
+ * bfelf_loader_relocate_begin for more information.
+ *
+ * @param ef the ELF file
+ * @param symcache memory used to cache resolved symbols while relocating
+ *     (one entry per symbol, i.e. ef->symnum entries), or 0 if resolved
+ *     symbols should not be cached
+ * @param symcache_num the number of entries in symcache
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_loader_relocate_file(struct bfelf_file_t *ef,
+                           struct bfelf_symcache_t *symcache,
+                           bfelf64_sword symcache_num);
+
+/**
+ * End Relocating ELF Loader
+ *
+ * See bfelf_loader_relocate_begin for more information.
+ *
+ * @param loader the ELF loader
+ * @return BFELF_SUCCESS if every ELF file was relocated, negative on error
+ */
+bfelf64_sword
+bfelf_loader_relocate_end(struct bfelf_loader_t *loader);
+
+/**
+ * Remove ELF File
+ *
+ * Removes an ELF file from an ELF loader, and rebuilds the global symbol
+ * table without it (in a new table, see bfelf_loader_set_symtab, if the
+ * ELF loader has been relocated). The other ELF files are not bound again,
+ * so this should only be used for an ELF file that none of the others are
+ * bound to, like one that was just added with bfelf_loader_add_relocated.
+ *
+ * @param loader the ELF loader
+ * @param ef the ELF file to remove
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_loader_remove(struct bfelf_loader_t *loader, struct bfelf_file_t *ef);
+
+/**
+ * Add ELF File to a Relocated ELF Loader
+ *
+ * Adds an ELF file to an ELF loader that has already been relocated, and
+ * relocates the ELF file against the ELF files that are already in it
+ * (including itself). The ELF files that are already in the ELF loader are
+ * not modified, unless the ELF file defines a global symbol that overrides
+ * a weak one of theirs, in which case they are bound again (see
+ * bfelf_loader_replace). If the ELF file cannot be relocated (e.g. one of
+ * its symbols is missing or already defined), it is removed again. The
+ * global symbol table is built again with the new ELF file's symbols, so a
+ * new table of bfelf_loader_symtab_size(loader, ef) bytes must be set first.
+ *
+ * @param loader the ELF loader
+ * @param ef the ELF file to add
+ * @param symcache memory used to cache resolved symbols while relocating,
+ *     or 0 if resolved symbols should not be cached
+ * @param symcache_num the number of entries in symcache
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_loader_add_relocated(struct bfelf_loader_t *loader,
+                           struct bfelf_file_t *ef,
+                           struct bfelf_symcache_t *symcache,
+                           bfelf64_sword symcache_num);
+
+/**
+ * Replace ELF File
+ *
+ * Replaces an ELF file in an ELF loader that has already been relocated
+ * with a new one. The new ELF file is relocated, and then every other ELF
+ * file is bound again (see bfelf_rebind_symbols), so that anything that was
+ * bound to the old ELF file is bound to the new one. On failure, the old
+ * ELF file is put back, and nothing is bound to the new one. The old ELF
+ * file is not modified, and can be freed once nothing is executing it, or
+ * swapped back in, in which case it is not relocated again (only ELF files
+ * that have not been relocated by an ELF loader are relocated). Like
+ * bfelf_loader_add_relocated, a new table of
+ * bfelf_loader_symtab_size(loader, new_ef) bytes must be set first.
+ *
+ * Nothing can be executing code in the ELF files while they are being
+ * bound again, so the caller must quiesce them first.
+ *
+ * @param loader the ELF loader
+ * @param old_ef the ELF file to replace
+ * @param new_ef the ELF file to replace it with
+ * @param symcache memory used to cache resolved symbols while relocating,
+ *     or 0 if resolved symbols should not be cached
+ * @param symcache_num the number of entries in symcache
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_loader_replace(struct bfelf_loader_t *loader,
+                     struct bfelf_file_t *old_ef,
+                     struct bfelf_file_t *new_ef,
+                     struct bfelf_symcache_t *symcache,
+                     bfelf64_sword symcache_num);
+
+/**
+ * ELF Loader address index size
+ *
+ * @param loader the ELF loader
+ * @return number of bytes needed by bfelf_loader_index, negative on error
+ */
+bfelf64_sword
+bfelf_loader_index_size(struct bfelf_loader_t *loader);
+
+/**
+ * Index ELF Loader by address
+ *
+ * Builds an index of every function and object that is defined by the ELF
+ * files that were added to the ELF loader, sorted by absolute address, so
+ * that bfelf_symbolize can turn an address (e.g. a faulting RIP) back into
+ * a symbol. The index is optional, and only covers the symbols in each ELF
+ * file's dynamic symbol table. Since the index points at the loaded ELF
+ * files, they must be loaded before the index is built. Adding another ELF
+ * file to the ELF loader drops the index, and it must be built again.
+ *
+ * @param loader the ELF loader
+ * @param buf a character buffer of bfelf_loader_index_size bytes, which
+ *     must remain valid for as long as the index is in use
+ * @param size the size of the character buffer
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_loader_index(struct bfelf_loader_t *loader, char *buf, bfelf64_sword size);
+
+/**
+ * Symbolize Address
+ *
+ * Looks up the function or object that contains addr using the ELF loader's
+ * address index (see bfelf_loader_index), and returns the ELF file that
+ * defines it, the symbol's name, and addr's offset from the start of the
+ * symbol. A symbol without a size only matches its own address. If more
+ * than one symbol contains addr, the one that starts closest to it is
+ * returned.
+ *
+ * @param loader the ELF loader
+ * @param addr the absolute address to symbolize
+ * @param ef the ELF file that defines the symbol
+ * @param name the name of the symbol
+ * @param offset the offset of addr from the start of the symbol
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_symbolize(struct bfelf_loader_t *loader,
+                void *addr,
+                struct bfelf_file_t **ef,
+                struct e_string_t *name,
+                bfelf64_xword *offset);
+
 /******************************************************************************/
 /* ELF File Header                                                            */
 /******************************************************************************/
@@ -520,6 +1185,7 @@ bfelf_file_print_header(struct bfelf_file_t *ef);
 #define bfsht_rel ((bfelf64_word)9)
 #define bfsht_shlib ((bfelf64_word)10)
 #define bfsht_dynsym ((bfelf64_word)11)
+#define bfsht_gnu_hash ((bfelf64_word)0x6FFFFFF6)
 #define bfsht_loos ((bfelf64_word)0x60000000)
 #define bfsht_hios ((bfelf64_word)0x6FFFFFFF)
 #define bfsht_loproc ((bfelf64_word)0x70000000)
@@ -642,11 +1308,19 @@ bfelf_print_section_header(struct bfelf_file_t *ef,
  * of a fuzzer. We define a string as a character array, plus a length,
  * which we can set to ensure safety (i.e. is NULL is not present, at least
  * we will not overrun the file).
+ *
+ * The hash is the string's GNU hash, or 0 if it has not been computed yet.
+ * Strings returned by the loader always have their hash filled in, and the
+ * lookup functions compute and store it the first time they are given a
+ * string without one, so a string that is looked up more than once (or in
+ * more than one module) is only ever hashed once. Two strings with
+ * different hashes are never compared byte by byte.
  */
 struct e_string_t
 {
     const char *buf;
     bfelf64_sword len;
+    bfelf64_word hash;
 };
 
 /**
@@ -714,6 +1388,7 @@ stb_to_str(bfelf64_word value);
 #define bfstt_section ((unsigned char)3)
 #define bfstt_file ((unsigned char)4)
 #define bfstt_loos ((unsigned char)10)
+#define bfstt_gnu_ifunc ((unsigned char)10)
 #define bfstt_hios ((unsigned char)12)
 #define bfstt_loproc ((unsigned char)13)
 #define bfstt_hiproc ((unsigned char)15)
@@ -763,6 +1438,23 @@ bfelf_symbol_by_index(struct bfelf_file_t *ef,
                       bfelf64_word index,
                       struct bfelf_sym **sym);
 
+/**
+ * Get Dynamic Symbol Name
+ *
+ * This function returns the name of a symbol from the dynamic string table.
+ * Unlike bfelf_string_table_entry, this does not need a section header, so
+ * it works with ELF files that do not have a section header table.
+ *
+ * @param ef the ELF file
+ * @param sym the symbol to get the name for
+ * @param str the string being returned
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_symbol_name(struct bfelf_file_t *ef,
+                  struct bfelf_sym *sym,
+                  struct e_string_t *str);
+
 /**
  * Get Dynamic Symbol (by name)
  *
@@ -770,6 +1462,12 @@ bfelf_symbol_by_index(struct bfelf_file_t *ef,
  * name. Note that this function does _not_ attempt to locate the symbol if
  * it's value is 0.
  *
+ * If the ELF file provides a .gnu.hash section, the lookup uses its Bloom
+ * filter and hash chains, which only contain the symbols that the ELF file
+ * defines. Otherwise, if a .hash section is provided, the lookup uses its
+ * hash chains. The .dynsym section is only searched linearly when neither
+ * hash table is present.
+ *
  * @param ef the ELF file
  * @param name name of the symbol in the .dynsym section to get
  * @param sym the symbol being returned
@@ -787,7 +1485,10 @@ bfelf_symbol_by_name(struct bfelf_file_t *ef,
  * name. If the symbol is not defined in the ELF file that was provided
  * (i.e. st_value == 0), this function will search all of the other ELF files
  * that were provided by an ELF loader to see if it can find the symbol that
- * is actually defined. If this function returns, BFELF_ERROR_NO_SUCH_SYMBOL
+ * is actually defined. Once the ELF file has been relocated by an ELF loader,
+ * this search is a single lookup in the ELF loader's global symbol table,
+ * falling back to the provided ELF file only for symbols that are not
+ * global. If this function returns, BFELF_ERROR_NO_SUCH_SYMBOL
  * the symbol is not defined by any of the ELF files that were loaded. If
  * the symbol was located, this function not only returns the symbol, but it
  * also returns the ELF file that the symbol was located in (which might be
@@ -863,6 +1564,22 @@ bfelf_print_sym(struct bfelf_file_t *ef,
 #define BFR_X86_64_GLOB_DAT ((bfelf64_xword)6)
 #define BFR_X86_64_JUMP_SLOT ((bfelf64_xword)7)
 #define BFR_X86_64_RELATIVE ((bfelf64_xword)8)
+#define BFR_X86_64_IRELATIVE ((bfelf64_xword)37)
+
+/*
+ * IFUNC Resolver
+ *
+ * A symbol of type bfstt_gnu_ifunc is the address of a resolver, which
+ * returns the address of the implementation to use (e.g. based on what
+ * CPUID reports), and is called when a relocation is made against the
+ * symbol, or for each BFR_X86_64_IRELATIVE relocation (whose addend is the
+ * resolver), so the selected address is written into the GOT, and calls
+ * do not go through a dispatcher. Resolvers are called while the ELF files
+ * are being relocated (possibly at the same time, see
+ * bfelf_loader_relocate_begin), so they must not rely on relocations (i.e.
+ * only use CPUID and the PC relative addresses of local functions).
+ */
+typedef bfelf64_addr(*bfelf_ifunc_resolver_t)(void);
 
 /**
  * Convert r_info (type) -> const char *
@@ -942,11 +1659,32 @@ bfelf64_sword
 bfelf_relocate_symbol_addend(struct bfelf_file_t *ef,
                              struct bfelf_rela *rela);
 
+/**
+ * Symbol Address
+ *
+ * Returns the address of a symbol of an ELF file that has been loaded. If
+ * the symbol is an IFUNC (bfstt_gnu_ifunc), its resolver is called, and the
+ * address that it returns is used instead. If the ELF file has been added
+ * to an ELF loader with no_ifunc set (e.g. when prelinking, as the
+ * resolver must run on the CPU that will execute the code),
+ * BFELF_ERROR_IFUNC_DISABLED is returned instead.
+ *
+ * @param ef the ELF file that defines the symbol
+ * @param sym the symbol
+ * @param addr where to store the address of the symbol
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_symbol_address(struct bfelf_file_t *ef,
+                     struct bfelf_sym *sym,
+                     bfelf64_addr *addr);
+
 /**
  * Relocate Symbols
  *
  * This function goes through all of the relocation tables, and relocates
- * each record in each relocation table.
+ * each record in each relocation table. The symbols that are resolved are
+ * not cached (see bfelf_relocate_symbols_cache).
  *
  * @param ef the ELF file
  * @return BFELF_SUCCESS on success, negative on error
@@ -954,6 +1692,61 @@ bfelf_relocate_symbol_addend(struct bfelf_file_t *ef,
 bfelf64_sword
 bfelf_relocate_symbols(struct bfelf_file_t *ef);
 
+/**
+ * Relocate Symbols (Symbol Cache)
+ *
+ * Same as bfelf_relocate_symbols, except that the symbols that are resolved
+ * are cached by index in symcache (which may be 0) while this function
+ * runs, and the number of cache hits and misses are stored in
+ * symcache_hits and symcache_misses. The cache belongs to the caller, so
+ * ELF files added to the same ELF loader can be relocated at the same time,
+ * each with its own cache. Only the first symcache_num symbols are cached.
+ *
+ * @param ef the ELF file
+ * @param symcache memory used to cache resolved symbols (ef->symnum
+ *     entries to cache every symbol), or 0
+ * @param symcache_num the number of entries in symcache
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_relocate_symbols_cache(struct bfelf_file_t *ef,
+                             struct bfelf_symcache_t *symcache,
+                             bfelf64_sword symcache_num);
+
+/**
+ * Rebind Symbols
+ *
+ * Applies the relocations of an ELF file that refer to a symbol again, so
+ * that they point to wherever the symbol is now found. Relative
+ * relocations are not applied again (DT_RELR relocations can only be
+ * applied once). Used by bfelf_loader_replace.
+ *
+ * @param ef the ELF file
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_rebind_symbols(struct bfelf_file_t *ef);
+
+/**
+ * Relocate Packed Relative Relocations
+ *
+ * Applies the packed relative relocations (DT_RELR) of an ELF file. The
+ * table is a list of 64bit entries. An even entry is the address of a
+ * relocation, and an odd entry is a bitmap of which of the next 63 words
+ * (after the last address) also need to be relocated. Each relocation adds
+ * the load address of the ELF file to the value that is already stored at
+ * the address (the addend is implicit), so these relocations can only be
+ * applied once. The ELF file records that they have been applied, and once
+ * they have, this function does nothing until the ELF file is loaded again.
+ * If the table is invalid, none of it is applied. This function is called
+ * by bfelf_relocate_symbols.
+ *
+ * @param ef the ELF file
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_relocate_relr(struct bfelf_file_t *ef);
+
 /**
  * Print Relocation
  *
@@ -1159,6 +1952,375 @@ bfelf64_sword
 bfelf_print_program_header(struct bfelf_file_t *ef,
                            struct bfelf_phdr *phdr);
 
+/******************************************************************************/
+/* ELF Dynamic Section                                                        */
+/******************************************************************************/
+
+/*
+ * ELF Dynamic Section Tags
+ *
+ * The following is defined in the ELF 64bit file format specification:
+ * http://www.uclibc.org/docs/elf-64-gen.pdf, page 14
+ */
+#define bfdt_null ((bfelf64_sxword)0)
+#define bfdt_needed ((bfelf64_sxword)1)
+#define bfdt_pltrelsz ((bfelf64_sxword)2)
+#define bfdt_pltgot ((bfelf64_sxword)3)
+#define bfdt_hash ((bfelf64_sxword)4)
+#define bfdt_strtab ((bfelf64_sxword)5)
+#define bfdt_symtab ((bfelf64_sxword)6)
+#define bfdt_rela ((bfelf64_sxword)7)
+#define bfdt_relasz ((bfelf64_sxword)8)
+#define bfdt_relaent ((bfelf64_sxword)9)
+#define bfdt_strsz ((bfelf64_sxword)10)
+#define bfdt_syment ((bfelf64_sxword)11)
+#define bfdt_symbolic ((bfelf64_sxword)16)
+#define bfdt_rel ((bfelf64_sxword)17)
+#define bfdt_relsz ((bfelf64_sxword)18)
+#define bfdt_relent ((bfelf64_sxword)19)
+#define bfdt_pltrel ((bfelf64_sxword)20)
+#define bfdt_jmprel ((bfelf64_sxword)23)
+#define bfdt_bind_now ((bfelf64_sxword)24)
+#define bfdt_flags ((bfelf64_sxword)30)
+#define bfdt_relrsz ((bfelf64_sxword)35)
+#define bfdt_relr ((bfelf64_sxword)36)
+#define bfdt_relrent ((bfelf64_sxword)37)
+#define bfdt_gnu_hash ((bfelf64_sxword)0x6FFFFEF5)
+#define bfdt_relacount ((bfelf64_sxword)0x6FFFFFF9)
+#define bfdt_flags_1 ((bfelf64_sxword)0x6FFFFFFB)
+
+/*
+ * ELF Dynamic Section Flags
+ *
+ * The following are the flags (found in the DT_FLAGS and DT_FLAGS_1
+ * entries) that request that all relocations be performed at load time,
+ * and that a file's own definitions be used before searching the other
+ * files of the loader (i.e. the file was linked with -Bsymbolic).
+ */
+#define bfdf_symbolic ((bfelf64_xword)0x2)
+#define bfdf_bind_now ((bfelf64_xword)0x8)
+#define bfdf_1_now ((bfelf64_xword)0x1)
+
+/*
+ * ELF Dynamic Section Entry
+ *
+ * The following is defined in the ELF 64bit file format specification:
+ * http://www.uclibc.org/docs/elf-64-gen.pdf, page 14
+ */
+struct bfelf_dyn
+{
+    bfelf64_sxword d_tag;
+    bfelf64_xword d_val;
+};
+
+/**
+ * Lazy Symbol Resolver
+ *
+ * When an ELF loader is relocated with lazy set to BFELF_TRUE, the
+ * BFR_X86_64_JUMP_SLOT relocations in an ELF file's PLT relocation table
+ * are not resolved. Instead, each GOT entry is left pointing at its PLT
+ * stub, which (the first time the function is called) passes the ELF file
+ * and the relocation's index to a resolver trampoline. The trampoline
+ * calls this function, which resolves the symbol through the ELF loader,
+ * patches the GOT entry so that the next call goes straight to the
+ * function, and returns the function's address so that the trampoline can
+ * jump to it. If the symbol cannot be resolved, the trampoline halts.
+ *
+ * @param ef the ELF file whose PLT stub was called
+ * @param index the index of the relocation in the PLT relocation table
+ * @return the absolute address of the symbol, 0 on error
+ */
+void *
+bfelf_lazy_resolve(struct bfelf_file_t *ef, bfelf64_xword index);
+
+/******************************************************************************/
+/* ELF Prelinked Image                                                        */
+/******************************************************************************/
+
+/*
+ * Prelinked Image Magic ("BFPRELNK") and Version
+ */
+#define BFELF_PRELINK_MAGIC ((bfelf64_xword)0x4B4E4C4552504642)
+#define BFELF_PRELINK_VERSION ((bfelf64_xword)1)
+
+/*
+ * Prelinked Image Header
+ *
+ * A prelinked image is created on the host by the bfprelink tool, which
+ * loads every module in a list of modules into a single image (at a nominal
+ * base address of 0), and relocates the modules against each other. The
+ * only thing left to do at load time is to copy the image into executable
+ * memory, and add the address of that memory to each of the absolute
+ * addresses stored in the image. These are listed in the fixup table,
+ * which uses the same packed encoding as a DT_RELR table. The symbol table
+ * lists the global symbols of all of the modules so that entry points can
+ * still be resolved by name.
+ *
+ * All offsets are from the start of the file, and image_size bytes of the
+ * image are stored in the file. The remaining exec_size - image_size bytes
+ * are zero.
+ */
+struct bfelf_prelink_hdr
+{
+    bfelf64_xword magic;
+    bfelf64_xword version;
+    bfelf64_xword image_offset;
+    bfelf64_xword image_size;
+    bfelf64_xword exec_size;
+    bfelf64_xword fixup_offset;
+    bfelf64_xword fixup_num;
+    bfelf64_xword sym_offset;
+    bfelf64_xword sym_num;
+    bfelf64_xword str_offset;
+    bfelf64_xword str_size;
+};
+
+/*
+ * Prelinked Image Symbol
+ *
+ * st_name is an offset into the image's string table, and st_value is an
+ * offset into the image.
+ */
+struct bfelf_prelink_sym
+{
+    bfelf64_xword st_name;
+    bfelf64_xword st_value;
+};
+
+/*
+ * Prelinked Image
+ *
+ * The following is used by this API to store information about a
+ * prelinked image that has been handed to the loader.
+ */
+struct bfelf_prelink_t
+{
+    char *file;
+    char *exec;
+    bfelf64_sword fsize;
+    bfelf64_sword esize;
+
+    struct bfelf_prelink_hdr *hdr;
+    char *image;
+    bfelf64_xword *fixups;
+    struct bfelf_prelink_sym *syms;
+    char *strtab;
+
+    bfelf64_sword valid;
+};
+
+/**
+ * Is Prelinked
+ *
+ * @param file a character buffer containing the contents of a module
+ * @param fsize the size of the character buffer
+ * @return BFELF_TRUE if the module is a prelinked image, BFELF_FALSE
+ *     otherwise
+ */
+bfelf64_sword
+bfelf_is_prelinked(char *file, bfelf64_sword fsize);
+
+/**
+ * Initialize a prelinked image
+ *
+ * Validates the prelinked image's header and tables. Like an ELF file, the
+ * buffer containing the prelinked image must remain valid for as long as
+ * the prelinked image is in use.
+ *
+ * @param file a character buffer containing the prelinked image
+ * @param fsize the size of the character buffer
+ * @param pl the prelinked image structure to initialize
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_prelink_init(char *file, bfelf64_sword fsize, struct bfelf_prelink_t *pl);
+
+/**
+ * Prelinked Image Exec Size
+ *
+ * @param pl the prelinked image
+ * @return number of bytes of RWE memory needed to load the prelinked image,
+ *     negative on error
+ */
+bfelf64_sword
+bfelf_prelink_exec_size(struct bfelf_prelink_t *pl);
+
+/**
+ * Load a prelinked image
+ *
+ * Copies the prelinked image into exec and applies the fixup table, using
+ * exec as the base address. Once loaded, the image is ready to execute, and
+ * does not need to be added to an ELF loader.
+ *
+ * @param pl the prelinked image
+ * @param exec a character buffer to load the prelinked image into
+ * @param esize the size of the character buffer
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_prelink_load(struct bfelf_prelink_t *pl, char *exec, bfelf64_sword esize);
+
+/**
+ * Detach prelinked image size
+ *
+ * @param pl the prelinked image
+ * @return number of bytes needed by bfelf_prelink_detach, negative on error
+ */
+bfelf64_sword
+bfelf_prelink_detach_size(struct bfelf_prelink_t *pl);
+
+/**
+ * Detach prelinked image
+ *
+ * Once a prelinked image has been loaded, this function copies its symbol
+ * table into meta so that the buffer that was given to bfelf_prelink_init
+ * can be freed. meta must remain valid for as long as the prelinked image
+ * is in use.
+ *
+ * @param pl the prelinked image
+ * @param meta a character buffer of bfelf_prelink_detach_size bytes
+ * @param msize the size of the character buffer
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_prelink_detach(struct bfelf_prelink_t *pl, char *meta, bfelf64_sword msize);
+
+/**
+ * Resolve Symbol in a prelinked image
+ *
+ * @param pl the prelinked image (must be loaded)
+ * @param name the name of the symbol to resolve
+ * @param addr the resulting address if the symbol is found
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_prelink_resolve_symbol(struct bfelf_prelink_t *pl,
+                             struct e_string_t *name,
+                             void **addr);
+
+/******************************************************************************/
+/* ELF Compressed Module                                                      */
+/******************************************************************************/
+
+/*
+ * Compressed Module Magic ("BFELFLZ4") and Version
+ */
+#define BFELF_LZ4_MAGIC ((bfelf64_xword)0x345A4C464C454642)
+#define BFELF_LZ4_VERSION ((bfelf64_xword)1)
+
+/*
+ * Compressed Module Header
+ *
+ * A compressed module is created by bfm (see --compress), and wraps an ELF
+ * file that has been split into blocks of block_size bytes (the last block
+ * may be smaller), each of which is compressed on its own using the LZ4
+ * block format. Since the blocks do not reference each other, a compressed
+ * module can be decompressed one block at a time, using a single block
+ * sized buffer.
+ *
+ * Each block is stored as a 32bit little endian size, followed by that
+ * many bytes of block data. If BFELF_LZ4_BLOCK_RAW is set in the size,
+ * the block could not be compressed, and is stored as is.
+ */
+struct bfelf_lz4_hdr
+{
+    bfelf64_xword magic;
+    bfelf64_xword version;
+    bfelf64_xword fsize;
+    bfelf64_xword block_size;
+};
+
+#define BFELF_LZ4_BLOCK_RAW ((bfelf64_word)0x80000000)
+
+/*
+ * Compressed Module
+ *
+ * The following is used by this API to store information about a
+ * compressed module that is being decompressed.
+ */
+struct bfelf_lz4_t
+{
+    char *file;
+    bfelf64_xword fsize;
+    bfelf64_xword offset;
+
+    bfelf64_xword usize;
+    bfelf64_xword uoffset;
+    bfelf64_xword block_size;
+
+    char block[BFELF_LZ4_MAX_BLOCK_SIZE];
+};
+
+/**
+ * Is Compressed
+ *
+ * @param file a character buffer containing the contents of a module
+ * @param fsize the size of the character buffer
+ * @return BFELF_TRUE if the module is a compressed module, BFELF_FALSE
+ *     otherwise
+ */
+bfelf64_sword
+bfelf_is_compressed(char *file, bfelf64_sword fsize);
+
+/**
+ * Decompress an LZ4 block
+ *
+ * Decompresses a single block that was compressed using the LZ4 block
+ * format. Every length and offset in the block is checked, so a corrupt
+ * block results in an error, and never in a read or write outside of the
+ * buffers that are provided.
+ *
+ * @param src the compressed block
+ * @param slen the size of the compressed block
+ * @param dst the buffer to decompress the block into
+ * @param dlen the size of dst
+ * @return the number of bytes written to dst, negative on error
+ */
+bfelf64_sword
+bfelf_lz4_decompress(const char *src,
+                     bfelf64_sword slen,
+                     char *dst,
+                     bfelf64_sword dlen);
+
+/**
+ * Initialize a compressed module
+ *
+ * Validates the compressed module's header. The buffer containing the
+ * compressed module must remain valid until it has been read.
+ *
+ * @param lz the compressed module structure to initialize
+ * @param file a character buffer containing the compressed module
+ * @param fsize the size of the character buffer
+ * @return BFELF_SUCCESS on success, negative on error
+ */
+bfelf64_sword
+bfelf_lz4_init(struct bfelf_lz4_t *lz, char *file, bfelf64_sword fsize);
+
+/**
+ * Compressed Module Size
+ *
+ * @param lz the compressed module
+ * @return the size of the ELF file once it has been decompressed,
+ *     negative on error
+ */
+bfelf64_sword
+bfelf_lz4_size(struct bfelf_lz4_t *lz);
+
+/**
+ * Read a compressed module
+ *
+ * Decompresses the next block of the compressed module. The block can be
+ * handed straight to bfelf_stream_write, so that the ELF file is loaded
+ * without ever being decompressed in full.
+ *
+ * @param lz the compressed module
+ * @param buf the resulting block, which remains valid until the next
+ *     call to this function
+ * @return the size of the block, 0 once every block has been read,
+ *     negative on error
+ */
+bfelf64_sword
+bfelf_lz4_read(struct bfelf_lz4_t *lz, char **buf);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,390 @@
+//
+// Bareflank Hypervisor
+//
+// Copyright (C) 2015 Assured Information Security, Inc.
+// Author: Rian Quinn        <quinnr@ainfosec.com>
+// Author: Brendan Kerrigan  <kerriganb@ainfosec.com>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <bfelf_loader.h>
+
+// -----------------------------------------------------------------------------
+// Overview
+// -----------------------------------------------------------------------------
+
+// The prelinker takes the same list of modules that is given to bfm, and
+// produces a single prelinked image (see bfelf_prelink_hdr) that the driver
+// can load without having to parse or relocate any ELF files.
+//
+// The modules are laid out one after another (page aligned, just like they
+// would be if each module was given its own RWE memory), and then loaded and
+// relocated by the ELF loader twice, at two different base addresses. Any
+// 64bit word that differs between the two images by exactly the distance
+// between the two base addresses, and that points into the image, is an
+// absolute address and is recorded in the fixup table. Any other difference
+// is a relocation that cannot be expressed as a base delta, and is an error.
+
+#define PAGE_SIZE 0x1000
+
+struct image
+{
+    char *buf;
+    uint64_t size;
+
+    std::unique_ptr<bfelf_loader_t> loader;
+    std::vector<bfelf_file_t> efs;
+    std::vector<char> symtab;
+
+    image() : buf(nullptr), size(0) {}
+    ~image() { free(buf); }
+};
+
+static std::vector<std::string>
+read_module_list(const std::string &filename)
+{
+    std::string line;
+    std::vector<std::string> modules;
+    std::ifstream ifs(filename);
+
+    while (std::getline(ifs, line))
+    {
+        if (!line.empty())
+            modules.push_back(line);
+    }
+
+    return modules;
+}
+
+static bool
+read_file(const std::string &filename, std::vector<char> &contents)
+{
+    std::ifstream ifs(filename, std::ifstream::binary);
+
+    if (ifs.is_open() == false)
+        return false;
+
+    contents.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    return contents.empty() == false;
+}
+
+static bool
+load_image(std::vector<std::vector<char>> &files,
+           const std::vector<uint64_t> &offsets,
+           uint64_t size,
+           image &img)
+{
+    bfelf64_sword ret;
+
+    if (posix_memalign((void **)&img.buf, PAGE_SIZE, size) != 0)
+    {
+        std::cerr << "error: out of memory" << std::endl;
+        return false;
+    }
+
+    img.size = size;
+    img.loader = std::make_unique<bfelf_loader_t>();
+    img.efs.resize(files.size());
+
+    for (auto i = 0U; i < size; i++)
+        img.buf[i] = 0;
+
+    if ((ret = bfelf_loader_init(img.loader.get())) != BFELF_SUCCESS)
+    {
+        std::cerr << "error: bfelf_loader_init failed: " << bfelf_error(ret) << std::endl;
+        return false;
+    }
+
+    // An IFUNC's resolver picks an implementation for the CPU that it runs
+    // on, which would be the host's, so a module that uses IFUNCs cannot be
+    // prelinked.
+
+    img.loader->no_ifunc = BFELF_TRUE;
+
+    for (auto i = 0U; i < files.size(); i++)
+    {
+        auto ef = &img.efs[i];
+        auto exec = img.buf + offsets[i];
+
+        if ((ret = bfelf_file_init(files[i].data(), files[i].size(), ef)) != BFELF_SUCCESS)
+        {
+            std::cerr << "error: bfelf_file_init failed: " << bfelf_error(ret) << std::endl;
+            return false;
+        }
+
+        if ((ret = bfelf_file_load(ef, exec, bfelf_total_exec_size(ef))) != BFELF_SUCCESS)
+        {
+            std::cerr << "error: bfelf_file_load failed: " << bfelf_error(ret) << std::endl;
+            return false;
+        }
+
+        if ((ret = bfelf_loader_add(img.loader.get(), ef)) != BFELF_SUCCESS)
+        {
+            std::cerr << "error: bfelf_loader_add failed: " << bfelf_error(ret) << std::endl;
+            return false;
+        }
+    }
+
+    img.symtab.resize(bfelf_loader_symtab_size(img.loader.get(), nullptr));
+
+    if ((ret = bfelf_loader_set_symtab(img.loader.get(), img.symtab.data(), img.symtab.size())) != BFELF_SUCCESS)
+    {
+        std::cerr << "error: bfelf_loader_set_symtab failed: " << bfelf_error(ret) << std::endl;
+        return false;
+    }
+
+    if ((ret = bfelf_loader_relocate(img.loader.get())) != BFELF_SUCCESS)
+    {
+        std::cerr << "error: bfelf_loader_relocate failed: " << bfelf_error(ret) << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+find_fixups(image &a, const image &b, std::vector<uint64_t> &fixups)
+{
+    auto abase = reinterpret_cast<uint64_t>(a.buf);
+    auto bbase = reinterpret_cast<uint64_t>(b.buf);
+
+    auto wa = reinterpret_cast<uint64_t *>(a.buf);
+    auto wb = reinterpret_cast<uint64_t *>(b.buf);
+
+    for (auto i = 0U; i < a.size / sizeof(uint64_t); i++)
+    {
+        if (wa[i] == wb[i])
+            continue;
+
+        if (wb[i] - wa[i] != bbase - abase ||
+            wa[i] - abase > a.size)
+        {
+            auto offset = i * sizeof(uint64_t);
+
+            std::cerr << "error: relocation at offset 0x" << std::hex << offset
+                      << std::dec << " cannot be prelinked" << std::endl;
+            return false;
+        }
+
+        wa[i] -= abase;
+        fixups.push_back(i * sizeof(uint64_t));
+    }
+
+    return true;
+}
+
+static std::vector<bfelf64_xword>
+encode_fixups(const std::vector<uint64_t> &fixups)
+{
+    std::vector<bfelf64_xword> relr;
+
+    for (auto i = 0U; i < fixups.size();)
+    {
+        uint64_t where = fixups[i++];
+
+        relr.push_back(where);
+        where += sizeof(uint64_t);
+
+        while (true)
+        {
+            bfelf64_xword bitmap = 0;
+
+            for (; i < fixups.size() && fixups[i] - where < 63 * sizeof(uint64_t); i++)
+                bitmap |= 1ULL << ((fixups[i] - where) / sizeof(uint64_t));
+
+            if (bitmap == 0)
+                break;
+
+            relr.push_back((bitmap << 1) | 1);
+            where += 63 * sizeof(uint64_t);
+        }
+    }
+
+    return relr;
+}
+
+static bool
+collect_symbols(const image &img,
+                std::vector<bfelf_prelink_sym> &syms,
+                std::string &strtab)
+{
+    auto symtab = img.loader->symtab;
+
+    for (auto i = 0; i < symtab->size; i++)
+    {
+        e_string_t str = {0};
+        bfelf_prelink_sym sym = {0};
+        auto gsym = &symtab->tab[i];
+
+        if (gsym->sym == 0)
+            continue;
+
+        auto ret = bfelf_symbol_name(gsym->ef, gsym->sym, &str);
+        if (ret != BFELF_SUCCESS)
+        {
+            std::cerr << "error: bfelf_symbol_name failed: " << bfelf_error(ret) << std::endl;
+            return false;
+        }
+
+        sym.st_name = strtab.size();
+        sym.st_value = static_cast<bfelf64_xword>(gsym->ef->exec + gsym->sym->st_value - img.buf);
+
+        strtab.append(str.buf, str.len);
+        strtab.push_back('\0');
+
+        syms.push_back(sym);
+    }
+
+    return true;
+}
+
+static uint64_t
+align(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static bool
+write_image(const std::string &filename,
+            const image &img,
+            const std::vector<bfelf64_xword> &relr,
+            const std::vector<bfelf_prelink_sym> &syms,
+            const std::string &strtab)
+{
+    bfelf_prelink_hdr hdr = {0};
+    std::ofstream ofs(filename, std::ofstream::binary | std::ofstream::trunc);
+
+    if (ofs.is_open() == false)
+    {
+        std::cerr << "error: unable to open " << filename << std::endl;
+        return false;
+    }
+
+    // Whatever is left at the end of the image once it has been relocated
+    // is .bss (and padding), which the driver zeros.
+
+    auto image_size = img.size;
+    while (image_size > 0 && img.buf[image_size - 1] == 0)
+        image_size--;
+
+    hdr.magic = BFELF_PRELINK_MAGIC;
+    hdr.version = BFELF_PRELINK_VERSION;
+    hdr.image_offset = align(sizeof(hdr), sizeof(uint64_t));
+    hdr.image_size = image_size;
+    hdr.exec_size = img.size;
+    hdr.fixup_offset = align(hdr.image_offset + hdr.image_size, sizeof(uint64_t));
+    hdr.fixup_num = relr.size();
+    hdr.sym_offset = hdr.fixup_offset + hdr.fixup_num * sizeof(bfelf64_xword);
+    hdr.sym_num = syms.size();
+    hdr.str_offset = hdr.sym_offset + hdr.sym_num * sizeof(bfelf_prelink_sym);
+    hdr.str_size = strtab.size();
+
+    std::vector<char> file(hdr.str_offset + hdr.str_size, 0);
+
+    std::copy_n(reinterpret_cast<const char *>(&hdr), sizeof(hdr), &file[0]);
+    std::copy_n(img.buf, hdr.image_size, &file[hdr.image_offset]);
+    std::copy_n(reinterpret_cast<const char *>(relr.data()), hdr.fixup_num * sizeof(bfelf64_xword), &file[hdr.fixup_offset]);
+    std::copy_n(reinterpret_cast<const char *>(syms.data()), hdr.sym_num * sizeof(bfelf_prelink_sym), &file[hdr.sym_offset]);
+    std::copy_n(strtab.data(), hdr.str_size, &file[hdr.str_offset]);
+
+    ofs.write(file.data(), file.size());
+    return ofs.good();
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc != 3)
+    {
+        std::cout << "Usage: bfprelink list_of_modules output" << std::endl;
+        std::cout << std::endl;
+        std::cout << "Loads and relocates the modules in list_of_modules into a single" << std::endl;
+        std::cout << "prelinked image that can be given to bfm in place of the modules." << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    auto modules = read_module_list(argv[1]);
+    if (modules.empty() == true)
+    {
+        std::cerr << "error: the list of modules is empty or does not exist" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    uint64_t size = 0;
+    std::vector<uint64_t> offsets;
+    std::vector<std::vector<char>> files(modules.size());
+
+    for (auto i = 0U; i < modules.size(); i++)
+    {
+        bfelf_file_t ef;
+
+        if (read_file(modules[i], files[i]) == false)
+        {
+            std::cerr << "error: unable to read " << modules[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        auto ret = bfelf_file_init(files[i].data(), files[i].size(), &ef);
+        if (ret != BFELF_SUCCESS)
+        {
+            std::cerr << "error: " << modules[i] << ": " << bfelf_error(ret) << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        offsets.push_back(align(size, PAGE_SIZE));
+        size = offsets.back() + bfelf_total_exec_size(&ef);
+    }
+
+    size = align(size, sizeof(uint64_t));
+
+    image a;
+    image b;
+    std::string strtab;
+    std::vector<uint64_t> fixups;
+    std::vector<bfelf_prelink_sym> syms;
+
+    if (load_image(files, offsets, size, a) == false ||
+        load_image(files, offsets, size, b) == false)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (collect_symbols(a, syms, strtab) == false)
+        return EXIT_FAILURE;
+
+    if (find_fixups(a, b, fixups) == false)
+        return EXIT_FAILURE;
+
+    if (write_image(argv[2], a, encode_fixups(fixups), syms, strtab) == false)
+    {
+        std::cerr << "error: unable to write " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "prelinked " << modules.size() << " modules: "
+              << size << " bytes, " << fixups.size() << " fixups, "
+              << syms.size() << " symbols" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -41,10 +41,68 @@
 #define ALERT(...)
 #endif
 
+/******************************************************************************/
+/* Atomics                                                                    */
+/******************************************************************************/
+
+/*
+ * Everything that is shared between CPUs goes through these. Without the
+ * GCC builtins, the loader falls back to plain loads and stores, which is
+ * only correct if the modules are not relocated on more than one CPU.
+ */
+
+#if defined(__GNUC__)
+#define BFELF_ATOMIC_ADD(ptr, value) __atomic_fetch_add((ptr), (value), __ATOMIC_RELAXED)
+#define BFELF_ATOMIC_STORE(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#define BFELF_ATOMIC_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#else
+#define BFELF_ATOMIC_ADD(ptr, value) (*(ptr) += (value))
+#define BFELF_ATOMIC_STORE(ptr, value) (*(ptr) = (value))
+#define BFELF_ATOMIC_LOAD(ptr) (*(ptr))
+#endif
+
+/******************************************************************************/
+/* ELF Loader Statistics                                                      */
+/******************************************************************************/
+
+struct bfelf_stats_t *g_bfelf_stats = 0;
+
+#define BFELF_STATS_ADD(field, value) \
+    do { if (g_bfelf_stats != 0) BFELF_ATOMIC_ADD(&g_bfelf_stats->field, (value)); } while (0)
+
+bfelf64_sword
+bfelf_stats_init(struct bfelf_stats_t *stats, bfelf_timestamp_t timestamp)
+{
+    struct bfelf_stats_t blank = {0};
+
+    g_bfelf_stats = stats;
+
+    if (stats == 0)
+        return BFELF_SUCCESS;
+
+    *stats = blank;
+    stats->timestamp = timestamp;
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_xword
+bfelf_stats_time(void)
+{
+    if (g_bfelf_stats == 0 || g_bfelf_stats->timestamp == 0)
+        return 0;
+
+    return g_bfelf_stats->timestamp();
+}
+
 /******************************************************************************/
 /* ELF Helpers                                                                */
 /******************************************************************************/
 
+#if defined(__GNUC__) && defined(__x86_64__)
+typedef bfelf64_xword bfelf_unaligned_xword __attribute__((may_alias, aligned(1)));
+#endif
+
 bfelf64_sword
 bfelf_strcmp(struct e_string_t *str1, struct e_string_t *str2)
 {
@@ -53,10 +111,38 @@ bfelf_strcmp(struct e_string_t *str1, struct e_string_t *str2)
     if (!str1 || !str2)
         return BFELF_ERROR_INVALID_ARG;
 
+    BFELF_STATS_ADD(strcmps, 1);
+
     if (str1->len != str2->len)
         return BFELF_FALSE;
 
-    for (i = 0; i < str1->len && i < str2->len; i++)
+    if (str1->hash != 0 && str2->hash != 0 && str1->hash != str2->hash)
+        return BFELF_FALSE;
+
+#if defined(__GNUC__) && defined(__x86_64__)
+
+    /*
+     * Compare a word at a time while the words are equal, and hand the word
+     * that differs (and the tail) to the byte loop below so that a NULL
+     * before the first difference is still reported as an invalid string.
+     * The subtraction trick is non-zero only if one of the bytes is zero.
+     */
+
+    for (; i + 8 <= str1->len; i += 8)
+    {
+        bfelf64_xword w1 = *(const bfelf_unaligned_xword *)(str1->buf + i);
+        bfelf64_xword w2 = *(const bfelf_unaligned_xword *)(str2->buf + i);
+
+        if (w1 != w2)
+            break;
+
+        if (((w1 - 0x0101010101010101ULL) & ~w1 & 0x8080808080808080ULL) != 0)
+            return BFELF_ERROR_INVALID_STRING;
+    }
+
+#endif
+
+    for (; i < str1->len && i < str2->len; i++)
     {
         if (str1->buf[i] != str2->buf[i])
             return BFELF_FALSE;
@@ -71,6 +157,441 @@ bfelf_strcmp(struct e_string_t *str1, struct e_string_t *str2)
     return BFELF_TRUE;
 }
 
+void
+bfelf_memcpy(char *dst, const char *src, bfelf64_xword num)
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+
+    bfelf64_xword words = num >> 3;
+    bfelf64_xword bytes = num & 7;
+
+    __asm__ __volatile__(
+        "rep movsq\n"
+        "mov %3, %%rcx\n"
+        "rep movsb\n"
+        : "+D"(dst), "+S"(src), "+c"(words)
+        : "r"(bytes)
+        : "memory");
+
+#else
+
+    bfelf64_xword i = 0;
+    bfelf64_xword *wdst = (bfelf64_xword *)dst;
+    const bfelf64_xword *wsrc = (const bfelf64_xword *)src;
+
+    if ((((bfelf64_addr)dst | (bfelf64_addr)src) & 7) == 0)
+    {
+        for (; i + 8 <= num; i += 8)
+            wdst[i >> 3] = wsrc[i >> 3];
+    }
+
+    for (; i < num; i++)
+        dst[i] = src[i];
+
+#endif
+}
+
+void
+bfelf_memclr(char *dst, bfelf64_xword num)
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+
+    bfelf64_xword words = num >> 3;
+    bfelf64_xword bytes = num & 7;
+
+    __asm__ __volatile__(
+        "xor %%eax, %%eax\n"
+        "rep stosq\n"
+        "mov %2, %%rcx\n"
+        "rep stosb\n"
+        : "+D"(dst), "+c"(words)
+        : "r"(bytes)
+        : "rax", "memory");
+
+#else
+
+    bfelf64_xword i = 0;
+    bfelf64_xword *wdst = (bfelf64_xword *)dst;
+
+    if (((bfelf64_addr)dst & 7) == 0)
+    {
+        for (; i + 8 <= num; i += 8)
+            wdst[i >> 3] = 0;
+    }
+
+    for (; i < num; i++)
+        dst[i] = 0;
+
+#endif
+}
+
+bfelf64_word
+bfelf_hash(struct e_string_t *str)
+{
+    bfelf64_sword i = 0;
+    bfelf64_word g = 0;
+    bfelf64_word h = 0;
+
+    for (i = 0; i < str->len; i++)
+    {
+        h = (h << 4) + (unsigned char)str->buf[i];
+
+        if ((g = h & 0xF0000000) != 0)
+            h ^= g >> 24;
+
+        h &= ~g;
+    }
+
+    return h;
+}
+
+bfelf64_word
+bfelf_gnu_hash(struct e_string_t *str)
+{
+    bfelf64_sword i = 0;
+    bfelf64_word h = 5381;
+
+    for (i = 0; i < str->len; i++)
+        h = (h << 5) + h + (unsigned char)str->buf[i];
+
+    return h;
+}
+
+bfelf64_word
+bfelf_string_hash(struct e_string_t *str)
+{
+    if (str->hash == 0)
+        str->hash = bfelf_gnu_hash(str);
+
+    return str->hash;
+}
+
+/*
+ * Compares a symbol's name with a string, reading only the string's length
+ * (plus the NULL) from the dynamic string table instead of first scanning
+ * for the end of the symbol's name. If what is left of the table is too
+ * small for that, this falls back to bfelf_symbol_name so that a string
+ * table that is not NULL terminated is still reported.
+ */
+bfelf64_sword
+bfelf_symbol_name_matches(struct bfelf_file_t *ef,
+                          struct bfelf_sym *sym,
+                          struct e_string_t *name)
+{
+    bfelf64_sword ret = 0;
+    struct e_string_t str = {0};
+
+    if (sym->st_name > ef->dynstrsz)
+        return BFELF_ERROR_INVALID_OFFSET;
+
+    if ((bfelf64_xword)name->len >= ef->dynstrsz - sym->st_name)
+    {
+        ret = bfelf_symbol_name(ef, sym, &str);
+        if (ret != BFELF_SUCCESS)
+            return ret;
+
+        return bfelf_strcmp(name, &str);
+    }
+
+    str.buf = ef->dynstr + sym->st_name;
+    str.len = name->len;
+
+    ret = bfelf_strcmp(name, &str);
+    if (ret != BFELF_TRUE)
+        return ret;
+
+    return str.buf[str.len] == 0 ? BFELF_TRUE : BFELF_FALSE;
+}
+
+char *
+bfelf_section_data(struct bfelf_file_t *ef, struct bfelf_shdr *shdr)
+{
+    if (ef->file != 0)
+        return ef->file + shdr->sh_offset;
+
+    /*
+     * The file was streamed (see bfelf_stream_init), or detached (see
+     * bfelf_file_detach), so only the loaded image, and the part of the
+     * file that was kept in the tail, are available.
+     */
+
+    if ((shdr->sh_flags & bfshf_alloc) != 0)
+    {
+        if (shdr->sh_addr + shdr->sh_size > (bfelf64_xword)ef->esize)
+            return 0;
+
+        return ef->exec + shdr->sh_addr;
+    }
+
+    if (ef->tail == 0 || shdr->sh_offset < ef->tail_offset)
+        return 0;
+
+    if (shdr->sh_offset + shdr->sh_size > ef->tail_offset + ef->tail_size)
+        return 0;
+
+    return ef->tail + (shdr->sh_offset - ef->tail_offset);
+}
+
+bfelf64_xword
+bfelf_vaddr_avail(struct bfelf_file_t *ef, bfelf64_addr vaddr)
+{
+    bfelf64_word i = 0;
+
+    if (ef->file == 0)
+        return vaddr < (bfelf64_xword)ef->esize ? ef->esize - vaddr : 0;
+
+    for (i = 0; i < ef->ehdr->e_phnum; i++)
+    {
+        struct bfelf_phdr *phdr = &(ef->phdrtab[i]);
+
+        if (phdr->p_type != bfpt_load)
+            continue;
+
+        if (vaddr >= phdr->p_vaddr && vaddr < phdr->p_vaddr + phdr->p_filesz)
+            return phdr->p_vaddr + phdr->p_filesz - vaddr;
+    }
+
+    return 0;
+}
+
+char *
+bfelf_vaddr_data(struct bfelf_file_t *ef, bfelf64_addr vaddr, bfelf64_xword size)
+{
+    bfelf64_word i = 0;
+
+    if (vaddr == 0 || size > bfelf_vaddr_avail(ef, vaddr))
+        return 0;
+
+    if (ef->file == 0)
+        return ef->exec + vaddr;
+
+    for (i = 0; i < ef->ehdr->e_phnum; i++)
+    {
+        struct bfelf_phdr *phdr = &(ef->phdrtab[i]);
+
+        if (phdr->p_type != bfpt_load)
+            continue;
+
+        if (vaddr >= phdr->p_vaddr && vaddr < phdr->p_vaddr + phdr->p_filesz)
+            return ef->file + phdr->p_offset + (vaddr - phdr->p_vaddr);
+    }
+
+    return 0;
+}
+
+bfelf64_sword
+bfelf_hash_table_init(struct bfelf_file_t *ef,
+                      bfelf64_word *tab,
+                      bfelf64_xword tabsize)
+{
+    bfelf64_xword size = 0;
+
+    if (tabsize < 2 * sizeof(bfelf64_word))
+        return BFELF_ERROR_INVALID_SH_SIZE;
+
+    if (tab == 0)
+        return BFELF_ERROR_INVALID_SH_OFFSET;
+
+    size = 2 + (bfelf64_xword)tab[0] + (bfelf64_xword)tab[1];
+
+    if (tab[0] == 0 || size * sizeof(bfelf64_word) > tabsize)
+        return BFELF_ERROR_INVALID_SH_SIZE;
+
+    ef->hashtab.nbucket = tab[0];
+    ef->hashtab.nchain = tab[1];
+    ef->hashtab.bucket = &(tab[2]);
+    ef->hashtab.chain = &(tab[2 + tab[0]]);
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_gnu_hash_table_init(struct bfelf_file_t *ef,
+                          bfelf64_word *tab,
+                          bfelf64_xword tabsize)
+{
+    bfelf64_xword size = 0;
+
+    if (tabsize < 4 * sizeof(bfelf64_word))
+        return BFELF_ERROR_INVALID_SH_SIZE;
+
+    if (tab == 0)
+        return BFELF_ERROR_INVALID_SH_OFFSET;
+
+    if (tab[0] == 0 || tab[2] == 0 || (tab[2] & (tab[2] - 1)) != 0)
+        return BFELF_ERROR_INVALID_SH_SIZE;
+
+    size = 4 * sizeof(bfelf64_word);
+    size += (bfelf64_xword)tab[2] * sizeof(bfelf64_xword);
+    size += (bfelf64_xword)tab[0] * sizeof(bfelf64_word);
+
+    if (size > tabsize)
+        return BFELF_ERROR_INVALID_SH_SIZE;
+
+    if (tab[1] > ef->symnum)
+        return BFELF_ERROR_INVALID_INDEX;
+
+    ef->gnuhashtab.nbucket = tab[0];
+    ef->gnuhashtab.symoffset = tab[1];
+    ef->gnuhashtab.bloom_size = tab[2];
+    ef->gnuhashtab.bloom_shift = tab[3];
+    ef->gnuhashtab.bloom = (bfelf64_xword *)(tab + 4);
+    ef->gnuhashtab.bucket = (bfelf64_word *)(ef->gnuhashtab.bloom + tab[2]);
+    ef->gnuhashtab.chain = &(ef->gnuhashtab.bucket[tab[0]]);
+    ef->gnuhashtab.nchain = (tabsize - size) / sizeof(bfelf64_word);
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_gnu_hash_symnum(struct bfelf_file_t *ef)
+{
+    bfelf64_word i = 0;
+    bfelf64_word max = 0;
+    struct bfgnuhashtab_t *tab = &(ef->gnuhashtab);
+
+    /*
+     * DT_GNU_HASH does not say how many symbols there are, so like a
+     * dynamic loader, the number of symbols is found by starting at the
+     * highest symbol index in the buckets, and walking its chain to the end.
+     */
+
+    for (i = 0; i < tab->nbucket; i++)
+    {
+        if (tab->bucket[i] > max)
+            max = tab->bucket[i];
+    }
+
+    if (max < tab->symoffset)
+        return tab->symoffset;
+
+    for (; max - tab->symoffset < tab->nchain; max++)
+    {
+        if ((tab->chain[max - tab->symoffset] & 1) != 0)
+            return max + 1;
+    }
+
+    return BFELF_ERROR_INVALID_SH_SIZE;
+}
+
+void
+bfelf_relative_init(struct bfrelatab_t *relatab, bfelf64_sword max)
+{
+    bfelf64_sword i = 0;
+
+    if (max > relatab->num)
+        max = relatab->num;
+
+    for (i = 0; i < max; i++)
+    {
+        if (BFELF_REL_TYPE(relatab->tab[i].r_info) != BFR_X86_64_RELATIVE)
+            break;
+    }
+
+    relatab->num_relative = i;
+}
+
+void
+bfelf_dynamic_init(struct bfelf_file_t *ef,
+                   struct bfelf_dyn *dyn,
+                   bfelf64_xword num)
+{
+    bfelf64_xword i = 0;
+
+    for (i = 0; i < num && dyn[i].d_tag != bfdt_null; i++)
+    {
+        switch (dyn[i].d_tag)
+        {
+            case bfdt_symtab:
+                ef->dynsymtab = dyn[i].d_val;
+                break;
+
+            case bfdt_strtab:
+                ef->dynstrtab = dyn[i].d_val;
+                break;
+
+            case bfdt_strsz:
+                ef->dynstrsz = dyn[i].d_val;
+                break;
+
+            case bfdt_hash:
+                ef->hash = dyn[i].d_val;
+                break;
+
+            case bfdt_gnu_hash:
+                ef->gnu_hash = dyn[i].d_val;
+                break;
+
+            case bfdt_rel:
+                ef->rel = dyn[i].d_val;
+                break;
+
+            case bfdt_relsz:
+                ef->relnum = dyn[i].d_val / sizeof(struct bfelf_rel);
+                break;
+
+            case bfdt_rela:
+                ef->rela = dyn[i].d_val;
+                break;
+
+            case bfdt_relasz:
+                ef->relanum = dyn[i].d_val / sizeof(struct bfelf_rela);
+                break;
+
+            case bfdt_relacount:
+                ef->relacount = dyn[i].d_val;
+                break;
+
+            case bfdt_relr:
+                ef->relr = dyn[i].d_val;
+                break;
+
+            case bfdt_relrsz:
+                ef->relrnum = dyn[i].d_val / sizeof(bfelf64_xword);
+                break;
+
+            case bfdt_pltgot:
+                ef->pltgot = dyn[i].d_val;
+                break;
+
+            case bfdt_jmprel:
+                ef->jmprel = dyn[i].d_val;
+                break;
+
+            case bfdt_pltrelsz:
+                ef->jmprelnum = dyn[i].d_val / sizeof(struct bfelf_rela);
+                break;
+
+            case bfdt_pltrel:
+                ef->pltrel = dyn[i].d_val;
+                break;
+
+            case bfdt_symbolic:
+                ef->symbolic = BFELF_TRUE;
+                break;
+
+            case bfdt_bind_now:
+                ef->bind_now = BFELF_TRUE;
+                break;
+
+            case bfdt_flags:
+                if ((dyn[i].d_val & bfdf_bind_now) != 0)
+                    ef->bind_now = BFELF_TRUE;
+                if ((dyn[i].d_val & bfdf_symbolic) != 0)
+                    ef->symbolic = BFELF_TRUE;
+                break;
+
+            case bfdt_flags_1:
+                if ((dyn[i].d_val & bfdf_1_now) != 0)
+                    ef->bind_now = BFELF_TRUE;
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
 /******************************************************************************/
 /* ELF Error Codes                                                            */
 /******************************************************************************/
@@ -125,9 +646,14 @@ const char *BFELF_ERROR_INVALID_PH_ALIGN_STR = "Invalid segment alignment (BFELF
 const char *BFELF_ERROR_INVALID_STRING_TABLE_STR = "Invalid string table (BFELF_ERROR_INVALID_STRING_TABLE)";
 const char *BFELF_ERROR_NO_SUCH_SYMBOL_STR = "Unable to find symbol (BFELF_ERROR_NO_SUCH_SYMBOL)";
 const char *BFELF_ERROR_SYMBOL_UNDEFINED_STR = "Symbol is undefined (BFELF_ERROR_SYMBOL_UNDEFINED)";
+const char *BFELF_ERROR_DUPLICATE_SYMBOL_STR = "Symbol is defined more than once (BFELF_ERROR_DUPLICATE_SYMBOL)";
 const char *BFELF_ERROR_LOADER_FULL_STR = "Loader is full (BFELF_ERROR_LOADER_FULL_STR)";
 const char *BFELF_ERROR_INVALID_LOADER_STR = "Invalid loader (BFELF_ERROR_INVALID_LOADER)";
+const char *BFELF_ERROR_NOT_RELOCATED_STR = "ELF file not relocated (BFELF_ERROR_NOT_RELOCATED)";
 const char *BFELF_ERROR_INVALID_RELOCATION_TYPE_STR = "Invalid relocation type (BFELF_ERROR_INVALID_RELOCATION_TYPE)";
+const char *BFELF_ERROR_IFUNC_DISABLED_STR = "IFUNCs are disabled (BFELF_ERROR_IFUNC_DISABLED)";
+const char *BFELF_ERROR_INVALID_PRELINK_STR = "Invalid prelinked image (BFELF_ERROR_INVALID_PRELINK)";
+const char *BFELF_ERROR_INVALID_COMPRESSED_STR = "Invalid compressed module (BFELF_ERROR_INVALID_COMPRESSED)";
 
 const char *
 bfelf_error(bfelf64_sword value)
@@ -184,8 +710,14 @@ bfelf_error(bfelf64_sword value)
         case BFELF_ERROR_INVALID_STRING_TABLE: return BFELF_ERROR_INVALID_STRING_TABLE_STR;
         case BFELF_ERROR_NO_SUCH_SYMBOL: return BFELF_ERROR_NO_SUCH_SYMBOL_STR;
         case BFELF_ERROR_SYMBOL_UNDEFINED: return BFELF_ERROR_SYMBOL_UNDEFINED_STR;
+        case BFELF_ERROR_DUPLICATE_SYMBOL: return BFELF_ERROR_DUPLICATE_SYMBOL_STR;
         case BFELF_ERROR_LOADER_FULL: return BFELF_ERROR_LOADER_FULL_STR;
         case BFELF_ERROR_INVALID_LOADER: return BFELF_ERROR_INVALID_LOADER_STR;
+        case BFELF_ERROR_NOT_RELOCATED: return BFELF_ERROR_NOT_RELOCATED_STR;
+        case BFELF_ERROR_INVALID_RELOCATION_TYPE: return BFELF_ERROR_INVALID_RELOCATION_TYPE_STR;
+        case BFELF_ERROR_IFUNC_DISABLED: return BFELF_ERROR_IFUNC_DISABLED_STR;
+        case BFELF_ERROR_INVALID_PRELINK: return BFELF_ERROR_INVALID_PRELINK_STR;
+        case BFELF_ERROR_INVALID_COMPRESSED: return BFELF_ERROR_INVALID_COMPRESSED_STR;
         default: return "Undefined";
     }
 }
@@ -195,131 +727,101 @@ bfelf_error(bfelf64_sword value)
 /******************************************************************************/
 
 bfelf64_sword
-bfelf_file_init(char *file, bfelf64_sword fsize, struct bfelf_file_t *ef)
+bfelf_file_check_ehdr(struct bfelf64_ehdr *ehdr, bfelf64_sword fsize)
 {
-    bfelf64_word i = 0;
-    bfelf64_sword ret = 0;
-    struct bfelf_shdr *dynsym = 0;
-    struct bfelf_shdr *strtab = 0;
-    struct bfelf_shdr *shstrtab = 0;
+    if (ehdr->e_ident[bfei_mag0] != 0x7F)
+        return BFELF_ERROR_INVALID_EI_MAG0;
 
-    if (!file || !ef)
-        return BFELF_ERROR_INVALID_ARG;
-
-    for (i = 0; i < sizeof(struct bfelf_file_t); i++)
-        ((char *)ef)[i] = 0;
-
-    if (fsize < sizeof(struct bfelf64_ehdr))
-        return BFELF_ERROR_INVALID_ARG;
-
-    ef->ehdr = (struct bfelf64_ehdr *)file;
-
-    if (ef->ehdr->e_ident[bfei_mag0] != 0x7F)
-        return BFELF_ERROR_INVALID_EI_MAG0;
-
-    if (ef->ehdr->e_ident[bfei_mag1] != 'E')
+    if (ehdr->e_ident[bfei_mag1] != 'E')
         return BFELF_ERROR_INVALID_EI_MAG1;
 
-    if (ef->ehdr->e_ident[bfei_mag2] != 'L')
+    if (ehdr->e_ident[bfei_mag2] != 'L')
         return BFELF_ERROR_INVALID_EI_MAG2;
 
-    if (ef->ehdr->e_ident[bfei_mag3] != 'F')
+    if (ehdr->e_ident[bfei_mag3] != 'F')
         return BFELF_ERROR_INVALID_EI_MAG3;
 
-    if (ef->ehdr->e_ident[bfei_class] != bfelfclass64)
+    if (ehdr->e_ident[bfei_class] != bfelfclass64)
         return BFELF_ERROR_INVALID_EI_CLASS;
 
-    if (ef->ehdr->e_ident[bfei_data] != bfelfdata2lsb)
+    if (ehdr->e_ident[bfei_data] != bfelfdata2lsb)
         return BFELF_ERROR_INVALID_EI_DATA;
 
-    if (ef->ehdr->e_ident[bfei_version] != bfev_current)
+    if (ehdr->e_ident[bfei_version] != bfev_current)
         return BFELF_ERROR_INVALID_EI_VERSION;
 
-    if (ef->ehdr->e_ident[bfei_osabi] != bfelfosabi_sysv)
+    if (ehdr->e_ident[bfei_osabi] != bfelfosabi_sysv)
         return BFELF_ERROR_INVALID_EI_OSABI;
 
-    if (ef->ehdr->e_ident[bfei_abiversion] != 0)
+    if (ehdr->e_ident[bfei_abiversion] != 0)
         return BFELF_ERROR_INVALID_EI_ABIVERSION;
 
-    if (ef->ehdr->e_type != bfet_dyn)
+    if (ehdr->e_type != bfet_dyn)
         return BFELF_ERROR_INVALID_E_TYPE;
 
-    if (ef->ehdr->e_machine != bfem_x86_64)
+    if (ehdr->e_machine != bfem_x86_64)
         return BFELF_ERROR_INVALID_E_MACHINE;
 
-    if (ef->ehdr->e_version != bfev_current)
+    if (ehdr->e_version != bfev_current)
         return BFELF_ERROR_INVALID_EI_VERSION;
 
-    if (ef->ehdr->e_entry <= 0 ||
-        ef->ehdr->e_entry >= fsize)
+    if (ehdr->e_entry <= 0 ||
+        ehdr->e_entry >= fsize)
     {
         return BFELF_ERROR_INVALID_E_ENTRY;
     }
 
-    if (ef->ehdr->e_phoff <= 0 ||
-        ef->ehdr->e_phoff >= fsize)
+    if (ehdr->e_phoff <= 0 ||
+        ehdr->e_phoff >= fsize)
     {
         return BFELF_ERROR_INVALID_E_PHOFF;
     }
 
-    if (ef->ehdr->e_shoff <= 0 ||
-        ef->ehdr->e_shoff >= fsize)
+    /*
+     * The section header table is optional (see bfelf_file_init), in which
+     * case both e_shoff and e_shnum are 0.
+     */
+
+    if (ehdr->e_shoff != 0 || ehdr->e_shnum != 0)
     {
-        return BFELF_ERROR_INVALID_E_SHOFF;
+        if (ehdr->e_shoff <= 0 ||
+            ehdr->e_shoff >= fsize)
+        {
+            return BFELF_ERROR_INVALID_E_SHOFF;
+        }
     }
 
-    if (ef->ehdr->e_flags != 0)
+    if (ehdr->e_flags != 0)
         return BFELF_ERROR_INVALID_E_FLAGS;
 
-    if (ef->ehdr->e_ehsize != sizeof(struct bfelf64_ehdr))
+    if (ehdr->e_ehsize != sizeof(struct bfelf64_ehdr))
         return BFELF_ERROR_INVALID_E_EHSIZE;
 
-    if (ef->ehdr->e_phentsize != sizeof(struct bfelf_phdr))
+    if (ehdr->e_phentsize != sizeof(struct bfelf_phdr))
         return BFELF_ERROR_INVALID_E_PHENTSIZE;
 
-    if (ef->ehdr->e_shentsize != sizeof(struct bfelf_shdr))
+    if (ehdr->e_shentsize != sizeof(struct bfelf_shdr))
         return BFELF_ERROR_INVALID_E_SHENTSIZE;
 
-    if (ef->ehdr->e_shstrndx >= ef->ehdr->e_shnum)
+    if (ehdr->e_shstrndx >= ehdr->e_shnum && ehdr->e_shstrndx != 0)
         return BFELF_ERROR_INVALID_E_SHSTRNDX;
 
-    if (ef->ehdr->e_shoff + (ef->ehdr->e_shentsize * ef->ehdr->e_shnum) > fsize)
+    if (ehdr->e_shoff + (ehdr->e_shentsize * ehdr->e_shnum) > fsize)
         return BFELF_ERROR_INVALID_SHT;
 
-    if (ef->ehdr->e_phoff + (ef->ehdr->e_phentsize * ef->ehdr->e_phnum) > fsize)
+    if (ehdr->e_phoff + (ehdr->e_phentsize * ehdr->e_phnum) > fsize)
         return BFELF_ERROR_INVALID_PHT;
 
-    ef->file = file;
-    ef->fsize = fsize;
-    ef->shdrtab = (struct bfelf_shdr *)(file + ef->ehdr->e_shoff);
-    ef->phdrtab = (struct bfelf_phdr *)(file + ef->ehdr->e_phoff);
-
-    for (i = 0; i < ef->ehdr->e_shnum; i++)
-    {
-        struct bfelf_shdr *shdr;
-
-        ret = bfelf_section_header(ef, i, &shdr);
-        if (ret != BFELF_SUCCESS)
-            return ret;
-
-        if (shdr->sh_offset + shdr->sh_size > ef->fsize)
-            return BFELF_ERROR_INVALID_SH_SIZE;
-    }
-
-    for (i = 0; i < ef->ehdr->e_phnum; i++)
-    {
-        struct bfelf_phdr *phdr;
-
-        ret = bfelf_program_header(ef, i, &phdr);
-        if (ret != BFELF_SUCCESS)
-            return ret;
-
-        if (phdr->p_offset + phdr->p_filesz > ef->fsize)
-            return BFELF_ERROR_INVALID_PH_FILESZ;
+    return BFELF_SUCCESS;
+}
 
-        if (phdr->p_filesz > phdr->p_memsz)
-            return BFELF_ERROR_INVALID_PH_FILESZ;
-    }
+bfelf64_sword
+bfelf_file_init_sections(struct bfelf_file_t *ef)
+{
+    bfelf64_word i = 0;
+    bfelf64_sword ret = 0;
+    struct bfelf_shdr *dynsym = 0;
+    struct bfelf_shdr *strtab = 0;
 
     for (i = 0; i < ef->ehdr->e_shnum; i++)
     {
@@ -346,19 +848,18 @@ bfelf_file_init(char *file, bfelf64_sword fsize, struct bfelf_file_t *ef)
     if (strtab->sh_type != bfsht_strtab)
         return BFELF_ERROR_INVALID_SH_TYPE;
 
-    ret = bfelf_section_header(ef, ef->ehdr->e_shstrndx, &shstrtab);
-    if (ret != BFELF_SUCCESS)
-        return ret;
-
-    if (shstrtab->sh_type != bfsht_strtab)
-        return BFELF_ERROR_INVALID_SH_TYPE;
-
     ef->dynsym = dynsym;
     ef->strtab = strtab;
-    ef->shstrtab = shstrtab;
+
+    ef->dynstrsz = strtab->sh_size;
+    ef->dynstr = bfelf_section_data(ef, strtab);
+    if (ef->dynstr == 0)
+        return BFELF_ERROR_INVALID_STRING_TABLE;
 
     ef->symnum = dynsym->sh_size / sizeof(struct bfelf_sym);
-    ef->symtab = (struct bfelf_sym *)(file + dynsym->sh_offset);
+    ef->symtab = (struct bfelf_sym *)bfelf_section_data(ef, dynsym);
+    if (ef->symtab == 0)
+        return BFELF_ERROR_INVALID_SH_OFFSET;
 
     for (i = 0; i < ef->ehdr->e_shnum; i++)
     {
@@ -368,19 +869,245 @@ bfelf_file_init(char *file, bfelf64_sword fsize, struct bfelf_file_t *ef)
         if (ret != BFELF_SUCCESS)
             return ret;
 
+        if ((shdr->sh_type == bfsht_rel && ef->num_rel >= BFELF_MAX_RELTAB) ||
+            (shdr->sh_type == bfsht_rela && ef->num_rela >= BFELF_MAX_RELTAB))
+        {
+            return BFELF_ERROR_INVALID_FILE;
+        }
+
         if (shdr->sh_type == bfsht_rel)
         {
             ef->bfreltab[ef->num_rel].num = shdr->sh_size / sizeof(struct bfelf_rel);
-            ef->bfreltab[ef->num_rel].tab = (struct bfelf_rel *)(ef->file + shdr->sh_offset);
+            ef->bfreltab[ef->num_rel].tab = (struct bfelf_rel *)bfelf_section_data(ef, shdr);
+
+            if (ef->bfreltab[ef->num_rel].tab == 0)
+                return BFELF_ERROR_INVALID_SH_OFFSET;
+
             ef->num_rel++;
         }
 
         if (shdr->sh_type == bfsht_rela)
         {
             ef->bfrelatab[ef->num_rela].num = shdr->sh_size / sizeof(struct bfelf_rela);
-            ef->bfrelatab[ef->num_rela].tab = (struct bfelf_rela *)(ef->file + shdr->sh_offset);
+            ef->bfrelatab[ef->num_rela].tab = (struct bfelf_rela *)bfelf_section_data(ef, shdr);
+
+            if (ef->bfrelatab[ef->num_rela].tab == 0)
+                return BFELF_ERROR_INVALID_SH_OFFSET;
+
+            if (shdr->sh_addr == ef->rela && ef->relacount != 0)
+                bfelf_relative_init(&(ef->bfrelatab[ef->num_rela]), ef->relacount);
+            else
+                bfelf_relative_init(&(ef->bfrelatab[ef->num_rela]), ef->bfrelatab[ef->num_rela].num);
+
             ef->num_rela++;
         }
+
+        if (shdr->sh_type == bfsht_hash || shdr->sh_type == bfsht_gnu_hash)
+        {
+            bfelf64_word *tab = (bfelf64_word *)bfelf_section_data(ef, shdr);
+
+            if (shdr->sh_link >= ef->ehdr->e_shnum ||
+                &(ef->shdrtab[shdr->sh_link]) != ef->dynsym)
+            {
+                return BFELF_ERROR_INVALID_SH_LINK;
+            }
+
+            if (shdr->sh_type == bfsht_hash)
+                ret = bfelf_hash_table_init(ef, tab, shdr->sh_size);
+            else
+                ret = bfelf_gnu_hash_table_init(ef, tab, shdr->sh_size);
+
+            if (ret != BFELF_SUCCESS)
+                return ret;
+        }
+    }
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_file_init_dynamic(struct bfelf_file_t *ef)
+{
+    bfelf64_sword ret = 0;
+    bfelf64_word *tab = 0;
+
+    /*
+     * The dynamic symbol table is the only table that the dynamic section
+     * does not provide a size for. Until the hash tables have been parsed,
+     * everything from DT_SYMTAB to the end of its segment is treated as the
+     * symbol table, which is then narrowed to the number of symbols that
+     * are in the hash table.
+     */
+
+    ef->symnum = bfelf_vaddr_avail(ef, ef->dynsymtab) / sizeof(struct bfelf_sym);
+
+    if (ef->hash != 0)
+    {
+        tab = (bfelf64_word *)bfelf_vaddr_data(ef, ef->hash, 2 * sizeof(bfelf64_word));
+
+        ret = bfelf_hash_table_init(ef, tab, bfelf_vaddr_avail(ef, ef->hash));
+        if (ret != BFELF_SUCCESS)
+            return ret;
+
+        if (ef->hashtab.nchain > ef->symnum)
+            return BFELF_ERROR_INVALID_INDEX;
+
+        ef->symnum = ef->hashtab.nchain;
+    }
+
+    if (ef->gnu_hash != 0)
+    {
+        tab = (bfelf64_word *)bfelf_vaddr_data(ef, ef->gnu_hash, 4 * sizeof(bfelf64_word));
+
+        ret = bfelf_gnu_hash_table_init(ef, tab, bfelf_vaddr_avail(ef, ef->gnu_hash));
+        if (ret != BFELF_SUCCESS)
+            return ret;
+
+        if (ef->hash == 0)
+        {
+            ret = bfelf_gnu_hash_symnum(ef);
+            if (ret < BFELF_SUCCESS)
+                return ret;
+
+            if (ret > ef->symnum)
+                return BFELF_ERROR_INVALID_INDEX;
+
+            ef->symnum = ret;
+        }
+
+        ef->gnuhashtab.nchain = ef->symnum - ef->gnuhashtab.symoffset;
+    }
+
+    ef->symtab = (struct bfelf_sym *)bfelf_vaddr_data(ef, ef->dynsymtab, ef->symnum * sizeof(struct bfelf_sym));
+    if (ef->symtab == 0)
+        return BFELF_ERROR_INVALID_FILE;
+
+    ef->dynstr = bfelf_vaddr_data(ef, ef->dynstrtab, ef->dynstrsz);
+    if (ef->dynstr == 0)
+        return BFELF_ERROR_INVALID_STRING_TABLE;
+
+    if (ef->rel != 0 && ef->relnum != 0)
+    {
+        ef->bfreltab[ef->num_rel].num = ef->relnum;
+        ef->bfreltab[ef->num_rel].tab = (struct bfelf_rel *)bfelf_vaddr_data(ef, ef->rel, ef->relnum * sizeof(struct bfelf_rel));
+
+        if (ef->bfreltab[ef->num_rel].tab == 0)
+            return BFELF_ERROR_INVALID_FILE;
+
+        ef->num_rel++;
+    }
+
+    /*
+     * Some linkers include DT_JMPREL in DT_RELASZ, in which case the
+     * JUMP_SLOT relocations are only added once, with DT_JMPREL. If all of
+     * the relocations are JUMP_SLOTs, DT_RELA is DT_JMPREL, and nothing is
+     * left of DT_RELASZ.
+     */
+
+    if (ef->jmprel >= ef->rela && ef->jmprel < ef->rela + ef->relanum * sizeof(struct bfelf_rela))
+        ef->relanum = (ef->jmprel - ef->rela) / sizeof(struct bfelf_rela);
+
+    if (ef->rela != 0 && ef->relanum != 0)
+    {
+        ef->bfrelatab[ef->num_rela].num = ef->relanum;
+        ef->bfrelatab[ef->num_rela].tab = (struct bfelf_rela *)bfelf_vaddr_data(ef, ef->rela, ef->relanum * sizeof(struct bfelf_rela));
+
+        if (ef->bfrelatab[ef->num_rela].tab == 0)
+            return BFELF_ERROR_INVALID_FILE;
+
+        if (ef->relacount != 0)
+            bfelf_relative_init(&(ef->bfrelatab[ef->num_rela]), ef->relacount);
+        else
+            bfelf_relative_init(&(ef->bfrelatab[ef->num_rela]), ef->relanum);
+
+        ef->num_rela++;
+    }
+
+    if (ef->jmprel != 0 && ef->jmprelnum != 0)
+    {
+        if (ef->pltrel != (bfelf64_xword)bfdt_rela)
+            return BFELF_ERROR_INVALID_FILE;
+
+        ef->bfrelatab[ef->num_rela].num = ef->jmprelnum;
+        ef->bfrelatab[ef->num_rela].tab = (struct bfelf_rela *)bfelf_vaddr_data(ef, ef->jmprel, ef->jmprelnum * sizeof(struct bfelf_rela));
+
+        if (ef->bfrelatab[ef->num_rela].tab == 0)
+            return BFELF_ERROR_INVALID_FILE;
+
+        bfelf_relative_init(&(ef->bfrelatab[ef->num_rela]), ef->jmprelnum);
+
+        ef->num_rela++;
+    }
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_file_init_tables(struct bfelf_file_t *ef)
+{
+    bfelf64_word i = 0;
+    bfelf64_sword ret = 0;
+    struct bfelf_dyn *dyn = 0;
+    struct bfelf_phdr *dynamic = 0;
+    struct bfelf_shdr *shstrtab = 0;
+
+    for (i = 0; i < ef->ehdr->e_shnum; i++)
+    {
+        struct bfelf_shdr *shdr;
+
+        ret = bfelf_section_header(ef, i, &shdr);
+        if (ret != BFELF_SUCCESS)
+            return ret;
+
+        if (shdr->sh_offset + shdr->sh_size > ef->fsize)
+            return BFELF_ERROR_INVALID_SH_SIZE;
+    }
+
+    for (i = 0; i < ef->ehdr->e_phnum; i++)
+    {
+        struct bfelf_phdr *phdr;
+
+        ret = bfelf_program_header(ef, i, &phdr);
+        if (ret != BFELF_SUCCESS)
+            return ret;
+
+        if (phdr->p_offset + phdr->p_filesz > ef->fsize)
+            return BFELF_ERROR_INVALID_PH_FILESZ;
+
+        if (phdr->p_filesz > phdr->p_memsz)
+            return BFELF_ERROR_INVALID_PH_FILESZ;
+
+        if (phdr->p_type == bfpt_dynamic)
+            dynamic = phdr;
+    }
+
+    if (dynamic != 0)
+    {
+        dyn = (struct bfelf_dyn *)bfelf_vaddr_data(ef, dynamic->p_vaddr, dynamic->p_filesz);
+        if (dyn == 0)
+            return BFELF_ERROR_INVALID_PH_OFFSET;
+
+        bfelf_dynamic_init(ef, dyn, dynamic->p_filesz / sizeof(struct bfelf_dyn));
+    }
+
+    if (ef->dynsymtab != 0 && ef->dynstrtab != 0 && (ef->hash != 0 || ef->gnu_hash != 0))
+        ret = bfelf_file_init_dynamic(ef);
+    else
+        ret = bfelf_file_init_sections(ef);
+
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    if (ef->ehdr->e_shnum != 0)
+    {
+        ret = bfelf_section_header(ef, ef->ehdr->e_shstrndx, &shstrtab);
+        if (ret != BFELF_SUCCESS)
+            return ret;
+
+        if (shstrtab->sh_type != bfsht_strtab)
+            return BFELF_ERROR_INVALID_SH_TYPE;
+
+        ef->shstrtab = shstrtab;
     }
 
     ef->valid = BFELF_TRUE;
@@ -388,426 +1115,2738 @@ bfelf_file_init(char *file, bfelf64_sword fsize, struct bfelf_file_t *ef)
     return BFELF_SUCCESS;
 }
 
+bfelf64_sword
+bfelf_file_init(char *file, bfelf64_sword fsize, struct bfelf_file_t *ef)
+{
+    bfelf64_sword ret = 0;
+    bfelf64_xword start = 0;
+
+    if (!file || !ef)
+        return BFELF_ERROR_INVALID_ARG;
+
+    bfelf_memclr((char *)ef, sizeof(struct bfelf_file_t));
+    ef->relocated = BFELF_ERROR_NOT_RELOCATED;
+
+    if (fsize < sizeof(struct bfelf64_ehdr))
+        return BFELF_ERROR_INVALID_ARG;
+
+    ef->ehdr = (struct bfelf64_ehdr *)file;
+
+    ret = bfelf_file_check_ehdr(ef->ehdr, fsize);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    ef->file = file;
+    ef->fsize = fsize;
+    ef->shdrtab = (struct bfelf_shdr *)(file + ef->ehdr->e_shoff);
+    ef->phdrtab = (struct bfelf_phdr *)(file + ef->ehdr->e_phoff);
+
+    start = bfelf_stats_time();
+    ret = bfelf_file_init_tables(ef);
+    BFELF_STATS_ADD(init_time, bfelf_stats_time() - start);
+
+    return ret;
+}
+
 bfelf64_sword
 bfelf_file_load(struct bfelf_file_t *ef, char *exec, bfelf64_sword esize)
 {
-    bfelf64_word i = 0;
     bfelf64_sword ret = 0;
+    bfelf64_xword start = 0;
     bfelf64_sxword total_size = 0;
 
     if (!ef || !exec)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (esize < ef->fsize)
-        return BFELF_ERROR_INVALID_ARG;
-
     if (ef->valid != BFELF_TRUE)
         return BFELF_ERROR_INVALID_FILE;
 
     total_size = bfelf_total_exec_size(ef);
     if (total_size < BFELF_SUCCESS)
-        return ret;
+        return total_size;
 
     if (esize != total_size)
         return BFELF_ERROR_INVALID_ARG;
 
-    for (i = 0; i < esize; i++)
-        exec[i] = 0;
-
     ef->exec = exec;
     ef->esize = esize;
+    ef->relr_applied = BFELF_FALSE;
 
+    start = bfelf_stats_time();
     ret = bfelf_load_segments(ef);
+    BFELF_STATS_ADD(load_time, bfelf_stats_time() - start);
+
     if (ret != BFELF_SUCCESS)
         return ret;
 
-    /* TODO: Make sure there are no duplicate symbols */
-
     return BFELF_SUCCESS;
 }
 
-/******************************************************************************/
-/* ELF Loader                                                                 */
-/******************************************************************************/
-
 bfelf64_sword
-bfelf_loader_init(struct bfelf_loader_t *loader)
+bfelf_file_detach_size(struct bfelf_file_t *ef)
 {
-    bfelf64_word i = 0;
+    bfelf64_sword size = 0;
 
-    if (!loader)
+    if (!ef)
         return BFELF_ERROR_INVALID_ARG;
 
-    for (i = 0; i < sizeof(struct bfelf_loader_t); i++)
-        ((char *)loader)[i] = 0;
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    size += sizeof(struct bfelf64_ehdr);
+    size += ef->ehdr->e_phnum * sizeof(struct bfelf_phdr);
+    size += ef->ehdr->e_shnum * sizeof(struct bfelf_shdr);
 
-    return BFELF_SUCCESS;
+    if (ef->shstrtab != 0)
+        size += ef->shstrtab->sh_size;
+
+    return size;
 }
 
 bfelf64_sword
-bfelf_loader_add(struct bfelf_loader_t *loader, struct bfelf_file_t *ef)
+bfelf_file_detach(struct bfelf_file_t *ef, char *meta, bfelf64_sword msize)
 {
-    if (!loader || !ef)
+    char *exec = 0;
+    char *shstrtab = 0;
+    bfelf64_sword size = 0;
+    bfelf64_sword esize = 0;
+    bfelf64_sword fsize = 0;
+    bfelf64_sword relocated = 0;
+    bfelf64_sword relr_applied = 0;
+    bfelf64_xword phsize = 0;
+    bfelf64_xword shsize = 0;
+    struct bfelf_shdr tail = {0};
+
+    if (!ef || !meta)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (loader->num >= BFELF_MAX_MODULES)
-        return BFELF_ERROR_LOADER_FULL;
-
-    if (ef->valid != BFELF_TRUE)
+    if (ef->valid != BFELF_TRUE || ef->exec == 0)
         return BFELF_ERROR_INVALID_FILE;
 
-    loader->efs[loader->num++] = ef;
+    size = bfelf_file_detach_size(ef);
+    if (msize < size)
+        return BFELF_ERROR_INVALID_ARG;
 
-    return BFELF_SUCCESS;
-}
+    if (ef->shstrtab != 0)
+    {
+        shstrtab = bfelf_section_data(ef, ef->shstrtab);
+        if (shstrtab == 0)
+            return BFELF_ERROR_INVALID_SH_OFFSET;
 
-bfelf64_sword
-bfelf_loader_relocate(struct bfelf_loader_t *loader)
-{
-    bfelf64_word i = 0;
-    bfelf64_word j = 0;
-    bfelf64_sword ret = 0;
+        tail = *(ef->shstrtab);
+    }
 
-    if (!loader)
-        return BFELF_ERROR_INVALID_ARG;
+    phsize = ef->ehdr->e_phnum * sizeof(struct bfelf_phdr);
+    shsize = ef->ehdr->e_shnum * sizeof(struct bfelf_shdr);
 
-    if (loader->num > BFELF_MAX_MODULES)
-        return BFELF_ERROR_INVALID_LOADER;
+    /*
+     * The ELF header, program header table, section header table and the
+     * section names are all that is needed from the file once it has been
+     * loaded. Everything else that is used at runtime (the dynamic symbol
+     * table, string table, hash tables and relocation tables) is part of
+     * the loaded image, which is where the tables are rebuilt to point to.
+     */
 
-    for (i = 0; i < loader->num; i++)
-    {
-        struct bfelf_file_t *ef1 = loader->efs[i];
+    bfelf_memcpy(meta, (char *)ef->ehdr, sizeof(struct bfelf64_ehdr));
+    bfelf_memcpy(meta + sizeof(struct bfelf64_ehdr), (char *)ef->phdrtab, phsize);
+    bfelf_memcpy(meta + sizeof(struct bfelf64_ehdr) + phsize, (char *)ef->shdrtab, shsize);
+    bfelf_memcpy(meta + sizeof(struct bfelf64_ehdr) + phsize + shsize, shstrtab, tail.sh_size);
 
-        for (j = 0; j < BFELF_MAX_MODULES; j++)
-            ef1->eftab[j] = 0;
+    exec = ef->exec;
+    esize = ef->esize;
+    fsize = ef->fsize;
+    relocated = ef->relocated;
+    relr_applied = ef->relr_applied;
 
-        for (j = 0; j < loader->num; j++)
-        {
-            struct bfelf_file_t *ef2 = loader->efs[j];
+    bfelf_memclr((char *)ef, sizeof(struct bfelf_file_t));
 
-            if (ef1 == ef2)
-                continue;
+    ef->exec = exec;
+    ef->esize = esize;
+    ef->fsize = fsize;
+    ef->relocated = relocated;
+    ef->relr_applied = relr_applied;
 
-            ef1->eftab[ef1->efnum++] = ef2;
-        }
+    ef->ehdr = (struct bfelf64_ehdr *)meta;
+    ef->phdrtab = (struct bfelf_phdr *)(meta + sizeof(struct bfelf64_ehdr));
 
-        ret = bfelf_relocate_symbols(ef1);
-        if (ret != BFELF_SUCCESS)
-            return ret;
-    }
+    if (shsize != 0)
+        ef->shdrtab = (struct bfelf_shdr *)(meta + sizeof(struct bfelf64_ehdr) + phsize);
 
-    /* TODO: Make sure there are no duplicate symbols globally */
+    ef->tail = meta + sizeof(struct bfelf64_ehdr) + phsize + shsize;
+    ef->tail_offset = tail.sh_offset;
+    ef->tail_size = tail.sh_size;
 
-    return BFELF_SUCCESS;
+    return bfelf_file_init_tables(ef);
 }
 
 /******************************************************************************/
-/* ELF File Header                                                            */
+/* ELF File Stream                                                            */
 /******************************************************************************/
 
-const char *bfelfclass32_str = "ELF32 (bfelfclass32)";
-const char *bfelfclass64_str = "ELF64 (bfelfclass64)";
-
-const char *
-ei_class_to_str(unsigned char value)
+bfelf64_sword
+bfelf_stream_headers(struct bfelf_stream_t *stream)
 {
-    switch (value)
+    bfelf64_word i = 0;
+    bfelf64_sword ret = 0;
+    bfelf64_xword end = 0;
+    bfelf64_xword size = 0;
+    bfelf64_xword tail = 0;
+    bfelf64_xword esize = 0;
+    struct bfelf_phdr *phdrtab = 0;
+    struct bfelf64_ehdr *ehdr = (struct bfelf64_ehdr *)stream->head;
+
+    if (stream->offset == sizeof(struct bfelf64_ehdr))
     {
-        case bfelfclass32: return bfelfclass32_str;
-        case bfelfclass64: return bfelfclass64_str;
-        default: return "Unknown bfei_class";
+        ret = bfelf_file_check_ehdr(ehdr, stream->fsize);
+        if (ret != BFELF_SUCCESS)
+            return ret;
+
+        size = ehdr->e_phoff + (ehdr->e_phentsize * ehdr->e_phnum);
+
+        if (size > BFELF_STREAM_HEAD_SIZE)
+            return BFELF_ERROR_INVALID_PHT;
+
+        if (size > stream->hdr_size)
+        {
+            stream->hdr_size = size;
+            return BFELF_SUCCESS;
+        }
     }
-}
 
-const char *bfelfdata2lsb_str = "2's complement, little endian (bfelfdata2lsb)";
-const char *bfelfdata2msb_str = "2's complement, big endian (bfelfdata2msb)";
+    phdrtab = (struct bfelf_phdr *)(stream->head + ehdr->e_phoff);
 
-const char *
-ei_data_to_str(unsigned char value)
-{
-    switch (value)
+    for (i = 0; i < ehdr->e_phnum; i++)
     {
-        case bfelfdata2lsb: return bfelfdata2lsb_str;
-        case bfelfdata2msb: return bfelfdata2msb_str;
-        default: return "Unknown bfei_data";
+        struct bfelf_phdr *phdr = &(phdrtab[i]);
+
+        if (phdr->p_offset + phdr->p_filesz < phdr->p_offset ||
+            phdr->p_offset + phdr->p_filesz > stream->fsize)
+            return BFELF_ERROR_INVALID_PH_FILESZ;
+
+        if (phdr->p_filesz > phdr->p_memsz)
+            return BFELF_ERROR_INVALID_PH_FILESZ;
+
+        if (phdr->p_vaddr + phdr->p_memsz < phdr->p_vaddr ||
+            phdr->p_vaddr + phdr->p_memsz > BFELF_MAX_EXEC_SIZE)
+            return BFELF_ERROR_INVALID_PH_MEMSZ;
+
+        if (phdr->p_vaddr + phdr->p_memsz > esize)
+            esize = phdr->p_vaddr + phdr->p_memsz;
+
+        if (phdr->p_type != bfpt_load)
+            continue;
+
+        if (phdr->p_vaddr < end)
+            return BFELF_ERROR_INVALID_PH_VADDR;
+
+        end = phdr->p_vaddr + phdr->p_memsz;
+
+        if (phdr->p_offset + phdr->p_filesz > tail)
+            tail = phdr->p_offset + phdr->p_filesz;
     }
+
+    if (end == 0)
+        return BFELF_ERROR_INVALID_E_PHNUM;
+
+    if (tail < stream->hdr_size)
+        tail = stream->hdr_size;
+
+    if (ehdr->e_shnum != 0 && ehdr->e_shoff < tail)
+        return BFELF_ERROR_INVALID_SHT;
+
+    stream->tail_offset = tail;
+    stream->esize = esize;
+    stream->msize = stream->hdr_size + (stream->fsize - tail);
+
+    return BFELF_SUCCESS;
 }
 
-const char *
-version_to_str(unsigned char value)
+/*
+ * The segments were checked against the exec size by bfelf_stream_headers,
+ * but as the exec buffer is usually kernel memory, each copy is checked
+ * again before anything is written to it.
+ */
+bfelf64_sword
+bfelf_stream_copy(struct bfelf_stream_t *stream,
+                  bfelf64_xword offset,
+                  const char *buf,
+                  bfelf64_xword len)
 {
-    switch (value)
+    bfelf64_word i = 0;
+    bfelf64_xword start = 0;
+    bfelf64_xword end = 0;
+    bfelf64_xword dst = 0;
+    struct bfelf64_ehdr *ehdr = (struct bfelf64_ehdr *)stream->head;
+    struct bfelf_phdr *phdrtab = (struct bfelf_phdr *)(stream->head + ehdr->e_phoff);
+
+    for (i = 0; i < ehdr->e_phnum; i++)
     {
-        case bfev_current: return "1 (bfev_current)";
-        default: return "Unknown version";
+        struct bfelf_phdr *phdr = &(phdrtab[i]);
+
+        if (phdr->p_type != bfpt_load)
+            continue;
+
+        start = offset > phdr->p_offset ? offset : phdr->p_offset;
+        end = offset + len < phdr->p_offset + phdr->p_filesz ? offset + len : phdr->p_offset + phdr->p_filesz;
+
+        if (start < end)
+        {
+            dst = phdr->p_vaddr + (start - phdr->p_offset);
+
+            if (dst < phdr->p_vaddr || dst + (end - start) < dst ||
+                dst + (end - start) > (bfelf64_xword)stream->esize)
+                return BFELF_ERROR_INVALID_PH_VADDR;
+
+            bfelf_memcpy(stream->exec + dst, buf + (start - offset), end - start);
+
+            BFELF_STATS_ADD(bytes_copied, end - start);
+        }
     }
-}
 
-const char *bfelfosabi_sysv_str = "System V ABI (bfelfosabi_sysv)";
-const char *bfelfosabi_hpux_str = "HP-UX operating system (bfelfosabi_hpux)";
-const char *bfelfosabi_standalone_str = "Standalone (bfelfosabi_standalone)";
+    start = offset > stream->tail_offset ? offset : stream->tail_offset;
+    end = offset + len;
 
-const char *
-ei_osabi_to_str(unsigned char value)
-{
-    switch (value)
+    if (start < end)
     {
-        case bfelfosabi_sysv: return bfelfosabi_sysv_str;
-        case bfelfosabi_hpux: return bfelfosabi_hpux_str;
-        case bfelfosabi_standalone: return bfelfosabi_standalone_str;
-        default: return "Unknown bfei_osabi";
+        if (stream->hdr_size + (end - stream->tail_offset) > (bfelf64_xword)stream->msize)
+            return BFELF_ERROR_INVALID_FILE;
+
+        bfelf_memcpy(stream->meta + stream->hdr_size + (start - stream->tail_offset),
+                     buf + (start - offset),
+                     end - start);
     }
+
+    return BFELF_SUCCESS;
 }
 
-const char *bfet_none_str = "No file type (bfet_none)";
-const char *bfet_rel_str = "Relocatable object file (bfet_rel)";
-const char *bfet_exec_str = "Executable file (bfet_exec)";
-const char *bfet_dyn_str = "Shared object file (bfet_dyn)";
-const char *bfet_core_str = "Core file (bfet_core)";
-const char *bfet_loos_str = "Environment-specific use (bfet_loos)";
-const char *bfet_hios_str = "Environment-specific use (bfet_hios)";
-const char *bfet_loproc_str = "Processor-specific use (bfet_loproc)";
-const char *bfet_hiproc_str = "Processor-specific use (bfet_hiproc)";
+bfelf64_sword
+bfelf_stream_init(struct bfelf_stream_t *stream,
+                  struct bfelf_file_t *ef,
+                  bfelf64_sword fsize)
+{
+    if (!stream || !ef)
+        return BFELF_ERROR_INVALID_ARG;
 
-const char *
-e_type_to_str(bfelf64_half value)
+    if (fsize < (bfelf64_sword)sizeof(struct bfelf64_ehdr))
+        return BFELF_ERROR_INVALID_ARG;
+
+    bfelf_memclr((char *)stream, sizeof(struct bfelf_stream_t));
+    bfelf_memclr((char *)ef, sizeof(struct bfelf_file_t));
+    ef->relocated = BFELF_ERROR_NOT_RELOCATED;
+
+    stream->ef = ef;
+    stream->fsize = fsize;
+    stream->hdr_size = sizeof(struct bfelf64_ehdr);
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_stream_write(struct bfelf_stream_t *stream,
+                   const char *buf,
+                   bfelf64_sword len)
 {
-    switch (value)
+    bfelf64_sword ret = 0;
+    bfelf64_xword num = 0;
+    bfelf64_xword size = 0;
+
+    if (!stream || !buf || len < 0)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (stream->ef == 0 || (bfelf64_xword)len > stream->fsize - stream->offset)
+        return BFELF_ERROR_INVALID_ARG;
+
+    while (stream->offset < stream->hdr_size && num < (bfelf64_xword)len)
     {
-        case bfet_none: return bfet_none_str;
-        case bfet_rel: return bfet_rel_str;
-        case bfet_exec: return bfet_exec_str;
-        case bfet_dyn: return bfet_dyn_str;
-        case bfet_core: return bfet_core_str;
-        case bfet_loos: return bfet_loos_str;
-        case bfet_hios: return bfet_hios_str;
-        case bfet_loproc: return bfet_loproc_str;
-        case bfet_hiproc: return bfet_hiproc_str;
-        default: return "Unknown bfe_type";
+        size = stream->hdr_size - stream->offset;
+
+        if (size > len - num)
+            size = len - num;
+
+        bfelf_memcpy(stream->head + stream->offset, buf + num, size);
+
+        num += size;
+        stream->offset += size;
+
+        if (stream->offset == stream->hdr_size)
+        {
+            ret = bfelf_stream_headers(stream);
+            if (ret != BFELF_SUCCESS)
+                return ret;
+        }
     }
+
+    if (stream->exec == 0 || num == (bfelf64_xword)len)
+        return num;
+
+    ret = bfelf_stream_copy(stream, stream->offset, buf + num, len - num);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    stream->offset += len - num;
+
+    return len;
 }
 
-const char *bfem_none_str = "none";
-const char *bfem_m32_str = "m32";
-const char *bfem_sparc_str = "sparc";
-const char *bfem_386_str = "386";
-const char *bfem_68k_str = "68k";
-const char *bfem_88k_str = "88k";
-const char *bfem_486_str = "486";
-const char *bfem_860_str = "860";
-const char *bfem_mips_str = "mips";
-const char *bfem_mips_rs3_le_str = "mips_rs3_le";
-const char *bfem_mips_rs4_be_str = "mips_rs4_be";
-const char *bfem_parisc_str = "parisc";
-const char *bfem_sparc32plus_str = "sparc32plus";
-const char *bfem_ppc_str = "ppc";
-const char *bfem_ppc64_str = "ppc64";
-const char *bfem_spu_str = "spu";
-const char *bfem_arm_str = "arm";
-const char *bfem_sh_str = "sh";
-const char *bfem_sparcv9_str = "sparcv9";
-const char *bfem_h8_300_str = "h8_300";
-const char *bfem_ia_64_str = "ia_64";
-const char *bfem_x86_64_str = "x86_64";
-const char *bfem_s390_str = "s390";
-const char *bfem_cris_str = "cris";
-const char *bfem_v850_str = "v850";
-const char *bfem_m32r_str = "m32r";
-const char *bfem_mn10300_str = "mn10300";
-const char *bfem_openrisc_str = "openrisc";
-const char *bfem_blackfin_str = "blackfin";
-const char *bfem_altera_nios2_str = "altera_nios2";
-const char *bfem_ti_c6000_str = "ti_c6000";
-const char *bfem_aarch64_str = "aarch64";
-const char *bfem_frv_str = "frv";
-const char *bfem_avr32_str = "avr32";
-const char *bfem_alpha_str = "alpha";
-const char *bfem_cygnus_v850_str = "cygnus_v850";
-const char *bfem_cygnus_m32r_str = "cygnus_m32r";
-const char *bfem_s390_old_str = "s390_old";
-const char *bfem_cygnus_mn10300_str = "cygnus_mn10300";
+bfelf64_sword
+bfelf_stream_exec_size(struct bfelf_stream_t *stream)
+{
+    if (!stream)
+        return BFELF_ERROR_INVALID_ARG;
 
-const char *
-e_machine_to_str(bfelf64_half value)
+    if (stream->esize == 0)
+        return BFELF_ERROR_INVALID_FILE;
+
+    return stream->esize;
+}
+
+bfelf64_sword
+bfelf_stream_meta_size(struct bfelf_stream_t *stream)
 {
-    switch (value)
-    {
-        case bfem_none: return bfem_none_str;
-        case bfem_m32: return bfem_m32_str;
-        case bfem_sparc: return bfem_sparc_str;
-        case bfem_386: return bfem_386_str;
-        case bfem_68k: return bfem_68k_str;
-        case bfem_88k: return bfem_88k_str;
-        case bfem_486: return bfem_486_str;
-        case bfem_860: return bfem_860_str;
-        case bfem_mips: return bfem_mips_str;
-        case bfem_mips_rs3_le: return bfem_mips_rs3_le_str;
-        case bfem_mips_rs4_be: return bfem_mips_rs4_be_str;
-        case bfem_parisc: return bfem_parisc_str;
-        case bfem_sparc32plus: return bfem_sparc32plus_str;
-        case bfem_ppc: return bfem_ppc_str;
-        case bfem_ppc64: return bfem_ppc64_str;
-        case bfem_spu: return bfem_spu_str;
-        case bfem_arm: return bfem_arm_str;
-        case bfem_sh: return bfem_sh_str;
-        case bfem_sparcv9: return bfem_sparcv9_str;
-        case bfem_h8_300: return bfem_h8_300_str;
-        case bfem_ia_64: return bfem_ia_64_str;
-        case bfem_x86_64: return bfem_x86_64_str;
-        case bfem_s390: return bfem_s390_str;
-        case bfem_cris: return bfem_cris_str;
-        case bfem_v850: return bfem_v850_str;
-        case bfem_m32r: return bfem_m32r_str;
-        case bfem_mn10300: return bfem_mn10300_str;
-        case bfem_openrisc: return bfem_openrisc_str;
-        case bfem_blackfin: return bfem_blackfin_str;
-        case bfem_altera_nios2: return bfem_altera_nios2_str;
-        case bfem_ti_c6000: return bfem_ti_c6000_str;
-        case bfem_aarch64: return bfem_aarch64_str;
-        case bfem_frv: return bfem_frv_str;
-        case bfem_avr32: return bfem_avr32_str;
-        case bfem_alpha: return bfem_alpha_str;
-        case bfem_cygnus_v850: return bfem_cygnus_v850_str;
-        case bfem_cygnus_m32r: return bfem_cygnus_m32r_str;
-        case bfem_s390_old: return bfem_s390_old_str;
-        case bfem_cygnus_mn10300: return bfem_cygnus_mn10300_str;
-        default: return "Unknown e_machine";
-    }
+    if (!stream)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (stream->esize == 0)
+        return BFELF_ERROR_INVALID_FILE;
+
+    return stream->msize;
+}
+
+bfelf64_sword
+bfelf_stream_set_buffers(struct bfelf_stream_t *stream,
+                         char *exec,
+                         bfelf64_sword esize,
+                         char *meta,
+                         bfelf64_sword msize)
+{
+    if (!stream || !exec || !meta)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (stream->esize == 0 || stream->exec != 0)
+        return BFELF_ERROR_INVALID_FILE;
+
+    if (esize != stream->esize || msize < stream->msize)
+        return BFELF_ERROR_INVALID_ARG;
+
+    stream->exec = exec;
+    stream->meta = meta;
+
+    bfelf_memcpy(meta, stream->head, stream->hdr_size);
+    return bfelf_stream_copy(stream, 0, stream->head, stream->hdr_size);
 }
 
-bfelf64_sword
-bfelf_file_print_header(struct bfelf_file_t *ef)
-{
-    if (!ef)
-        return BFELF_ERROR_INVALID_ARG;
+bfelf64_sword
+bfelf_stream_finish(struct bfelf_stream_t *stream)
+{
+    bfelf64_sword ret = 0;
+    bfelf64_xword start = 0;
+    struct bfelf_file_t *ef = 0;
+
+    if (!stream || !stream->ef)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (stream->exec == 0 || stream->offset != stream->fsize)
+        return BFELF_ERROR_INVALID_FILE;
+
+    ef = stream->ef;
+
+    ef->fsize = stream->fsize;
+    ef->exec = stream->exec;
+    ef->esize = stream->esize;
+    ef->tail = stream->meta + stream->hdr_size;
+    ef->tail_offset = stream->tail_offset;
+    ef->tail_size = stream->fsize - stream->tail_offset;
+
+    ef->ehdr = (struct bfelf64_ehdr *)stream->meta;
+    ef->phdrtab = (struct bfelf_phdr *)(stream->meta + ef->ehdr->e_phoff);
+
+    if (ef->ehdr->e_shnum != 0)
+        ef->shdrtab = (struct bfelf_shdr *)(ef->tail + (ef->ehdr->e_shoff - ef->tail_offset));
+
+    start = bfelf_stats_time();
+    ret = bfelf_file_init_tables(ef);
+    BFELF_STATS_ADD(init_time, bfelf_stats_time() - start);
+
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    start = bfelf_stats_time();
+    ret = bfelf_load_segments(ef);
+    BFELF_STATS_ADD(load_time, bfelf_stats_time() - start);
+
+    return ret;
+}
+
+/******************************************************************************/
+/* ELF Loader                                                                 */
+/******************************************************************************/
+
+bfelf64_sword
+bfelf_loader_init(struct bfelf_loader_t *loader)
+{
+    if (!loader)
+        return BFELF_ERROR_INVALID_ARG;
+
+    bfelf_memclr((char *)loader, sizeof(struct bfelf_loader_t));
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_loader_add(struct bfelf_loader_t *loader, struct bfelf_file_t *ef)
+{
+    struct bfelf_file_t *tmp = 0;
+
+    if (!loader || !ef)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    for (tmp = loader->efs; tmp != 0; tmp = tmp->next)
+    {
+        if (tmp == ef)
+            return BFELF_ERROR_INVALID_ARG;
+    }
+
+    ef->next = 0;
+
+    if (loader->last != 0)
+        loader->last->next = ef;
+    else
+        loader->efs = ef;
+
+    loader->last = ef;
+    loader->num++;
+
+    loader->addrnum = 0;
+    loader->addrmax = 0;
+    loader->addrtab = 0;
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_loader_symtab_size(struct bfelf_loader_t *loader, struct bfelf_file_t *ef)
+{
+    bfelf64_xword num = 0;
+    bfelf64_xword size = 16;
+    struct bfelf_file_t *tmp = 0;
+
+    if (!loader)
+        return BFELF_ERROR_INVALID_ARG;
+
+    for (tmp = loader->efs; tmp != 0; tmp = tmp->next)
+        num += (bfelf64_xword)tmp->symnum;
+
+    if (ef != 0)
+        num += (bfelf64_xword)ef->symnum;
+
+    /*
+     * Every symbol of every ELF file is counted (even the undefined and
+     * local ones, which are never added), so the table can never fill up
+     * past the 3/4 that bfelf_loader_add_symbols allows.
+     */
+
+    while ((size / 4) * 3 < num)
+        size <<= 1;
+
+    if (size > (0x7FFFFFFF - sizeof(struct bfelf_symtab_t)) / sizeof(struct bfelf_global_sym_t))
+        return BFELF_ERROR_LOADER_FULL;
+
+    return (bfelf64_sword)(sizeof(struct bfelf_symtab_t) + size * sizeof(struct bfelf_global_sym_t));
+}
+
+bfelf64_sword
+bfelf_loader_set_symtab(struct bfelf_loader_t *loader, char *buf, bfelf64_sword size)
+{
+    bfelf64_sword num = 1;
+    struct bfelf_symtab_t *symtab = 0;
+
+    if (!loader || !buf)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (size < (bfelf64_sword)(sizeof(struct bfelf_symtab_t) + sizeof(struct bfelf_global_sym_t)))
+        return BFELF_ERROR_INVALID_ARG;
+
+    size = (size - sizeof(struct bfelf_symtab_t)) / sizeof(struct bfelf_global_sym_t);
+
+    while (num * 2 <= size)
+        num *= 2;
+
+    symtab = (struct bfelf_symtab_t *)buf;
+    symtab->num = 0;
+    symtab->size = num;
+    symtab->tab = (struct bfelf_global_sym_t *)(buf + sizeof(struct bfelf_symtab_t));
+
+    bfelf_memclr((char *)symtab->tab, num * sizeof(struct bfelf_global_sym_t));
+
+    loader->next_symtab = symtab;
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_loader_find_symbol(struct bfelf_symtab_t *symtab,
+                         struct e_string_t *name,
+                         bfelf64_word hash,
+                         struct bfelf_global_sym_t **gsym)
+{
+    bfelf64_word i = 0;
+    bfelf64_word n = 0;
+    bfelf64_word mask = (bfelf64_word)symtab->size - 1;
+    bfelf64_sword ret = 0;
+
+    i = hash & mask;
+
+    for (n = 0; n <= mask; n++)
+    {
+        struct bfelf_global_sym_t *tmp = &(symtab->tab[i]);
+
+        if (tmp->sym == 0)
+        {
+            *gsym = tmp;
+            return BFELF_ERROR_NO_SUCH_SYMBOL;
+        }
+
+        if (tmp->hash == hash)
+        {
+            ret = bfelf_symbol_name_matches(tmp->ef, tmp->sym, name);
+            if (ret == BFELF_TRUE)
+            {
+                *gsym = tmp;
+                return BFELF_SUCCESS;
+            }
+
+            if (ret != BFELF_FALSE)
+                return ret;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    *gsym = 0;
+    return BFELF_ERROR_NO_SUCH_SYMBOL;
+}
+
+bfelf64_sword
+bfelf_loader_add_symbols(struct bfelf_symtab_t *symtab,
+                         struct bfelf_file_t *ef)
+{
+    bfelf64_sword i = 0;
+    bfelf64_word hash = 0;
+    bfelf64_sword ret = 0;
+    struct e_string_t name = {0};
+    struct bfelf_global_sym_t *gsym = 0;
+
+    for (i = 0; i < ef->symnum; i++)
+    {
+        struct bfelf_sym *sym = &(ef->symtab[i]);
+
+        if (sym->st_value == 0)
+            continue;
+
+        if (BFELF_SYM_BIND(sym->st_info) != bfstb_global &&
+            BFELF_SYM_BIND(sym->st_info) != bfstb_weak)
+        {
+            continue;
+        }
+
+        ret = bfelf_symbol_name(ef, sym, &name);
+        if (ret != BFELF_SUCCESS)
+            return ret;
+
+        hash = bfelf_string_hash(&name);
+
+        ret = bfelf_loader_find_symbol(symtab, &name, hash, &gsym);
+        switch (ret)
+        {
+            case BFELF_SUCCESS:
+                break;
+
+            case BFELF_ERROR_NO_SUCH_SYMBOL:
+                if (gsym == 0 || symtab->num >= (symtab->size / 4) * 3)
+                    return BFELF_ERROR_LOADER_FULL;
+
+                gsym->hash = hash;
+                gsym->ef = ef;
+                gsym->sym = sym;
+
+                symtab->num++;
+                continue;
+
+            default:
+                return ret;
+        }
+
+        if (BFELF_SYM_BIND(sym->st_info) != bfstb_global)
+            continue;
+
+        if (BFELF_SYM_BIND(gsym->sym->st_info) != bfstb_global)
+        {
+            gsym->ef = ef;
+            gsym->sym = sym;
+            continue;
+        }
+
+        if (BFELF_SYM_TYPE(sym->st_info) == bfstt_notype && sym->st_size == 0 &&
+            BFELF_SYM_TYPE(gsym->sym->st_info) == bfstt_notype && gsym->sym->st_size == 0)
+        {
+            continue;
+        }
+
+        ALERT("duplicate symbol: %s\n", name.buf);
+        return BFELF_ERROR_DUPLICATE_SYMBOL;
+    }
+
+    return BFELF_SUCCESS;
+}
+
+/*
+ * Builds a new global symbol table from the ELF files that are currently in
+ * the ELF loader, in the table given to bfelf_loader_set_symtab, and then
+ * swaps it in with a single store. The table that is in use is not
+ * touched, so a lookup on another CPU (e.g. a lazy binding) sees either
+ * the old table or the new one, never a partial one. The old table is
+ * returned in prev, so that the caller can swap it back in on failure.
+ */
+bfelf64_sword
+bfelf_loader_index_symbols(struct bfelf_loader_t *loader,
+                           struct bfelf_symtab_t **prev)
+{
+    bfelf64_sword ret = 0;
+    struct bfelf_file_t *ef = 0;
+    struct bfelf_symtab_t *symtab = loader->next_symtab;
+
+    if (symtab == 0)
+        return BFELF_ERROR_LOADER_FULL;
+
+    bfelf_memclr((char *)symtab->tab, symtab->size * sizeof(struct bfelf_global_sym_t));
+    symtab->num = 0;
+
+    for (ef = loader->efs; ef != 0; ef = ef->next)
+    {
+        ret = bfelf_loader_add_symbols(symtab, ef);
+        if (ret != BFELF_SUCCESS)
+            return ret;
+    }
+
+    if (prev != 0)
+        *prev = loader->symtab;
+
+    loader->next_symtab = 0;
+    BFELF_ATOMIC_STORE(&loader->symtab, symtab);
+
+    for (ef = loader->efs; ef != 0; ef = ef->next)
+        ef->loader = loader;
+
+    return BFELF_SUCCESS;
+}
+
+/*
+ * Returns BFELF_TRUE if ef defines a global symbol that overrides a weak
+ * one in symtab, which other ELF files may already be bound to.
+ */
+bfelf64_sword
+bfelf_loader_overrides_weak(struct bfelf_symtab_t *symtab,
+                            struct bfelf_file_t *ef)
+{
+    bfelf64_sword i = 0;
+    struct e_string_t name = {0};
+    struct bfelf_global_sym_t *gsym = 0;
+
+    for (i = 0; i < ef->symnum; i++)
+    {
+        struct bfelf_sym *sym = &(ef->symtab[i]);
+
+        if (sym->st_value == 0 || BFELF_SYM_BIND(sym->st_info) != bfstb_global)
+            continue;
+
+        if (bfelf_symbol_name(ef, sym, &name) != BFELF_SUCCESS)
+            continue;
+
+        if (bfelf_loader_find_symbol(symtab, &name, bfelf_string_hash(&name), &gsym) != BFELF_SUCCESS)
+            continue;
+
+        if (BFELF_SYM_BIND(gsym->sym->st_info) == bfstb_weak)
+            return BFELF_TRUE;
+    }
+
+    return BFELF_FALSE;
+}
+
+bfelf64_sword
+bfelf_loader_relocate_begin(struct bfelf_loader_t *loader)
+{
+    bfelf64_sword ret = 0;
+    bfelf64_xword start = 0;
+    struct bfelf_file_t *ef = 0;
+
+    if (!loader)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if ((loader->efs == 0) != (loader->num == 0))
+        return BFELF_ERROR_INVALID_LOADER;
+
+    start = bfelf_stats_time();
+    loader->relocate_start = start;
+
+    /*
+     * Nothing is executing the ELF files until they are relocated, so if
+     * no new table was given, the one in use can be built again in place.
+     */
+
+    if (loader->next_symtab == 0)
+        loader->next_symtab = loader->symtab;
+
+    for (ef = loader->efs; ef != 0; ef = ef->next)
+    {
+        ef->loader = 0;
+        ef->relocated = BFELF_ERROR_NOT_RELOCATED;
+    }
+
+    ret = bfelf_loader_index_symbols(loader, 0);
+    if (ret != BFELF_SUCCESS)
+    {
+        BFELF_STATS_ADD(relocate_time, bfelf_stats_time() - start);
+        return ret;
+    }
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_loader_relocate_file(struct bfelf_file_t *ef,
+                           struct bfelf_symcache_t *symcache,
+                           bfelf64_sword symcache_num)
+{
+    if (!ef)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->loader == 0)
+        return BFELF_ERROR_INVALID_LOADER;
+
+    ef->relocated = bfelf_relocate_symbols_cache(ef, symcache, symcache_num);
+    return ef->relocated;
+}
+
+bfelf64_sword
+bfelf_loader_relocate_end(struct bfelf_loader_t *loader)
+{
+    bfelf64_sword ret = BFELF_SUCCESS;
+    struct bfelf_file_t *ef = 0;
+
+    if (!loader)
+        return BFELF_ERROR_INVALID_ARG;
+
+    for (ef = loader->efs; ef != 0; ef = ef->next)
+    {
+        if (ef->relocated != BFELF_SUCCESS)
+        {
+            ret = ef->relocated;
+            break;
+        }
+    }
+
+    if (loader->relocate_start != 0)
+        BFELF_STATS_ADD(relocate_time, bfelf_stats_time() - loader->relocate_start);
+
+    loader->relocate_start = 0;
+
+    return ret;
+}
+
+bfelf64_sword
+bfelf_loader_relocate(struct bfelf_loader_t *loader)
+{
+    bfelf64_sword ret = 0;
+    struct bfelf_file_t *ef = 0;
+
+    ret = bfelf_loader_relocate_begin(loader);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    for (ef = loader->efs; ef != 0; ef = ef->next)
+    {
+        ret = bfelf_loader_relocate_file(ef, 0, 0);
+        if (ret != BFELF_SUCCESS)
+            break;
+    }
+
+    return bfelf_loader_relocate_end(loader);
+}
+
+bfelf64_sword
+bfelf_loader_relocated(struct bfelf_loader_t *loader)
+{
+    struct bfelf_file_t *ef = 0;
+
+    for (ef = loader->efs; ef != 0; ef = ef->next)
+    {
+        if (ef->loader != loader || ef->relocated != BFELF_SUCCESS)
+            return BFELF_FALSE;
+    }
+
+    return BFELF_TRUE;
+}
+
+/*
+ * Rebinds every ELF file in the ELF loader, other than skip, to the symbols
+ * that are currently in the global symbol table. Lazy binding is turned off
+ * while doing so, as a JUMP_SLOT that was already bound lazily has to be
+ * bound again, and its PLT stub can no longer be found.
+ */
+bfelf64_sword
+bfelf_loader_rebind(struct bfelf_loader_t *loader, struct bfelf_file_t *skip)
+{
+    bfelf64_sword ret = 0;
+    bfelf64_sword lazy = loader->lazy;
+    struct bfelf_file_t *ef = 0;
+
+    loader->lazy = BFELF_FALSE;
+
+    for (ef = loader->efs; ef != 0; ef = ef->next)
+    {
+        if (ef == skip)
+            continue;
+
+        ret = bfelf_rebind_symbols(ef);
+        if (ret != BFELF_SUCCESS)
+            break;
+    }
+
+    loader->lazy = lazy;
+
+    return ret;
+}
+
+bfelf64_sword
+bfelf_loader_unlink(struct bfelf_loader_t *loader, struct bfelf_file_t *ef)
+{
+    struct bfelf_file_t **link = 0;
+
+    for (link = &(loader->efs); *link != 0; link = &((*link)->next))
+    {
+        if (*link == ef)
+            break;
+    }
+
+    if (*link == 0)
+        return BFELF_ERROR_INVALID_ARG;
+
+    *link = ef->next;
+
+    if (loader->last == ef)
+    {
+        for (loader->last = loader->efs; loader->last != 0 && loader->last->next != 0;)
+            loader->last = loader->last->next;
+    }
+
+    ef->next = 0;
+    ef->loader = 0;
+
+    loader->num--;
+    loader->addrnum = 0;
+    loader->addrmax = 0;
+    loader->addrtab = 0;
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_loader_remove(struct bfelf_loader_t *loader, struct bfelf_file_t *ef)
+{
+    bfelf64_sword ret = 0;
+    struct bfelf_file_t *tmp = 0;
+
+    if (!loader || !ef)
+        return BFELF_ERROR_INVALID_ARG;
+
+    for (tmp = loader->efs; tmp != 0 && tmp != ef;)
+        tmp = tmp->next;
+
+    if (tmp == 0)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (loader->symtab != 0 && loader->next_symtab == 0)
+        return BFELF_ERROR_LOADER_FULL;
+
+    ret = bfelf_loader_unlink(loader, ef);
+    if (ret != BFELF_SUCCESS || loader->symtab == 0)
+        return ret;
+
+    return bfelf_loader_index_symbols(loader, 0);
+}
+
+bfelf64_sword
+bfelf_loader_add_relocated(struct bfelf_loader_t *loader,
+                           struct bfelf_file_t *ef,
+                           struct bfelf_symcache_t *symcache,
+                           bfelf64_sword symcache_num)
+{
+    bfelf64_sword ret = 0;
+    bfelf64_sword rebind = BFELF_FALSE;
+    struct bfelf_symtab_t *prev = 0;
+
+    if (!loader || !ef)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (bfelf_loader_relocated(loader) != BFELF_TRUE)
+        return BFELF_ERROR_NOT_RELOCATED;
+
+    ret = bfelf_loader_add(loader, ef);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    /*
+     * A new global symbol table is built with the new ELF file's symbols,
+     * and the new ELF file is relocated against it. The other ELF files
+     * are only bound again if the new ELF file overrides a weak symbol, as
+     * they may be bound to the weak one. If any of this fails, the old
+     * table is swapped back in, and everything is bound to it again.
+     */
+
+    ret = bfelf_loader_index_symbols(loader, &prev);
+    if (ret != BFELF_SUCCESS)
+    {
+        bfelf_loader_unlink(loader, ef);
+        return ret;
+    }
+
+    ret = bfelf_loader_relocate_file(ef, symcache, symcache_num);
+
+    if (ret == BFELF_SUCCESS)
+        rebind = bfelf_loader_overrides_weak(prev, ef);
+
+    if (ret == BFELF_SUCCESS && rebind == BFELF_TRUE)
+        ret = bfelf_loader_rebind(loader, ef);
+
+    if (ret == BFELF_SUCCESS)
+        return BFELF_SUCCESS;
+
+    bfelf_loader_unlink(loader, ef);
+    BFELF_ATOMIC_STORE(&loader->symtab, prev);
+
+    if (rebind == BFELF_TRUE)
+        bfelf_loader_rebind(loader, 0);
+
+    return ret;
+}
+
+bfelf64_sword
+bfelf_loader_replace(struct bfelf_loader_t *loader,
+                     struct bfelf_file_t *old_ef,
+                     struct bfelf_file_t *new_ef,
+                     struct bfelf_symcache_t *symcache,
+                     bfelf64_sword symcache_num)
+{
+    bfelf64_sword ret = 0;
+    struct bfelf_file_t **link = 0;
+    struct bfelf_symtab_t *prev = 0;
+
+    if (!loader || !old_ef || !new_ef || old_ef == new_ef)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (new_ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    if (bfelf_loader_relocated(loader) != BFELF_TRUE)
+        return BFELF_ERROR_NOT_RELOCATED;
+
+    for (link = &(loader->efs); *link != 0; link = &((*link)->next))
+    {
+        if (*link == old_ef)
+            break;
+    }
+
+    if (*link == 0)
+        return BFELF_ERROR_INVALID_ARG;
+
+    /*
+     * The new ELF file takes the old one's place in the list, so symbols
+     * are resolved in the same order as before. Once it is relocated, every
+     * other ELF file is bound again, which moves the references to the old
+     * ELF file's symbols over to the new one. If any of this fails, the old
+     * ELF file and the old global symbol table are put back, and everything
+     * is bound to them again.
+     */
+
+    new_ef->next = old_ef->next;
+    *link = new_ef;
+
+    if (loader->last == old_ef)
+        loader->last = new_ef;
+
+    loader->addrnum = 0;
+    loader->addrmax = 0;
+    loader->addrtab = 0;
+
+    ret = bfelf_loader_index_symbols(loader, &prev);
+    if (ret == BFELF_SUCCESS && new_ef->relocated != BFELF_SUCCESS)
+        ret = bfelf_loader_relocate_file(new_ef, symcache, symcache_num);
+
+    if (ret == BFELF_SUCCESS)
+        ret = bfelf_loader_rebind(loader, new_ef);
+
+    if (ret == BFELF_SUCCESS)
+    {
+        old_ef->next = 0;
+        old_ef->loader = 0;
+
+        return BFELF_SUCCESS;
+    }
+
+    *link = old_ef;
+
+    if (loader->last == new_ef)
+        loader->last = old_ef;
+
+    new_ef->next = 0;
+    new_ef->loader = 0;
+
+    if (prev != 0)
+    {
+        BFELF_ATOMIC_STORE(&loader->symtab, prev);
+        bfelf_loader_rebind(loader, 0);
+    }
+
+    return ret;
+}
+
+bfelf64_sword
+bfelf_addr_sym_is_indexed(struct bfelf_sym *sym)
+{
+    if (sym->st_value == 0 || sym->st_shndx == 0)
+        return BFELF_FALSE;
+
+    if (BFELF_SYM_TYPE(sym->st_info) != bfstt_func &&
+        BFELF_SYM_TYPE(sym->st_info) != bfstt_object)
+    {
+        return BFELF_FALSE;
+    }
+
+    return BFELF_TRUE;
+}
+
+/*
+ * Entries are sorted by address, and entries with the same address (i.e.
+ * aliases) are sorted by size, so that the largest alias is the one found
+ * by bfelf_symbolize.
+ */
+bfelf64_sword
+bfelf_addr_sym_less(struct bfelf_addr_sym_t *a, struct bfelf_addr_sym_t *b)
+{
+    if (a->addr != b->addr)
+        return a->addr < b->addr ? BFELF_TRUE : BFELF_FALSE;
+
+    return a->size < b->size ? BFELF_TRUE : BFELF_FALSE;
+}
+
+void
+bfelf_addr_sym_sift(struct bfelf_addr_sym_t *tab,
+                    bfelf64_sword root,
+                    bfelf64_sword num)
+{
+    bfelf64_sword child = 0;
+    struct bfelf_addr_sym_t tmp = {0};
+
+    while ((child = root * 2 + 1) < num)
+    {
+        if (child + 1 < num && bfelf_addr_sym_less(&tab[child], &tab[child + 1]) == BFELF_TRUE)
+            child++;
+
+        if (bfelf_addr_sym_less(&tab[root], &tab[child]) == BFELF_FALSE)
+            return;
+
+        tmp = tab[root];
+        tab[root] = tab[child];
+        tab[child] = tmp;
+
+        root = child;
+    }
+}
+
+/*
+ * The index is sorted in place with a heap sort, which needs neither an
+ * allocator nor a recursion depth that depends on the number of symbols.
+ */
+void
+bfelf_addr_sym_sort(struct bfelf_addr_sym_t *tab, bfelf64_sword num)
+{
+    bfelf64_sword i = 0;
+    struct bfelf_addr_sym_t tmp = {0};
+
+    for (i = num / 2 - 1; i >= 0; i--)
+        bfelf_addr_sym_sift(tab, i, num);
+
+    for (i = num - 1; i > 0; i--)
+    {
+        tmp = tab[0];
+        tab[0] = tab[i];
+        tab[i] = tmp;
+
+        bfelf_addr_sym_sift(tab, 0, i);
+    }
+}
+
+bfelf64_sword
+bfelf_loader_index_size(struct bfelf_loader_t *loader)
+{
+    bfelf64_sword i = 0;
+    bfelf64_sword num = 0;
+    struct bfelf_file_t *ef = 0;
+
+    if (!loader)
+        return BFELF_ERROR_INVALID_ARG;
+
+    for (ef = loader->efs; ef != 0; ef = ef->next)
+    {
+        for (i = 0; i < ef->symnum; i++)
+        {
+            if (bfelf_addr_sym_is_indexed(&(ef->symtab[i])) == BFELF_TRUE)
+                num++;
+        }
+    }
+
+    if (num > 0x7FFFFFFF / (bfelf64_sword)sizeof(struct bfelf_addr_sym_t))
+        return BFELF_ERROR_LOADER_FULL;
+
+    return num * (bfelf64_sword)sizeof(struct bfelf_addr_sym_t);
+}
+
+bfelf64_sword
+bfelf_loader_index(struct bfelf_loader_t *loader, char *buf, bfelf64_sword size)
+{
+    bfelf64_sword i = 0;
+    bfelf64_sword num = 0;
+    bfelf64_sword ret = 0;
+    bfelf64_xword max = 0;
+    struct bfelf_file_t *ef = 0;
+    struct bfelf_addr_sym_t *tab = 0;
+
+    if (!loader || !buf)
+        return BFELF_ERROR_INVALID_ARG;
+
+    ret = bfelf_loader_index_size(loader);
+    if (ret < 0)
+        return ret;
+
+    if (size < ret)
+        return BFELF_ERROR_INVALID_ARG;
+
+    for (ef = loader->efs; ef != 0; ef = ef->next)
+    {
+        if (ef->exec == 0)
+            return BFELF_ERROR_INVALID_FILE;
+    }
+
+    tab = (struct bfelf_addr_sym_t *)buf;
+
+    for (ef = loader->efs; ef != 0; ef = ef->next)
+    {
+        for (i = 0; i < ef->symnum; i++)
+        {
+            struct bfelf_sym *sym = &(ef->symtab[i]);
+
+            if (bfelf_addr_sym_is_indexed(sym) == BFELF_FALSE)
+                continue;
+
+            tab[num].addr = (bfelf64_addr)(ef->exec + sym->st_value);
+            tab[num].size = sym->st_size;
+            tab[num].ef = ef;
+            tab[num].sym = sym;
+
+            if (sym->st_size > max)
+                max = sym->st_size;
+
+            num++;
+        }
+    }
+
+    bfelf_addr_sym_sort(tab, num);
+
+    loader->addrnum = num;
+    loader->addrmax = max;
+    loader->addrtab = tab;
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_symbolize(struct bfelf_loader_t *loader,
+                void *addr,
+                struct bfelf_file_t **ef,
+                struct e_string_t *name,
+                bfelf64_xword *offset)
+{
+    bfelf64_sword lo = 0;
+    bfelf64_sword hi = 0;
+    bfelf64_sword mid = 0;
+    bfelf64_sword ret = 0;
+    bfelf64_addr target = 0;
+    struct bfelf_addr_sym_t *entry = 0;
+
+    if (!loader || !ef || !name || !offset)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (loader->addrtab == 0)
+        return BFELF_ERROR_INVALID_LOADER;
+
+    target = (bfelf64_addr)addr;
+
+    /*
+     * Find the last entry that starts at or before the address. Symbols
+     * can be nested (e.g. a label or a small object inside of a function),
+     * so that entry does not have to contain the address, and the entries
+     * before it are checked as well, until one contains the address, or
+     * the address is further from the start of the entry than the largest
+     * symbol in the index, at which point no earlier entry can contain it.
+     */
+
+    lo = 0;
+    hi = loader->addrnum;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+
+        if (loader->addrtab[mid].addr <= target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (; lo > 0; lo--)
+    {
+        entry = &(loader->addrtab[lo - 1]);
+
+        if (target == entry->addr || target - entry->addr < entry->size)
+            break;
+
+        if (target - entry->addr >= loader->addrmax)
+            return BFELF_ERROR_NO_SUCH_SYMBOL;
+    }
+
+    if (lo == 0)
+        return BFELF_ERROR_NO_SUCH_SYMBOL;
+
+    ret = bfelf_symbol_name(entry->ef, entry->sym, name);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    *ef = entry->ef;
+    *offset = target - entry->addr;
+
+    return BFELF_SUCCESS;
+}
+
+/******************************************************************************/
+/* ELF File Header                                                            */
+/******************************************************************************/
+
+const char *bfelfclass32_str = "ELF32 (bfelfclass32)";
+const char *bfelfclass64_str = "ELF64 (bfelfclass64)";
+
+const char *
+ei_class_to_str(unsigned char value)
+{
+    switch (value)
+    {
+        case bfelfclass32: return bfelfclass32_str;
+        case bfelfclass64: return bfelfclass64_str;
+        default: return "Unknown bfei_class";
+    }
+}
+
+const char *bfelfdata2lsb_str = "2's complement, little endian (bfelfdata2lsb)";
+const char *bfelfdata2msb_str = "2's complement, big endian (bfelfdata2msb)";
+
+const char *
+ei_data_to_str(unsigned char value)
+{
+    switch (value)
+    {
+        case bfelfdata2lsb: return bfelfdata2lsb_str;
+        case bfelfdata2msb: return bfelfdata2msb_str;
+        default: return "Unknown bfei_data";
+    }
+}
+
+const char *
+version_to_str(unsigned char value)
+{
+    switch (value)
+    {
+        case bfev_current: return "1 (bfev_current)";
+        default: return "Unknown version";
+    }
+}
+
+const char *bfelfosabi_sysv_str = "System V ABI (bfelfosabi_sysv)";
+const char *bfelfosabi_hpux_str = "HP-UX operating system (bfelfosabi_hpux)";
+const char *bfelfosabi_standalone_str = "Standalone (bfelfosabi_standalone)";
+
+const char *
+ei_osabi_to_str(unsigned char value)
+{
+    switch (value)
+    {
+        case bfelfosabi_sysv: return bfelfosabi_sysv_str;
+        case bfelfosabi_hpux: return bfelfosabi_hpux_str;
+        case bfelfosabi_standalone: return bfelfosabi_standalone_str;
+        default: return "Unknown bfei_osabi";
+    }
+}
+
+const char *bfet_none_str = "No file type (bfet_none)";
+const char *bfet_rel_str = "Relocatable object file (bfet_rel)";
+const char *bfet_exec_str = "Executable file (bfet_exec)";
+const char *bfet_dyn_str = "Shared object file (bfet_dyn)";
+const char *bfet_core_str = "Core file (bfet_core)";
+const char *bfet_loos_str = "Environment-specific use (bfet_loos)";
+const char *bfet_hios_str = "Environment-specific use (bfet_hios)";
+const char *bfet_loproc_str = "Processor-specific use (bfet_loproc)";
+const char *bfet_hiproc_str = "Processor-specific use (bfet_hiproc)";
+
+const char *
+e_type_to_str(bfelf64_half value)
+{
+    switch (value)
+    {
+        case bfet_none: return bfet_none_str;
+        case bfet_rel: return bfet_rel_str;
+        case bfet_exec: return bfet_exec_str;
+        case bfet_dyn: return bfet_dyn_str;
+        case bfet_core: return bfet_core_str;
+        case bfet_loos: return bfet_loos_str;
+        case bfet_hios: return bfet_hios_str;
+        case bfet_loproc: return bfet_loproc_str;
+        case bfet_hiproc: return bfet_hiproc_str;
+        default: return "Unknown bfe_type";
+    }
+}
+
+const char *bfem_none_str = "none";
+const char *bfem_m32_str = "m32";
+const char *bfem_sparc_str = "sparc";
+const char *bfem_386_str = "386";
+const char *bfem_68k_str = "68k";
+const char *bfem_88k_str = "88k";
+const char *bfem_486_str = "486";
+const char *bfem_860_str = "860";
+const char *bfem_mips_str = "mips";
+const char *bfem_mips_rs3_le_str = "mips_rs3_le";
+const char *bfem_mips_rs4_be_str = "mips_rs4_be";
+const char *bfem_parisc_str = "parisc";
+const char *bfem_sparc32plus_str = "sparc32plus";
+const char *bfem_ppc_str = "ppc";
+const char *bfem_ppc64_str = "ppc64";
+const char *bfem_spu_str = "spu";
+const char *bfem_arm_str = "arm";
+const char *bfem_sh_str = "sh";
+const char *bfem_sparcv9_str = "sparcv9";
+const char *bfem_h8_300_str = "h8_300";
+const char *bfem_ia_64_str = "ia_64";
+const char *bfem_x86_64_str = "x86_64";
+const char *bfem_s390_str = "s390";
+const char *bfem_cris_str = "cris";
+const char *bfem_v850_str = "v850";
+const char *bfem_m32r_str = "m32r";
+const char *bfem_mn10300_str = "mn10300";
+const char *bfem_openrisc_str = "openrisc";
+const char *bfem_blackfin_str = "blackfin";
+const char *bfem_altera_nios2_str = "altera_nios2";
+const char *bfem_ti_c6000_str = "ti_c6000";
+const char *bfem_aarch64_str = "aarch64";
+const char *bfem_frv_str = "frv";
+const char *bfem_avr32_str = "avr32";
+const char *bfem_alpha_str = "alpha";
+const char *bfem_cygnus_v850_str = "cygnus_v850";
+const char *bfem_cygnus_m32r_str = "cygnus_m32r";
+const char *bfem_s390_old_str = "s390_old";
+const char *bfem_cygnus_mn10300_str = "cygnus_mn10300";
+
+const char *
+e_machine_to_str(bfelf64_half value)
+{
+    switch (value)
+    {
+        case bfem_none: return bfem_none_str;
+        case bfem_m32: return bfem_m32_str;
+        case bfem_sparc: return bfem_sparc_str;
+        case bfem_386: return bfem_386_str;
+        case bfem_68k: return bfem_68k_str;
+        case bfem_88k: return bfem_88k_str;
+        case bfem_486: return bfem_486_str;
+        case bfem_860: return bfem_860_str;
+        case bfem_mips: return bfem_mips_str;
+        case bfem_mips_rs3_le: return bfem_mips_rs3_le_str;
+        case bfem_mips_rs4_be: return bfem_mips_rs4_be_str;
+        case bfem_parisc: return bfem_parisc_str;
+        case bfem_sparc32plus: return bfem_sparc32plus_str;
+        case bfem_ppc: return bfem_ppc_str;
+        case bfem_ppc64: return bfem_ppc64_str;
+        case bfem_spu: return bfem_spu_str;
+        case bfem_arm: return bfem_arm_str;
+        case bfem_sh: return bfem_sh_str;
+        case bfem_sparcv9: return bfem_sparcv9_str;
+        case bfem_h8_300: return bfem_h8_300_str;
+        case bfem_ia_64: return bfem_ia_64_str;
+        case bfem_x86_64: return bfem_x86_64_str;
+        case bfem_s390: return bfem_s390_str;
+        case bfem_cris: return bfem_cris_str;
+        case bfem_v850: return bfem_v850_str;
+        case bfem_m32r: return bfem_m32r_str;
+        case bfem_mn10300: return bfem_mn10300_str;
+        case bfem_openrisc: return bfem_openrisc_str;
+        case bfem_blackfin: return bfem_blackfin_str;
+        case bfem_altera_nios2: return bfem_altera_nios2_str;
+        case bfem_ti_c6000: return bfem_ti_c6000_str;
+        case bfem_aarch64: return bfem_aarch64_str;
+        case bfem_frv: return bfem_frv_str;
+        case bfem_avr32: return bfem_avr32_str;
+        case bfem_alpha: return bfem_alpha_str;
+        case bfem_cygnus_v850: return bfem_cygnus_v850_str;
+        case bfem_cygnus_m32r: return bfem_cygnus_m32r_str;
+        case bfem_s390_old: return bfem_s390_old_str;
+        case bfem_cygnus_mn10300: return bfem_cygnus_mn10300_str;
+        default: return "Unknown e_machine";
+    }
+}
+
+bfelf64_sword
+bfelf_file_print_header(struct bfelf_file_t *ef)
+{
+    if (!ef)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    DEBUG("ELF Header:\n");
+    DEBUG("  %-35s %X %c %c %c\n", "Magic:", ef->ehdr->e_ident[bfei_mag0]
+          , ef->ehdr->e_ident[bfei_mag1]
+          , ef->ehdr->e_ident[bfei_mag2]
+          , ef->ehdr->e_ident[bfei_mag3]);
+
+    DEBUG("  %-35s %s\n", "Class:", ei_class_to_str(ef->ehdr->e_ident[bfei_class]));
+    DEBUG("  %-35s %s\n", "Data:", ei_data_to_str(ef->ehdr->e_ident[bfei_data]));
+    DEBUG("  %-35s %s\n", "Version:", version_to_str(ef->ehdr->e_ident[bfei_version]));
+    DEBUG("  %-35s %s\n", "OS/ABI:", ei_osabi_to_str(ef->ehdr->e_ident[bfei_osabi]));
+    DEBUG("  %-35s %d\n", "ABI Version:", ef->ehdr->e_ident[bfei_abiversion]);
+    DEBUG("  %-35s %s\n", "Type:", e_type_to_str(ef->ehdr->e_type));
+    DEBUG("  %-35s %s\n", "Machine:", e_machine_to_str(ef->ehdr->e_machine));
+    DEBUG("  %-35s %s\n", "Version:", version_to_str(ef->ehdr->e_version));
+    DEBUG("  %-35s 0x%" PRIu64 "\n", "Entry point address:", ef->ehdr->e_entry);
+    DEBUG("  %-35s 0x%" PRIu64 ", %" PRIu64 " (bytes into file)\n", "Start of program headers:", ef->ehdr->e_phoff, ef->ehdr->e_phoff);
+    DEBUG("  %-35s 0x%" PRIu64 ", %" PRIu64 " (bytes into file)\n", "Start of section headers:", ef->ehdr->e_shoff, ef->ehdr->e_shoff);
+    DEBUG("  %-35s 0x%X\n", "Flags:", ef->ehdr->e_flags);
+    DEBUG("  %-35s %d (bytes)\n", "Size of this header:", ef->ehdr->e_ehsize);
+    DEBUG("  %-35s %d (bytes)\n", "Size of program headers:", ef->ehdr->e_phentsize);
+    DEBUG("  %-35s %d\n", "Num of program headers:", ef->ehdr->e_phnum);
+    DEBUG("  %-35s %d (bytes)\n", "Size of section headers:", ef->ehdr->e_shentsize);
+    DEBUG("  %-35s %d\n", "Num of section headers:", ef->ehdr->e_shnum);
+    DEBUG("  %-35s %d\n", "Section header string table index:", ef->ehdr->e_shstrndx);
+
+    DEBUG("\n");
+
+    return BFELF_SUCCESS;
+}
+
+/******************************************************************************/
+/* ELF Section Header Table                                                   */
+/******************************************************************************/
+
+const char *bfsht_null_str = "Unused (bfsht_null)";
+const char *bfsht_progbits_str = "Program data (bfsht_progbits)";
+const char *bfsht_symtab_str = "Symbol table (bfsht_symtab)";
+const char *bfsht_strtab_str = "String table (bfsht_strtab)";
+const char *bfsht_rela_str = "Rela (bfsht_rela)";
+const char *bfsht_hash_str = "Hash table (bfsht_hash)";
+const char *bfsht_dynamic_str = "Dynamic linking table (bfsht_dynamic)";
+const char *bfsht_note_str = "Note info (bfsht_note)";
+const char *bfsht_nobits_str = "Uninitialized (bfsht_nobits)";
+const char *bfsht_rel_str = "Rel (bfsht_rel)";
+const char *bfsht_shlib_str = "Reserved (bfsht_shlib)";
+const char *bfsht_dynsym_str = "Dynamic loader table (bfsht_dynsym)";
+const char *bfsht_loos_str = "Process specific (bfsht_loos)";
+const char *bfsht_hios_str = "Process specific (bfsht_hios)";
+const char *bfsht_loproc_str = "Process specific (bfsht_loproc)";
+const char *bfsht_hiproc_str = "Process specific (bfsht_hiproc)";
+
+const char *
+sh_type_to_str(bfelf64_word value)
+{
+    switch (value)
+    {
+        case bfsht_null: return bfsht_null_str;
+        case bfsht_progbits: return bfsht_progbits_str;
+        case bfsht_symtab: return bfsht_symtab_str;
+        case bfsht_strtab: return bfsht_strtab_str;
+        case bfsht_rela: return bfsht_rela_str;
+        case bfsht_hash: return bfsht_hash_str;
+        case bfsht_dynamic: return bfsht_dynamic_str;
+        case bfsht_note: return bfsht_note_str;
+        case bfsht_nobits: return bfsht_nobits_str;
+        case bfsht_rel: return bfsht_rel_str;
+        case bfsht_shlib: return bfsht_shlib_str;
+        case bfsht_dynsym: return bfsht_dynsym_str;
+        case bfsht_loos: return bfsht_loos_str;
+        case bfsht_hios: return bfsht_hios_str;
+        case bfsht_loproc: return bfsht_loproc_str;
+        case bfsht_hiproc: return bfsht_hiproc_str;
+        default: return "Unknown sh_type";
+    }
+}
+
+bfelf64_sword
+sh_flags_is_writable(struct bfelf_shdr *shdr)
+{
+    if (!shdr)
+        return BFELF_ERROR_INVALID_ARG;
+
+    return (shdr->sh_flags & bfshf_write) != 0 ? BFELF_TRUE : BFELF_FALSE;
+}
+
+bfelf64_sword
+sh_flags_is_allocated(struct bfelf_shdr *shdr)
+{
+    if (!shdr)
+        return BFELF_ERROR_INVALID_ARG;
+
+    return (shdr->sh_flags & bfshf_alloc) != 0 ? BFELF_TRUE : BFELF_FALSE;
+}
+
+bfelf64_sword
+sh_flags_is_executable(struct bfelf_shdr *shdr)
+{
+    if (!shdr)
+        return BFELF_ERROR_INVALID_ARG;
+
+    return (shdr->sh_flags & bfshf_execinstr) != 0 ? BFELF_TRUE : BFELF_FALSE;
+}
+
+bfelf64_sword
+bfelf_section_header(struct bfelf_file_t *ef,
+                     bfelf64_word index,
+                     struct bfelf_shdr **shdr)
+{
+    if (!ef || !ef->ehdr || !ef->shdrtab || !shdr)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (index >= ef->ehdr->e_shnum)
+        return BFELF_ERROR_INVALID_INDEX;
+
+    *shdr = &(ef->shdrtab[index]);
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_print_section_header_table(struct bfelf_file_t *ef)
+{
+    bfelf64_word i = 0;
+    bfelf64_sword ret = 0;
+
+    if (!ef)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    for (i = 0; i < ef->ehdr->e_shnum; i++)
+    {
+        struct bfelf_shdr *shdr = 0;
+
+        ret = bfelf_section_header(ef, i, &shdr);
+        if (ret != BFELF_SUCCESS)
+            return ret;
+
+        ret = bfelf_print_section_header(ef, shdr);
+        if (ret != BFELF_SUCCESS)
+            return ret;
+    }
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_print_section_header(struct bfelf_file_t *ef,
+                           struct bfelf_shdr *shdr)
+{
+    bfelf64_sword ret = 0;
+    struct e_string_t section_name = {0};
+
+    if (!ef || !shdr)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    ret = bfelf_section_name_string(ef, shdr, &section_name);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    DEBUG("Section Header: %s\n", section_name.buf);
+    DEBUG("  %-35s %s\n", "Type:", sh_type_to_str(shdr->sh_type));
+    DEBUG("  %-35s ", "Flags:");
+
+    if (sh_flags_is_writable(shdr) == BFELF_TRUE) INFO("W ");
+    if (sh_flags_is_allocated(shdr) == BFELF_TRUE) INFO("A ");
+    if (sh_flags_is_executable(shdr) == BFELF_TRUE) INFO("E ");
+
+    INFO("\n");
+    DEBUG("  %-35s 0x%" PRIu64 "\n", "Address:", shdr->sh_addr);
+    DEBUG("  %-35s 0x%" PRIu64 "\n", "Offset:", shdr->sh_offset);
+    DEBUG("  %-35s %" PRIu64 " (bytes)\n", "Size:", shdr->sh_size);
+    DEBUG("  %-35s %u\n", "Linked Section:", shdr->sh_link);
+    DEBUG("  %-35s %u\n", "Info:", shdr->sh_info);
+    DEBUG("  %-35s %" PRIu64 "\n", "Address Alignment:", shdr->sh_addralign);
+    DEBUG("  %-35s %" PRIu64 "\n", "Entry Size:", shdr->sh_entsize);
+
+    DEBUG("\n");
+
+    return BFELF_SUCCESS;
+}
+
+/******************************************************************************/
+/* Section Name String Table                                                  */
+/******************************************************************************/
+
+bfelf64_sword
+bfelf_string_table_entry(struct bfelf_file_t *ef,
+                         struct bfelf_shdr *strtab,
+                         bfelf64_word offset,
+                         struct e_string_t *str)
+{
+    char *buf = 0;
+    bfelf64_word i = 0;
+    bfelf64_sword max = 0;
+    bfelf64_sword length = 0;
+    bfelf64_word hash = 5381;
+
+    if (!ef || !strtab || !str)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    if (offset > strtab->sh_size)
+        return BFELF_ERROR_INVALID_OFFSET;
+
+    buf = bfelf_section_data(ef, strtab);
+    if (buf == 0)
+        return BFELF_ERROR_INVALID_STRING_TABLE;
+
+    buf += offset;
+    max = strtab->sh_size - offset;
+
+    for (i = 0; i < max; i++, length++)
+    {
+        if (buf[i] == 0)
+            break;
+
+        hash = (hash << 5) + hash + (unsigned char)buf[i];
+    }
+
+    if (i == max)
+        return BFELF_ERROR_INVALID_STRING_TABLE;
+
+    str->buf = buf;
+    str->len = length;
+    str->hash = hash;
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_section_name_string(struct bfelf_file_t *ef,
+                          struct bfelf_shdr *shdr,
+                          struct e_string_t *str)
+{
+    if (!ef || !shdr || !str)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    return bfelf_string_table_entry(ef, ef->shstrtab, shdr->sh_name, str);
+}
+
+/******************************************************************************/
+/* ELF Dynamic Symbol Table                                                   */
+/******************************************************************************/
+
+const char *bfstb_local_str = "bfstb_local";
+const char *bfstb_global_str = "bfstb_global";
+const char *bfstb_weak_str = "bfstb_weak";
+const char *bfstb_loos_str = "bfstb_loos";
+const char *bfstb_hios_str = "bfstb_hios";
+const char *bfstb_loproc_str = "bfstb_loproc";
+const char *bfstb_hiproc_str = "bfstb_hiproc";
+
+const char *
+stb_to_str(bfelf64_word value)
+{
+    switch (BFELF_SYM_BIND(value))
+    {
+        case bfstb_local: return bfstb_local_str;
+        case bfstb_global: return bfstb_global_str;
+        case bfstb_weak: return bfstb_weak_str;
+        case bfstb_loos: return bfstb_loos_str;
+        case bfstb_hios: return bfstb_hios_str;
+        case bfstb_loproc: return bfstb_loproc_str;
+        case bfstb_hiproc: return bfstb_hiproc_str;
+        default: return "Unknown st_info (bind)";
+    }
+}
+
+const char *bfstt_notype_str = "bfstt_notype";
+const char *bfstt_object_str = "bfstt_object";
+const char *bfstt_func_str = "bfstt_func";
+const char *bfstt_section_str = "bfstt_section";
+const char *bfstt_file_str = "bfstt_file";
+const char *bfstt_gnu_ifunc_str = "bfstt_gnu_ifunc";
+const char *bfstt_hios_str = "bfstt_hios";
+const char *bfstt_loproc_str = "bfstt_loproc";
+const char *bfstt_hiproc_str = "bfstt_hiproc";
+
+const char *
+stt_to_str(bfelf64_word value)
+{
+    switch (BFELF_SYM_TYPE(value))
+    {
+        case bfstt_notype: return bfstt_notype_str;
+        case bfstt_object: return bfstt_object_str;
+        case bfstt_func: return bfstt_func_str;
+        case bfstt_section: return bfstt_section_str;
+        case bfstt_file: return bfstt_file_str;
+        case bfstt_gnu_ifunc: return bfstt_gnu_ifunc_str;
+        case bfstt_hios: return bfstt_hios_str;
+        case bfstt_loproc: return bfstt_loproc_str;
+        case bfstt_hiproc: return bfstt_hiproc_str;
+        default: return "Unknown st_info (bind)";
+    }
+}
+
+bfelf64_sword
+bfelf_symbol_by_index(struct bfelf_file_t *ef,
+                      bfelf64_word index,
+                      struct bfelf_sym **sym)
+{
+    if (!ef || !sym)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (index >= ef->symnum)
+        return BFELF_ERROR_INVALID_INDEX;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    *sym = &(ef->symtab[index]);
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_symbol_name(struct bfelf_file_t *ef,
+                  struct bfelf_sym *sym,
+                  struct e_string_t *str)
+{
+    bfelf64_xword i = 0;
+    bfelf64_xword max = 0;
+    bfelf64_word hash = 5381;
+    const char *buf = 0;
+
+    if (!ef || !sym || !str)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    if (sym->st_name > ef->dynstrsz)
+        return BFELF_ERROR_INVALID_OFFSET;
+
+    buf = ef->dynstr + sym->st_name;
+    max = ef->dynstrsz - sym->st_name;
+
+    for (i = 0; i < max; i++)
+    {
+        if (buf[i] == 0)
+            break;
+
+        hash = (hash << 5) + hash + (unsigned char)buf[i];
+    }
+
+    if (i == max)
+        return BFELF_ERROR_INVALID_STRING_TABLE;
+
+    str->buf = buf;
+    str->len = i;
+    str->hash = hash;
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_symbol_name_equals(struct bfelf_file_t *ef,
+                         bfelf64_word index,
+                         struct e_string_t *name)
+{
+    bfelf64_sword ret = 0;
+    struct bfelf_sym *sym = 0;
+
+    ret = bfelf_symbol_by_index(ef, index, &sym);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    return bfelf_symbol_name_matches(ef, sym, name);
+}
+
+bfelf64_sword
+bfelf_symbol_by_name_hash(struct bfelf_file_t *ef,
+                          struct e_string_t *name,
+                          struct bfelf_sym **sym)
+{
+    bfelf64_word i = 0;
+    bfelf64_word n = 0;
+    bfelf64_sword ret = 0;
+    struct bfhashtab_t *tab = &(ef->hashtab);
+
+    i = tab->bucket[bfelf_hash(name) % tab->nbucket];
+
+    for (n = 0; i != 0 && n < tab->nchain; i = tab->chain[i], n++)
+    {
+        if (i >= tab->nchain)
+            return BFELF_ERROR_INVALID_INDEX;
+
+        ret = bfelf_symbol_name_equals(ef, i, name);
+        if (ret == BFELF_FALSE) continue;
+        if (ret == BFELF_TRUE) break;
+        return ret;
+    }
+
+    if (i != 0 && n < tab->nchain)
+    {
+        *sym = &(ef->symtab[i]);
+        return BFELF_SUCCESS;
+    }
+
+    return BFELF_ERROR_NO_SUCH_SYMBOL;
+}
+
+bfelf64_sword
+bfelf_symbol_by_name_gnu_hash(struct bfelf_file_t *ef,
+                              struct e_string_t *name,
+                              struct bfelf_sym **sym)
+{
+    bfelf64_word i = 0;
+    bfelf64_word h1 = 0;
+    bfelf64_word h2 = 0;
+    bfelf64_sword ret = 0;
+    bfelf64_xword word = 0;
+    bfelf64_xword mask = 0;
+    struct bfgnuhashtab_t *tab = &(ef->gnuhashtab);
+
+    h1 = bfelf_string_hash(name);
+
+    word = tab->bloom[(h1 / 64) & (tab->bloom_size - 1)];
+    mask = ((bfelf64_xword)1 << (h1 % 64)) |
+           ((bfelf64_xword)1 << ((h1 >> tab->bloom_shift) % 64));
+
+    if ((word & mask) != mask)
+        return BFELF_ERROR_NO_SUCH_SYMBOL;
+
+    i = tab->bucket[h1 % tab->nbucket];
+    if (i < tab->symoffset)
+        return BFELF_ERROR_NO_SUCH_SYMBOL;
+
+    for (; i - tab->symoffset < tab->nchain; i++)
+    {
+        h2 = tab->chain[i - tab->symoffset];
+
+        if ((h1 | 1) == (h2 | 1))
+        {
+            ret = bfelf_symbol_name_equals(ef, i, name);
+            if (ret == BFELF_TRUE)
+            {
+                *sym = &(ef->symtab[i]);
+                return BFELF_SUCCESS;
+            }
+
+            if (ret != BFELF_FALSE)
+                return ret;
+        }
+
+        if ((h2 & 1) != 0)
+            break;
+    }
+
+    return BFELF_ERROR_NO_SUCH_SYMBOL;
+}
+
+bfelf64_sword
+bfelf_symbol_by_name(struct bfelf_file_t *ef,
+                     struct e_string_t *name,
+                     struct bfelf_sym **sym)
+{
+    bfelf64_sword i = 0;
+    bfelf64_sword ret = 0;
+
+    if (!ef || !name || !sym)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    if (ef->gnuhashtab.nbucket != 0)
+        return bfelf_symbol_by_name_gnu_hash(ef, name, sym);
+
+    if (ef->hashtab.nbucket != 0)
+        return bfelf_symbol_by_name_hash(ef, name, sym);
+
+    for (i = 0; i < ef->symnum; i++)
+    {
+        ret = bfelf_symbol_name_equals(ef, i, name);
+        if (ret == BFELF_FALSE) continue;
+        if (ret == BFELF_TRUE) break;
+        return ret;
+    }
+
+    if (i != ef->symnum)
+    {
+        *sym = &(ef->symtab[i]);
+        return BFELF_SUCCESS;
+    }
+
+    return BFELF_ERROR_NO_SUCH_SYMBOL;
+}
+
+bfelf64_sword
+bfelf_symbol_by_name_global(struct bfelf_file_t *efl,
+                            struct e_string_t *name,
+                            struct bfelf_file_t **efr,
+                            struct bfelf_sym **sym)
+{
+    bfelf64_sword ret = 0;
+    struct bfelf_sym *tmpsym = 0;
+    struct bfelf_file_t *tmpef = efl;
+    struct bfelf_global_sym_t *gsym = 0;
+
+    if (!efl || !name || !efr || !sym)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (efl->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    BFELF_STATS_ADD(lookups, 1);
+
+    if (efl->loader != 0)
+    {
+        struct bfelf_symtab_t *symtab = BFELF_ATOMIC_LOAD(&efl->loader->symtab);
+
+        ret = bfelf_loader_find_symbol(symtab, name, bfelf_string_hash(name), &gsym);
+        switch (ret)
+        {
+            case BFELF_SUCCESS:
+                tmpef = gsym->ef;
+                tmpsym = gsym->sym;
+                goto found;
+
+            case BFELF_ERROR_NO_SUCH_SYMBOL:
+                break;
+
+            default:
+                return ret;
+        };
+    }
+
+    ret = bfelf_symbol_by_name(tmpef, name, &tmpsym);
+    switch (ret)
+    {
+        case BFELF_SUCCESS:
+            if (tmpsym->st_value != 0)
+                goto found;
+
+        case BFELF_ERROR_NO_SUCH_SYMBOL:
+            break;
+
+        default:
+            return ret;
+    };
+
+    ALERT("failed to find: %s\n", name->buf);
+
+    return BFELF_ERROR_NO_SUCH_SYMBOL;
+
+found:
+
+    *efr = tmpef;
+    *sym = tmpsym;
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_resolve_symbol(struct bfelf_file_t *ef,
+                     struct e_string_t *name,
+                     void **addr)
+{
+    bfelf64_sword ret = 0;
+    struct bfelf_sym *sym = 0;
+    struct bfelf_file_t *efr = 0;
+
+    if (!ef || !name || !addr)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    ret = bfelf_symbol_by_name_global(ef, name, &efr, &sym);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    *addr = efr->exec + sym->st_value;
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_print_sym_table(struct bfelf_file_t *ef)
+{
+    bfelf64_sword i = 0;
+    bfelf64_sword ret = 0;
+
+    if (!ef)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    for (i = 0; i < ef->symnum; i++)
+    {
+        struct bfelf_sym *sym = 0;
+
+        ret = bfelf_symbol_by_index(ef, i, &sym);
+        if (ret != BFELF_SUCCESS)
+            return ret;
+
+        ret = bfelf_print_sym(ef, sym);
+        if (ret != BFELF_SUCCESS)
+            return ret;
+    }
+
+    DEBUG("\n");
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_print_sym(struct bfelf_file_t *ef,
+                struct bfelf_sym *sym)
+{
+    bfelf64_sword ret = 0;
+    struct e_string_t str = {0};
+
+    if (!ef || !sym)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    ret = bfelf_symbol_name(ef, sym, &str);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+#ifdef PRINT_DETAILED_SYM
+
+    DEBUG("Symbol: %s\n", str.buf);
+    DEBUG("  %-35s %s\n", "Bind:", stb_to_str(sym->st_info));
+    DEBUG("  %-35s %s\n", "Type:", stt_to_str(sym->st_info));
+    DEBUG("  %-35s %d\n", "Section Index:", sym->st_shndx);
+    DEBUG("  %-35s 0x%" PRIu64 "\n", "Value:", sym->st_value);
+    DEBUG("  %-35s 0x%" PRIu64 "\n", "Size:", sym->st_size);
+
+    DEBUG("\n");
+
+#else
+
+    DEBUG("Symbol: %-29s 0x%08" PRIu64 " %-2s %-12s %s\n", str.buf, sym->st_value, " ",
+          stb_to_str(sym->st_info),
+          stt_to_str(sym->st_info));
+
+#endif
+
+    return BFELF_SUCCESS;
+}
+
+/******************************************************************************/
+/* ELF Relocations                                                            */
+/******************************************************************************/
+
+const char *BFR_X86_64_64_STR = "BFR_X86_64_64";
+const char *BFR_X86_64_GLOB_DAT_STR = "BFR_X86_64_GLOB_DAT";
+const char *BFR_X86_64_JUMP_SLOT_STR = "BFR_X86_64_JUMP_SLOT";
+const char *BFR_X86_64_RELATIVE_STR = "BFR_X86_64_RELATIVE";
+const char *BFR_X86_64_IRELATIVE_STR = "BFR_X86_64_IRELATIVE";
+
+const char *
+rel_type_to_str(bfelf64_xword value)
+{
+    switch (BFELF_REL_TYPE(value))
+    {
+        case BFR_X86_64_64: return BFR_X86_64_64_STR;
+        case BFR_X86_64_GLOB_DAT: return BFR_X86_64_GLOB_DAT_STR;
+        case BFR_X86_64_JUMP_SLOT: return BFR_X86_64_JUMP_SLOT_STR;
+        case BFR_X86_64_RELATIVE: return BFR_X86_64_RELATIVE_STR;
+        case BFR_X86_64_IRELATIVE: return BFR_X86_64_IRELATIVE_STR;
+        default: return "Unknown BFELF_REL_TYPE(r_info)";
+    }
+}
+
+bfelf64_sword
+bfelf_relocation_symbol(struct bfelf_file_t *ef,
+                        bfelf64_word index,
+                        struct bfelf_file_t **efr,
+                        struct bfelf_sym **sym)
+{
+    bfelf64_sword ret = 0;
+    struct e_string_t name = {0};
+    struct bfelf_symcache_t *entry = 0;
+
+    if (index < ef->symcache_num)
+    {
+        entry = &(ef->symcache[index]);
+
+        if (entry->sym != 0)
+        {
+            *efr = entry->ef;
+            *sym = entry->sym;
+
+            ef->symcache_hits++;
+            BFELF_STATS_ADD(symcache_hits, 1);
+
+            return BFELF_SUCCESS;
+        }
+
+        ef->symcache_misses++;
+    }
+
+    ret = bfelf_symbol_by_index(ef, index, sym);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    /*
+     * A file linked with -Bsymbolic binds its references to the symbols it
+     * defines itself, so those never have to be looked up (and cannot be
+     * interposed by another file).
+     */
+    if (ef->symbolic == BFELF_TRUE && (*sym)->st_value != 0)
+    {
+        *efr = ef;
+        goto found;
+    }
+
+    ret = bfelf_symbol_name(ef, *sym, &name);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    ret = bfelf_symbol_by_name_global(ef, &name, efr, sym);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+found:
+
+    if (entry != 0)
+    {
+        entry->ef = *efr;
+        entry->sym = *sym;
+    }
+
+    return BFELF_SUCCESS;
+}
+
+/*
+ * Lazy Binding Trampoline
+ *
+ * The PLT stub for a function pushes the index of its relocation, and PLT0
+ * pushes GOT[1] (the ELF file) before jumping to GOT[2] (this trampoline).
+ * The trampoline preserves the argument registers, asks bfelf_lazy_resolve
+ * for the function's address (which also patches the GOT entry), pops the
+ * two values pushed by the PLT, and then jumps to the function as if it had
+ * been called directly. If the function cannot be resolved, there is
+ * nothing to return to, so the trampoline halts on a ud2 (invalid opcode)
+ * instead of jumping to 0, once bfelf_lazy_resolve has said why.
+ */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__ELF__)
+
+#define BFELF_LAZY_TRAMPOLINE
+
+void bfelf_lazy_trampoline(void);
+
+__asm__(
+    "    .text\n"
+    "    .globl bfelf_lazy_trampoline\n"
+    "    .type bfelf_lazy_trampoline, @function\n"
+    "bfelf_lazy_trampoline:\n"
+    "    push %rax\n"
+    "    push %rcx\n"
+    "    push %rdx\n"
+    "    push %rsi\n"
+    "    push %rdi\n"
+    "    push %r8\n"
+    "    push %r9\n"
+    "    push %r10\n"
+    "    sub $136, %rsp\n"
+    "    movdqu %xmm0, 0x00(%rsp)\n"
+    "    movdqu %xmm1, 0x10(%rsp)\n"
+    "    movdqu %xmm2, 0x20(%rsp)\n"
+    "    movdqu %xmm3, 0x30(%rsp)\n"
+    "    movdqu %xmm4, 0x40(%rsp)\n"
+    "    movdqu %xmm5, 0x50(%rsp)\n"
+    "    movdqu %xmm6, 0x60(%rsp)\n"
+    "    movdqu %xmm7, 0x70(%rsp)\n"
+    "    mov 200(%rsp), %rdi\n"
+    "    mov 208(%rsp), %rsi\n"
+    "    call bfelf_lazy_resolve\n"
+    "    test %rax, %rax\n"
+    "    jz 1f\n"
+    "    mov %rax, %r11\n"
+    "    movdqu 0x00(%rsp), %xmm0\n"
+    "    movdqu 0x10(%rsp), %xmm1\n"
+    "    movdqu 0x20(%rsp), %xmm2\n"
+    "    movdqu 0x30(%rsp), %xmm3\n"
+    "    movdqu 0x40(%rsp), %xmm4\n"
+    "    movdqu 0x50(%rsp), %xmm5\n"
+    "    movdqu 0x60(%rsp), %xmm6\n"
+    "    movdqu 0x70(%rsp), %xmm7\n"
+    "    add $136, %rsp\n"
+    "    pop %r10\n"
+    "    pop %r9\n"
+    "    pop %r8\n"
+    "    pop %rdi\n"
+    "    pop %rsi\n"
+    "    pop %rdx\n"
+    "    pop %rcx\n"
+    "    pop %rax\n"
+    "    add $16, %rsp\n"
+    "    jmp *%r11\n"
+    "1:\n"
+    "    ud2\n"
+    "    jmp 1b\n"
+    "    .size bfelf_lazy_trampoline, .-bfelf_lazy_trampoline\n"
+);
+
+#endif
+
+bfelf64_sword
+bfelf_lazy_binding(struct bfelf_file_t *ef)
+{
+#ifdef BFELF_LAZY_TRAMPOLINE
+
+    if (ef->loader == 0 || ef->loader->lazy != BFELF_TRUE)
+        return BFELF_FALSE;
+
+    if (ef->pltgot == 0 || ef->jmprel == 0 || ef->jmprelnum == 0)
+        return BFELF_FALSE;
+
+    if (ef->pltrel != (bfelf64_xword)bfdt_rela || ef->bind_now == BFELF_TRUE)
+        return BFELF_FALSE;
+
+    return BFELF_TRUE;
+
+#else
+
+    return BFELF_FALSE;
+
+#endif
+}
+
+bfelf64_sword
+bfelf_lazy_binding_init(struct bfelf_file_t *ef)
+{
+    bfelf64_addr *got = 0;
+
+    if (ef->pltgot + 3 * sizeof(bfelf64_addr) > ef->esize)
+        return BFELF_ERROR_INVALID_FILE;
+
+    if (ef->jmprel + ef->jmprelnum * sizeof(struct bfelf_rela) > ef->esize)
+        return BFELF_ERROR_INVALID_FILE;
+
+    got = (bfelf64_addr *)(ef->exec + ef->pltgot);
+
+#ifdef BFELF_LAZY_TRAMPOLINE
+    got[1] = (bfelf64_addr)ef;
+    got[2] = (bfelf64_addr)bfelf_lazy_trampoline;
+#endif
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_ifunc_resolve(struct bfelf_file_t *ef,
+                    bfelf64_addr resolver,
+                    bfelf64_addr *addr)
+{
+    if (ef->loader != 0 && ef->loader->no_ifunc == BFELF_TRUE)
+        return BFELF_ERROR_IFUNC_DISABLED;
+
+    *addr = ((bfelf_ifunc_resolver_t)(ef->exec + resolver))();
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_symbol_address(struct bfelf_file_t *ef,
+                     struct bfelf_sym *sym,
+                     bfelf64_addr *addr)
+{
+    if (!ef || !sym || !addr)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (BFELF_SYM_TYPE(sym->st_info) == bfstt_gnu_ifunc)
+        return bfelf_ifunc_resolve(ef, sym->st_value, addr);
+
+    *addr = (bfelf64_addr)(ef->exec + sym->st_value);
+
+    return BFELF_SUCCESS;
+}
+
+void *
+bfelf_lazy_resolve(struct bfelf_file_t *ef, bfelf64_xword index)
+{
+    bfelf64_addr *ptr = 0;
+    bfelf64_addr addr = 0;
+    bfelf64_sword ret = 0;
+    struct bfelf_sym *sym = 0;
+    struct bfelf_rela *rela = 0;
+    struct bfelf_file_t *efr = 0;
+
+    if (!ef || index >= ef->jmprelnum)
+    {
+        ALERT("lazy binding failed: invalid relocation index\n");
+        return 0;
+    }
+
+    rela = (struct bfelf_rela *)(ef->exec + ef->jmprel) + index;
+
+    ret = bfelf_relocation_symbol(ef, BFELF_REL_SYM(rela->r_info), &efr, &sym);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("lazy binding failed: %d - %s\n", ret, bfelf_error(ret));
+        return 0;
+    }
+
+    ret = bfelf_symbol_address(efr, sym, &addr);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("lazy binding failed: %d - %s\n", ret, bfelf_error(ret));
+        return 0;
+    }
+
+    ptr = (bfelf64_addr *)(ef->exec + rela->r_offset);
+    *ptr = addr;
+
+    return (void *)*ptr;
+}
+
+bfelf64_sword
+bfelf_relocate_symbol(struct bfelf_file_t *ef,
+                      struct bfelf_rel *rel)
+{
+    bfelf64_addr *ptr = 0;
+    bfelf64_addr addr = 0;
+    bfelf64_sword ret = 0;
+    struct bfelf_sym *sym = 0;
+    struct bfelf_file_t *efr = 0;
+
+    if (!ef || !rel)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    ret = bfelf_relocation_symbol(ef, BFELF_REL_SYM(rel->r_info), &efr, &sym);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    ptr = (bfelf64_addr *)(ef->exec + rel->r_offset);
+
+    if (ptr > (bfelf64_addr *)(ef->exec + ef->esize))
+        return BFELF_ERROR_INVALID_FILE;
+
+    ret = bfelf_symbol_address(efr, sym, &addr);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    switch (BFELF_REL_TYPE(rel->r_info))
+    {
+        case BFR_X86_64_GLOB_DAT:
+            *ptr = addr;
+            BFELF_STATS_ADD(relocs_glob_dat, 1);
+            break;
+
+        case BFR_X86_64_JUMP_SLOT:
+            *ptr = addr;
+            BFELF_STATS_ADD(relocs_jump_slot, 1);
+            break;
+
+        default:
+            return BFELF_ERROR_INVALID_RELOCATION_TYPE;
+    }
+
+    return BFELF_SUCCESS;
+}
+
+bfelf64_sword
+bfelf_relocate_symbol_addend(struct bfelf_file_t *ef,
+                             struct bfelf_rela *rela)
+{
+    bfelf64_addr *ptr = 0;
+    bfelf64_addr addr = 0;
+    bfelf64_sword ret = 0;
+    bfelf64_sword lazy = 0;
+    struct bfelf_sym *sym = 0;
+    struct bfelf_file_t *efr = 0;
+
+    if (!ef || !rela)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
+
+    if (BFELF_REL_TYPE(rela->r_info) == BFR_X86_64_JUMP_SLOT)
+        lazy = bfelf_lazy_binding(ef);
+
+    switch (BFELF_REL_TYPE(rela->r_info))
+    {
+        case BFR_X86_64_RELATIVE:
+        case BFR_X86_64_IRELATIVE:
+            break;
+
+        default:
+        {
+            if (lazy == BFELF_TRUE)
+                break;
+
+            ret = bfelf_relocation_symbol(ef, BFELF_REL_SYM(rela->r_info), &efr, &sym);
+            if (ret != BFELF_SUCCESS)
+                return ret;
+        }
+    };
+
+    ptr = (bfelf64_addr *)(ef->exec + rela->r_offset);
 
-    if (ef->valid != BFELF_TRUE)
+    if (ptr > (bfelf64_addr *)(ef->exec + ef->esize))
         return BFELF_ERROR_INVALID_FILE;
 
-    DEBUG("ELF Header:\n");
-    DEBUG("  %-35s %X %c %c %c\n", "Magic:", ef->ehdr->e_ident[bfei_mag0]
-          , ef->ehdr->e_ident[bfei_mag1]
-          , ef->ehdr->e_ident[bfei_mag2]
-          , ef->ehdr->e_ident[bfei_mag3]);
+    /* When binding lazily, the GOT entry for a JUMP_SLOT relocation still
+       holds the (unrelocated) address of its PLT stub, which is rebased
+       so that the first call goes through the resolver trampoline. An
+       entry that has already been bound is left alone. */
 
-    DEBUG("  %-35s %s\n", "Class:", ei_class_to_str(ef->ehdr->e_ident[bfei_class]));
-    DEBUG("  %-35s %s\n", "Data:", ei_data_to_str(ef->ehdr->e_ident[bfei_data]));
-    DEBUG("  %-35s %s\n", "Version:", version_to_str(ef->ehdr->e_ident[bfei_version]));
-    DEBUG("  %-35s %s\n", "OS/ABI:", ei_osabi_to_str(ef->ehdr->e_ident[bfei_osabi]));
-    DEBUG("  %-35s %d\n", "ABI Version:", ef->ehdr->e_ident[bfei_abiversion]);
-    DEBUG("  %-35s %s\n", "Type:", e_type_to_str(ef->ehdr->e_type));
-    DEBUG("  %-35s %s\n", "Machine:", e_machine_to_str(ef->ehdr->e_machine));
-    DEBUG("  %-35s %s\n", "Version:", version_to_str(ef->ehdr->e_version));
-    DEBUG("  %-35s 0x%" PRIu64 "\n", "Entry point address:", ef->ehdr->e_entry);
-    DEBUG("  %-35s 0x%" PRIu64 ", %" PRIu64 " (bytes into file)\n", "Start of program headers:", ef->ehdr->e_phoff, ef->ehdr->e_phoff);
-    DEBUG("  %-35s 0x%" PRIu64 ", %" PRIu64 " (bytes into file)\n", "Start of section headers:", ef->ehdr->e_shoff, ef->ehdr->e_shoff);
-    DEBUG("  %-35s 0x%X\n", "Flags:", ef->ehdr->e_flags);
-    DEBUG("  %-35s %d (bytes)\n", "Size of this header:", ef->ehdr->e_ehsize);
-    DEBUG("  %-35s %d (bytes)\n", "Size of program headers:", ef->ehdr->e_phentsize);
-    DEBUG("  %-35s %d\n", "Num of program headers:", ef->ehdr->e_phnum);
-    DEBUG("  %-35s %d (bytes)\n", "Size of section headers:", ef->ehdr->e_shentsize);
-    DEBUG("  %-35s %d\n", "Num of section headers:", ef->ehdr->e_shnum);
-    DEBUG("  %-35s %d\n", "Section header string table index:", ef->ehdr->e_shstrndx);
+    if (lazy == BFELF_TRUE)
+    {
+        if (*ptr < (bfelf64_addr)ef->esize)
+            *ptr += (bfelf64_addr)ef->exec;
 
-    DEBUG("\n");
+        BFELF_STATS_ADD(relocs_jump_slot, 1);
+        return BFELF_SUCCESS;
+    }
 
-    return BFELF_SUCCESS;
-}
+    /*
+     * An IFUNC is resolved here, once, so the address that is written is
+     * that of the implementation that its resolver selected.
+     */
 
-/******************************************************************************/
-/* ELF Section Header Table                                                   */
-/******************************************************************************/
+    if (efr != 0)
+        ret = bfelf_symbol_address(efr, sym, &addr);
+    else if (BFELF_REL_TYPE(rela->r_info) == BFR_X86_64_IRELATIVE)
+        ret = bfelf_ifunc_resolve(ef, rela->r_addend, &addr);
 
-const char *bfsht_null_str = "Unused (bfsht_null)";
-const char *bfsht_progbits_str = "Program data (bfsht_progbits)";
-const char *bfsht_symtab_str = "Symbol table (bfsht_symtab)";
-const char *bfsht_strtab_str = "String table (bfsht_strtab)";
-const char *bfsht_rela_str = "Rela (bfsht_rela)";
-const char *bfsht_hash_str = "Hash table (bfsht_hash)";
-const char *bfsht_dynamic_str = "Dynamic linking table (bfsht_dynamic)";
-const char *bfsht_note_str = "Note info (bfsht_note)";
-const char *bfsht_nobits_str = "Uninitialized (bfsht_nobits)";
-const char *bfsht_rel_str = "Rel (bfsht_rel)";
-const char *bfsht_shlib_str = "Reserved (bfsht_shlib)";
-const char *bfsht_dynsym_str = "Dynamic loader table (bfsht_dynsym)";
-const char *bfsht_loos_str = "Process specific (bfsht_loos)";
-const char *bfsht_hios_str = "Process specific (bfsht_hios)";
-const char *bfsht_loproc_str = "Process specific (bfsht_loproc)";
-const char *bfsht_hiproc_str = "Process specific (bfsht_hiproc)";
+    if (ret != BFELF_SUCCESS)
+        return ret;
 
-const char *
-sh_type_to_str(bfelf64_word value)
-{
-    switch (value)
+    switch (BFELF_REL_TYPE(rela->r_info))
     {
-        case bfsht_null: return bfsht_null_str;
-        case bfsht_progbits: return bfsht_progbits_str;
-        case bfsht_symtab: return bfsht_symtab_str;
-        case bfsht_strtab: return bfsht_strtab_str;
-        case bfsht_rela: return bfsht_rela_str;
-        case bfsht_hash: return bfsht_hash_str;
-        case bfsht_dynamic: return bfsht_dynamic_str;
-        case bfsht_note: return bfsht_note_str;
-        case bfsht_nobits: return bfsht_nobits_str;
-        case bfsht_rel: return bfsht_rel_str;
-        case bfsht_shlib: return bfsht_shlib_str;
-        case bfsht_dynsym: return bfsht_dynsym_str;
-        case bfsht_loos: return bfsht_loos_str;
-        case bfsht_hios: return bfsht_hios_str;
-        case bfsht_loproc: return bfsht_loproc_str;
-        case bfsht_hiproc: return bfsht_hiproc_str;
-        default: return "Unknown sh_type";
+        case BFR_X86_64_64:
+            *ptr = addr + rela->r_addend;
+            BFELF_STATS_ADD(relocs_64, 1);
+            break;
+
+        case BFR_X86_64_GLOB_DAT:
+            *ptr = addr;
+            BFELF_STATS_ADD(relocs_glob_dat, 1);
+            break;
+
+        case BFR_X86_64_JUMP_SLOT:
+            *ptr = addr;
+            BFELF_STATS_ADD(relocs_jump_slot, 1);
+            break;
+
+        case BFR_X86_64_RELATIVE:
+            *ptr = (bfelf64_addr)(ef->exec + rela->r_addend);
+            BFELF_STATS_ADD(relocs_relative, 1);
+            break;
+
+        case BFR_X86_64_IRELATIVE:
+            *ptr = addr;
+            BFELF_STATS_ADD(relocs_irelative, 1);
+            break;
+
+        default:
+            return BFELF_ERROR_INVALID_RELOCATION_TYPE;
     }
+
+    return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-sh_flags_is_writable(struct bfelf_shdr *shdr)
+bfelf_relocate_relative(struct bfelf_file_t *ef,
+                        struct bfrelatab_t *relatab)
 {
-    if (!shdr)
-        return BFELF_ERROR_INVALID_ARG;
+    bfelf64_sword r = 0;
+    struct bfelf_rela *rela = relatab->tab;
+    bfelf64_addr exec = (bfelf64_addr)ef->exec;
+    bfelf64_addr limit = (bfelf64_addr)ef->esize - sizeof(bfelf64_addr);
 
-    return (shdr->sh_flags & bfshf_write) != 0 ? BFELF_TRUE : BFELF_FALSE;
-}
+    for (r = 0; r < relatab->num_relative; r++)
+    {
+        if (rela[r].r_offset > limit)
+            return BFELF_ERROR_INVALID_FILE;
 
-bfelf64_sword
-sh_flags_is_allocated(struct bfelf_shdr *shdr)
-{
-    if (!shdr)
-        return BFELF_ERROR_INVALID_ARG;
+        *(bfelf64_addr *)(exec + rela[r].r_offset) = exec + rela[r].r_addend;
+    }
 
-    return (shdr->sh_flags & bfshf_alloc) != 0 ? BFELF_TRUE : BFELF_FALSE;
+    BFELF_STATS_ADD(relocs_relative, relatab->num_relative);
+
+    return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-sh_flags_is_executable(struct bfelf_shdr *shdr)
+bfelf_relr_apply(char *exec,
+                 bfelf64_xword esize,
+                 bfelf64_xword *relr,
+                 bfelf64_xword num)
 {
-    if (!shdr)
+    bfelf64_xword i = 0;
+    bfelf64_xword n = 0;
+    bfelf64_xword bits = 0;
+    bfelf64_addr where = 0;
+    bfelf64_addr base = 0;
+    bfelf64_addr limit = 0;
+    bfelf64_xword count = 0;
+
+    if (!exec || !relr)
         return BFELF_ERROR_INVALID_ARG;
 
-    return (shdr->sh_flags & bfshf_execinstr) != 0 ? BFELF_TRUE : BFELF_FALSE;
+    if (esize < sizeof(bfelf64_addr))
+        return BFELF_ERROR_INVALID_FILE;
+
+    base = (bfelf64_addr)exec;
+    limit = (bfelf64_addr)esize - sizeof(bfelf64_addr);
+
+    /*
+     * Since each relocation adds to what is already stored, the table is
+     * checked before any of it is applied, so an invalid table leaves the
+     * image untouched instead of partly relocated.
+     */
+
+    for (i = 0; i < num; i++)
+    {
+        if ((relr[i] & 1) == 0)
+        {
+            where = relr[i];
+
+            if (where > limit)
+                return BFELF_ERROR_INVALID_FILE;
+
+            where += sizeof(bfelf64_addr);
+            continue;
+        }
+
+        bits = relr[i] >> 1;
+
+        if (bits != 0 && where + (63 - __builtin_clzll(bits)) * sizeof(bfelf64_addr) > limit)
+            return BFELF_ERROR_INVALID_FILE;
+
+        where += 63 * sizeof(bfelf64_addr);
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        if ((relr[i] & 1) == 0)
+        {
+            where = relr[i];
+
+            *(bfelf64_addr *)(base + where) += base;
+
+            where += sizeof(bfelf64_addr);
+            count++;
+            continue;
+        }
+
+        for (bits = relr[i] >> 1, n = 0; bits != 0; bits >>= 1, n++)
+        {
+            if ((bits & 1) == 0)
+                continue;
+
+            *(bfelf64_addr *)(base + where + n * sizeof(bfelf64_addr)) += base;
+            count++;
+        }
+
+        where += 63 * sizeof(bfelf64_addr);
+    }
+
+    BFELF_STATS_ADD(relocs_relr, count);
+
+    return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-bfelf_section_header(struct bfelf_file_t *ef,
-                     bfelf64_word index,
-                     struct bfelf_shdr **shdr)
+bfelf_relocate_relr(struct bfelf_file_t *ef)
 {
-    if (!ef || !ef->ehdr || !ef->shdrtab || !shdr)
+    bfelf64_sword ret = 0;
+
+    if (!ef)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (index >= ef->ehdr->e_shnum)
-        return BFELF_ERROR_INVALID_INDEX;
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
 
-    *shdr = &(ef->shdrtab[index]);
+    if (ef->relrnum == 0 || ef->relr_applied == BFELF_TRUE)
+        return BFELF_SUCCESS;
 
+    if (ef->relr + ef->relrnum * sizeof(bfelf64_xword) > ef->esize)
+        return BFELF_ERROR_INVALID_FILE;
+
+    ret = bfelf_relr_apply(ef->exec,
+                           ef->esize,
+                           (bfelf64_xword *)(ef->exec + ef->relr),
+                           ef->relrnum);
+    if (ret != BFELF_SUCCESS)
+        return ret;
+
+    ef->relr_applied = BFELF_TRUE;
     return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-bfelf_print_section_header_table(struct bfelf_file_t *ef)
+bfelf_relocate_symbols(struct bfelf_file_t *ef)
 {
-    bfelf64_word i = 0;
+    return bfelf_relocate_symbols_cache(ef, 0, 0);
+}
+
+bfelf64_sword
+bfelf_relocate_symbols_cache(struct bfelf_file_t *ef,
+                             struct bfelf_symcache_t *symcache,
+                             bfelf64_sword symcache_num)
+{
+    bfelf64_word t = 0;
+    bfelf64_word r = 0;
+    bfelf64_sword i = 0;
     bfelf64_sword ret = 0;
+    struct bfelf_symcache_t entry = {0};
 
     if (!ef)
         return BFELF_ERROR_INVALID_ARG;
@@ -815,326 +3854,436 @@ bfelf_print_section_header_table(struct bfelf_file_t *ef)
     if (ef->valid != BFELF_TRUE)
         return BFELF_ERROR_INVALID_FILE;
 
-    for (i = 0; i < ef->ehdr->e_shnum; i++)
+    ef->symcache_hits = 0;
+    ef->symcache_misses = 0;
+
+    if (symcache != 0 && symcache_num > 0)
     {
-        struct bfelf_shdr *shdr = 0;
+        ef->symcache = symcache;
+        ef->symcache_num = ef->symnum;
 
-        ret = bfelf_section_header(ef, i, &shdr);
+        if (ef->symcache_num > symcache_num)
+            ef->symcache_num = symcache_num;
+
+        for (i = 0; i < ef->symcache_num; i++)
+            ef->symcache[i] = entry;
+    }
+
+    if (bfelf_lazy_binding(ef) == BFELF_TRUE)
+    {
+        ret = bfelf_lazy_binding_init(ef);
         if (ret != BFELF_SUCCESS)
-            return ret;
+            goto done;
+    }
 
-        ret = bfelf_print_section_header(ef, shdr);
+    for (t = 0; t < ef->num_rel; t++)
+    {
+        for (r = 0; r < ef->bfreltab[t].num; r++)
+        {
+            ret = bfelf_relocate_symbol(ef, &(ef->bfreltab[t].tab[r]));
+            if (ret != BFELF_SUCCESS)
+                goto done;
+        }
+    }
+
+    ret = bfelf_relocate_relr(ef);
+    if (ret != BFELF_SUCCESS)
+        goto done;
+
+    for (t = 0; t < ef->num_rela; t++)
+    {
+        ret = bfelf_relocate_relative(ef, &(ef->bfrelatab[t]));
         if (ret != BFELF_SUCCESS)
-            return ret;
+            goto done;
+
+        for (r = ef->bfrelatab[t].num_relative; r < ef->bfrelatab[t].num; r++)
+        {
+            ret = bfelf_relocate_symbol_addend(ef, &(ef->bfrelatab[t].tab[r]));
+            if (ret != BFELF_SUCCESS)
+                goto done;
+        }
     }
 
-    return BFELF_SUCCESS;
+done:
+
+    ef->symcache = 0;
+    ef->symcache_num = 0;
+
+    return ret;
 }
 
 bfelf64_sword
-bfelf_print_section_header(struct bfelf_file_t *ef,
-                           struct bfelf_shdr *shdr)
+bfelf_rebind_symbols(struct bfelf_file_t *ef)
 {
+    bfelf64_word t = 0;
+    bfelf64_word r = 0;
     bfelf64_sword ret = 0;
-    struct e_string_t section_name = {0};
 
-    if (!ef || !shdr)
+    if (!ef)
         return BFELF_ERROR_INVALID_ARG;
 
     if (ef->valid != BFELF_TRUE)
         return BFELF_ERROR_INVALID_FILE;
 
-    ret = bfelf_section_name_string(ef, shdr, &section_name);
-    if (ret != BFELF_SUCCESS)
-        return ret;
+    for (t = 0; t < ef->num_rel; t++)
+    {
+        for (r = 0; r < ef->bfreltab[t].num; r++)
+        {
+            ret = bfelf_relocate_symbol(ef, &(ef->bfreltab[t].tab[r]));
+            if (ret != BFELF_SUCCESS)
+                return ret;
+        }
+    }
 
-    DEBUG("Section Header: %s\n", section_name.buf);
-    DEBUG("  %-35s %s\n", "Type:", sh_type_to_str(shdr->sh_type));
-    DEBUG("  %-35s ", "Flags:");
+    for (t = 0; t < ef->num_rela; t++)
+    {
+        for (r = ef->bfrelatab[t].num_relative; r < ef->bfrelatab[t].num; r++)
+        {
+            ret = bfelf_relocate_symbol_addend(ef, &(ef->bfrelatab[t].tab[r]));
+            if (ret != BFELF_SUCCESS)
+                return ret;
+        }
+    }
 
-    if (sh_flags_is_writable(shdr) == BFELF_TRUE) INFO("W ");
-    if (sh_flags_is_allocated(shdr) == BFELF_TRUE) INFO("A ");
-    if (sh_flags_is_executable(shdr) == BFELF_TRUE) INFO("E ");
+    return BFELF_SUCCESS;
+}
 
-    INFO("\n");
-    DEBUG("  %-35s 0x%" PRIu64 "\n", "Address:", shdr->sh_addr);
-    DEBUG("  %-35s 0x%" PRIu64 "\n", "Offset:", shdr->sh_offset);
-    DEBUG("  %-35s %" PRIu64 " (bytes)\n", "Size:", shdr->sh_size);
-    DEBUG("  %-35s %u\n", "Linked Section:", shdr->sh_link);
-    DEBUG("  %-35s %u\n", "Info:", shdr->sh_info);
-    DEBUG("  %-35s %" PRIu64 "\n", "Address Alignment:", shdr->sh_addralign);
-    DEBUG("  %-35s %" PRIu64 "\n", "Entry Size:", shdr->sh_entsize);
+bfelf64_sword
+bfelf_print_relocation(struct bfelf_rel *rel)
+{
+    if (!rel)
+        return BFELF_ERROR_INVALID_ARG;
+
+#ifdef PRINT_DETAILED_REL
+
+    DEBUG("Relocation:\n");
+    DEBUG("  %-35s 0x%08" PRIu64 "\n", "Offset:", rel->r_offset);
+    DEBUG("  %-35s %" PRId64 "\n", "Symbol:", BFELF_REL_SYM(rel->r_info));
+    DEBUG("  %-35s %s\n", "Type:", rel_type_to_str(rel->r_info));
 
     DEBUG("\n");
 
+#else
+
+    DEBUG("Relocation: %-20s 0x%08" PRIu64 " %04" PRId64 "\n", rel_type_to_str(rel->r_info),
+          rel->r_offset,
+          BFELF_REL_SYM(rel->r_info));
+
+#endif
+
     return BFELF_SUCCESS;
 }
 
-/******************************************************************************/
-/* Section Name String Table                                                  */
-/******************************************************************************/
-
 bfelf64_sword
-bfelf_string_table_entry(struct bfelf_file_t *ef,
-                         struct bfelf_shdr *strtab,
-                         bfelf64_word offset,
-                         struct e_string_t *str)
+bfelf_print_relocation_addend(struct bfelf_rela *rela)
 {
-    char *buf = 0;
-    bfelf64_word i = 0;
-    bfelf64_sword max = 0;
-    bfelf64_sword length = 0;
-
-    if (!ef || !strtab || !str)
+    if (!rela)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (ef->valid != BFELF_TRUE)
-        return BFELF_ERROR_INVALID_FILE;
+#ifdef PRINT_DETAILED_REL
 
-    if (offset > strtab->sh_size)
-        return BFELF_ERROR_INVALID_OFFSET;
+    DEBUG("Relocation:\n");
+    DEBUG("  %-35s 0x%08" PRIu64 "\n", "Offset:", rela->r_offset);
+    DEBUG("  %-35s %" PRId64 "\n", "Symbol:", BFELF_REL_SYM(rela->r_info));
+    DEBUG("  %-35s %s\n", "Type:", rel_type_to_str(rela->r_info));
+    DEBUG("  %-35s 0x%" PRIu64 "\n", "Addend:", rela->r_addend);
 
-    buf = ef->file + strtab->sh_offset + offset;
-    max = strtab->sh_size - offset;
+    DEBUG("\n");
 
-    for (i = 0; i < max; i++, length++)
-    {
-        if (buf[i] == 0)
-            break;
-    }
+#else
 
-    if (i == max)
-        return BFELF_ERROR_INVALID_STRING_TABLE;
+    DEBUG("Relocation: %-20s 0x%08" PRIu64 " %04" PRId64 " 0x%08" PRIu64 "\n", rel_type_to_str(rela->r_info),
+          rela->r_offset,
+          BFELF_REL_SYM(rela->r_info),
+          rela->r_addend);
 
-    str->buf = buf;
-    str->len = length;
+#endif
 
     return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-bfelf_section_name_string(struct bfelf_file_t *ef,
-                          struct bfelf_shdr *shdr,
-                          struct e_string_t *str)
+bfelf_print_relocations(struct bfelf_file_t *ef)
 {
-    if (!ef || !shdr || !str)
+    bfelf64_word t = 0;
+    bfelf64_word r = 0;
+    bfelf64_sword ret = 0;
+
+    if (!ef)
         return BFELF_ERROR_INVALID_ARG;
 
     if (ef->valid != BFELF_TRUE)
         return BFELF_ERROR_INVALID_FILE;
 
-    return bfelf_string_table_entry(ef, ef->shstrtab, shdr->sh_name, str);
+    for (t = 0; t < ef->num_rel; t++)
+    {
+        for (r = 0; r < ef->bfreltab[t].num; r++)
+        {
+            ret = bfelf_print_relocation(&(ef->bfreltab[t].tab[r]));
+            if (ret != BFELF_SUCCESS)
+                return ret;
+        }
+    }
+
+    for (t = 0; t < ef->num_rela; t++)
+    {
+        for (r = 0; r < ef->bfrelatab[t].num; r++)
+        {
+            ret = bfelf_print_relocation_addend(&(ef->bfrelatab[t].tab[r]));
+            if (ret != BFELF_SUCCESS)
+                return ret;
+        }
+    }
+
+    DEBUG("\n");
+
+    return BFELF_SUCCESS;
 }
 
 /******************************************************************************/
-/* ELF Dynamic Symbol Table                                                   */
+/* ELF Program Header                                                         */
 /******************************************************************************/
 
-const char *bfstb_local_str = "bfstb_local";
-const char *bfstb_global_str = "bfstb_global";
-const char *bfstb_weak_str = "bfstb_weak";
-const char *bfstb_loos_str = "bfstb_loos";
-const char *bfstb_hios_str = "bfstb_hios";
-const char *bfstb_loproc_str = "bfstb_loproc";
-const char *bfstb_hiproc_str = "bfstb_hiproc";
+/* TODO: Need function to return a map that explains how to set the permissions
+   of the memory used to load the ELF file. This way, portions of the RAM that
+   holds the program can be RW and other portions can be RE */
+
+const char *bfpt_null_str = "Unused entry (bfpt_null)";
+const char *bfpt_load_str = "Loadable segment (bfpt_load)";
+const char *bfpt_dynamic_str = "Dynamic linking tables (bfpt_dynamic)";
+const char *bfpt_interp_str = "Program interpreter path name (bfpt_interp)";
+const char *bfpt_note_str = "Note sections (bfpt_note)";
+const char *bfpt_shlib_str = "Reserved (bfpt_shlib)";
+const char *bfpt_phdr_str = "Program header table (bfpt_phdr)";
+const char *bfpt_loos_str = "Environment specific (bfpt_loos)";
+const char *bfpt_hios_str = "Environment specific (bfpt_hios)";
+const char *bfpt_loproc_str = "Processor specific (bfpt_loproc)";
+const char *bfpt_hiproc_str = "Processor specific (bfpt_hiproc)";
 
 const char *
-stb_to_str(bfelf64_word value)
+p_type_to_str(bfelf64_word value)
 {
-    switch (BFELF_SYM_BIND(value))
+    switch (value)
     {
-        case bfstb_local: return bfstb_local_str;
-        case bfstb_global: return bfstb_global_str;
-        case bfstb_weak: return bfstb_weak_str;
-        case bfstb_loos: return bfstb_loos_str;
-        case bfstb_hios: return bfstb_hios_str;
-        case bfstb_loproc: return bfstb_loproc_str;
-        case bfstb_hiproc: return bfstb_hiproc_str;
-        default: return "Unknown st_info (bind)";
+        case bfpt_null: return bfpt_null_str;
+        case bfpt_load: return bfpt_load_str;
+        case bfpt_dynamic: return bfpt_dynamic_str;
+        case bfpt_interp: return bfpt_interp_str;
+        case bfpt_note: return bfpt_note_str;
+        case bfpt_shlib: return bfpt_shlib_str;
+        case bfpt_phdr: return bfpt_phdr_str;
+        case bfpt_loos: return bfpt_loos_str;
+        case bfpt_hios: return bfpt_hios_str;
+        case bfpt_loproc: return bfpt_loproc_str;
+        case bfpt_hiproc: return bfpt_hiproc_str;
+        default: return "Unknown p_type";
     }
 }
 
-const char *bfstt_notype_str = "bfstt_notype";
-const char *bfstt_object_str = "bfstt_object";
-const char *bfstt_func_str = "bfstt_func";
-const char *bfstt_section_str = "bfstt_section";
-const char *bfstt_file_str = "bfstt_file";
-const char *bfstt_loos_str = "bfstt_loos";
-const char *bfstt_hios_str = "bfstt_hios";
-const char *bfstt_loproc_str = "bfstt_loproc";
-const char *bfstt_hiproc_str = "bfstt_hiproc";
+bfelf64_sword
+p_flags_is_executable(struct bfelf_phdr *phdr)
+{
+    if (!phdr)
+        return BFELF_ERROR_INVALID_ARG;
 
-const char *
-stt_to_str(bfelf64_word value)
+    return (phdr->p_flags & bfpf_x) != 0 ? BFELF_TRUE : BFELF_FALSE;
+}
+
+bfelf64_sword
+p_flags_is_writable(struct bfelf_phdr *phdr)
 {
-    switch (BFELF_SYM_TYPE(value))
-    {
-        case bfstt_notype: return bfstt_notype_str;
-        case bfstt_object: return bfstt_object_str;
-        case bfstt_func: return bfstt_func_str;
-        case bfstt_section: return bfstt_section_str;
-        case bfstt_file: return bfstt_file_str;
-        case bfstt_loos: return bfstt_loos_str;
-        case bfstt_hios: return bfstt_hios_str;
-        case bfstt_loproc: return bfstt_loproc_str;
-        case bfstt_hiproc: return bfstt_hiproc_str;
-        default: return "Unknown st_info (bind)";
-    }
+    if (!phdr)
+        return BFELF_ERROR_INVALID_ARG;
+
+    return (phdr->p_flags & bfpf_w) != 0 ? BFELF_TRUE : BFELF_FALSE;
 }
 
 bfelf64_sword
-bfelf_symbol_by_index(struct bfelf_file_t *ef,
-                      bfelf64_word index,
-                      struct bfelf_sym **sym)
+p_flags_is_readable(struct bfelf_phdr *phdr)
 {
-    if (!ef || !sym)
+    if (!phdr)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (index >= ef->symnum)
-        return BFELF_ERROR_INVALID_INDEX;
+    return (phdr->p_flags & bfpf_r) != 0 ? BFELF_TRUE : BFELF_FALSE;
+}
 
-    if (ef->valid != BFELF_TRUE)
-        return BFELF_ERROR_INVALID_FILE;
+bfelf64_sword
+bfelf_program_header(struct bfelf_file_t *ef,
+                     bfelf64_word index,
+                     struct bfelf_phdr **phdr)
+{
+    if (!ef || !ef->ehdr || !ef->phdrtab || !phdr)
+        return BFELF_ERROR_INVALID_ARG;
 
-    *sym = &(ef->symtab[index]);
+    if (index >= ef->ehdr->e_phnum)
+        return BFELF_ERROR_INVALID_INDEX;
+
+    *phdr = &(ef->phdrtab[index]);
 
     return BFELF_SUCCESS;
 }
 
-bfelf64_sword
-bfelf_symbol_by_name(struct bfelf_file_t *ef,
-                     struct e_string_t *name,
-                     struct bfelf_sym **sym)
+bfelf64_sxword
+bfelf_total_exec_size(struct bfelf_file_t *ef)
 {
-    bfelf64_sword i = 0;
+    bfelf64_word i = 0;
     bfelf64_sword ret = 0;
+    bfelf64_sxword total_size = 0;
 
-    /* TODO: Use .hash instead of a O(n) loop. */
-
-    if (!ef || !name || !sym)
+    if (!ef)
         return BFELF_ERROR_INVALID_ARG;
 
     if (ef->valid != BFELF_TRUE)
         return BFELF_ERROR_INVALID_FILE;
 
-    for (i = 0; i < ef->symnum; i++)
+    for (i = 0; i < ef->ehdr->e_phnum; i++)
     {
-        struct bfelf_sym *sym = 0;
-        struct e_string_t str = {0};
-
-        ret = bfelf_symbol_by_index(ef, i, &sym);
-        if (ret != BFELF_SUCCESS)
-            return ret;
+        bfelf64_sxword size = 0;
+        struct bfelf_phdr *phdr = 0;
 
-        ret = bfelf_string_table_entry(ef, ef->strtab, sym->st_name, &str);
+        ret = bfelf_program_header(ef, i, &phdr);
         if (ret != BFELF_SUCCESS)
             return ret;
 
-        ret = bfelf_strcmp(name, &str);
-        if (ret == BFELF_FALSE) continue;
-        if (ret == BFELF_TRUE) break;
-        return ret;
-    }
+        size = phdr->p_vaddr + phdr->p_memsz;
 
-    if (i != ef->symnum)
-    {
-        *sym = &(ef->symtab[i]);
-        return BFELF_SUCCESS;
+        if (size > total_size)
+            total_size = size;
     }
 
-    return BFELF_ERROR_NO_SUCH_SYMBOL;
+    return total_size;
 }
 
 bfelf64_sword
-bfelf_symbol_by_name_global(struct bfelf_file_t *efl,
-                            struct e_string_t *name,
-                            struct bfelf_file_t **efr,
-                            struct bfelf_sym **sym)
+bfelf_load_segments(struct bfelf_file_t *ef)
 {
-    bfelf64_sword i = 0;
+    bfelf64_word i = 0;
     bfelf64_sword ret = 0;
-    struct bfelf_sym *tmpsym = 0;
-    struct bfelf_file_t *tmpef = efl;
+    bfelf64_addr end = 0;
+    bfelf64_sword sorted = BFELF_TRUE;
+    struct bfelf_phdr *phdr = 0;
 
-    if (!efl || !name || !efr || !sym)
+    if (!ef)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (efl->valid != BFELF_TRUE)
-        return BFELF_ERROR_INVALID_FILE;
-
-    ret = bfelf_symbol_by_name(tmpef, name, &tmpsym);
-    switch (ret)
-    {
-        case BFELF_SUCCESS:
-            if (tmpsym->st_value != 0)
-                goto found;
+    if (ef->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
 
-        case BFELF_ERROR_NO_SUCH_SYMBOL:
-            break;
+    /*
+     * Only the parts of the image that are not loaded from the file need to
+     * be zeroed: the holes between segments (and the BSS at the end of each
+     * segment, which is handled by bfelf_load_segment). This requires the
+     * PT_LOAD segments to be sorted and not overlap, which the ELF
+     * specification requires. If they are not, the whole image is zeroed
+     * first instead. If the image was zeroed by the caller, nothing but the
+     * segments is touched, as the holes might belong to another ELF file.
+     */
 
-        default:
-            return ret;
-    };
+    if (ef->zeroed == BFELF_TRUE)
+        sorted = BFELF_FALSE;
 
-    for (i = 0; i < efl->efnum; i++)
+    for (i = 0; sorted == BFELF_TRUE && i < ef->ehdr->e_phnum; i++)
     {
-        tmpef = efl->eftab[i];
+        ret = bfelf_program_header(ef, i, &phdr);
+        if (ret != BFELF_SUCCESS)
+            return ret;
 
-        ret = bfelf_symbol_by_name(tmpef, name, &tmpsym);
-        switch (ret)
+        if (phdr->p_type != bfpt_load)
+            continue;
+
+        if (phdr->p_vaddr < end)
         {
-            case BFELF_SUCCESS:
-                if (tmpsym->st_value != 0)
-                    goto found;
+            sorted = BFELF_FALSE;
+            break;
+        }
 
-            case BFELF_ERROR_NO_SUCH_SYMBOL:
-                break;
+        end = phdr->p_vaddr + phdr->p_memsz;
+    }
 
-            default:
-                return ret;
-        };
+    if (sorted == BFELF_FALSE && ef->zeroed != BFELF_TRUE)
+    {
+        bfelf_memclr(ef->exec, ef->esize);
+        BFELF_STATS_ADD(bytes_zeroed, ef->esize);
     }
 
-    ALERT("failed to find: %s\n", name->buf);
+    for (i = 0, end = 0; i < ef->ehdr->e_phnum; i++)
+    {
+        ret = bfelf_program_header(ef, i, &phdr);
+        if (ret != BFELF_SUCCESS)
+            return ret;
 
-    return BFELF_ERROR_NO_SUCH_SYMBOL;
+        if (phdr->p_type != bfpt_load)
+            continue;
 
-found:
+        ret = bfelf_load_segment(ef, phdr);
+        if (ret != BFELF_SUCCESS)
+            return ret;
 
-    *efr = tmpef;
-    *sym = tmpsym;
+        if (sorted == BFELF_TRUE)
+        {
+            bfelf_memclr(ef->exec + end, phdr->p_vaddr - end);
+            BFELF_STATS_ADD(bytes_zeroed, phdr->p_vaddr - end);
+        }
+
+        end = phdr->p_vaddr + phdr->p_memsz;
+    }
+
+    if (sorted == BFELF_TRUE && end < ef->esize)
+    {
+        bfelf_memclr(ef->exec + end, ef->esize - end);
+        BFELF_STATS_ADD(bytes_zeroed, ef->esize - end);
+    }
 
     return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-bfelf_resolve_symbol(struct bfelf_file_t *ef,
-                     struct e_string_t *name,
-                     void **addr)
+bfelf_load_segment(struct bfelf_file_t *ef,
+                   struct bfelf_phdr *phdr)
 {
-    bfelf64_sword ret = 0;
-    struct bfelf_sym *sym = 0;
-    struct bfelf_file_t *efr = 0;
+    char *exec = 0;
+    char *file = 0;
 
-    if (!ef || !name || !addr)
+    if (!ef || !phdr)
         return BFELF_ERROR_INVALID_ARG;
 
     if (ef->valid != BFELF_TRUE)
         return BFELF_ERROR_INVALID_FILE;
 
-    ret = bfelf_symbol_by_name_global(ef, name, &efr, &sym);
-    if (ret != BFELF_SUCCESS)
-        return ret;
+    if (phdr->p_vaddr + phdr->p_memsz > ef->esize)
+        return BFELF_ERROR_INVALID_PH_MEMSZ;
 
-    *addr = efr->exec + sym->st_value;
+    if (phdr->p_filesz > phdr->p_memsz)
+        return BFELF_ERROR_INVALID_PH_FILESZ;
+
+    exec = ef->exec + phdr->p_vaddr;
+
+    /*
+     * If the ELF file was streamed, the segment's contents have already
+     * been copied into exec, and only the BSS needs to be zeroed.
+     */
+
+    if (ef->file != 0)
+    {
+        file = ef->file + phdr->p_offset;
+        bfelf_memcpy(exec, file, phdr->p_filesz);
+
+        BFELF_STATS_ADD(bytes_copied, phdr->p_filesz);
+    }
+
+    if (ef->zeroed != BFELF_TRUE)
+    {
+        bfelf_memclr(exec + phdr->p_filesz, phdr->p_memsz - phdr->p_filesz);
+        BFELF_STATS_ADD(bytes_zeroed, phdr->p_memsz - phdr->p_filesz);
+    }
 
     return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-bfelf_print_sym_table(struct bfelf_file_t *ef)
+bfelf_print_program_header_table(struct bfelf_file_t *ef)
 {
-    bfelf64_sword i = 0;
+    bfelf64_word i = 0;
     bfelf64_sword ret = 0;
 
     if (!ef)
@@ -1143,557 +4292,509 @@ bfelf_print_sym_table(struct bfelf_file_t *ef)
     if (ef->valid != BFELF_TRUE)
         return BFELF_ERROR_INVALID_FILE;
 
-    for (i = 0; i < ef->symnum; i++)
+    for (i = 0; i < ef->ehdr->e_phnum; i++)
     {
-        struct bfelf_sym *sym = 0;
+        struct bfelf_phdr *phdr = 0;
 
-        ret = bfelf_symbol_by_index(ef, i, &sym);
+        ret = bfelf_program_header(ef, i, &phdr);
         if (ret != BFELF_SUCCESS)
             return ret;
 
-        ret = bfelf_print_sym(ef, sym);
+        ret = bfelf_print_program_header(ef, phdr);
         if (ret != BFELF_SUCCESS)
             return ret;
     }
 
-    DEBUG("\n");
-
     return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-bfelf_print_sym(struct bfelf_file_t *ef,
-                struct bfelf_sym *sym)
+bfelf_print_program_header(struct bfelf_file_t *ef,
+                           struct bfelf_phdr *phdr)
 {
-    bfelf64_sword ret = 0;
-    struct e_string_t str = {0};
-
-    if (!ef || !sym)
+    if (!ef || !phdr)
         return BFELF_ERROR_INVALID_ARG;
 
     if (ef->valid != BFELF_TRUE)
         return BFELF_ERROR_INVALID_FILE;
 
-    ret = bfelf_string_table_entry(ef, ef->strtab, sym->st_name, &str);
-    if (ret != BFELF_SUCCESS)
-        return ret;
+    DEBUG("Program Header:\n");
+    DEBUG("  %-35s %s\n", "Type:", p_type_to_str(phdr->p_type));
+    DEBUG("  %-35s ", "Flags:");
 
-#ifdef PRINT_DETAILED_SYM
+    if (p_flags_is_executable(phdr) == BFELF_TRUE) INFO("E ");
+    if (p_flags_is_writable(phdr) == BFELF_TRUE) INFO("W ");
+    if (p_flags_is_readable(phdr) == BFELF_TRUE) INFO("R ");
 
-    DEBUG("Symbol: %s\n", str.buf);
-    DEBUG("  %-35s %s\n", "Bind:", stb_to_str(sym->st_info));
-    DEBUG("  %-35s %s\n", "Type:", stt_to_str(sym->st_info));
-    DEBUG("  %-35s %d\n", "Section Index:", sym->st_shndx);
-    DEBUG("  %-35s 0x%" PRIu64 "\n", "Value:", sym->st_value);
-    DEBUG("  %-35s 0x%" PRIu64 "\n", "Size:", sym->st_size);
+    INFO("\n");
+    DEBUG("  %-35s 0x%" PRIu64 "\n", "Offset:", phdr->p_offset);
+    DEBUG("  %-35s 0x%" PRIu64 "\n", "Virtual Address:", phdr->p_vaddr);
+    DEBUG("  %-35s 0x%" PRIu64 "\n", "Physical Address:", phdr->p_paddr);
+    DEBUG("  %-35s %" PRIu64 " (bytes)\n", "File Size:", phdr->p_filesz);
+    DEBUG("  %-35s %" PRIu64 " (bytes)\n", "Exec Size:", phdr->p_memsz);
+    DEBUG("  %-35s 0x%" PRIu64 "\n", "Alignment:", phdr->p_align);
 
     DEBUG("\n");
 
-#else
-
-    DEBUG("Symbol: %-29s 0x%08" PRIu64 " %-2s %-12s %s\n", str.buf, sym->st_value, " ",
-          stb_to_str(sym->st_info),
-          stt_to_str(sym->st_info));
-
-#endif
-
     return BFELF_SUCCESS;
 }
 
 /******************************************************************************/
-/* ELF Relocations                                                            */
+/* ELF Prelinked Image                                                        */
 /******************************************************************************/
 
-const char *BFR_X86_64_64_STR = "BFR_X86_64_64";
-const char *BFR_X86_64_GLOB_DAT_STR = "BFR_X86_64_GLOB_DAT";
-const char *BFR_X86_64_JUMP_SLOT_STR = "BFR_X86_64_JUMP_SLOT";
-const char *BFR_X86_64_RELATIVE_STR = "BFR_X86_64_RELATIVE";
-
-const char *
-rel_type_to_str(bfelf64_xword value)
-{
-    switch (BFELF_REL_TYPE(value))
-    {
-        case BFR_X86_64_64: return BFR_X86_64_64_STR;
-        case BFR_X86_64_GLOB_DAT: return BFR_X86_64_GLOB_DAT_STR;
-        case BFR_X86_64_JUMP_SLOT: return BFR_X86_64_JUMP_SLOT_STR;
-        case BFR_X86_64_RELATIVE: return BFR_X86_64_RELATIVE_STR;
-        default: return "Unknown BFELF_REL_TYPE(r_info)";
-    }
-}
-
 bfelf64_sword
-bfelf_relocate_symbol(struct bfelf_file_t *ef,
-                      struct bfelf_rel *rel)
+bfelf_prelink_range(bfelf64_sword fsize,
+                    bfelf64_xword offset,
+                    bfelf64_xword num,
+                    bfelf64_xword entsize)
 {
-    bfelf64_addr *ptr = 0;
-    bfelf64_sword ret = 0;
-    struct bfelf_sym *sym = 0;
-    struct e_string_t name = {0};
-    struct bfelf_file_t *efr = 0;
-
-    if (!ef || !rel)
-        return BFELF_ERROR_INVALID_ARG;
-
-    if (ef->valid != BFELF_TRUE)
-        return BFELF_ERROR_INVALID_FILE;
-
-    ret = bfelf_symbol_by_index(ef, BFELF_REL_SYM(rel->r_info), &sym);
-    if (ret != BFELF_SUCCESS)
-        return ret;
-
-    ret = bfelf_string_table_entry(ef, ef->strtab, sym->st_name, &name);
-    if (ret != BFELF_SUCCESS)
-        return ret;
+    if (offset > (bfelf64_xword)fsize)
+        return BFELF_FALSE;
 
-    ret = bfelf_symbol_by_name_global(ef, &name, &efr, &sym);
-    if (ret != BFELF_SUCCESS)
-        return ret;
+    if (num > ((bfelf64_xword)fsize - offset) / entsize)
+        return BFELF_FALSE;
 
-    ptr = (bfelf64_addr *)(ef->exec + rel->r_offset);
+    return BFELF_TRUE;
+}
 
-    if (ptr > (bfelf64_addr *)(ef->exec + ef->esize))
-        return BFELF_ERROR_INVALID_FILE;
+bfelf64_sword
+bfelf_is_prelinked(char *file, bfelf64_sword fsize)
+{
+    struct bfelf_prelink_hdr *hdr = 0;
 
-    /* TODO: Remove the relocation for BFR_X86_64_JUMP_SLOT, and instead
-       fill in the address of a function that does the relocation and
-       then jumps to the value that should have been there. Called
-       lazy loading */
+    if (!file || fsize < (bfelf64_sword)sizeof(struct bfelf_prelink_hdr))
+        return BFELF_FALSE;
 
-    switch (BFELF_REL_TYPE(rel->r_info))
-    {
-        case BFR_X86_64_GLOB_DAT:
-        case BFR_X86_64_JUMP_SLOT:
-            *ptr = (bfelf64_addr)(efr->exec + sym->st_value);
-            break;
+    hdr = (struct bfelf_prelink_hdr *)file;
 
-        default:
-            return BFELF_ERROR_INVALID_RELOCATION_TYPE;
-    }
+    if (hdr->magic != BFELF_PRELINK_MAGIC)
+        return BFELF_FALSE;
 
-    return BFELF_SUCCESS;
+    return BFELF_TRUE;
 }
 
 bfelf64_sword
-bfelf_relocate_symbol_addend(struct bfelf_file_t *ef,
-                             struct bfelf_rela *rela)
+bfelf_prelink_init(char *file,
+                   bfelf64_sword fsize,
+                   struct bfelf_prelink_t *pl)
 {
-    bfelf64_addr *ptr = 0;
-    bfelf64_sword ret = 0;
-    struct bfelf_sym *sym = 0;
-    struct e_string_t name = {0};
-    struct bfelf_file_t *efr = 0;
+    struct bfelf_prelink_hdr *hdr = 0;
 
-    if (!ef || !rela)
+    if (!file || !pl)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (ef->valid != BFELF_TRUE)
-        return BFELF_ERROR_INVALID_FILE;
-
-    ret = bfelf_symbol_by_index(ef, BFELF_REL_SYM(rela->r_info), &sym);
-    if (ret != BFELF_SUCCESS)
-        return ret;
-
-    switch (BFELF_REL_TYPE(rela->r_info))
-    {
-        case BFR_X86_64_RELATIVE:
-            break;
-
-        default:
-        {
-            ret = bfelf_string_table_entry(ef, ef->strtab, sym->st_name, &name);
-            if (ret != BFELF_SUCCESS)
-                return ret;
-
-            ret = bfelf_symbol_by_name_global(ef, &name, &efr, &sym);
-            if (ret != BFELF_SUCCESS)
-                return ret;
-        }
-    };
+    bfelf_memclr((char *)pl, sizeof(struct bfelf_prelink_t));
 
-    ptr = (bfelf64_addr *)(ef->exec + rela->r_offset);
+    if (bfelf_is_prelinked(file, fsize) != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_PRELINK;
 
-    if (ptr > (bfelf64_addr *)(ef->exec + ef->esize))
-        return BFELF_ERROR_INVALID_FILE;
+    hdr = (struct bfelf_prelink_hdr *)file;
 
-    /* TODO: Remove the relocation for BFR_X86_64_JUMP_SLOT, and instead
-       fill in the address of a function that does the relocation and
-       then jumps to the value that should have been there. Called
-       lazy loading */
+    if (hdr->version != BFELF_PRELINK_VERSION)
+        return BFELF_ERROR_INVALID_PRELINK;
 
-    switch (BFELF_REL_TYPE(rela->r_info))
+    if (hdr->exec_size == 0 ||
+        hdr->exec_size > BFELF_PRELINK_MAX_EXEC_SIZE ||
+        hdr->image_size > hdr->exec_size)
     {
-        case BFR_X86_64_64:
-            *ptr = (bfelf64_addr)(efr->exec + sym->st_value + rela->r_addend);
-            break;
+        return BFELF_ERROR_INVALID_PRELINK;
+    }
 
-        case BFR_X86_64_GLOB_DAT:
-        case BFR_X86_64_JUMP_SLOT:
-            *ptr = (bfelf64_addr)(efr->exec + sym->st_value);
-            break;
+    if (bfelf_prelink_range(fsize, hdr->image_offset, hdr->image_size, 1) != BFELF_TRUE ||
+        bfelf_prelink_range(fsize, hdr->fixup_offset, hdr->fixup_num, sizeof(bfelf64_xword)) != BFELF_TRUE ||
+        bfelf_prelink_range(fsize, hdr->sym_offset, hdr->sym_num, sizeof(struct bfelf_prelink_sym)) != BFELF_TRUE ||
+        bfelf_prelink_range(fsize, hdr->str_offset, hdr->str_size, 1) != BFELF_TRUE)
+    {
+        return BFELF_ERROR_INVALID_PRELINK;
+    }
 
-        case BFR_X86_64_RELATIVE:
-            *ptr = (bfelf64_addr)(ef->exec + rela->r_addend);
-            break;
+    pl->file = file;
+    pl->fsize = fsize;
+    pl->hdr = hdr;
+    pl->image = file + hdr->image_offset;
+    pl->fixups = (bfelf64_xword *)(file + hdr->fixup_offset);
+    pl->syms = (struct bfelf_prelink_sym *)(file + hdr->sym_offset);
+    pl->strtab = file + hdr->str_offset;
 
-        default:
-            return BFELF_ERROR_INVALID_RELOCATION_TYPE;
-    }
+    pl->valid = BFELF_TRUE;
 
     return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-bfelf_relocate_symbols(struct bfelf_file_t *ef)
+bfelf_prelink_exec_size(struct bfelf_prelink_t *pl)
 {
-    bfelf64_word t = 0;
-    bfelf64_word r = 0;
-    bfelf64_sword ret = 0;
-
-    if (!ef)
+    if (!pl)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (ef->valid != BFELF_TRUE)
-        return BFELF_ERROR_INVALID_FILE;
-
-    for (t = 0; t < ef->num_rel; t++)
-    {
-        for (r = 0; r < ef->bfreltab[t].num; r++)
-        {
-            ret = bfelf_relocate_symbol(ef, &(ef->bfreltab[t].tab[r]));
-            if (ret != BFELF_SUCCESS)
-                return ret;
-        }
-    }
-
-    for (t = 0; t < ef->num_rela; t++)
-    {
-        for (r = 0; r < ef->bfrelatab[t].num; r++)
-        {
-            ret = bfelf_relocate_symbol_addend(ef, &(ef->bfrelatab[t].tab[r]));
-            if (ret != BFELF_SUCCESS)
-                return ret;
-        }
-    }
+    if (pl->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
 
-    return BFELF_SUCCESS;
+    return (bfelf64_sword)pl->hdr->exec_size;
 }
 
 bfelf64_sword
-bfelf_print_relocation(struct bfelf_rel *rel)
+bfelf_prelink_load(struct bfelf_prelink_t *pl,
+                   char *exec,
+                   bfelf64_sword esize)
 {
-    if (!rel)
+    bfelf64_sword ret = 0;
+    struct bfelf_prelink_hdr *hdr = 0;
+
+    if (!pl || !exec)
         return BFELF_ERROR_INVALID_ARG;
 
-#ifdef PRINT_DETAILED_REL
+    if (pl->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
 
-    DEBUG("Relocation:\n");
-    DEBUG("  %-35s 0x%08" PRIu64 "\n", "Offset:", rel->r_offset);
-    DEBUG("  %-35s %" PRId64 "\n", "Symbol:", BFELF_REL_SYM(rel->r_info));
-    DEBUG("  %-35s %s\n", "Type:", rel_type_to_str(rel->r_info));
+    hdr = pl->hdr;
 
-    DEBUG("\n");
+    if (esize < 0 || (bfelf64_xword)esize < hdr->exec_size)
+        return BFELF_ERROR_INVALID_ARG;
 
-#else
+    bfelf_memcpy(exec, pl->image, hdr->image_size);
+    bfelf_memclr(exec + hdr->image_size, hdr->exec_size - hdr->image_size);
 
-    DEBUG("Relocation: %-20s 0x%08" PRIu64 " %04" PRId64 "\n", rel_type_to_str(rel->r_info),
-          rel->r_offset,
-          BFELF_REL_SYM(rel->r_info));
+    ret = bfelf_relr_apply(exec, hdr->exec_size, pl->fixups, hdr->fixup_num);
+    if (ret != BFELF_SUCCESS)
+        return BFELF_ERROR_INVALID_PRELINK;
 
-#endif
+    pl->exec = exec;
+    pl->esize = esize;
 
     return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-bfelf_print_relocation_addend(struct bfelf_rela *rela)
+bfelf_prelink_detach_size(struct bfelf_prelink_t *pl)
 {
-    if (!rela)
+    if (!pl)
         return BFELF_ERROR_INVALID_ARG;
 
-#ifdef PRINT_DETAILED_REL
+    if (pl->valid != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_FILE;
 
-    DEBUG("Relocation:\n");
-    DEBUG("  %-35s 0x%08" PRIu64 "\n", "Offset:", rela->r_offset);
-    DEBUG("  %-35s %" PRId64 "\n", "Symbol:", BFELF_REL_SYM(rela->r_info));
-    DEBUG("  %-35s %s\n", "Type:", rel_type_to_str(rela->r_info));
-    DEBUG("  %-35s 0x%" PRIu64 "\n", "Addend:", rela->r_addend);
+    return sizeof(struct bfelf_prelink_hdr) +
+           pl->hdr->sym_num * sizeof(struct bfelf_prelink_sym) +
+           pl->hdr->str_size;
+}
 
-    DEBUG("\n");
+bfelf64_sword
+bfelf_prelink_detach(struct bfelf_prelink_t *pl, char *meta, bfelf64_sword msize)
+{
+    bfelf64_xword symsize = 0;
+    struct bfelf_prelink_hdr *hdr = 0;
 
-#else
+    if (!pl || !meta)
+        return BFELF_ERROR_INVALID_ARG;
 
-    DEBUG("Relocation: %-20s 0x%08" PRIu64 " %04" PRId64 " 0x%08" PRIu64 "\n", rel_type_to_str(rela->r_info),
-          rela->r_offset,
-          BFELF_REL_SYM(rela->r_info),
-          rela->r_addend);
+    if (pl->valid != BFELF_TRUE || pl->exec == 0)
+        return BFELF_ERROR_INVALID_FILE;
 
-#endif
+    if (msize < bfelf_prelink_detach_size(pl))
+        return BFELF_ERROR_INVALID_ARG;
+
+    symsize = pl->hdr->sym_num * sizeof(struct bfelf_prelink_sym);
+    hdr = (struct bfelf_prelink_hdr *)meta;
+
+    bfelf_memcpy(meta, (char *)pl->hdr, sizeof(struct bfelf_prelink_hdr));
+    bfelf_memcpy(meta + sizeof(struct bfelf_prelink_hdr), (char *)pl->syms, symsize);
+    bfelf_memcpy(meta + sizeof(struct bfelf_prelink_hdr) + symsize, pl->strtab, pl->hdr->str_size);
+
+    hdr->image_offset = 0;
+    hdr->fixup_offset = 0;
+    hdr->fixup_num = 0;
+    hdr->sym_offset = sizeof(struct bfelf_prelink_hdr);
+    hdr->str_offset = sizeof(struct bfelf_prelink_hdr) + symsize;
+
+    pl->file = 0;
+    pl->fsize = 0;
+    pl->hdr = hdr;
+    pl->image = 0;
+    pl->fixups = 0;
+    pl->syms = (struct bfelf_prelink_sym *)(meta + hdr->sym_offset);
+    pl->strtab = meta + hdr->str_offset;
 
     return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-bfelf_print_relocations(struct bfelf_file_t *ef)
+bfelf_prelink_resolve_symbol(struct bfelf_prelink_t *pl,
+                             struct e_string_t *name,
+                             void **addr)
 {
-    bfelf64_word t = 0;
-    bfelf64_word r = 0;
-    bfelf64_sword ret = 0;
+    bfelf64_xword i = 0;
+    bfelf64_xword offset = 0;
+    struct e_string_t str = {0};
+    struct bfelf_prelink_hdr *hdr = 0;
 
-    if (!ef)
+    if (!pl || !name || !addr)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (ef->valid != BFELF_TRUE)
+    if (pl->valid != BFELF_TRUE || pl->exec == 0)
         return BFELF_ERROR_INVALID_FILE;
 
-    for (t = 0; t < ef->num_rel; t++)
-    {
-        for (r = 0; r < ef->bfreltab[t].num; r++)
-        {
-            ret = bfelf_print_relocation(&(ef->bfreltab[t].tab[r]));
-            if (ret != BFELF_SUCCESS)
-                return ret;
-        }
-    }
+    hdr = pl->hdr;
 
-    for (t = 0; t < ef->num_rela; t++)
+    for (i = 0; i < hdr->sym_num; i++)
     {
-        for (r = 0; r < ef->bfrelatab[t].num; r++)
-        {
-            ret = bfelf_print_relocation_addend(&(ef->bfrelatab[t].tab[r]));
-            if (ret != BFELF_SUCCESS)
-                return ret;
-        }
-    }
+        offset = pl->syms[i].st_name;
 
-    DEBUG("\n");
+        if (offset >= hdr->str_size)
+            return BFELF_ERROR_INVALID_PRELINK;
 
-    return BFELF_SUCCESS;
-}
+        if ((bfelf64_xword)name->len >= hdr->str_size - offset)
+            continue;
 
-/******************************************************************************/
-/* ELF Program Header                                                         */
-/******************************************************************************/
+        str.buf = pl->strtab + offset;
+        str.len = name->len;
 
-/* TODO: Need function to return a map that explains how to set the permissions
-   of the memory used to load the ELF file. This way, portions of the RAM that
-   holds the program can be RW and other portions can be RE */
+        if (bfelf_strcmp(name, &str) != BFELF_TRUE || str.buf[str.len] != 0)
+            continue;
 
-const char *bfpt_null_str = "Unused entry (bfpt_null)";
-const char *bfpt_load_str = "Loadable segment (bfpt_load)";
-const char *bfpt_dynamic_str = "Dynamic linking tables (bfpt_dynamic)";
-const char *bfpt_interp_str = "Program interpreter path name (bfpt_interp)";
-const char *bfpt_note_str = "Note sections (bfpt_note)";
-const char *bfpt_shlib_str = "Reserved (bfpt_shlib)";
-const char *bfpt_phdr_str = "Program header table (bfpt_phdr)";
-const char *bfpt_loos_str = "Environment specific (bfpt_loos)";
-const char *bfpt_hios_str = "Environment specific (bfpt_hios)";
-const char *bfpt_loproc_str = "Processor specific (bfpt_loproc)";
-const char *bfpt_hiproc_str = "Processor specific (bfpt_hiproc)";
+        if (pl->syms[i].st_value > hdr->exec_size)
+            return BFELF_ERROR_INVALID_PRELINK;
 
-const char *
-p_type_to_str(bfelf64_word value)
-{
-    switch (value)
-    {
-        case bfpt_null: return bfpt_null_str;
-        case bfpt_load: return bfpt_load_str;
-        case bfpt_dynamic: return bfpt_dynamic_str;
-        case bfpt_interp: return bfpt_interp_str;
-        case bfpt_note: return bfpt_note_str;
-        case bfpt_shlib: return bfpt_shlib_str;
-        case bfpt_phdr: return bfpt_phdr_str;
-        case bfpt_loos: return bfpt_loos_str;
-        case bfpt_hios: return bfpt_hios_str;
-        case bfpt_loproc: return bfpt_loproc_str;
-        case bfpt_hiproc: return bfpt_hiproc_str;
-        default: return "Unknown p_type";
+        *addr = pl->exec + pl->syms[i].st_value;
+        return BFELF_SUCCESS;
     }
+
+    return BFELF_ERROR_NO_SUCH_SYMBOL;
 }
 
+/******************************************************************************/
+/* ELF Compressed Module                                                      */
+/******************************************************************************/
+
 bfelf64_sword
-p_flags_is_executable(struct bfelf_phdr *phdr)
+bfelf_is_compressed(char *file, bfelf64_sword fsize)
 {
-    if (!phdr)
-        return BFELF_ERROR_INVALID_ARG;
+    struct bfelf_lz4_hdr *hdr = 0;
 
-    return (phdr->p_flags & bfpf_x) != 0 ? BFELF_TRUE : BFELF_FALSE;
-}
+    if (!file || fsize < (bfelf64_sword)sizeof(struct bfelf_lz4_hdr))
+        return BFELF_FALSE;
 
-bfelf64_sword
-p_flags_is_writable(struct bfelf_phdr *phdr)
-{
-    if (!phdr)
-        return BFELF_ERROR_INVALID_ARG;
+    hdr = (struct bfelf_lz4_hdr *)file;
 
-    return (phdr->p_flags & bfpf_w) != 0 ? BFELF_TRUE : BFELF_FALSE;
+    if (hdr->magic != BFELF_LZ4_MAGIC)
+        return BFELF_FALSE;
+
+    return BFELF_TRUE;
 }
 
 bfelf64_sword
-p_flags_is_readable(struct bfelf_phdr *phdr)
+bfelf_lz4_length(const unsigned char *src,
+                 bfelf64_xword slen,
+                 bfelf64_xword *si,
+                 bfelf64_xword *len)
 {
-    if (!phdr)
-        return BFELF_ERROR_INVALID_ARG;
+    unsigned char byte = 0;
 
-    return (phdr->p_flags & bfpf_r) != 0 ? BFELF_TRUE : BFELF_FALSE;
-}
+    /*
+     * A length of 15 in the token is continued in the bytes that follow,
+     * each of which adds 0-255 to the length, until a byte other than 255.
+     */
 
-bfelf64_sword
-bfelf_program_header(struct bfelf_file_t *ef,
-                     bfelf64_word index,
-                     struct bfelf_phdr **phdr)
-{
-    if (!ef || !ef->ehdr || !ef->phdrtab || !phdr)
-        return BFELF_ERROR_INVALID_ARG;
+    if (*len != 15)
+        return BFELF_SUCCESS;
 
-    if (index >= ef->ehdr->e_phnum)
-        return BFELF_ERROR_INVALID_INDEX;
+    do
+    {
+        if (*si >= slen)
+            return BFELF_ERROR_INVALID_COMPRESSED;
 
-    *phdr = &(ef->phdrtab[index]);
+        byte = src[(*si)++];
+        *len += byte;
+    }
+    while (byte == 255);
 
     return BFELF_SUCCESS;
 }
 
-bfelf64_sxword
-bfelf_total_exec_size(struct bfelf_file_t *ef)
+bfelf64_sword
+bfelf_lz4_decompress(const char *src,
+                     bfelf64_sword slen,
+                     char *dst,
+                     bfelf64_sword dlen)
 {
-    bfelf64_word i = 0;
+    bfelf64_xword i = 0;
+    bfelf64_xword si = 0;
+    bfelf64_xword di = 0;
+    bfelf64_xword len = 0;
+    bfelf64_xword offset = 0;
     bfelf64_sword ret = 0;
-    bfelf64_sxword total_size = 0;
+    unsigned char token = 0;
+    const unsigned char *s = (const unsigned char *)src;
 
-    if (!ef)
+    if (!src || !dst || slen <= 0 || dlen < 0)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (ef->valid != BFELF_TRUE)
-        return BFELF_ERROR_INVALID_FILE;
+    /*
+     * An LZ4 block is a list of sequences, each of which is a token, the
+     * literals (bytes that are copied as is), and a match (a copy of bytes
+     * that have already been decompressed). The last sequence in a block
+     * only has literals.
+     */
 
-    for (i = 0; i < ef->ehdr->e_phnum; i++)
+    while (si < (bfelf64_xword)slen)
     {
-        bfelf64_sxword size = 0;
-        struct bfelf_phdr *phdr = 0;
+        token = s[si++];
+        len = token >> 4;
 
-        ret = bfelf_program_header(ef, i, &phdr);
+        ret = bfelf_lz4_length(s, slen, &si, &len);
         if (ret != BFELF_SUCCESS)
             return ret;
 
-        size = phdr->p_vaddr + phdr->p_memsz;
+        if (len > (bfelf64_xword)slen - si || len > (bfelf64_xword)dlen - di)
+            return BFELF_ERROR_INVALID_COMPRESSED;
 
-        if (size > total_size)
-            total_size = size;
-    }
+        bfelf_memcpy(dst + di, src + si, len);
 
-    return total_size;
-}
+        si += len;
+        di += len;
 
-bfelf64_sword
-bfelf_load_segments(struct bfelf_file_t *ef)
-{
-    bfelf64_word i = 0;
-    bfelf64_sword ret = 0;
+        if (si == (bfelf64_xword)slen)
+            break;
 
-    if (!ef)
-        return BFELF_ERROR_INVALID_ARG;
+        if ((bfelf64_xword)slen - si < 2)
+            return BFELF_ERROR_INVALID_COMPRESSED;
 
-    if (ef->valid != BFELF_TRUE)
-        return BFELF_ERROR_INVALID_FILE;
+        offset = (bfelf64_xword)s[si] | ((bfelf64_xword)s[si + 1] << 8);
+        si += 2;
 
-    for (i = 0; i < ef->ehdr->e_phnum; i++)
-    {
-        struct bfelf_phdr *phdr = 0;
+        if (offset == 0 || offset > di)
+            return BFELF_ERROR_INVALID_COMPRESSED;
 
-        ret = bfelf_program_header(ef, i, &phdr);
-        if (ret != BFELF_SUCCESS)
-            return ret;
+        len = token & 0xF;
 
-        ret = bfelf_load_segment(ef, phdr);
+        ret = bfelf_lz4_length(s, slen, &si, &len);
         if (ret != BFELF_SUCCESS)
             return ret;
+
+        len += 4;
+
+        if (len > (bfelf64_xword)dlen - di)
+            return BFELF_ERROR_INVALID_COMPRESSED;
+
+        /*
+         * The match is allowed to overlap the bytes that it produces (i.e.
+         * an offset of 1 repeats the last byte), so it is copied one byte
+         * at a time.
+         */
+
+        for (i = 0; i < len; i++, di++)
+            dst[di] = dst[di - offset];
     }
 
-    return BFELF_SUCCESS;
+    return (bfelf64_sword)di;
 }
 
 bfelf64_sword
-bfelf_load_segment(struct bfelf_file_t *ef,
-                   struct bfelf_phdr *phdr)
+bfelf_lz4_init(struct bfelf_lz4_t *lz, char *file, bfelf64_sword fsize)
 {
-    char *exec = 0;
-    char *file = 0;
-    bfelf64_word i = 0;
+    struct bfelf_lz4_hdr *hdr = 0;
 
-    if (!ef || !phdr)
+    if (!lz || !file)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (ef->valid != BFELF_TRUE)
-        return BFELF_ERROR_INVALID_FILE;
+    if (bfelf_is_compressed(file, fsize) != BFELF_TRUE)
+        return BFELF_ERROR_INVALID_COMPRESSED;
 
-    if (phdr->p_vaddr + phdr->p_memsz > ef->esize)
-        return BFELF_ERROR_INVALID_PH_MEMSZ;
+    hdr = (struct bfelf_lz4_hdr *)file;
 
-    exec = ef->exec + phdr->p_vaddr;
-    file = ef->file + phdr->p_offset;
+    if (hdr->version != BFELF_LZ4_VERSION)
+        return BFELF_ERROR_INVALID_COMPRESSED;
+
+    if (hdr->fsize == 0 || hdr->fsize > 0x7FFFFFFF)
+        return BFELF_ERROR_INVALID_COMPRESSED;
+
+    if (hdr->block_size == 0 || hdr->block_size > BFELF_LZ4_MAX_BLOCK_SIZE)
+        return BFELF_ERROR_INVALID_COMPRESSED;
+
+    lz->file = file;
+    lz->fsize = fsize;
+    lz->offset = sizeof(struct bfelf_lz4_hdr);
 
-    for (i = 0; i < phdr->p_filesz; i++)
-        exec[i] = file[i];
+    lz->usize = hdr->fsize;
+    lz->uoffset = 0;
+    lz->block_size = hdr->block_size;
 
     return BFELF_SUCCESS;
 }
 
 bfelf64_sword
-bfelf_print_program_header_table(struct bfelf_file_t *ef)
+bfelf_lz4_size(struct bfelf_lz4_t *lz)
+{
+    if (!lz)
+        return BFELF_ERROR_INVALID_ARG;
+
+    if (lz->file == 0)
+        return BFELF_ERROR_INVALID_COMPRESSED;
+
+    return (bfelf64_sword)lz->usize;
+}
+
+bfelf64_sword
+bfelf_lz4_read(struct bfelf_lz4_t *lz, char **buf)
 {
-    bfelf64_word i = 0;
     bfelf64_sword ret = 0;
+    bfelf64_word size = 0;
+    bfelf64_xword usize = 0;
+    char *block = 0;
 
-    if (!ef)
+    if (!lz || !buf)
         return BFELF_ERROR_INVALID_ARG;
 
-    if (ef->valid != BFELF_TRUE)
-        return BFELF_ERROR_INVALID_FILE;
+    if (lz->file == 0)
+        return BFELF_ERROR_INVALID_COMPRESSED;
 
-    for (i = 0; i < ef->ehdr->e_phnum; i++)
-    {
-        struct bfelf_phdr *phdr = 0;
+    if (lz->uoffset == lz->usize)
+        return 0;
 
-        ret = bfelf_program_header(ef, i, &phdr);
-        if (ret != BFELF_SUCCESS)
-            return ret;
+    usize = lz->usize - lz->uoffset;
 
-        ret = bfelf_print_program_header(ef, phdr);
-        if (ret != BFELF_SUCCESS)
-            return ret;
-    }
+    if (usize > lz->block_size)
+        usize = lz->block_size;
 
-    return BFELF_SUCCESS;
-}
+    if (lz->fsize - lz->offset < sizeof(bfelf64_word))
+        return BFELF_ERROR_INVALID_COMPRESSED;
 
-bfelf64_sword
-bfelf_print_program_header(struct bfelf_file_t *ef,
-                           struct bfelf_phdr *phdr)
-{
-    if (!ef || !phdr)
-        return BFELF_ERROR_INVALID_ARG;
+    size = *(bfelf64_word *)(lz->file + lz->offset);
+    block = lz->file + lz->offset + sizeof(bfelf64_word);
 
-    if (ef->valid != BFELF_TRUE)
-        return BFELF_ERROR_INVALID_FILE;
+    lz->offset += sizeof(bfelf64_word);
 
-    DEBUG("Program Header:\n");
-    DEBUG("  %-35s %s\n", "Type:", p_type_to_str(phdr->p_type));
-    DEBUG("  %-35s ", "Flags:");
+    if ((size & ~BFELF_LZ4_BLOCK_RAW) > lz->fsize - lz->offset)
+        return BFELF_ERROR_INVALID_COMPRESSED;
 
-    if (p_flags_is_executable(phdr) == BFELF_TRUE) INFO("E ");
-    if (p_flags_is_writable(phdr) == BFELF_TRUE) INFO("W ");
-    if (p_flags_is_readable(phdr) == BFELF_TRUE) INFO("R ");
+    lz->offset += size & ~BFELF_LZ4_BLOCK_RAW;
 
-    INFO("\n");
-    DEBUG("  %-35s 0x%" PRIu64 "\n", "Offset:", phdr->p_offset);
-    DEBUG("  %-35s 0x%" PRIu64 "\n", "Virtual Address:", phdr->p_vaddr);
-    DEBUG("  %-35s 0x%" PRIu64 "\n", "Physical Address:", phdr->p_paddr);
-    DEBUG("  %-35s %" PRIu64 " (bytes)\n", "File Size:", phdr->p_filesz);
-    DEBUG("  %-35s %" PRIu64 " (bytes)\n", "Exec Size:", phdr->p_memsz);
-    DEBUG("  %-35s 0x%" PRIu64 "\n", "Alignment:", phdr->p_align);
+    /*
+     * A block that is stored as is does not need to be copied, the caller
+     * is simply given the block in the compressed module itself.
+     */
 
-    DEBUG("\n");
+    if ((size & BFELF_LZ4_BLOCK_RAW) != 0)
+    {
+        if ((size & ~BFELF_LZ4_BLOCK_RAW) != usize)
+            return BFELF_ERROR_INVALID_COMPRESSED;
 
-    return BFELF_SUCCESS;
+        *buf = block;
+    }
+    else
+    {
+        ret = bfelf_lz4_decompress(block, size, lz->block, usize);
+        if (ret < BFELF_SUCCESS)
+            return ret;
+
+        if ((bfelf64_xword)ret != usize)
+            return BFELF_ERROR_INVALID_COMPRESSED;
+
+        *buf = lz->block;
+    }
+
+    lz->uoffset += usize;
+
+    return (bfelf64_sword)usize;
 }
@@ -23,7 +23,13 @@
 #include <abi_conversion.h>
 
 #include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <unistd.h>
 #include <sys/mman.h>
+#include <sys/wait.h>
 
 auto c_dummy1_filename = "../cross/libdummy1.so";
 auto c_dummy2_filename = "../cross/libdummy2.so";
@@ -177,18 +183,26 @@ bool bfelf_loader_ut::list()
     this->test_bfelf_loader_init();
     this->test_bfelf_loader_add();
     this->test_bfelf_loader_relocate();
+    this->test_bfelf_loader_relocate_duplicate();
+    this->test_bfelf_loader_symtab();
     this->test_bfelf_section_header();
     this->test_bfelf_string_table_entry();
     this->test_bfelf_section_name_string();
     this->test_bfelf_symbol_by_index();
     this->test_bfelf_symbol_by_name();
+    this->test_bfelf_symbol_by_name_hash();
+    this->test_bfelf_symbol_name_hash();
     this->test_bfelf_symbol_by_name_global();
     this->test_bfelf_resolve_symbol();
     this->test_bfelf_relocate_symbol();
     this->test_bfelf_relocate_symbol_addend();
     this->test_bfelf_relocate_symbols();
+    this->test_bfelf_relocate_relative();
+    this->test_bfelf_relocate_relr();
     this->test_bfelf_program_header();
     this->test_bfelf_load_segments();
+    this->test_bfelf_load_segments_zero();
+    this->test_bfelf_load_segments_zeroed();
     this->test_bfelf_load_segment();
 
     this->test_bfelf_file_print_header();
@@ -198,6 +212,23 @@ bool bfelf_loader_ut::list()
     this->test_bfelf_print_relocations();
 
     this->test_resolve();
+    this->test_lazy_binding();
+    this->test_prelink();
+    this->test_stream();
+    this->test_stream_bounds();
+    this->test_detach();
+    this->test_jmprel_in_rela();
+    this->test_rela_sections();
+    this->test_no_section_headers();
+    this->test_symbolize();
+    this->test_stats();
+    this->test_compressed();
+    this->test_parallel_relocate();
+    this->test_hot_load();
+    this->test_hot_load_detached();
+    this->test_hot_load_weak();
+    this->test_ifunc();
+    this->test_symbolic();
 
     return true;
 }
@@ -208,6 +239,91 @@ char *alloc_exec(int32_t size)
                         MAP_PRIVATE | MAP_ANON, -1, 0);
 }
 
+// Gives an ELF loader a global symbol table that fits the ELF files that
+// have been added to it, and ef (if it is about to be hot loaded).
+
+static void
+set_symtab(bfelf_loader_t *loader, std::vector<char> &symtab, bfelf_file_t *ef = 0)
+{
+    symtab.resize(bfelf_loader_symtab_size(loader, ef));
+    bfelf_loader_set_symtab(loader, symtab.data(), symtab.size());
+}
+
+// Most of the end to end tests load dummy1, dummy2 and dummy3 into a new
+// ELF loader, relocate them, and then check that dummy3_test2(5) returns
+// 0x26. They only differ in how the files are loaded or relocated, so each
+// step is its own helper, and a test can do any of them itself instead.
+
+void bfelf_loader_ut::init_dummies(dummies_t &d)
+{
+    char *files[3] = {m_dummy1, m_dummy2, m_dummy3};
+    int32_t fsizes[3] = {m_dummy1_length, m_dummy2_length, m_dummy3_length};
+
+    for (auto i = 0; i < 3; i++)
+    {
+        d.files[i] = files[i];
+        d.fsizes[i] = fsizes[i];
+        d.execs[i] = 0;
+        d.esizes[i] = 0;
+    }
+
+    d.loader = new bfelf_loader_t;
+
+    auto ret = bfelf_loader_init(d.loader);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+}
+
+void bfelf_loader_ut::load_dummies(dummies_t &d)
+{
+    auto ret = 0;
+
+    for (auto i = 0; i < 3; i++)
+    {
+        ret = bfelf_file_init(d.files[i], d.fsizes[i], &d.efs[i]);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        d.esizes[i] = bfelf_total_exec_size(&d.efs[i]);
+        d.execs[i] = alloc_exec(d.esizes[i]);
+        ASSERT_TRUE(d.execs[i] != MAP_FAILED);
+
+        ret = bfelf_file_load(&d.efs[i], d.execs[i], d.esizes[i]);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        ret = bfelf_loader_add(d.loader, &d.efs[i]);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+    }
+}
+
+void bfelf_loader_ut::relocate_dummies(dummies_t &d)
+{
+    set_symtab(d.loader, d.symtab);
+
+    auto ret = bfelf_loader_relocate(d.loader);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+}
+
+void bfelf_loader_ut::check_dummies(dummies_t &d)
+{
+    void *entry = 0;
+    struct e_string_t str = {"_Z12dummy3_test2i", 17};
+
+    auto ret = bfelf_resolve_symbol(&d.efs[2], &str, &entry);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    EXPECT_TRUE(((int(*)(int))entry)(5) == 0x26);
+}
+
+void bfelf_loader_ut::fini_dummies(dummies_t &d)
+{
+    for (auto i = 0; i < 3; i++)
+    {
+        if (d.execs[i] != 0)
+            munmap(d.execs[i], d.esizes[i]);
+    }
+
+    delete d.loader;
+}
+
 void bfelf_loader_ut::test_bfelf_file_init()
 {
     auto ret = 0;
@@ -529,9 +645,26 @@ void bfelf_loader_ut::test_bfelf_loader_add()
     ASSERT_TRUE(ret == BFELF_ERROR_INVALID_FILE);
     m_test_elf.valid = BFELF_TRUE;
 
-    for (auto i = 0; i < BFELF_MAX_MODULES + 1; i++)
-        ret = bfelf_loader_add(&m_test_loader, &m_test_elf);
-    ASSERT_TRUE(ret == BFELF_ERROR_LOADER_FULL);
+    ret = bfelf_loader_add(&m_test_loader, &m_test_elf);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    ret = bfelf_loader_add(&m_test_loader, &m_test_elf);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    auto loader = std::make_shared<bfelf_loader_t>();
+    auto efs = std::vector<bfelf_file_t>(100, m_test_elf);
+
+    ret = bfelf_loader_init(loader.get());
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    for (auto &ef : efs)
+    {
+        ret = bfelf_loader_add(loader.get(), &ef);
+        if (ret != BFELF_SUCCESS)
+            break;
+    }
+
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    ASSERT_TRUE(loader->num == 100);
 
     ret = bfelf_loader_init(&m_test_loader);
     ASSERT_TRUE(ret == BFELF_SUCCESS);
@@ -553,18 +686,131 @@ void bfelf_loader_ut::test_bfelf_loader_relocate()
     ret = bfelf_loader_relocate(NULL);
     ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
 
-    m_test_loader.num = 1000;
+    m_test_loader.efs = 0;
     ret = bfelf_loader_relocate(&m_test_loader);
     ASSERT_TRUE(ret == BFELF_ERROR_INVALID_LOADER);
-    m_test_loader.num = 1;
+    m_test_loader.efs = &m_test_elf;
+
+    // The global symbol table has to be set before relocating
+
+    ret = bfelf_loader_relocate(&m_test_loader);
+    ASSERT_TRUE(ret == BFELF_ERROR_LOADER_FULL);
+
+    set_symtab(&m_test_loader, m_test_loader_symtab);
 
     ret = bfelf_loader_relocate(&m_test_loader);
     ASSERT_TRUE(ret == BFELF_SUCCESS);
     ret = bfelf_loader_relocate(&m_test_loader);
     ASSERT_TRUE(ret == BFELF_SUCCESS);
 
+    ASSERT_TRUE(m_test_elf.symcache == 0);
+    ASSERT_TRUE(m_test_elf.symcache_hits == 0);
+    ASSERT_TRUE(m_test_elf.symcache_misses == 0);
+
+    // The symbol cache is only used when the caller provides one
+
+    std::vector<bfelf_symcache_t> cache(m_test_elf.symnum);
+
+    ret = bfelf_loader_relocate_begin(&m_test_loader);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    ret = bfelf_loader_relocate_file(&m_test_elf, cache.data(), cache.size());
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    ret = bfelf_loader_relocate_end(&m_test_loader);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ASSERT_TRUE(m_test_elf.symcache == 0);
+    ASSERT_TRUE(m_test_elf.symcache_hits == 3);
+    ASSERT_TRUE(m_test_elf.symcache_misses == 1);
+
+    set_symtab(&m_loader, m_loader_symtab);
+
     ret = bfelf_loader_relocate(&m_loader);
     ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ASSERT_TRUE(m_loader.symtab->num > 0);
+    ASSERT_TRUE(m_dummy1_ef.loader == &m_loader);
+    ASSERT_TRUE(m_dummy2_ef.loader == &m_loader);
+    ASSERT_TRUE(m_dummy3_ef.loader == &m_loader);
+}
+
+void bfelf_loader_ut::test_bfelf_loader_relocate_duplicate()
+{
+    auto ret = 0;
+    auto ef1 = m_dummy1_ef;
+    auto ef2 = m_dummy1_ef;
+    auto loader = new bfelf_loader_t;
+    std::vector<char> symtab;
+
+    ret = bfelf_loader_init(loader);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_loader_add(loader, &ef1);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    ret = bfelf_loader_add(loader, &ef2);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    set_symtab(loader, symtab);
+
+    ret = bfelf_loader_relocate(loader);
+    EXPECT_TRUE(ret == BFELF_ERROR_DUPLICATE_SYMBOL);
+    EXPECT_TRUE(ef1.loader == 0);
+    EXPECT_TRUE(ef2.loader == 0);
+
+    delete loader;
+}
+
+void bfelf_loader_ut::test_bfelf_loader_symtab()
+{
+    auto ret = 0;
+    auto entry = (bfelf64_sword)sizeof(bfelf_global_sym_t);
+    auto header = (bfelf64_sword)sizeof(bfelf_symtab_t);
+
+    dummies_t d;
+    std::vector<char> symtab;
+
+    init_dummies(d);
+
+    EXPECT_TRUE(bfelf_loader_symtab_size(NULL, 0) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_loader_set_symtab(NULL, (char *)&ret, 0x1000) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_loader_set_symtab(d.loader, NULL, 0x1000) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_loader_set_symtab(d.loader, (char *)&ret, header) == BFELF_ERROR_INVALID_ARG);
+
+    // The table grows with the number of symbols, and always has room for
+    // all of them (including those of a file that is not added yet)
+
+    EXPECT_TRUE(bfelf_loader_symtab_size(d.loader, 0) == header + 16 * entry);
+    EXPECT_TRUE(bfelf_loader_symtab_size(d.loader, &m_dummy1_ef) > header + m_dummy1_ef.symnum * entry);
+
+    load_dummies(d);
+
+    auto symnum = d.efs[0].symnum + d.efs[1].symnum + d.efs[2].symnum;
+
+    EXPECT_TRUE(bfelf_loader_symtab_size(d.loader, 0) > header + symnum * entry);
+    EXPECT_TRUE(bfelf_loader_symtab_size(d.loader, &m_dummy1_ef) >= bfelf_loader_symtab_size(d.loader, 0));
+
+    // The number of entries is rounded down to a power of 2
+
+    symtab.resize(header + 24 * entry);
+
+    ret = bfelf_loader_set_symtab(d.loader, symtab.data(), symtab.size());
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(d.loader->next_symtab->num == 0);
+    EXPECT_TRUE(d.loader->next_symtab->size == 16);
+
+    // A table that is too small is full before every symbol is added
+
+    symtab.resize(header + entry);
+
+    ret = bfelf_loader_set_symtab(d.loader, symtab.data(), symtab.size());
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_loader_relocate(d.loader);
+    EXPECT_TRUE(ret == BFELF_ERROR_LOADER_FULL);
+    EXPECT_TRUE(d.efs[0].loader == 0);
+
+    relocate_dummies(d);
+    check_dummies(d);
+    fini_dummies(d);
 }
 
 void bfelf_loader_ut::test_bfelf_section_header()
@@ -709,6 +955,80 @@ void bfelf_loader_ut::test_bfelf_symbol_by_name()
     ASSERT_TRUE(ret == BFELF_SUCCESS);
 }
 
+void bfelf_loader_ut::check_symbol_by_name(bfelf_file_t *ef)
+{
+    auto ret = 0;
+    struct bfelf_sym *sym = 0;
+    struct bfelf_sym *found = 0;
+    struct e_string_t str = {0};
+    struct e_string_t missing = {"missing_symbol", 14};
+
+    for (auto i = 1; i < ef->symnum; i++)
+    {
+        ret = bfelf_symbol_by_index(ef, i, &sym);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        if (sym->st_value == 0)
+            continue;
+
+        ret = bfelf_symbol_name(ef, sym, &str);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        ret = bfelf_symbol_by_name(ef, &str, &found);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+        ASSERT_TRUE(found == sym);
+    }
+
+    ret = bfelf_symbol_by_name(ef, &missing, &found);
+    ASSERT_TRUE(ret == BFELF_ERROR_NO_SUCH_SYMBOL);
+}
+
+void bfelf_loader_ut::test_bfelf_symbol_by_name_hash()
+{
+    auto ef = m_dummy3_ef;
+
+    ASSERT_TRUE(ef.hashtab.nbucket != 0 || ef.gnuhashtab.nbucket != 0);
+    this->check_symbol_by_name(&ef);
+
+    ef.gnuhashtab.nbucket = 0;
+    this->check_symbol_by_name(&ef);
+
+    ef.hashtab.nbucket = 0;
+    this->check_symbol_by_name(&ef);
+}
+
+void bfelf_loader_ut::test_bfelf_symbol_name_hash()
+{
+    auto ret = 0;
+    uint32_t hash = 5381;
+    struct bfelf_sym *sym = 0;
+    struct bfelf_sym *found = 0;
+    struct e_string_t str = {0};
+    struct e_string_t name = {"_Z12dummy3_test2i", 17};
+    struct e_string_t prefix = {"_Z12dummy3_test2", 16};
+    struct e_string_t other = {"_Z12dummy3_test2j", 17};
+
+    for (auto i = 0; i < name.len; i++)
+        hash = (hash << 5) + hash + static_cast<unsigned char>(name.buf[i]);
+
+    ret = bfelf_symbol_by_name(&m_dummy3_ef, &name, &sym);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_symbol_name(&m_dummy3_ef, sym, &str);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    ASSERT_TRUE(str.hash == hash);
+
+    ret = bfelf_symbol_by_name(&m_dummy3_ef, &str, &found);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    ASSERT_TRUE(found == sym);
+
+    ret = bfelf_symbol_by_name(&m_dummy3_ef, &prefix, &found);
+    ASSERT_TRUE(ret == BFELF_ERROR_NO_SUCH_SYMBOL);
+
+    ret = bfelf_symbol_by_name(&m_dummy3_ef, &other, &found);
+    ASSERT_TRUE(ret == BFELF_ERROR_NO_SUCH_SYMBOL);
+}
+
 void bfelf_loader_ut::test_bfelf_symbol_by_name_global()
 {
     auto ret = 0;
@@ -747,6 +1067,15 @@ void bfelf_loader_ut::test_bfelf_symbol_by_name_global()
     ret = bfelf_symbol_by_name_global(&m_test_elf, &str, &efr, &sym);
     ASSERT_TRUE(ret == BFELF_SUCCESS);
     ASSERT_TRUE(efr == &m_test_elf);
+
+    str = {"_Z12dummy3_test1i", 17};
+    ret = bfelf_symbol_by_name_global(&m_dummy1_ef, &str, &efr, &sym);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    ASSERT_TRUE(efr == &m_dummy3_ef);
+
+    str = {"missing_symbol", 14};
+    ret = bfelf_symbol_by_name_global(&m_dummy1_ef, &str, &efr, &sym);
+    ASSERT_TRUE(ret == BFELF_ERROR_NO_SUCH_SYMBOL);
 }
 
 void bfelf_loader_ut::test_bfelf_resolve_symbol()
@@ -863,6 +1192,82 @@ void bfelf_loader_ut::test_bfelf_relocate_symbols()
     ASSERT_TRUE(ret == BFELF_SUCCESS);
 }
 
+void bfelf_loader_ut::test_bfelf_relocate_relative()
+{
+    auto num_relative = 0;
+
+    for (auto t = 0; t < m_dummy3_ef.num_rela; t++)
+    {
+        auto relatab = &m_dummy3_ef.bfrelatab[t];
+
+        for (auto r = 0; r < relatab->num_relative; r++)
+            EXPECT_TRUE(BFELF_REL_TYPE(relatab->tab[r].r_info) == BFR_X86_64_RELATIVE);
+
+        num_relative += relatab->num_relative;
+    }
+
+    EXPECT_TRUE(num_relative > 0 || m_dummy3_ef.relrnum > 0);
+}
+
+void bfelf_loader_ut::test_bfelf_relocate_relr()
+{
+    auto ret = 0;
+    bfelf_file_t ef = {0};
+    bfelf64_xword exec[128] = {0};
+
+    exec[120] = 0x40 * sizeof(bfelf64_xword);
+    exec[121] = (1ULL << 63) | (0x5ULL << 1) | 1;
+    exec[122] = (0x1ULL << 1) | 1;
+
+    ef.exec = (char *)exec;
+    ef.esize = sizeof(exec);
+    ef.relr = 120 * sizeof(bfelf64_xword);
+    ef.relrnum = 3;
+
+    ret = bfelf_relocate_relr(NULL);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_relocate_relr(&ef);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_FILE);
+    ef.valid = BFELF_TRUE;
+
+    ef.relrnum = 100;
+    ret = bfelf_relocate_relr(&ef);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_FILE);
+    ef.relrnum = 3;
+
+    exec[0x40] = 1;
+    exec[0x41] = 2;
+    exec[0x42] = 3;
+    exec[0x43] = 4;
+    exec[0x7F] = 5;
+
+    ret = bfelf_relocate_relr(&ef);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_FILE);
+    EXPECT_TRUE(exec[0x40] == 1);
+    EXPECT_TRUE(ef.relr_applied != BFELF_TRUE);
+    exec[122] = 1;
+
+    ret = bfelf_relocate_relr(&ef);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(ef.relr_applied == BFELF_TRUE);
+
+    EXPECT_TRUE(exec[0x40] == (bfelf64_addr)exec + 1);
+    EXPECT_TRUE(exec[0x41] == (bfelf64_addr)exec + 2);
+    EXPECT_TRUE(exec[0x42] == 3);
+    EXPECT_TRUE(exec[0x43] == (bfelf64_addr)exec + 4);
+    EXPECT_TRUE(exec[0x7F] == (bfelf64_addr)exec + 5);
+
+    ret = bfelf_relocate_relr(&ef);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    EXPECT_TRUE(exec[0x40] == (bfelf64_addr)exec + 1);
+    EXPECT_TRUE(exec[0x41] == (bfelf64_addr)exec + 2);
+    EXPECT_TRUE(exec[0x42] == 3);
+    EXPECT_TRUE(exec[0x43] == (bfelf64_addr)exec + 4);
+    EXPECT_TRUE(exec[0x7F] == (bfelf64_addr)exec + 5);
+}
+
 void bfelf_loader_ut::test_bfelf_program_header()
 {
     auto ret = 0;
@@ -905,6 +1310,86 @@ void bfelf_loader_ut::test_bfelf_load_segments()
     ASSERT_TRUE(ret == BFELF_SUCCESS);
 }
 
+void bfelf_loader_ut::test_bfelf_load_segments_zero()
+{
+    auto ret = 0;
+    auto ef = m_dummy3_ef;
+    auto matches = true;
+    auto exec = alloc_exec(m_dummy3_esize);
+
+    ASSERT_TRUE(exec != MAP_FAILED);
+
+    for (auto i = 0; i < m_dummy3_esize; i++)
+        exec[i] = (char)0xAA;
+
+    ret = bfelf_file_load(&ef, exec, m_dummy3_esize);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    for (auto i = 0; i < m_dummy3_esize; i++)
+    {
+        char expected = 0;
+
+        for (auto p = 0; p < ef.ehdr->e_phnum; p++)
+        {
+            auto phdr = &ef.phdrtab[p];
+
+            if (phdr->p_type != bfpt_load)
+                continue;
+
+            if (i >= (int64_t)phdr->p_vaddr && i < (int64_t)(phdr->p_vaddr + phdr->p_filesz))
+                expected = ef.file[phdr->p_offset + (i - phdr->p_vaddr)];
+        }
+
+        if (exec[i] != expected)
+            matches = false;
+    }
+
+    EXPECT_TRUE(matches);
+
+    munmap(exec, m_dummy3_esize);
+}
+
+void bfelf_loader_ut::test_bfelf_load_segments_zeroed()
+{
+    auto ret = 0;
+    auto ef = m_dummy3_ef;
+    auto matches = true;
+    auto exec = alloc_exec(m_dummy3_esize);
+
+    ASSERT_TRUE(exec != MAP_FAILED);
+
+    for (auto i = 0; i < m_dummy3_esize; i++)
+        exec[i] = (char)0xAA;
+
+    ef.zeroed = BFELF_TRUE;
+
+    ret = bfelf_file_load(&ef, exec, m_dummy3_esize);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    for (auto i = 0; i < m_dummy3_esize; i++)
+    {
+        char expected = (char)0xAA;
+
+        for (auto p = 0; p < ef.ehdr->e_phnum; p++)
+        {
+            auto phdr = &ef.phdrtab[p];
+
+            if (phdr->p_type != bfpt_load)
+                continue;
+
+            if (i >= (int64_t)phdr->p_vaddr && i < (int64_t)(phdr->p_vaddr + phdr->p_filesz))
+                expected = ef.file[phdr->p_offset + (i - phdr->p_vaddr)];
+        }
+
+        if (exec[i] != expected)
+            matches = false;
+    }
+
+    EXPECT_TRUE(matches);
+
+    munmap(exec, m_dummy3_esize);
+}
+
 void bfelf_loader_ut::test_bfelf_load_segment()
 {
     auto ret = 0;
@@ -925,6 +1410,11 @@ void bfelf_loader_ut::test_bfelf_load_segment()
     ASSERT_TRUE(ret == BFELF_ERROR_INVALID_PH_MEMSZ);
     g_test.phdr1.p_memsz = g_test.phdr1.p_filesz;
 
+    g_test.phdr1.p_filesz = g_test.phdr1.p_memsz + 1;
+    ret = bfelf_load_segment(&m_test_elf, &g_test.phdr1);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_PH_FILESZ);
+    g_test.phdr1.p_filesz = g_test.phdr1.p_memsz;
+
     ret = bfelf_load_segment(&m_test_elf, &g_test.phdr1);
     ASSERT_TRUE(ret == BFELF_SUCCESS);
 }
@@ -1033,8 +1523,1326 @@ void bfelf_loader_ut::test_resolve()
 
 }
 
+void bfelf_loader_ut::test_lazy_binding()
+{
+    auto bound = 0;
+    dummies_t d;
+
+    init_dummies(d);
+
+    d.loader->lazy = BFELF_TRUE;
+
+    load_dummies(d);
+    relocate_dummies(d);
+
+    auto ef3 = &d.efs[2];
+    auto jmprel = (bfelf_rela *)(ef3->exec + ef3->jmprel);
+
+    ASSERT_TRUE(ef3->jmprelnum > 0);
+
+    for (auto i = 0; i < ef3->jmprelnum; i++)
+    {
+        auto slot = *(bfelf64_addr *)(ef3->exec + jmprel[i].r_offset);
+        EXPECT_TRUE(slot >= (bfelf64_addr)ef3->exec);
+        EXPECT_TRUE(slot < (bfelf64_addr)ef3->exec + ef3->esize);
+    }
+
+    check_dummies(d);
+    check_dummies(d);
+
+    for (auto i = 0; i < ef3->jmprelnum; i++)
+    {
+        auto slot = *(bfelf64_addr *)(ef3->exec + jmprel[i].r_offset);
+
+        if (slot < (bfelf64_addr)ef3->exec ||
+            slot >= (bfelf64_addr)ef3->exec + ef3->esize)
+        {
+            bound++;
+        }
+    }
+
+    EXPECT_TRUE(bound > 0);
+    EXPECT_TRUE(bfelf_lazy_resolve(NULL, 0) == 0);
+    EXPECT_TRUE(bfelf_lazy_resolve(ef3, ef3->jmprelnum) == 0);
+
+#ifdef __x86_64__
+
+    // A PLT stub whose symbol cannot be resolved halts in the trampoline
+    // instead of jumping to 0. This pushes what PLT0 would have pushed.
+
+    auto status = 0;
+    auto pid = fork();
+
+    if (pid == 0)
+    {
+        __asm__ volatile("push %0\n"
+                         "push %1\n"
+                         "jmp bfelf_lazy_trampoline\n"
+                         :: "r"((bfelf64_xword)ef3->jmprelnum), "r"(ef3));
+        _exit(0);
+    }
+
+    ASSERT_TRUE(pid > 0);
+    ASSERT_TRUE(waitpid(pid, &status, 0) == pid);
+    EXPECT_TRUE(WIFSIGNALED(status) && WTERMSIG(status) == SIGILL);
+
+#endif
+
+    fini_dummies(d);
+}
+
 int
 main(int argc, char *argv[])
 {
     return RUN_ALL_TESTS(bfelf_loader_ut);
 }
+
+void bfelf_loader_ut::test_prelink()
+{
+    auto ret = 0;
+    void *addr = 0;
+    bfelf_prelink_t pl;
+    bfelf64_xword file[22] = {0};
+    bfelf64_xword exec[8] = {0};
+    struct e_string_t foo = {"foo", 3};
+    struct e_string_t baz = {"baz", 3};
+
+    auto hdr = (bfelf_prelink_hdr *)file;
+    auto syms = (bfelf_prelink_sym *)&file[17];
+
+    hdr->magic = BFELF_PRELINK_MAGIC;
+    hdr->version = BFELF_PRELINK_VERSION;
+    hdr->image_offset = 11 * sizeof(bfelf64_xword);
+    hdr->image_size = 4 * sizeof(bfelf64_xword);
+    hdr->exec_size = sizeof(exec);
+    hdr->fixup_offset = 15 * sizeof(bfelf64_xword);
+    hdr->fixup_num = 2;
+    hdr->sym_offset = 17 * sizeof(bfelf64_xword);
+    hdr->sym_num = 2;
+    hdr->str_offset = 21 * sizeof(bfelf64_xword);
+    hdr->str_size = 8;
+
+    file[11] = 0x10;
+    file[12] = 7;
+    file[13] = 0xC3;
+    file[14] = 0x18;
+
+    file[15] = 0;
+    file[16] = (0x1ULL << 3) | 1;
+
+    syms[0].st_name = 4;
+    syms[0].st_value = 0x18;
+    syms[1].st_name = 0;
+    syms[1].st_value = 0x10;
+
+    memcpy(&file[21], "foo\0bar\0", 8);
+
+    EXPECT_TRUE(bfelf_is_prelinked(NULL, sizeof(file)) == BFELF_FALSE);
+    EXPECT_TRUE(bfelf_is_prelinked((char *)file, 8) == BFELF_FALSE);
+    EXPECT_TRUE(bfelf_is_prelinked(m_dummy1, m_dummy1_length) == BFELF_FALSE);
+    EXPECT_TRUE(bfelf_is_prelinked((char *)file, sizeof(file)) == BFELF_TRUE);
+
+    ret = bfelf_prelink_init(NULL, sizeof(file), &pl);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_prelink_init((char *)file, sizeof(file), NULL);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_prelink_init(m_dummy1, m_dummy1_length, &pl);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_PRELINK);
+
+    hdr->version = 0;
+    ret = bfelf_prelink_init((char *)file, sizeof(file), &pl);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_PRELINK);
+    hdr->version = BFELF_PRELINK_VERSION;
+
+    hdr->image_size = sizeof(exec) + 1;
+    ret = bfelf_prelink_init((char *)file, sizeof(file), &pl);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_PRELINK);
+    hdr->image_size = 4 * sizeof(bfelf64_xword);
+
+    hdr->str_size = 9;
+    ret = bfelf_prelink_init((char *)file, sizeof(file), &pl);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_PRELINK);
+    hdr->str_size = 8;
+
+    hdr->fixup_num = ~0ULL;
+    ret = bfelf_prelink_init((char *)file, sizeof(file), &pl);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_PRELINK);
+    hdr->fixup_num = 2;
+
+    ret = bfelf_prelink_init((char *)file, sizeof(file), &pl);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    EXPECT_TRUE(bfelf_prelink_exec_size(NULL) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_prelink_exec_size(&pl) == sizeof(exec));
+
+    ret = bfelf_prelink_resolve_symbol(&pl, &foo, &addr);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_FILE);
+
+    ret = bfelf_prelink_load(&pl, (char *)exec, sizeof(exec) - 1);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    for (auto i = 0; i < 8; i++)
+        exec[i] = 0xAAAAAAAAAAAAAAAA;
+
+    ret = bfelf_prelink_load(&pl, (char *)exec, sizeof(exec));
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    EXPECT_TRUE(exec[0] == (bfelf64_addr)exec + 0x10);
+    EXPECT_TRUE(exec[1] == 7);
+    EXPECT_TRUE(exec[2] == 0xC3);
+    EXPECT_TRUE(exec[3] == (bfelf64_addr)exec + 0x18);
+    EXPECT_TRUE(exec[4] == 0);
+    EXPECT_TRUE(exec[7] == 0);
+
+    ret = bfelf_prelink_resolve_symbol(&pl, NULL, &addr);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_prelink_resolve_symbol(&pl, &foo, &addr);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(addr == (char *)exec + 0x10);
+
+    ret = bfelf_prelink_resolve_symbol(&pl, &baz, &addr);
+    ASSERT_TRUE(ret == BFELF_ERROR_NO_SUCH_SYMBOL);
+
+    char meta[sizeof(bfelf_prelink_hdr) + 2 * sizeof(bfelf_prelink_sym) + 8];
+
+    EXPECT_TRUE(bfelf_prelink_detach_size(NULL) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_prelink_detach_size(&pl) == sizeof(meta));
+
+    ret = bfelf_prelink_detach(&pl, meta, sizeof(meta) - 1);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_prelink_detach(&pl, meta, sizeof(meta));
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    memset(file, 0, sizeof(file));
+
+    ret = bfelf_prelink_resolve_symbol(&pl, &foo, &addr);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(addr == (char *)exec + 0x10);
+
+    ret = bfelf_prelink_resolve_symbol(&pl, &baz, &addr);
+    ASSERT_TRUE(ret == BFELF_ERROR_NO_SUCH_SYMBOL);
+}
+
+void bfelf_loader_ut::test_stream()
+{
+    auto ret = 0;
+    dummies_t d;
+    bfelf_stream_t stream;
+
+    int32_t chunks[3] = {1, 333, 0x1000};
+    char *metas[3] = {0};
+
+    init_dummies(d);
+
+    auto files = d.files;
+    auto fsizes = d.fsizes;
+    auto execs = d.execs;
+    auto esizes = d.esizes;
+    auto efs = d.efs;
+
+    ret = bfelf_stream_init(NULL, &efs[0], fsizes[0]);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_stream_init(&stream, &efs[0], 10);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_stream_init(&stream, &efs[0], fsizes[0]);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_stream_write(&stream, (char *)&stream, 0x20);
+    ASSERT_TRUE(ret == 0x20);
+
+    ret = bfelf_stream_write(&stream, (char *)&stream, 0x20);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_EI_MAG0);
+
+    ret = bfelf_stream_init(&stream, &efs[0], fsizes[0]);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_stream_write(&stream, files[0], fsizes[0] + 1);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_stream_exec_size(&stream);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_FILE);
+
+    for (auto i = 0; i < 3; i++)
+    {
+        auto offset = 0;
+
+        ret = bfelf_stream_init(&stream, &efs[i], fsizes[i]);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        while (offset < fsizes[i])
+        {
+            auto len = std::min(chunks[i], fsizes[i] - offset);
+
+            ret = bfelf_stream_write(&stream, files[i] + offset, len);
+            if (ret < 0)
+                break;
+
+            if (ret == 0)
+            {
+                esizes[i] = bfelf_stream_exec_size(&stream);
+                ASSERT_TRUE(esizes[i] > 0);
+
+                auto msize = bfelf_stream_meta_size(&stream);
+                ASSERT_TRUE(msize > 0 && msize < fsizes[i]);
+
+                execs[i] = alloc_exec(esizes[i]);
+                metas[i] = new char[msize];
+
+                ret = bfelf_stream_finish(&stream);
+                ASSERT_TRUE(ret == BFELF_ERROR_INVALID_FILE);
+
+                ret = bfelf_stream_set_buffers(&stream, execs[i], esizes[i] - 1, metas[i], msize);
+                ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+                ret = bfelf_stream_set_buffers(&stream, execs[i], esizes[i], metas[i], msize);
+                ASSERT_TRUE(ret == BFELF_SUCCESS);
+            }
+
+            offset += ret;
+        }
+
+        ASSERT_TRUE(offset == fsizes[i]);
+
+        ret = bfelf_stream_finish(&stream);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        ret = bfelf_loader_add(d.loader, &efs[i]);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+    }
+
+    for (auto i = 0; i < 3; i++)
+    {
+        bfelf_file_t ef;
+
+        ret = bfelf_file_init(files[i], fsizes[i], &ef);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        EXPECT_TRUE(efs[i].file == 0);
+        EXPECT_TRUE(efs[i].symnum == ef.symnum);
+        EXPECT_TRUE(efs[i].num_rela == ef.num_rela);
+        EXPECT_TRUE(efs[i].hashtab.nbucket == ef.hashtab.nbucket);
+        EXPECT_TRUE(efs[i].gnuhashtab.nbucket == ef.gnuhashtab.nbucket);
+    }
+
+    relocate_dummies(d);
+    check_dummies(d);
+
+    for (auto i = 0; i < 3; i++)
+        delete[] metas[i];
+
+    fini_dummies(d);
+}
+
+void bfelf_loader_ut::test_stream_bounds()
+{
+    auto ret = 0;
+    bfelf_stream_t stream;
+    bfelf_file_t ef;
+
+    auto ehdr = (bfelf64_ehdr *)m_dummy1;
+    auto num = ehdr->e_phoff + ehdr->e_phentsize * ehdr->e_phnum;
+
+    std::vector<char> file(m_dummy1, m_dummy1 + m_dummy1_length);
+    auto phdr = (bfelf_phdr *)(file.data() + ehdr->e_phoff);
+
+    auto write_headers = [&]()
+    {
+        ret = bfelf_stream_init(&stream, &ef, file.size());
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        return bfelf_stream_write(&stream, file.data(), num);
+    };
+
+    auto memsz = phdr[1].p_memsz;
+
+    phdr[1].p_memsz = 0xFFFFFFFFFFFFFFFF;
+    EXPECT_TRUE(write_headers() == BFELF_ERROR_INVALID_PH_MEMSZ);
+
+    phdr[1].p_memsz = BFELF_MAX_EXEC_SIZE;
+    EXPECT_TRUE(write_headers() == BFELF_ERROR_INVALID_PH_MEMSZ);
+
+    phdr[1].p_memsz = memsz;
+
+    auto filesz = phdr[1].p_filesz;
+
+    phdr[1].p_filesz = 0xFFFFFFFFFFFFFFFF;
+    EXPECT_TRUE(write_headers() == BFELF_ERROR_INVALID_PH_FILESZ);
+
+    phdr[1].p_filesz = filesz;
+
+    EXPECT_TRUE(write_headers() == (bfelf64_sword)num);
+
+    auto esize = bfelf_stream_exec_size(&stream);
+    auto msize = bfelf_stream_meta_size(&stream);
+    auto exec = alloc_exec(esize);
+    auto meta = new char[msize];
+
+    ret = bfelf_stream_set_buffers(&stream, exec, esize, meta, msize);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    // A segment that no longer fits in the exec buffer is never copied
+
+    stream.esize = 1;
+    ret = bfelf_stream_write(&stream, file.data() + num, file.size() - num);
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_PH_VADDR);
+
+    munmap(exec, esize);
+    delete[] meta;
+}
+
+void bfelf_loader_ut::test_detach()
+{
+    auto ret = 0;
+    dummies_t d;
+    char *metas[3] = {0};
+
+    ret = bfelf_file_detach_size(NULL);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    init_dummies(d);
+
+    auto files = d.files;
+    auto fsizes = d.fsizes;
+    auto execs = d.execs;
+    auto esizes = d.esizes;
+    auto efs = d.efs;
+
+    for (auto i = 0; i < 3; i++)
+    {
+        auto file = new char[fsizes[i]];
+        memcpy(file, files[i], fsizes[i]);
+
+        ret = bfelf_file_init(file, fsizes[i], &efs[i]);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        auto msize = bfelf_file_detach_size(&efs[i]);
+        ASSERT_TRUE(msize > 0 && msize < fsizes[i]);
+
+        metas[i] = new char[msize];
+
+        ret = bfelf_file_detach(&efs[i], metas[i], msize);
+        ASSERT_TRUE(ret == BFELF_ERROR_INVALID_FILE);
+
+        esizes[i] = bfelf_total_exec_size(&efs[i]);
+        execs[i] = alloc_exec(esizes[i]);
+
+        ret = bfelf_file_load(&efs[i], execs[i], esizes[i]);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        ret = bfelf_file_detach(&efs[i], metas[i], msize - 1);
+        ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+        ret = bfelf_file_detach(&efs[i], metas[i], msize);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        memset(file, 0, fsizes[i]);
+        delete[] file;
+
+        EXPECT_TRUE(efs[i].file == 0);
+
+        ret = bfelf_loader_add(d.loader, &efs[i]);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+    }
+
+    relocate_dummies(d);
+    check_dummies(d);
+
+    for (auto i = 0; i < 3; i++)
+        delete[] metas[i];
+
+    fini_dummies(d);
+}
+
+void bfelf_loader_ut::test_jmprel_in_rela()
+{
+    auto ret = 0;
+    bfelf_file_t ef = {0};
+    bfelf64_xword rela = 0;
+    bfelf64_xword relasz = 0;
+    bfelf64_xword jmprel = 0;
+    bfelf64_xword pltrelsz = 0;
+
+    auto copy = new char[m_dummy3_length];
+    auto ehdr = (bfelf64_ehdr *)m_dummy3;
+    auto phdrtab = (bfelf_phdr *)(m_dummy3 + ehdr->e_phoff);
+
+    for (auto layout = 0; layout < 2; layout++)
+    {
+        memcpy(copy, m_dummy3, m_dummy3_length);
+
+        for (auto p = 0; p < ehdr->e_phnum; p++)
+        {
+            if (phdrtab[p].p_type != bfpt_dynamic)
+                continue;
+
+            auto dyn = (bfelf_dyn *)(copy + phdrtab[p].p_offset);
+
+            for (auto d = 0U; dyn[d].d_tag != bfdt_null; d++)
+            {
+                if (dyn[d].d_tag == bfdt_rela)
+                    rela = dyn[d].d_val;
+                if (dyn[d].d_tag == bfdt_relasz)
+                    relasz = dyn[d].d_val;
+                if (dyn[d].d_tag == bfdt_jmprel)
+                    jmprel = dyn[d].d_val;
+                if (dyn[d].d_tag == bfdt_pltrelsz)
+                    pltrelsz = dyn[d].d_val;
+            }
+
+            ASSERT_TRUE(rela != 0 && jmprel != 0 && pltrelsz != 0);
+
+            // Layout 0 has DT_RELASZ cover both tables, and layout 1 only
+            // has JUMP_SLOT relocations, so DT_RELA is the same as
+            // DT_JMPREL.
+
+            for (auto d = 0U; dyn[d].d_tag != bfdt_null; d++)
+            {
+                if (layout == 0 && dyn[d].d_tag == bfdt_relasz)
+                    dyn[d].d_val = jmprel + pltrelsz - rela;
+                if (layout == 1 && dyn[d].d_tag == bfdt_rela)
+                    dyn[d].d_val = jmprel;
+                if (layout == 1 && dyn[d].d_tag == bfdt_relasz)
+                    dyn[d].d_val = pltrelsz;
+                if (layout == 1 && dyn[d].d_tag == bfdt_relacount)
+                    dyn[d].d_val = 0;
+            }
+        }
+
+        ret = bfelf_file_init(copy, m_dummy3_length, &ef);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        EXPECT_TRUE(ef.jmprelnum == (bfelf64_sword)(pltrelsz / sizeof(bfelf_rela)));
+        EXPECT_TRUE(ef.bfrelatab[ef.num_rela - 1].num == ef.jmprelnum);
+
+        if (layout == 0)
+        {
+            EXPECT_TRUE(ef.num_rela == 2);
+            EXPECT_TRUE(ef.relanum == (bfelf64_sword)(relasz / sizeof(bfelf_rela)));
+        }
+        else
+        {
+            EXPECT_TRUE(ef.num_rela == 1);
+            EXPECT_TRUE(ef.relanum == 0);
+        }
+    }
+
+    delete[] copy;
+}
+
+void bfelf_loader_ut::test_rela_sections()
+{
+    auto ret = 0;
+
+    auto copy = new char[m_dummy3_length];
+    auto ehdr = (bfelf64_ehdr *)m_dummy3;
+    auto phdrtab = (bfelf_phdr *)(copy + ehdr->e_phoff);
+    auto shdrtab = (bfelf_shdr *)(copy + ehdr->e_shoff);
+
+    // Without PT_DYNAMIC, the relocation tables come from the section
+    // headers, one per SHT_RELA section. dummy3 has two, so the extra ones
+    // are made by copying .rela.dyn over sections that are not needed to
+    // initialize the file. Three tables must fit, and one more than
+    // BFELF_MAX_RELTAB is rejected.
+
+    for (auto extra : {1, BFELF_MAX_RELTAB - 1})
+    {
+        bfelf_file_t ef = {0};
+        bfelf_shdr *rela = 0;
+        auto added = 0;
+
+        memcpy(copy, m_dummy3, m_dummy3_length);
+
+        for (auto p = 0; p < ehdr->e_phnum; p++)
+        {
+            if (phdrtab[p].p_type == bfpt_dynamic)
+                phdrtab[p].p_type = bfpt_null;
+        }
+
+        for (auto s = 0; s < ehdr->e_shnum && rela == 0; s++)
+        {
+            if (shdrtab[s].sh_type == bfsht_rela)
+                rela = &shdrtab[s];
+        }
+
+        ASSERT_TRUE(rela != 0);
+
+        for (auto s = 1; s < ehdr->e_shnum && added < extra; s++)
+        {
+            if (shdrtab[s].sh_type != bfsht_progbits &&
+                shdrtab[s].sh_type != bfsht_nobits)
+            {
+                continue;
+            }
+
+            shdrtab[s] = *rela;
+            added++;
+        }
+
+        ASSERT_TRUE(added == extra);
+
+        ret = bfelf_file_init(copy, m_dummy3_length, &ef);
+
+        if (extra == 1)
+        {
+            EXPECT_TRUE(ret == BFELF_SUCCESS);
+            EXPECT_TRUE(ef.num_rela == 3);
+        }
+        else
+        {
+            EXPECT_TRUE(ret == BFELF_ERROR_INVALID_FILE);
+        }
+    }
+
+    delete[] copy;
+}
+
+void bfelf_loader_ut::test_no_section_headers()
+{
+    auto ret = 0;
+
+    for (auto gnu_hash_only = 0; gnu_hash_only < 2; gnu_hash_only++)
+    {
+        dummies_t d;
+        char *copies[3] = {0};
+
+        init_dummies(d);
+
+        auto files = d.files;
+        auto execs = d.execs;
+        auto esizes = d.esizes;
+        auto efs = d.efs;
+
+        for (auto i = 0; i < 3; i++)
+        {
+            bfelf64_xword symnum = 0;
+            auto ehdr = (bfelf64_ehdr *)files[i];
+            auto shdrtab = (bfelf_shdr *)(files[i] + ehdr->e_shoff);
+            auto phdrtab = (bfelf_phdr *)(files[i] + ehdr->e_phoff);
+
+            for (auto s = 0; s < ehdr->e_shnum; s++)
+            {
+                if (shdrtab[s].sh_type == bfsht_dynsym)
+                    symnum = shdrtab[s].sh_size / sizeof(bfelf_sym);
+            }
+
+            // Strip the section header table (which is at the end of the
+            // file), and if asked, hide DT_HASH so that the number of
+            // symbols has to come from DT_GNU_HASH.
+
+            auto fsize = (int32_t)ehdr->e_shoff;
+
+            copies[i] = new char[fsize];
+            memcpy(copies[i], files[i], fsize);
+
+            auto copy = (bfelf64_ehdr *)copies[i];
+            copy->e_shoff = 0;
+            copy->e_shnum = 0;
+            copy->e_shstrndx = 0;
+
+            for (auto p = 0; p < ehdr->e_phnum && gnu_hash_only == 1; p++)
+            {
+                if (phdrtab[p].p_type != bfpt_dynamic)
+                    continue;
+
+                auto dyn = (bfelf_dyn *)(copies[i] + phdrtab[p].p_offset);
+
+                for (auto d = 0U; dyn[d].d_tag != bfdt_null; d++)
+                {
+                    if (dyn[d].d_tag == bfdt_hash)
+                        dyn[d].d_tag = bfdt_relaent;
+                }
+            }
+
+            ret = bfelf_file_init(copies[i], fsize, &efs[i]);
+            ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+            EXPECT_TRUE(efs[i].dynsym == 0);
+            EXPECT_TRUE(efs[i].shstrtab == 0);
+            EXPECT_TRUE(efs[i].symnum == (bfelf64_sword)symnum);
+            EXPECT_TRUE(efs[i].hashtab.nbucket == 0 || gnu_hash_only == 0);
+
+            esizes[i] = bfelf_total_exec_size(&efs[i]);
+            execs[i] = alloc_exec(esizes[i]);
+
+            ret = bfelf_file_load(&efs[i], execs[i], esizes[i]);
+            ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+            ret = bfelf_loader_add(d.loader, &efs[i]);
+            ASSERT_TRUE(ret == BFELF_SUCCESS);
+        }
+
+        relocate_dummies(d);
+        check_dummies(d);
+
+        for (auto i = 0; i < 3; i++)
+            delete[] copies[i];
+
+        fini_dummies(d);
+    }
+}
+
+void bfelf_loader_ut::test_symbolize()
+{
+    auto ret = 0;
+    void *addr = 0;
+    bfelf64_xword offset = 0;
+    bfelf_file_t *ef = 0;
+    struct e_string_t name = {0};
+    struct e_string_t str1 = {"_Z12dummy3_test2i", 17};
+    struct e_string_t str2 = {"g_my_glob1", 10};
+
+    auto loader = new bfelf_loader_t;
+
+    ret = bfelf_loader_index_size(NULL);
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_loader_init(loader);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_symbolize(loader, (void *)m_dummy3_exec, &ef, &name, &offset);
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_LOADER);
+
+    delete loader;
+
+    auto size = bfelf_loader_index_size(&m_loader);
+    ASSERT_TRUE(size > 0);
+
+    auto buf = new char[size];
+
+    ret = bfelf_loader_index(&m_loader, NULL, size);
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_loader_index(&m_loader, buf, size - 1);
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_loader_index(&m_loader, buf, size);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ASSERT_TRUE(m_loader.addrnum > 0);
+
+    for (auto i = 1; i < m_loader.addrnum; i++)
+        EXPECT_TRUE(m_loader.addrtab[i - 1].addr <= m_loader.addrtab[i].addr);
+
+    ret = bfelf_symbolize(&m_loader, (void *)m_dummy3_exec, NULL, &name, &offset);
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_resolve_symbol(&m_dummy3_ef, &str1, &addr);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_symbolize(&m_loader, (char *)addr + 5, &ef, &name, &offset);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    EXPECT_TRUE(ef == &m_dummy3_ef);
+    EXPECT_TRUE(offset == 5);
+    EXPECT_TRUE(name.len == str1.len && memcmp(name.buf, str1.buf, name.len) == 0);
+
+    ret = bfelf_resolve_symbol(&m_dummy3_ef, &str2, &addr);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_symbolize(&m_loader, addr, &ef, &name, &offset);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    EXPECT_TRUE(offset == 0);
+    EXPECT_TRUE(name.len == str2.len && memcmp(name.buf, str2.buf, name.len) == 0);
+
+    ret = bfelf_symbolize(&m_loader, (void *)m_dummy3_exec, &ef, &name, &offset);
+    EXPECT_TRUE(ret == BFELF_ERROR_NO_SUCH_SYMBOL);
+
+    ret = bfelf_symbolize(&m_loader, (void *)0x1, &ef, &name, &offset);
+    EXPECT_TRUE(ret == BFELF_ERROR_NO_SUCH_SYMBOL);
+
+    struct bfelf_addr_sym_t nested[3] =
+    {
+        {0x1000, 0x100, &m_dummy3_ef, &m_dummy3_ef.symtab[1]},
+        {0x1010, 0, &m_dummy3_ef, &m_dummy3_ef.symtab[2]},
+        {0x1020, 0x8, &m_dummy3_ef, &m_dummy3_ef.symtab[3]}
+    };
+
+    m_loader.addrnum = 3;
+    m_loader.addrmax = 0x100;
+    m_loader.addrtab = nested;
+
+    ret = bfelf_symbolize(&m_loader, (void *)0x1050, &ef, &name, &offset);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(ef == &m_dummy3_ef);
+    EXPECT_TRUE(offset == 0x50);
+    EXPECT_TRUE(name.buf == m_dummy3_ef.dynstr + m_dummy3_ef.symtab[1].st_name);
+
+    ret = bfelf_symbolize(&m_loader, (void *)0x1010, &ef, &name, &offset);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(offset == 0);
+    EXPECT_TRUE(name.buf == m_dummy3_ef.dynstr + m_dummy3_ef.symtab[2].st_name);
+
+    ret = bfelf_symbolize(&m_loader, (void *)0x1024, &ef, &name, &offset);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(offset == 4);
+    EXPECT_TRUE(name.buf == m_dummy3_ef.dynstr + m_dummy3_ef.symtab[3].st_name);
+
+    ret = bfelf_symbolize(&m_loader, (void *)0x1100, &ef, &name, &offset);
+    EXPECT_TRUE(ret == BFELF_ERROR_NO_SUCH_SYMBOL);
+
+    m_loader.addrnum = 0;
+    m_loader.addrmax = 0;
+    m_loader.addrtab = 0;
+
+    delete[] buf;
+}
+
+static bfelf64_xword g_ticks = 0;
+
+static bfelf64_xword
+test_timestamp()
+{
+    return g_ticks++;
+}
+
+void bfelf_loader_ut::test_stats()
+{
+    auto ret = 0;
+    dummies_t d;
+    bfelf_stats_t stats;
+
+    memset(&stats, 0xFF, sizeof(stats));
+
+    ret = bfelf_stats_init(&stats, test_timestamp);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    EXPECT_TRUE(stats.timestamp == test_timestamp);
+    EXPECT_TRUE(stats.init_time == 0);
+    EXPECT_TRUE(stats.lookups == 0);
+
+    init_dummies(d);
+    load_dummies(d);
+    relocate_dummies(d);
+
+    ret = bfelf_stats_init(NULL, NULL);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    EXPECT_TRUE(stats.init_time == 3);
+    EXPECT_TRUE(stats.load_time == 3);
+    EXPECT_TRUE(stats.relocate_time == 1);
+    EXPECT_TRUE(stats.bytes_copied > 0);
+    EXPECT_TRUE(stats.bytes_copied + stats.bytes_zeroed ==
+                (bfelf64_xword)(d.esizes[0] + d.esizes[1] + d.esizes[2]));
+    EXPECT_TRUE(stats.relocs_relative + stats.relocs_relr > 0);
+    EXPECT_TRUE(stats.relocs_glob_dat + stats.relocs_jump_slot + stats.relocs_64 > 0);
+    EXPECT_TRUE(stats.lookups > 0);
+    EXPECT_TRUE(stats.strcmps > 0);
+
+    auto lookups = stats.lookups;
+
+    relocate_dummies(d);
+
+    EXPECT_TRUE(stats.lookups == lookups);
+
+    fini_dummies(d);
+}
+
+static void
+append_block(std::vector<char> &file, const char *block, bfelf64_word size)
+{
+    file.insert(file.end(), (const char *)&size, (const char *)&size + sizeof(size));
+    file.insert(file.end(), block, block + (size & ~BFELF_LZ4_BLOCK_RAW));
+}
+
+static std::vector<char>
+make_compressed(bfelf64_xword fsize, bfelf64_xword block_size)
+{
+    struct bfelf_lz4_hdr hdr = {BFELF_LZ4_MAGIC, BFELF_LZ4_VERSION, fsize, block_size};
+    return std::vector<char>((char *)&hdr, (char *)&hdr + sizeof(hdr));
+}
+
+void bfelf_loader_ut::test_compressed()
+{
+    auto ret = 0;
+    char *buf = 0;
+    char dst[32] = {0};
+    bfelf_lz4_t lz;
+
+    // "abc", then a 9 byte match at offset 3, then "x"
+    const char block[] = {0x35, 'a', 'b', 'c', 0x03, 0x00, 0x10, 'x'};
+    const char bad_offset[] = {0x35, 'a', 'b', 'c', 0x04, 0x00, 0x10, 'x'};
+    const char truncated[] = {0x35, 'a', 'b', 'c', 0x03};
+    const char long_literals[] = {(char)0xF0, 0x01, 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h',
+                                  'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p'
+                                 };
+
+    ret = bfelf_lz4_decompress(NULL, sizeof(block), dst, sizeof(dst));
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_lz4_decompress(block, sizeof(block), dst, sizeof(dst));
+    ASSERT_TRUE(ret == 13);
+    EXPECT_TRUE(memcmp(dst, "abcabcabcabcx", 13) == 0);
+
+    ret = bfelf_lz4_decompress(block, sizeof(block), dst, 12);
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_COMPRESSED);
+
+    ret = bfelf_lz4_decompress(bad_offset, sizeof(bad_offset), dst, sizeof(dst));
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_COMPRESSED);
+
+    ret = bfelf_lz4_decompress(truncated, sizeof(truncated), dst, sizeof(dst));
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_COMPRESSED);
+
+    ret = bfelf_lz4_decompress(long_literals, sizeof(long_literals), dst, sizeof(dst));
+    ASSERT_TRUE(ret == 16);
+    EXPECT_TRUE(memcmp(dst, "abcdefghijklmnop", 16) == 0);
+
+    // A compressed module made up of raw blocks and a compressed block
+
+    auto file = make_compressed(13 + m_dummy1_length, 13);
+
+    append_block(file, block, sizeof(block));
+
+    for (auto offset = 0; offset < m_dummy1_length; offset += 13)
+    {
+        auto size = std::min(13, m_dummy1_length - offset);
+        append_block(file, m_dummy1 + offset, size | BFELF_LZ4_BLOCK_RAW);
+    }
+
+    EXPECT_TRUE(bfelf_is_compressed(m_dummy1, m_dummy1_length) == BFELF_FALSE);
+    EXPECT_TRUE(bfelf_is_compressed(file.data(), file.size()) == BFELF_TRUE);
+
+    ret = bfelf_lz4_init(NULL, file.data(), file.size());
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_lz4_init(&lz, m_dummy1, m_dummy1_length);
+    ASSERT_TRUE(ret == BFELF_ERROR_INVALID_COMPRESSED);
+
+    ret = bfelf_lz4_init(&lz, file.data(), file.size());
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_lz4_size(&lz);
+    ASSERT_TRUE(ret == 13 + m_dummy1_length);
+
+    std::vector<char> contents;
+
+    while ((ret = bfelf_lz4_read(&lz, &buf)) > 0)
+        contents.insert(contents.end(), buf, buf + ret);
+
+    ASSERT_TRUE(ret == 0);
+    ASSERT_TRUE(contents.size() == (size_t)m_dummy1_length + 13);
+    EXPECT_TRUE(memcmp(contents.data(), "abcabcabcabcx", 13) == 0);
+    EXPECT_TRUE(memcmp(contents.data() + 13, m_dummy1, m_dummy1_length) == 0);
+
+    // Truncated and corrupt compressed modules
+
+    ret = bfelf_lz4_init(&lz, file.data(), file.size() - 1);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    while ((ret = bfelf_lz4_read(&lz, &buf)) > 0);
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_COMPRESSED);
+
+    file = make_compressed(14, 0x1000);
+    append_block(file, block, sizeof(block));
+
+    ret = bfelf_lz4_init(&lz, file.data(), file.size());
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_lz4_read(&lz, &buf);
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_COMPRESSED);
+
+    file = make_compressed(13, BFELF_LZ4_MAX_BLOCK_SIZE + 1);
+
+    ret = bfelf_lz4_init(&lz, file.data(), file.size());
+    EXPECT_TRUE(ret == BFELF_ERROR_INVALID_COMPRESSED);
+}
+
+void bfelf_loader_ut::test_parallel_relocate()
+{
+    auto ret = 0;
+    dummies_t d;
+
+    std::vector<std::thread> threads;
+    std::vector<std::vector<bfelf_symcache_t>> caches(3);
+
+    init_dummies(d);
+    load_dummies(d);
+
+    auto loader = d.loader;
+    auto execs = d.execs;
+    auto esizes = d.esizes;
+    auto efs = d.efs;
+
+    EXPECT_TRUE(bfelf_loader_relocate_begin(NULL) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_loader_relocate_file(NULL, 0, 0) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_loader_relocate_end(NULL) == BFELF_ERROR_INVALID_ARG);
+
+    set_symtab(loader, d.symtab);
+
+    // A file that is never relocated is reported by relocate_end
+
+    ret = bfelf_loader_relocate_begin(loader);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_loader_relocate_file(&efs[0], 0, 0);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_loader_relocate_end(loader);
+    EXPECT_TRUE(ret == BFELF_ERROR_NOT_RELOCATED);
+
+    // Relocate each file on its own thread, each with its own symcache
+
+    for (auto i = 0; i < 3; i++)
+        bfelf_file_load(&efs[i], execs[i], esizes[i]);
+
+    ret = bfelf_loader_relocate_begin(loader);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    auto relocate = [&](int i)
+    {
+        bfelf_loader_relocate_file(&efs[i], caches[i].data(), caches[i].size());
+    };
+
+    for (auto i = 0; i < 3; i++)
+    {
+        caches[i].resize(efs[i].symnum);
+        threads.push_back(std::thread(relocate, i));
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    ret = bfelf_loader_relocate_end(loader);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    check_dummies(d);
+    fini_dummies(d);
+}
+
+void bfelf_loader_ut::test_hot_load()
+{
+    auto ret = 0;
+    void *entry = 0;
+    struct e_string_t str = {"_Z12dummy3_test2i", 17};
+
+    char *files[5] = {m_dummy1, m_dummy2, m_dummy3, m_dummy2, m_dummy1};
+    int32_t fsizes[5] = {m_dummy1_length, m_dummy2_length, m_dummy3_length, m_dummy2_length, m_dummy1_length};
+
+    char *execs[5] = {0};
+    int32_t esizes[5] = {0};
+    bfelf_file_t efs[5];
+
+    std::vector<char> symtabs[6];
+    auto loader = new bfelf_loader_t;
+
+    ret = bfelf_loader_init(loader);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    for (auto i = 0; i < 5; i++)
+    {
+        ret = bfelf_file_init(files[i], fsizes[i], &efs[i]);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+        esizes[i] = bfelf_total_exec_size(&efs[i]);
+        execs[i] = alloc_exec(esizes[i]);
+        ASSERT_TRUE(execs[i] != MAP_FAILED);
+
+        ret = bfelf_file_load(&efs[i], execs[i], esizes[i]);
+        ASSERT_TRUE(ret == BFELF_SUCCESS);
+    }
+
+    EXPECT_TRUE(bfelf_loader_add_relocated(NULL, &efs[2], 0, 0) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_loader_add_relocated(loader, NULL, 0, 0) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_loader_replace(NULL, &efs[1], &efs[3], 0, 0) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_loader_remove(NULL, &efs[0]) == BFELF_ERROR_INVALID_ARG);
+
+    ret = bfelf_loader_add(loader, &efs[0]);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    ret = bfelf_loader_add(loader, &efs[1]);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    // The loader has to be relocated before files can be hot loaded
+
+    EXPECT_TRUE(bfelf_loader_add_relocated(loader, &efs[2], 0, 0) == BFELF_ERROR_NOT_RELOCATED);
+    EXPECT_TRUE(bfelf_loader_replace(loader, &efs[1], &efs[3], 0, 0) == BFELF_ERROR_NOT_RELOCATED);
+
+    set_symtab(loader, symtabs[0]);
+
+    ret = bfelf_loader_relocate(loader);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    // A second copy of dummy1 defines the same symbols, so it is removed.
+    // Each hot load is given a table that also fits the new file.
+
+    set_symtab(loader, symtabs[1], &efs[4]);
+
+    EXPECT_TRUE(bfelf_loader_add_relocated(loader, &efs[4], 0, 0) == BFELF_ERROR_DUPLICATE_SYMBOL);
+    EXPECT_TRUE(loader->num == 2);
+
+    // Hot load dummy3, which imports from dummy1 and dummy2
+
+    std::vector<bfelf_symcache_t> cache(efs[2].symnum);
+
+    set_symtab(loader, symtabs[2], &efs[2]);
+
+    auto old = loader->symtab;
+    auto oldnum = old->num;
+
+    ret = bfelf_loader_add_relocated(loader, &efs[2], cache.data(), cache.size());
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(loader->num == 3);
+
+    // The new table was built in the memory that was given to the loader,
+    // and the old one, which might still be in use, was not touched
+
+    EXPECT_TRUE(loader->symtab != old);
+    EXPECT_TRUE((char *)loader->symtab == symtabs[2].data());
+    EXPECT_TRUE(old->num == oldnum);
+    EXPECT_TRUE(efs[0].loader == loader);
+    EXPECT_TRUE(efs[1].loader == loader);
+
+    ret = bfelf_resolve_symbol(&efs[2], &str, &entry);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(((int(*)(int))entry)(5) == 0x26);
+
+    // Replacing a file that is not in the loader, or with a file that
+    // clashes with the others, leaves everything bound to the old file
+
+    set_symtab(loader, symtabs[3], &efs[4]);
+
+    EXPECT_TRUE(bfelf_loader_replace(loader, &efs[3], &efs[1], 0, 0) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_loader_replace(loader, &efs[1], &efs[4], 0, 0) == BFELF_ERROR_DUPLICATE_SYMBOL);
+    EXPECT_TRUE(((int(*)(int))entry)(5) == 0x26);
+
+    // Replace dummy2 with a second copy, and unmap the first, so any
+    // reference to the old copy that was not rebound would fault
+
+    set_symtab(loader, symtabs[4], &efs[3]);
+
+    ret = bfelf_loader_replace(loader, &efs[1], &efs[3], 0, 0);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(loader->num == 3);
+
+    munmap(execs[1], esizes[1]);
+    execs[1] = 0;
+
+    EXPECT_TRUE(((int(*)(int))entry)(5) == 0x26);
+
+    // dummy3 was hot loaded, and nothing is bound to it, so it can be
+    // removed, once there is a new table to build without it
+
+    EXPECT_TRUE(bfelf_loader_remove(loader, &efs[1]) == BFELF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(bfelf_loader_remove(loader, &efs[2]) == BFELF_ERROR_LOADER_FULL);
+    EXPECT_TRUE(loader->num == 3);
+
+    set_symtab(loader, symtabs[5]);
+
+    EXPECT_TRUE(bfelf_loader_remove(loader, &efs[2]) == BFELF_SUCCESS);
+    EXPECT_TRUE(loader->num == 2);
+    EXPECT_TRUE(loader->last == &efs[3]);
+
+    for (auto i = 0; i < 5; i++)
+    {
+        if (execs[i] != 0)
+            munmap(execs[i], esizes[i]);
+    }
+
+    delete loader;
+}
+
+void bfelf_loader_ut::test_hot_load_detached()
+{
+    auto ret = 0;
+    dummies_t d;
+    bfelf_file_t ef;
+    void *entry = 0;
+    std::vector<char> symtab;
+    struct e_string_t str = {"_Z12dummy3_test2i", 17};
+
+    init_dummies(d);
+    load_dummies(d);
+    relocate_dummies(d);
+
+    // A second copy of dummy3 is detached before it replaces the first,
+    // the same way the driver adds a module, so it is not relocated yet
+
+    ret = bfelf_file_init(m_dummy3, m_dummy3_length, &ef);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    auto esize = bfelf_total_exec_size(&ef);
+    auto exec = alloc_exec(esize);
+    ASSERT_TRUE(exec != MAP_FAILED);
+
+    ret = bfelf_file_load(&ef, exec, esize);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    std::vector<char> meta(bfelf_file_detach_size(&ef));
+
+    ret = bfelf_file_detach(&ef, meta.data(), meta.size());
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(ef.relocated == BFELF_ERROR_NOT_RELOCATED);
+
+    set_symtab(d.loader, symtab, &ef);
+
+    ret = bfelf_loader_replace(d.loader, &d.efs[2], &ef, 0, 0);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(ef.relocated == BFELF_SUCCESS);
+
+    munmap(d.execs[2], d.esizes[2]);
+    d.execs[2] = 0;
+
+    ret = bfelf_resolve_symbol(&ef, &str, &entry);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(((int(*)(int))entry)(5) == 0x26);
+
+    munmap(exec, esize);
+    fini_dummies(d);
+}
+
+void bfelf_loader_ut::test_hot_load_weak()
+{
+    auto ret = 0;
+    dummies_t d;
+    bfelf_file_t ef;
+    bfelf_file_t *efr = 0;
+    bfelf_sym *sym = 0;
+    struct e_string_t str = {"_ZN6dummy211dummy2_add2Ei", 25};
+
+    // Every global symbol of this copy of dummy2 is made weak, so that a
+    // second copy that is hot loaded overrides all of them
+
+    std::vector<char> weak(m_dummy2, m_dummy2 + m_dummy2_length);
+
+    init_dummies(d);
+    d.files[1] = weak.data();
+    load_dummies(d);
+
+    for (auto i = 0; i < d.efs[1].symnum; i++)
+    {
+        auto tmp = &d.efs[1].symtab[i];
+
+        if (tmp->st_value != 0 && BFELF_SYM_BIND(tmp->st_info) == bfstb_global)
+            tmp->st_info = (bfstb_weak << 4) | BFELF_SYM_TYPE(tmp->st_info);
+    }
+
+    relocate_dummies(d);
+    check_dummies(d);
+
+    ret = bfelf_file_init(m_dummy2, m_dummy2_length, &ef);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    auto esize = bfelf_total_exec_size(&ef);
+    auto exec = alloc_exec(esize);
+    ASSERT_TRUE(exec != MAP_FAILED);
+
+    ret = bfelf_file_load(&ef, exec, esize);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    std::vector<char> symtab;
+    set_symtab(d.loader, symtab, &ef);
+
+    ret = bfelf_loader_add_relocated(d.loader, &ef, 0, 0);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    ret = bfelf_symbol_by_name_global(&d.efs[2], &str, &efr, &sym);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(efr == &ef);
+
+    // dummy3 was bound to the weak copy, so it has to have been bound
+    // again, or this would fault
+
+    mprotect(d.execs[1], d.esizes[1], PROT_NONE);
+    check_dummies(d);
+
+    munmap(exec, esize);
+    fini_dummies(d);
+}
+
+static void
+ifunc_target()
+{
+}
+
+static bfelf64_addr
+ifunc_resolver()
+{
+    return (bfelf64_addr)ifunc_target;
+}
+
+void bfelf_loader_ut::test_ifunc()
+{
+    auto ret = 0;
+    auto sym = m_test_elf.symtab[0];
+    auto offset = (bfelf64_addr)g_test.tmp - (bfelf64_addr)&g_test;
+    auto resolver = (bfelf64_addr)ifunc_resolver - (bfelf64_addr)m_test_elf.exec;
+    auto ptr = (bfelf64_addr *)(m_test_elf.exec + offset);
+
+    bfelf_rel rel = {offset, BFR_X86_64_GLOB_DAT};
+    bfelf_rela rela = {offset, BFR_X86_64_GLOB_DAT, 0};
+    bfelf_rela irela = {offset, BFR_X86_64_IRELATIVE, (bfelf64_sxword)resolver};
+
+    ASSERT_TRUE(m_test_elf.loader == &m_test_loader);
+
+    *ptr = 0;
+    ret = bfelf_relocate_symbol_addend(&m_test_elf, &irela);
+    EXPECT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(*ptr == (bfelf64_addr)ifunc_target);
+
+    m_test_elf.symtab[0].st_info = bfstt_gnu_ifunc;
+    m_test_elf.symtab[0].st_value = resolver;
+
+    *ptr = 0;
+    ret = bfelf_relocate_symbol(&m_test_elf, &rel);
+    EXPECT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(*ptr == (bfelf64_addr)ifunc_target);
+
+    *ptr = 0;
+    ret = bfelf_relocate_symbol_addend(&m_test_elf, &rela);
+    EXPECT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(*ptr == (bfelf64_addr)ifunc_target);
+
+    m_test_loader.no_ifunc = BFELF_TRUE;
+
+    *ptr = 0;
+    ret = bfelf_relocate_symbol(&m_test_elf, &rel);
+    EXPECT_TRUE(ret == BFELF_ERROR_IFUNC_DISABLED);
+    ret = bfelf_relocate_symbol_addend(&m_test_elf, &rela);
+    EXPECT_TRUE(ret == BFELF_ERROR_IFUNC_DISABLED);
+    ret = bfelf_relocate_symbol_addend(&m_test_elf, &irela);
+    EXPECT_TRUE(ret == BFELF_ERROR_IFUNC_DISABLED);
+    EXPECT_TRUE(*ptr == 0);
+
+    m_test_loader.no_ifunc = BFELF_FALSE;
+    m_test_elf.symtab[0] = sym;
+}
+
+void bfelf_loader_ut::test_symbolic()
+{
+    auto ret = 0;
+    bfelf_stats_t stats;
+    auto offset = (bfelf64_addr)g_test.tmp - (bfelf64_addr)&g_test;
+    auto ptr = (bfelf64_addr *)(m_test_elf.exec + offset);
+
+    bfelf_rel rel = {offset, BFR_X86_64_GLOB_DAT};
+
+    ASSERT_TRUE(m_test_elf.symtab[0].st_value != 0);
+    ASSERT_TRUE(m_test_elf.symbolic == BFELF_FALSE);
+
+    m_test_elf.symbolic = BFELF_TRUE;
+
+    ret = bfelf_stats_init(&stats, test_timestamp);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+
+    *ptr = 0;
+    ret = bfelf_relocate_symbol(&m_test_elf, &rel);
+    EXPECT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(*ptr == (bfelf64_addr)m_test_elf.exec + m_test_elf.symtab[0].st_value);
+    EXPECT_TRUE(stats.lookups == 0);
+
+    m_test_elf.symbolic = BFELF_FALSE;
+
+    *ptr = 0;
+    ret = bfelf_relocate_symbol(&m_test_elf, &rel);
+    EXPECT_TRUE(ret == BFELF_SUCCESS);
+    EXPECT_TRUE(*ptr == (bfelf64_addr)m_test_elf.exec + m_test_elf.symtab[0].st_value);
+    EXPECT_TRUE(stats.lookups == 1);
+
+    ret = bfelf_stats_init(NULL, NULL);
+    ASSERT_TRUE(ret == BFELF_SUCCESS);
+}
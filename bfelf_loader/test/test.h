@@ -22,6 +22,7 @@
 #ifndef TEST_H
 #define TEST_H
 
+#include <vector>
 #include <unittest.h>
 #include <bfelf_loader.h>
 
@@ -46,18 +47,26 @@ private:
     void test_bfelf_loader_init();
     void test_bfelf_loader_add();
     void test_bfelf_loader_relocate();
+    void test_bfelf_loader_relocate_duplicate();
+    void test_bfelf_loader_symtab();
     void test_bfelf_section_header();
     void test_bfelf_string_table_entry();
     void test_bfelf_section_name_string();
     void test_bfelf_symbol_by_index();
     void test_bfelf_symbol_by_name();
+    void test_bfelf_symbol_by_name_hash();
+    void test_bfelf_symbol_name_hash();
     void test_bfelf_symbol_by_name_global();
     void test_bfelf_resolve_symbol();
     void test_bfelf_relocate_symbol();
     void test_bfelf_relocate_symbol_addend();
     void test_bfelf_relocate_symbols();
+    void test_bfelf_relocate_relative();
+    void test_bfelf_relocate_relr();
     void test_bfelf_program_header();
     void test_bfelf_load_segments();
+    void test_bfelf_load_segments_zero();
+    void test_bfelf_load_segments_zeroed();
     void test_bfelf_load_segment();
 
     void test_bfelf_file_print_header();
@@ -67,6 +76,42 @@ private:
     void test_bfelf_print_relocations();
 
     void test_resolve();
+    void test_lazy_binding();
+    void test_prelink();
+    void test_stream();
+    void test_stream_bounds();
+    void test_detach();
+    void test_jmprel_in_rela();
+    void test_rela_sections();
+    void test_no_section_headers();
+    void test_symbolize();
+    void test_stats();
+    void test_compressed();
+    void test_parallel_relocate();
+    void test_hot_load();
+    void test_hot_load_detached();
+    void test_hot_load_weak();
+    void test_ifunc();
+    void test_symbolic();
+
+    void check_symbol_by_name(bfelf_file_t *ef);
+
+    struct dummies_t
+    {
+        char *files[3];
+        int32_t fsizes[3];
+        char *execs[3];
+        int32_t esizes[3];
+        bfelf_file_t efs[3];
+        bfelf_loader_t *loader;
+        std::vector<char> symtab;
+    };
+
+    void init_dummies(dummies_t &d);
+    void load_dummies(dummies_t &d);
+    void relocate_dummies(dummies_t &d);
+    void check_dummies(dummies_t &d);
+    void fini_dummies(dummies_t &d);
 
 private:
 
@@ -94,6 +139,8 @@ private:
 
     bfelf_loader_t m_loader;
     bfelf_loader_t m_test_loader;
+    std::vector<char> m_loader_symtab;
+    std::vector<char> m_test_loader_symtab;
 };
 
 #endif
@@ -75,25 +75,51 @@ public:
 
     /// Modules
     ///
-    /// If the command provided by the arguments is "start", a list of
-    /// modules must be provided for the arguments to make sense. This
-    /// function returns the provided list of modules when applicable.
+    /// If the command provided by the arguments is "start" or "load", a
+    /// list of modules must be provided for the arguments to make sense.
+    /// This function returns the provided list of modules when applicable.
+    /// If the command is "replace", this is the module to replace instead.
     ///
     /// @return module list filename
     ///
     std::string modules() const override;
 
+    /// Replacement
+    ///
+    /// If the command provided by the arguments is "replace", the module
+    /// to replace, and the module to replace it with must be provided for
+    /// the arguments to make sense. This function returns the latter.
+    ///
+    /// @return replacement module filename
+    ///
+    std::string replacement() const override;
+
+    /// Compress
+    ///
+    /// Returns true if the modules should be compressed before they are
+    /// given to the driver entry (-c or --compress).
+    ///
+    /// @return true if the modules should be compressed
+    ///
+    bool compress() const override;
+
 private:
 
     void parse_start(int argc, const char *argv[], int index);
     void parse_stop(int argc, const char *argv[], int index);
     void parse_dump(int argc, const char *argv[], int index);
+    void parse_load(int argc, const char *argv[], int index);
+    void parse_replace(int argc, const char *argv[], int index);
+
+    int next_arg(int argc, const char *argv[], int index) const;
 
 private:
 
     bool m_is_valid;
     command_line_parser_command::type m_cmd;
     std::string m_modules;
+    std::string m_replacement;
+    bool m_compress;
 };
 
 #endif
@@ -32,7 +32,9 @@ namespace command_line_parser_command
         help = 1,
         start = 2,
         stop = 3,
-        dump = 4
+        dump = 4,
+        load = 5,
+        replace = 6
     };
 }
 
@@ -51,6 +53,12 @@ public:
 
     virtual std::string modules() const
     { return std::string(); }
+
+    virtual std::string replacement() const
+    { return std::string(); }
+
+    virtual bool compress() const
+    { return false; }
 };
 
 #endif
@@ -0,0 +1,37 @@
+//
+// Bareflank Hypervisor
+//
+// Copyright (C) 2015 Assured Information Security, Inc.
+// Author: Rian Quinn        <quinnr@ainfosec.com>
+// Author: Brendan Kerrigan  <kerriganb@ainfosec.com>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <string>
+
+/// Compress Module
+///
+/// Wraps a module in a compressed module container (see bfelf_lz4_hdr in
+/// bfelf_loader.h), which the driver entry detects, and decompresses one
+/// block at a time as it loads the module. Each block is compressed using
+/// the LZ4 block format. A block that does not compress is stored as is.
+///
+/// @param str the contents of the module to compress
+/// @return the compressed module
+std::string compress(const std::string &str);
+
+#endif
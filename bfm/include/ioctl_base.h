@@ -34,7 +34,10 @@ namespace ioctl_error
         failed_add_module = 3,
         failed_start = 4,
         failed_stop = 5,
-        failed_dump = 6
+        failed_dump = 6,
+        already_added = 7,
+        failed_load_module = 8,
+        failed_replace_module = 9
     };
 }
 
@@ -46,7 +49,9 @@ namespace ioctl_commands
         add_module = 1,
         start = 2,
         stop = 3,
-        dump = 4
+        dump = 4,
+        load_module = 5,
+        replace_module = 6
     };
 }
 
@@ -23,6 +23,7 @@
 #define IOCTL_DRIVER_H
 
 #include <command_line_parser_base.h>
+#include <compress.h>
 #include <debug.h>
 #include <file_base.h>
 #include <ioctl_base.h>
@@ -81,6 +82,10 @@ private:
     ioctl_driver_error::type start_vmm() const;
     ioctl_driver_error::type stop_vmm() const;
     ioctl_driver_error::type dump_vmm() const;
+    ioctl_driver_error::type load_vmm_modules() const;
+    ioctl_driver_error::type replace_module() const;
+
+    ioctl_driver_error::type add_modules(ioctl_commands::type cmd) const;
 
 private:
 
@@ -36,7 +36,10 @@ int main(int argc, const char *argv[])
         std::cout << "Usage: bfm [OPTION]... start list_of_modules" << std::endl;
         std::cout << "   or: bfm [OPTION]... stop" << std::endl;
         std::cout << "   or: bfm [OPTION]... dump" << std::endl;
+        std::cout << "   or: bfm [OPTION]... load list_of_modules" << std::endl;
+        std::cout << "   or: bfm [OPTION]... replace old_module new_module" << std::endl;
         std::cout << std::endl;
+        std::cout << "       -c, --compress  compress the modules before adding them" << std::endl;
         std::cout << "       -h, --help      help" << std::endl;
 
         return EXIT_SUCCESS;
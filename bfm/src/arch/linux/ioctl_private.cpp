@@ -72,6 +72,64 @@ ioctl_private::call(ioctl_commands::type cmd, const void *const data, int32_t le
                 return ioctl_error::failed_add_module;
             }
 
+            if (ret == BF_IOCTL_MODULE_ALREADY_ADDED)
+                return ioctl_error::already_added;
+
+            return ioctl_error::success;
+        }
+
+        case ioctl_commands::load_module:
+        {
+            if (data == 0)
+            {
+                bfm_error << "invalid argument - data == NULL" << std::endl;
+                return ioctl_error::invalid_arg;
+            }
+
+            if (len == 0)
+            {
+                bfm_error << "invalid argument - length == 0" << std::endl;
+                return ioctl_error::invalid_arg;
+            }
+
+            if ((ret = ioctl(fd, IOCTL_ADD_MODULE_LENGTH, len)) < 0)
+            {
+                bfm_error << "failed IOCTL_ADD_MODULE_LENGTH" << std::endl;
+                return ioctl_error::failed_load_module;
+            }
+
+            if ((ret = ioctl(fd, IOCTL_LOAD_MODULE, data)) < 0)
+            {
+                bfm_error << "failed IOCTL_LOAD_MODULE" << std::endl;
+                return ioctl_error::failed_load_module;
+            }
+
+            if (ret == BF_IOCTL_MODULE_ALREADY_ADDED)
+                return ioctl_error::already_added;
+
+            return ioctl_error::success;
+        }
+
+        case ioctl_commands::replace_module:
+        {
+            if (data == 0)
+            {
+                bfm_error << "invalid argument - data == NULL" << std::endl;
+                return ioctl_error::invalid_arg;
+            }
+
+            if (len != sizeof(struct bf_replace_module_t))
+            {
+                bfm_error << "invalid argument - length != sizeof(bf_replace_module_t)" << std::endl;
+                return ioctl_error::invalid_arg;
+            }
+
+            if ((ret = ioctl(fd, IOCTL_REPLACE_MODULE, data)) < 0)
+            {
+                bfm_error << "failed IOCTL_REPLACE_MODULE" << std::endl;
+                return ioctl_error::failed_replace_module;
+            }
+
             return ioctl_error::success;
         }
 
@@ -25,7 +25,8 @@
 
 command_line_parser::command_line_parser(int argc, const char *argv[]) :
     m_is_valid(false),
-    m_cmd(command_line_parser_command::unknown)
+    m_cmd(command_line_parser_command::unknown),
+    m_compress(false)
 {
     if (argc <= 1)
     {
@@ -45,6 +46,12 @@ command_line_parser::command_line_parser(int argc, const char *argv[]) :
             m_cmd = command_line_parser_command::help;
             return;
         }
+
+        if (str.compare("-c") == 0 ||
+            str.compare("--compress") == 0)
+        {
+            m_compress = true;
+        }
     }
 
     for (auto i = 1; i < argc; i++)
@@ -75,6 +82,18 @@ command_line_parser::command_line_parser(int argc, const char *argv[]) :
             return;
         }
 
+        if (str.compare("load") == 0)
+        {
+            parse_load(argc, argv, i + 1);
+            return;
+        }
+
+        if (str.compare("replace") == 0)
+        {
+            parse_replace(argc, argv, i + 1);
+            return;
+        }
+
         bfm_error << "unknown command" << std::endl;
         break;
     }
@@ -102,32 +121,31 @@ command_line_parser::modules() const
     return m_modules;
 }
 
+std::string
+command_line_parser::replacement() const
+{
+    return m_replacement;
+}
+
+bool
+command_line_parser::compress() const
+{
+    return m_compress;
+}
+
 void
 command_line_parser::parse_start(int argc, const char *argv[], int index)
 {
-    auto i = index;
+    auto i = next_arg(argc, argv, index);
     m_cmd = command_line_parser_command::start;
 
-    for (; i < argc; i++)
-    {
-        std::string str(argv[i]);
-
-        if (str.empty() == true)
-            continue;
-
-        if (str[0] == '-')
-            continue;
-
-        m_modules = str;
-        break;
-    }
-
     if (i >= argc)
     {
         bfm_error << "missing argument" << std::endl;
         return;
     }
 
+    m_modules = argv[i];
     m_is_valid = true;
 }
 
@@ -144,3 +162,58 @@ command_line_parser::parse_dump(int argc, const char *argv[], int index)
     m_is_valid = true;
     m_cmd = command_line_parser_command::dump;
 }
+
+void
+command_line_parser::parse_load(int argc, const char *argv[], int index)
+{
+    auto i = next_arg(argc, argv, index);
+    m_cmd = command_line_parser_command::load;
+
+    if (i >= argc)
+    {
+        bfm_error << "missing argument" << std::endl;
+        return;
+    }
+
+    m_modules = argv[i];
+    m_is_valid = true;
+}
+
+void
+command_line_parser::parse_replace(int argc, const char *argv[], int index)
+{
+    auto i = next_arg(argc, argv, index);
+    auto j = next_arg(argc, argv, i + 1);
+    m_cmd = command_line_parser_command::replace;
+
+    if (i >= argc || j >= argc)
+    {
+        bfm_error << "missing argument" << std::endl;
+        return;
+    }
+
+    m_modules = argv[i];
+    m_replacement = argv[j];
+    m_is_valid = true;
+}
+
+int
+command_line_parser::next_arg(int argc, const char *argv[], int index) const
+{
+    auto i = index;
+
+    for (; i < argc; i++)
+    {
+        std::string str(argv[i]);
+
+        if (str.empty() == true)
+            continue;
+
+        if (str[0] == '-')
+            continue;
+
+        break;
+    }
+
+    return i;
+}
@@ -0,0 +1,155 @@
+//
+// Bareflank Hypervisor
+//
+// Copyright (C) 2015 Assured Information Security, Inc.
+// Author: Rian Quinn        <quinnr@ainfosec.com>
+// Author: Brendan Kerrigan  <kerriganb@ainfosec.com>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+
+#include <compress.h>
+
+#include <cstring>
+#include <vector>
+
+#include <bfelf_loader.h>
+
+// The compressor is a simple greedy LZ4 block compressor: the last position
+// that each 4 byte sequence was seen at is kept in a hash table, and a
+// match is taken whenever the sequence at the current position was seen
+// within the last 64KB. This does not get the best possible ratio, but it
+// is fast, and the decompressor in the ELF loader does not care.
+
+static const auto c_hash_bits = 12U;
+static const auto c_min_match = 4U;
+static const auto c_max_offset = 0xFFFFU;
+
+// The LZ4 block format requires the last 5 bytes of a block to be literals,
+// and the last match to start at least 12 bytes before the end of the block.
+
+static const auto c_last_literals = 5U;
+static const auto c_match_limit = 12U;
+
+static uint32_t
+hash(const char *ptr)
+{
+    uint32_t seq;
+    std::memcpy(&seq, ptr, sizeof(seq));
+
+    return (seq * 2654435761U) >> (32 - c_hash_bits);
+}
+
+static void
+append_length(std::string &out, size_t len)
+{
+    for (len -= 15; len >= 255; len -= 255)
+        out.push_back(static_cast<char>(255));
+
+    out.push_back(static_cast<char>(len));
+}
+
+static void
+append_sequence(std::string &out, const char *literals, size_t num, size_t offset, size_t len)
+{
+    auto token = (num < 15 ? num : 15) << 4;
+
+    if (len != 0)
+        token |= (len - c_min_match < 15 ? len - c_min_match : 15);
+
+    out.push_back(static_cast<char>(token));
+
+    if (num >= 15)
+        append_length(out, num);
+
+    out.append(literals, num);
+
+    if (len == 0)
+        return;
+
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+
+    if (len - c_min_match >= 15)
+        append_length(out, len - c_min_match);
+}
+
+static std::string
+compress_block(const char *src, size_t size)
+{
+    std::string out;
+    std::vector<size_t> table(1U << c_hash_bits, static_cast<size_t>(~0ULL));
+
+    auto i = 0UL;
+    auto anchor = 0UL;
+
+    while (size > c_match_limit && i < size - c_match_limit)
+    {
+        auto h = hash(src + i);
+        auto ref = table[h];
+
+        table[h] = i;
+
+        if (ref == static_cast<size_t>(~0ULL) ||
+            i - ref > c_max_offset ||
+            std::memcmp(src + ref, src + i, c_min_match) != 0)
+        {
+            i++;
+            continue;
+        }
+
+        auto len = c_min_match;
+        while (i + len < size - c_last_literals && src[ref + len] == src[i + len])
+            len++;
+
+        append_sequence(out, src + anchor, i - anchor, i - ref, len);
+
+        i += len;
+        anchor = i;
+    }
+
+    append_sequence(out, src + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+static void
+append_block(std::string &out, const char *block, bfelf64_word size)
+{
+    out.append(reinterpret_cast<const char *>(&size), sizeof(size));
+    out.append(block, size & ~BFELF_LZ4_BLOCK_RAW);
+}
+
+std::string compress(const std::string &str)
+{
+    std::string out;
+    bfelf_lz4_hdr hdr = {BFELF_LZ4_MAGIC, BFELF_LZ4_VERSION, str.size(), BFELF_LZ4_MAX_BLOCK_SIZE};
+
+    out.append(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+
+    for (auto offset = 0UL; offset < str.size(); offset += hdr.block_size)
+    {
+        auto size = str.size() - offset;
+
+        if (size > hdr.block_size)
+            size = hdr.block_size;
+
+        auto block = compress_block(str.data() + offset, size);
+
+        if (block.size() < size)
+            append_block(out, block.data(), block.size());
+        else
+            append_block(out, str.data() + offset, size | BFELF_LZ4_BLOCK_RAW);
+    }
+
+    return out;
+}
@@ -20,6 +20,7 @@
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 
 #include <ioctl_driver.h>
+#include <driver_entry_interface.h>
 
 ioctl_driver::ioctl_driver(const file_base *const fb,
                            const ioctl_base *const ioctlb,
@@ -62,6 +63,12 @@ ioctl_driver::process() const
         case command_line_parser_command::dump:
             return this->dump_vmm();
 
+        case command_line_parser_command::load:
+            return this->load_vmm_modules();
+
+        case command_line_parser_command::replace:
+            return this->replace_module();
+
         default:
         {
             bfm_error << "Unable to process command. Command is unknown" << std::endl;
@@ -79,61 +86,47 @@ ioctl_driver::start_vmm() const
     assert(m_clpb != NULL);
     assert(m_ioctlb != NULL);
 
-    auto modules_filename = m_clpb->modules();
-
-    if (modules_filename.empty() == true)
+    if (this->add_modules(ioctl_commands::add_module) != ioctl_driver_error::success)
     {
-        bfm_error << "Unable to start vmm. List of modules was not provided" << std::endl;
+        bfm_error << "Unable to start vmm. failed to add modules" << std::endl;
         return ioctl_driver_error::failure;
     }
 
-    if (m_fb->exists(modules_filename) == false)
+    if (m_ioctlb->call(ioctl_commands::start, NULL, 0) != ioctl_error::success)
     {
-        bfm_error << "Unable to start vmm. Provided filename for the list of modules does not exist" << std::endl;
+        bfm_error << "failed to start vmm: " << std::endl;
         return ioctl_driver_error::failure;
     }
 
-    auto modules = m_fb->read(modules_filename);
+    return ioctl_driver_error::success;
+}
 
-    if (modules.empty() == true)
+ioctl_driver_error::type
+ioctl_driver::stop_vmm() const
+{
+    assert(m_fb != NULL);
+    assert(m_clpb != NULL);
+    assert(m_ioctlb != NULL);
+
+    if (m_ioctlb->call(ioctl_commands::stop, NULL, 0) != ioctl_error::success)
     {
-        bfm_error << "Unable to start vmm. Provided list of modules is empty" << std::endl;
+        bfm_error << "failed to stop vmm: " << std::endl;
         return ioctl_driver_error::failure;
     }
 
-    for (const auto &module : split(modules, '\n'))
-    {
-        if (module.empty() == true)
-            continue;
-
-        if (m_fb->exists(module) == false)
-        {
-            bfm_error << "Unable to start vmm. module does not exist: " << module << std::endl;
-            return ioctl_driver_error::failure;
-        }
-
-        auto contents = m_fb->read(module);
-
-        if (contents.empty() == true)
-        {
-            bfm_error << "Unable to start vmm. module is empty: " << module << std::endl;
-            return ioctl_driver_error::failure;
-        }
-
-        auto result = m_ioctlb->call(ioctl_commands::add_module,
-                                     contents.c_str(),
-                                     contents.length());
+    return ioctl_driver_error::success;
+}
 
-        if (result != ioctl_error::success)
-        {
-            bfm_error << "Unable to start vmm. failed to add module: " << module << std::endl;
-            return ioctl_driver_error::failure;
-        }
-    }
+ioctl_driver_error::type
+ioctl_driver::dump_vmm() const
+{
+    assert(m_fb != NULL);
+    assert(m_clpb != NULL);
+    assert(m_ioctlb != NULL);
 
-    if (m_ioctlb->call(ioctl_commands::start, NULL, 0) != ioctl_error::success)
+    if (m_ioctlb->call(ioctl_commands::dump, NULL, 0) != ioctl_error::success)
     {
-        bfm_error << "failed to start vmm: " << std::endl;
+        bfm_error << "failed to dump vmm: " << std::endl;
         return ioctl_driver_error::failure;
     }
 
@@ -141,15 +134,15 @@ ioctl_driver::start_vmm() const
 }
 
 ioctl_driver_error::type
-ioctl_driver::stop_vmm() const
+ioctl_driver::load_vmm_modules() const
 {
     assert(m_fb != NULL);
     assert(m_clpb != NULL);
     assert(m_ioctlb != NULL);
 
-    if (m_ioctlb->call(ioctl_commands::stop, NULL, 0) != ioctl_error::success)
+    if (this->add_modules(ioctl_commands::load_module) != ioctl_driver_error::success)
     {
-        bfm_error << "failed to stop vmm: " << std::endl;
+        bfm_error << "Unable to load modules into the vmm" << std::endl;
         return ioctl_driver_error::failure;
     }
 
@@ -157,17 +150,114 @@ ioctl_driver::stop_vmm() const
 }
 
 ioctl_driver_error::type
-ioctl_driver::dump_vmm() const
+ioctl_driver::replace_module() const
 {
     assert(m_fb != NULL);
     assert(m_clpb != NULL);
     assert(m_ioctlb != NULL);
 
-    if (m_ioctlb->call(ioctl_commands::dump, NULL, 0) != ioctl_error::success)
+    auto old_module = m_clpb->modules();
+    auto new_module = m_clpb->replacement();
+
+    if (m_fb->exists(old_module) == false || m_fb->exists(new_module) == false)
     {
-        bfm_error << "failed to dump vmm: " << std::endl;
+        bfm_error << "Unable to replace module. module does not exist" << std::endl;
+        return ioctl_driver_error::failure;
+    }
+
+    auto old_contents = m_fb->read(old_module);
+    auto new_contents = m_fb->read(new_module);
+
+    if (old_contents.empty() == true || new_contents.empty() == true)
+    {
+        bfm_error << "Unable to replace module. module is empty" << std::endl;
+        return ioctl_driver_error::failure;
+    }
+
+    // The module to replace is identified by the contents of the module
+    // itself (even if it was compressed when it was added), so only the
+    // new module is compressed.
+
+    if (m_clpb->compress() == true)
+        new_contents = compress(new_contents);
+
+    struct bf_replace_module_t rm;
+
+    rm.old_file = old_contents.c_str();
+    rm.old_size = old_contents.length();
+    rm.new_file = new_contents.c_str();
+    rm.new_size = new_contents.length();
+
+    if (m_ioctlb->call(ioctl_commands::replace_module, &rm, sizeof(rm)) != ioctl_error::success)
+    {
+        bfm_error << "failed to replace module: " << old_module << std::endl;
+        return ioctl_driver_error::failure;
+    }
+
+    return ioctl_driver_error::success;
+}
+
+ioctl_driver_error::type
+ioctl_driver::add_modules(ioctl_commands::type cmd) const
+{
+    auto modules_filename = m_clpb->modules();
+
+    if (modules_filename.empty() == true)
+    {
+        bfm_error << "List of modules was not provided" << std::endl;
+        return ioctl_driver_error::failure;
+    }
+
+    if (m_fb->exists(modules_filename) == false)
+    {
+        bfm_error << "Provided filename for the list of modules does not exist" << std::endl;
+        return ioctl_driver_error::failure;
+    }
+
+    auto modules = m_fb->read(modules_filename);
+
+    if (modules.empty() == true)
+    {
+        bfm_error << "Provided list of modules is empty" << std::endl;
         return ioctl_driver_error::failure;
     }
 
+    for (const auto &module : split(modules, '\n'))
+    {
+        if (module.empty() == true)
+            continue;
+
+        if (m_fb->exists(module) == false)
+        {
+            bfm_error << "module does not exist: " << module << std::endl;
+            return ioctl_driver_error::failure;
+        }
+
+        auto contents = m_fb->read(module);
+
+        if (contents.empty() == true)
+        {
+            bfm_error << "module is empty: " << module << std::endl;
+            return ioctl_driver_error::failure;
+        }
+
+        if (m_clpb->compress() == true)
+            contents = compress(contents);
+
+        auto result = m_ioctlb->call(cmd, contents.c_str(), contents.length());
+
+        if (result == ioctl_error::already_added)
+        {
+            bfm_debug << "module already added, skipping: " << module << std::endl;
+            continue;
+        }
+
+        if (result != ioctl_error::success)
+        {
+            bfm_error << "failed to add module: " << module << std::endl;
+            return ioctl_driver_error::failure;
+        }
+    }
+
     return ioctl_driver_error::success;
 }
@@ -64,6 +64,14 @@ bfm_ut::list()
     this->test_command_line_parser_with_help_and_valid_start();
     this->test_command_line_parser_with_valid_stop();
     this->test_command_line_parser_with_valid_dump();
+    this->test_command_line_parser_with_compress();
+    this->test_command_line_parser_with_valid_load();
+    this->test_command_line_parser_with_replace_missing_module();
+    this->test_command_line_parser_with_valid_replace();
+
+    this->test_compress_repetitive();
+    this->test_compress_incompressible();
+    this->test_compress_small();
 
     this->test_file_exists_with_bad_filename();
     this->test_file_exists_with_good_filename();
@@ -87,12 +95,19 @@ bfm_ut::list()
     this->test_ioctl_driver_with_start_and_more_than_one_bad_module_filename();
     this->test_ioctl_driver_with_start_and_empty_module();
     this->test_ioctl_driver_with_start_and_ioctl_add_module_failure();
+    this->test_ioctl_driver_with_start_and_ioctl_add_module_already_added();
     this->test_ioctl_driver_with_start_and_ioctl_start_vmm_failure();
     this->test_ioctl_driver_with_start_and_ioctl_start_vmm_success();
+    this->test_ioctl_driver_with_start_and_compress();
     this->test_ioctl_driver_with_stop_and_ioctl_stop_vmm_failure();
     this->test_ioctl_driver_with_stop_and_ioctl_stop_vmm_success();
     this->test_ioctl_driver_with_stop_and_ioctl_dump_vmm_failure();
     this->test_ioctl_driver_with_stop_and_ioctl_dump_vmm_success();
+    this->test_ioctl_driver_with_load_and_ioctl_load_module_failure();
+    this->test_ioctl_driver_with_load_and_ioctl_load_module_success();
+    this->test_ioctl_driver_with_replace_and_bad_module_filename();
+    this->test_ioctl_driver_with_replace_and_ioctl_replace_module_failure();
+    this->test_ioctl_driver_with_replace_and_ioctl_replace_module_success();
 
     this->test_split_empty_string();
     this->test_split_with_non_existing_delimiter();
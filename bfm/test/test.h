@@ -55,6 +55,14 @@ private:
     void test_command_line_parser_with_help_and_valid_start();
     void test_command_line_parser_with_valid_stop();
     void test_command_line_parser_with_valid_dump();
+    void test_command_line_parser_with_compress();
+    void test_command_line_parser_with_valid_load();
+    void test_command_line_parser_with_replace_missing_module();
+    void test_command_line_parser_with_valid_replace();
+
+    void test_compress_repetitive();
+    void test_compress_incompressible();
+    void test_compress_small();
 
     void test_file_exists_with_bad_filename();
     void test_file_exists_with_good_filename();
@@ -78,12 +86,19 @@ private:
     void test_ioctl_driver_with_start_and_more_than_one_bad_module_filename();
     void test_ioctl_driver_with_start_and_empty_module();
     void test_ioctl_driver_with_start_and_ioctl_add_module_failure();
+    void test_ioctl_driver_with_start_and_ioctl_add_module_already_added();
     void test_ioctl_driver_with_start_and_ioctl_start_vmm_failure();
     void test_ioctl_driver_with_start_and_ioctl_start_vmm_success();
+    void test_ioctl_driver_with_start_and_compress();
     void test_ioctl_driver_with_stop_and_ioctl_stop_vmm_failure();
     void test_ioctl_driver_with_stop_and_ioctl_stop_vmm_success();
     void test_ioctl_driver_with_stop_and_ioctl_dump_vmm_failure();
     void test_ioctl_driver_with_stop_and_ioctl_dump_vmm_success();
+    void test_ioctl_driver_with_load_and_ioctl_load_module_failure();
+    void test_ioctl_driver_with_load_and_ioctl_load_module_success();
+    void test_ioctl_driver_with_replace_and_bad_module_filename();
+    void test_ioctl_driver_with_replace_and_ioctl_replace_module_failure();
+    void test_ioctl_driver_with_replace_and_ioctl_replace_module_success();
 
     void test_split_empty_string();
     void test_split_with_non_existing_delimiter();
@@ -202,3 +202,53 @@ bfm_ut::test_command_line_parser_with_valid_dump()
     EXPECT_TRUE(clp.is_valid() == true);
     EXPECT_TRUE(clp.cmd() == command_line_parser_command::dump);
 }
+
+void
+bfm_ut::test_command_line_parser_with_compress()
+{
+    int argc = 4;
+    const char *argv[] = {"app_name", "--compress", "start", "filename"};
+    command_line_parser clp(argc, argv);
+
+    EXPECT_TRUE(clp.is_valid() == true);
+    EXPECT_TRUE(clp.cmd() == command_line_parser_command::start);
+    EXPECT_TRUE(clp.modules() == "filename");
+    EXPECT_TRUE(clp.compress() == true);
+}
+
+void
+bfm_ut::test_command_line_parser_with_valid_load()
+{
+    int argc = 3;
+    const char *argv[] = {"app_name", "load", "filename"};
+    command_line_parser clp(argc, argv);
+
+    EXPECT_TRUE(clp.is_valid() == true);
+    EXPECT_TRUE(clp.cmd() == command_line_parser_command::load);
+    EXPECT_TRUE(clp.modules() == std::string("filename"));
+}
+
+void
+bfm_ut::test_command_line_parser_with_replace_missing_module()
+{
+    int argc = 3;
+    const char *argv[] = {"app_name", "replace", "old_module"};
+    command_line_parser clp(argc, argv);
+
+    EXPECT_TRUE(clp.is_valid() == false);
+    EXPECT_TRUE(clp.cmd() == command_line_parser_command::replace);
+}
+
+void
+bfm_ut::test_command_line_parser_with_valid_replace()
+{
+    int argc = 5;
+    const char *argv[] = {"app_name", "replace", "old_module", "--compress", "new_module"};
+    command_line_parser clp(argc, argv);
+
+    EXPECT_TRUE(clp.is_valid() == true);
+    EXPECT_TRUE(clp.cmd() == command_line_parser_command::replace);
+    EXPECT_TRUE(clp.modules() == std::string("old_module"));
+    EXPECT_TRUE(clp.replacement() == std::string("new_module"));
+    EXPECT_TRUE(clp.compress() == true);
+}
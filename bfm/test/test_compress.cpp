@@ -0,0 +1,85 @@
+//
+// Bareflank Hypervisor
+//
+// Copyright (C) 2015 Assured Information Security, Inc.
+// Author: Rian Quinn        <quinnr@ainfosec.com>
+// Author: Brendan Kerrigan  <kerriganb@ainfosec.com>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+
+#include <test.h>
+
+#include <compress.h>
+#include <bfelf_loader.h>
+
+static std::string
+decompress(const std::string &str)
+{
+    char *buf;
+    bfelf64_sword ret;
+    bfelf_lz4_t lz;
+    std::string result;
+
+    if (bfelf_lz4_init(&lz, const_cast<char *>(str.data()), str.size()) != BFELF_SUCCESS)
+        return std::string();
+
+    while ((ret = bfelf_lz4_read(&lz, &buf)) > 0)
+        result.append(buf, ret);
+
+    if (ret != 0)
+        return std::string();
+
+    return result;
+}
+
+void
+bfm_ut::test_compress_repetitive()
+{
+    std::string str;
+
+    for (auto i = 0; i < 0x4000; i++)
+        str += "the cow is blue " + std::to_string(i % 100) + "\n";
+
+    auto compressed = compress(str);
+
+    EXPECT_TRUE(compressed.size() < str.size() / 4);
+    EXPECT_TRUE(decompress(compressed) == str);
+}
+
+void
+bfm_ut::test_compress_incompressible()
+{
+    std::string str;
+    uint32_t seed = 42;
+
+    for (auto i = 0; i < 0x18000; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        str.push_back(static_cast<char>(seed >> 24));
+    }
+
+    auto compressed = compress(str);
+
+    EXPECT_TRUE(compressed.size() > str.size());
+    EXPECT_TRUE(decompress(compressed) == str);
+}
+
+void
+bfm_ut::test_compress_small()
+{
+    std::string str("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+
+    EXPECT_TRUE(decompress(compress(str)) == str);
+    EXPECT_TRUE(decompress(compress("a")) == "a");
+}
@@ -282,6 +282,7 @@ bfm_ut::test_ioctl_driver_with_start_and_ioctl_add_module_failure()
     mocks.OnCall(clpb, command_line_parser_base::is_valid).Return(true);
     mocks.OnCall(clpb, command_line_parser_base::cmd).Return(command_line_parser_command::start);
     mocks.OnCall(clpb, command_line_parser_base::modules).Return(std::string("good_filename"));
+    mocks.OnCall(clpb, command_line_parser_base::compress).Return(false);
     mocks.OnCall(fb, file_base::exists).With("good_filename").Return(true);
     mocks.OnCall(fb, file_base::read).With("good_filename").Return(std::string("three\ngood\nfiles\n"));
     mocks.OnCall(fb, file_base::exists).With("three").Return(true);
@@ -294,6 +295,34 @@ bfm_ut::test_ioctl_driver_with_start_and_ioctl_add_module_failure()
     });
 }
 
+void
+bfm_ut::test_ioctl_driver_with_start_and_ioctl_add_module_already_added()
+{
+    MockRepository mocks;
+
+    file_base *fb = mocks.Mock<file_base>();
+    ioctl_base *ioctlb = mocks.Mock<ioctl_base>();
+    command_line_parser_base *clpb = mocks.Mock<command_line_parser_base>();
+    ioctl_driver driver(fb, ioctlb, clpb);
+
+    mocks.OnCall(clpb, command_line_parser_base::is_valid).Return(true);
+    mocks.OnCall(clpb, command_line_parser_base::cmd).Return(command_line_parser_command::start);
+    mocks.OnCall(clpb, command_line_parser_base::modules).Return(std::string("good_filename"));
+    mocks.OnCall(clpb, command_line_parser_base::compress).Return(false);
+    mocks.OnCall(fb, file_base::exists).With("good_filename").Return(true);
+    mocks.OnCall(fb, file_base::read).With("good_filename").Return(std::string("good\ngood\n"));
+    mocks.OnCall(fb, file_base::exists).With("good").Return(true);
+    mocks.OnCall(fb, file_base::read).With("good").Return(std::string("goood_contents"));
+    mocks.ExpectCall(ioctlb, ioctl_base::call).With(ioctl_commands::add_module, _, _).Return(ioctl_error::success);
+    mocks.ExpectCall(ioctlb, ioctl_base::call).With(ioctl_commands::add_module, _, _).Return(ioctl_error::already_added);
+    mocks.ExpectCall(ioctlb, ioctl_base::call).With(ioctl_commands::start, _, _).Return(ioctl_error::success);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(driver.process() == ioctl_driver_error::success);
+    });
+}
+
 void
 bfm_ut::test_ioctl_driver_with_start_and_ioctl_start_vmm_failure()
 {
@@ -307,6 +336,7 @@ bfm_ut::test_ioctl_driver_with_start_and_ioctl_start_vmm_failure()
     mocks.OnCall(clpb, command_line_parser_base::is_valid).Return(true);
     mocks.OnCall(clpb, command_line_parser_base::cmd).Return(command_line_parser_command::start);
     mocks.OnCall(clpb, command_line_parser_base::modules).Return(std::string("good_filename"));
+    mocks.OnCall(clpb, command_line_parser_base::compress).Return(false);
     mocks.OnCall(fb, file_base::exists).With("good_filename").Return(true);
     mocks.OnCall(fb, file_base::read).With("good_filename").Return(std::string("three\ngood\nfiles\n"));
     mocks.OnCall(fb, file_base::exists).With("three").Return(true);
@@ -339,6 +369,7 @@ bfm_ut::test_ioctl_driver_with_start_and_ioctl_start_vmm_success()
     mocks.OnCall(clpb, command_line_parser_base::is_valid).Return(true);
     mocks.OnCall(clpb, command_line_parser_base::cmd).Return(command_line_parser_command::start);
     mocks.OnCall(clpb, command_line_parser_base::modules).Return(std::string("good_filename"));
+    mocks.OnCall(clpb, command_line_parser_base::compress).Return(false);
     mocks.OnCall(fb, file_base::exists).With("good_filename").Return(true);
     mocks.OnCall(fb, file_base::read).With("good_filename").Return(std::string("three\ngood\nfiles\n"));
     mocks.OnCall(fb, file_base::exists).With("three").Return(true);
@@ -358,6 +389,36 @@ bfm_ut::test_ioctl_driver_with_start_and_ioctl_start_vmm_success()
     });
 }
 
+void
+bfm_ut::test_ioctl_driver_with_start_and_compress()
+{
+    MockRepository mocks;
+
+    file_base *fb = mocks.Mock<file_base>();
+    ioctl_base *ioctlb = mocks.Mock<ioctl_base>();
+    command_line_parser_base *clpb = mocks.Mock<command_line_parser_base>();
+    ioctl_driver driver(fb, ioctlb, clpb);
+
+    auto contents = std::string("goood_contents");
+    auto compressed = compress(contents);
+
+    mocks.OnCall(clpb, command_line_parser_base::is_valid).Return(true);
+    mocks.OnCall(clpb, command_line_parser_base::cmd).Return(command_line_parser_command::start);
+    mocks.OnCall(clpb, command_line_parser_base::modules).Return(std::string("good_filename"));
+    mocks.OnCall(clpb, command_line_parser_base::compress).Return(true);
+    mocks.OnCall(fb, file_base::exists).With("good_filename").Return(true);
+    mocks.OnCall(fb, file_base::read).With("good_filename").Return(std::string("good\n"));
+    mocks.OnCall(fb, file_base::exists).With("good").Return(true);
+    mocks.OnCall(fb, file_base::read).With("good").Return(contents);
+    mocks.ExpectCall(ioctlb, ioctl_base::call).With(ioctl_commands::add_module, _, compressed.length()).Return(ioctl_error::success);
+    mocks.ExpectCall(ioctlb, ioctl_base::call).With(ioctl_commands::start, _, _).Return(ioctl_error::success);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(driver.process() == ioctl_driver_error::success);
+    });
+}
+
 void
 bfm_ut::test_ioctl_driver_with_stop_and_ioctl_stop_vmm_failure()
 {
@@ -437,3 +498,135 @@ bfm_ut::test_ioctl_driver_with_stop_and_ioctl_dump_vmm_success()
         EXPECT_TRUE(driver.process() == ioctl_driver_error::success);
     });
 }
+
+void
+bfm_ut::test_ioctl_driver_with_load_and_ioctl_load_module_failure()
+{
+    MockRepository mocks;
+
+    file_base *fb = mocks.Mock<file_base>();
+    ioctl_base *ioctlb = mocks.Mock<ioctl_base>();
+    command_line_parser_base *clpb = mocks.Mock<command_line_parser_base>();
+    ioctl_driver driver(fb, ioctlb, clpb);
+
+    mocks.OnCall(clpb, command_line_parser_base::is_valid).Return(true);
+    mocks.OnCall(clpb, command_line_parser_base::cmd).Return(command_line_parser_command::load);
+    mocks.OnCall(clpb, command_line_parser_base::modules).Return(std::string("good_filename"));
+    mocks.OnCall(clpb, command_line_parser_base::compress).Return(false);
+    mocks.OnCall(fb, file_base::exists).With("good_filename").Return(true);
+    mocks.OnCall(fb, file_base::read).With("good_filename").Return(std::string("good\n"));
+    mocks.OnCall(fb, file_base::exists).With("good").Return(true);
+    mocks.OnCall(fb, file_base::read).With("good").Return(std::string("goood_contents"));
+    mocks.ExpectCall(ioctlb, ioctl_base::call).With(ioctl_commands::load_module, _, _).Return(ioctl_error::failed_load_module);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(driver.process() == ioctl_driver_error::failure);
+    });
+}
+
+void
+bfm_ut::test_ioctl_driver_with_load_and_ioctl_load_module_success()
+{
+    MockRepository mocks;
+
+    file_base *fb = mocks.Mock<file_base>();
+    ioctl_base *ioctlb = mocks.Mock<ioctl_base>();
+    command_line_parser_base *clpb = mocks.Mock<command_line_parser_base>();
+    ioctl_driver driver(fb, ioctlb, clpb);
+
+    mocks.OnCall(clpb, command_line_parser_base::is_valid).Return(true);
+    mocks.OnCall(clpb, command_line_parser_base::cmd).Return(command_line_parser_command::load);
+    mocks.OnCall(clpb, command_line_parser_base::modules).Return(std::string("good_filename"));
+    mocks.OnCall(clpb, command_line_parser_base::compress).Return(false);
+    mocks.OnCall(fb, file_base::exists).With("good_filename").Return(true);
+    mocks.OnCall(fb, file_base::read).With("good_filename").Return(std::string("good\ngood\n"));
+    mocks.OnCall(fb, file_base::exists).With("good").Return(true);
+    mocks.OnCall(fb, file_base::read).With("good").Return(std::string("goood_contents"));
+    mocks.ExpectCall(ioctlb, ioctl_base::call).With(ioctl_commands::load_module, _, _).Return(ioctl_error::success);
+    mocks.ExpectCall(ioctlb, ioctl_base::call).With(ioctl_commands::load_module, _, _).Return(ioctl_error::already_added);
+    mocks.NeverCall(ioctlb, ioctl_base::call).With(ioctl_commands::start, _, _);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(driver.process() == ioctl_driver_error::success);
+    });
+}
+
+void
+bfm_ut::test_ioctl_driver_with_replace_and_bad_module_filename()
+{
+    MockRepository mocks;
+
+    file_base *fb = mocks.Mock<file_base>();
+    ioctl_base *ioctlb = mocks.Mock<ioctl_base>();
+    command_line_parser_base *clpb = mocks.Mock<command_line_parser_base>();
+    ioctl_driver driver(fb, ioctlb, clpb);
+
+    mocks.OnCall(clpb, command_line_parser_base::is_valid).Return(true);
+    mocks.OnCall(clpb, command_line_parser_base::cmd).Return(command_line_parser_command::replace);
+    mocks.OnCall(clpb, command_line_parser_base::modules).Return(std::string("old"));
+    mocks.OnCall(clpb, command_line_parser_base::replacement).Return(std::string("bad_filename"));
+    mocks.OnCall(fb, file_base::exists).With("old").Return(true);
+    mocks.OnCall(fb, file_base::exists).With("bad_filename").Return(false);
+    mocks.NeverCall(ioctlb, ioctl_base::call);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(driver.process() == ioctl_driver_error::failure);
+    });
+}
+
+void
+bfm_ut::test_ioctl_driver_with_replace_and_ioctl_replace_module_failure()
+{
+    MockRepository mocks;
+
+    file_base *fb = mocks.Mock<file_base>();
+    ioctl_base *ioctlb = mocks.Mock<ioctl_base>();
+    command_line_parser_base *clpb = mocks.Mock<command_line_parser_base>();
+    ioctl_driver driver(fb, ioctlb, clpb);
+
+    mocks.OnCall(clpb, command_line_parser_base::is_valid).Return(true);
+    mocks.OnCall(clpb, command_line_parser_base::cmd).Return(command_line_parser_command::replace);
+    mocks.OnCall(clpb, command_line_parser_base::modules).Return(std::string("old"));
+    mocks.OnCall(clpb, command_line_parser_base::replacement).Return(std::string("new"));
+    mocks.OnCall(clpb, command_line_parser_base::compress).Return(false);
+    mocks.OnCall(fb, file_base::exists).With("old").Return(true);
+    mocks.OnCall(fb, file_base::read).With("old").Return(std::string("old_contents"));
+    mocks.OnCall(fb, file_base::exists).With("new").Return(true);
+    mocks.OnCall(fb, file_base::read).With("new").Return(std::string("new_contents"));
+    mocks.ExpectCall(ioctlb, ioctl_base::call).With(ioctl_commands::replace_module, _, _).Return(ioctl_error::failed_replace_module);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(driver.process() == ioctl_driver_error::failure);
+    });
+}
+
+void
+bfm_ut::test_ioctl_driver_with_replace_and_ioctl_replace_module_success()
+{
+    MockRepository mocks;
+
+    file_base *fb = mocks.Mock<file_base>();
+    ioctl_base *ioctlb = mocks.Mock<ioctl_base>();
+    command_line_parser_base *clpb = mocks.Mock<command_line_parser_base>();
+    ioctl_driver driver(fb, ioctlb, clpb);
+
+    mocks.OnCall(clpb, command_line_parser_base::is_valid).Return(true);
+    mocks.OnCall(clpb, command_line_parser_base::cmd).Return(command_line_parser_command::replace);
+    mocks.OnCall(clpb, command_line_parser_base::modules).Return(std::string("old"));
+    mocks.OnCall(clpb, command_line_parser_base::replacement).Return(std::string("new"));
+    mocks.OnCall(clpb, command_line_parser_base::compress).Return(false);
+    mocks.OnCall(fb, file_base::exists).With("old").Return(true);
+    mocks.OnCall(fb, file_base::read).With("old").Return(std::string("old_contents"));
+    mocks.OnCall(fb, file_base::exists).With("new").Return(true);
+    mocks.OnCall(fb, file_base::read).With("new").Return(std::string("new_contents"));
+    mocks.ExpectCall(ioctlb, ioctl_base::call).With(ioctl_commands::replace_module, _, _).Return(ioctl_error::success);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(driver.process() == ioctl_driver_error::success);
+    });
+}
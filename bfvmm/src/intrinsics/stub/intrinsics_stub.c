@@ -0,0 +1,364 @@
+/*
+ * Bareflank Hypervisor
+ *
+ * Copyright (C) 2015 Assured Information Security, Inc.
+ * Author: Rian Quinn        <quinnr@ainfosec.com>
+ * Author: Brendan Kerrigan  <kerriganb@ainfosec.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Stub intrinsics for the userspace harness (driver_entry/harness). This
+ * module exports the same symbols as libintrinsics.so, and is listed in
+ * its place, so that the rest of the VMM can be loaded, relocated and
+ * started from a normal process without VT-x or ring 0:
+ *
+ * - CPUID is executed, but leaf 1 always reports VMX
+ * - MSRs and control registers are read from / written to the tables below,
+ *   which describe a VMX capable processor
+ * - segment selectors are read from the process, and the GDT / IDT are
+ *   empty tables that are large enough to index with those selectors
+ * - port IO and all of the VMX instructions do nothing, and succeed. Since
+ *   __vmlaunch returns, the VMM reports a failed launch, and start_vmm
+ *   returns as if the guest had been launched
+ */
+
+#include <stdint.h>
+
+#pragma pack(push, 1)
+
+struct gdt_t
+{
+    uint64_t limit : 16;
+    uint64_t base  : 64;
+};
+
+struct idt_t
+{
+    uint64_t limit : 16;
+    uint64_t base  : 64;
+};
+
+#pragma pack(pop)
+
+struct msr_t
+{
+    uint32_t msr;
+    uint64_t val;
+};
+
+/* ========================================================================== */
+/* Processor State                                                            */
+/* ========================================================================== */
+
+#define CPUID_1_ECX_VMX (1U << 5)
+#define NUM_DESCRIPTORS 16
+
+static struct msr_t g_msrs[] =
+{
+    {0x03A, 0x0000000000000005ULL},     /* IA32_FEATURE_CONTROL (locked, VMX) */
+    {0x174, 0x0000000000000000ULL},     /* IA32_SYSENTER_CS */
+    {0x175, 0x0000000000000000ULL},     /* IA32_SYSENTER_ESP */
+    {0x176, 0x0000000000000000ULL},     /* IA32_SYSENTER_EIP */
+    {0x1D9, 0x0000000000000000ULL},     /* IA32_DEBUGCTL */
+    {0x480, 0x0098100000000001ULL},     /* IA32_VMX_BASIC (WB, 4K, true ctls) */
+    {0x486, 0x0000000080000021ULL},     /* IA32_VMX_CR0_FIXED0 */
+    {0x487, 0x00000000FFFFFFFFULL},     /* IA32_VMX_CR0_FIXED1 */
+    {0x488, 0x0000000000002000ULL},     /* IA32_VMX_CR4_FIXED0 */
+    {0x489, 0x00000000FFFFFFFFULL},     /* IA32_VMX_CR4_FIXED1 */
+    {0x48D, 0xFFFFFFFF00000000ULL},     /* IA32_VMX_TRUE_PINBASED_CTLS */
+    {0x48E, 0xFFFFFFFF00000000ULL},     /* IA32_VMX_TRUE_PROCBASED_CTLS */
+    {0x48F, 0xFFFFFFFF00000000ULL},     /* IA32_VMX_TRUE_EXIT_CTLS */
+    {0x490, 0xFFFFFFFF00000000ULL},     /* IA32_VMX_TRUE_ENTRY_CTLS */
+};
+
+static uint64_t g_cr0 = 0x0000000080050033ULL;
+static uint64_t g_cr3 = 0x0000000000000000ULL;
+static uint64_t g_cr4 = 0x00000000001406E0ULL;
+
+static uint64_t g_descriptor_table[NUM_DESCRIPTORS];
+
+static struct msr_t *
+find_msr(uint32_t msr)
+{
+    uint64_t i;
+
+    for (i = 0; i < sizeof(g_msrs) / sizeof(g_msrs[0]); i++)
+    {
+        if (g_msrs[i].msr == msr)
+            return &g_msrs[i];
+    }
+
+    return 0;
+}
+
+/* ========================================================================== */
+/* x64                                                                        */
+/* ========================================================================== */
+
+static void
+stub_cpuid(uint32_t leaf, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+    __asm__ volatile("cpuid"
+                     : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                     : "a"(leaf), "c"(0));
+
+    if (leaf == 1)
+        *ecx |= CPUID_1_ECX_VMX;
+}
+
+uint32_t
+__cpuid_eax(uint32_t val)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    stub_cpuid(val, &eax, &ebx, &ecx, &edx);
+    return eax;
+}
+
+uint32_t
+__cpuid_ebx(uint32_t val)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    stub_cpuid(val, &eax, &ebx, &ecx, &edx);
+    return ebx;
+}
+
+uint32_t
+__cpuid_ecx(uint32_t val)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    stub_cpuid(val, &eax, &ebx, &ecx, &edx);
+    return ecx;
+}
+
+uint32_t
+__cpuid_edx(uint32_t val)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    stub_cpuid(val, &eax, &ebx, &ecx, &edx);
+    return edx;
+}
+
+uint64_t
+__read_rflags(void)
+{
+    uint64_t rflags;
+
+    __asm__ volatile("pushfq; popq %0" : "=r"(rflags));
+    return rflags;
+}
+
+uint64_t
+__read_msr(uint32_t msr)
+{
+    struct msr_t *entry = find_msr(msr);
+
+    return entry != 0 ? entry->val : 0;
+}
+
+uint32_t
+__read_msr32(uint32_t msr)
+{
+    return (uint32_t)__read_msr(msr);
+}
+
+void
+__write_msr(uint32_t msr, uint64_t val)
+{
+    struct msr_t *entry = find_msr(msr);
+
+    if (entry != 0)
+        entry->val = val;
+}
+
+uint64_t
+__read_cr0(void)
+{
+    return g_cr0;
+}
+
+void
+__write_cr0(uint64_t val)
+{
+    g_cr0 = val;
+}
+
+uint64_t
+__read_cr3(void)
+{
+    return g_cr3;
+}
+
+void
+__write_cr3(uint64_t val)
+{
+    g_cr3 = val;
+}
+
+uint64_t
+__read_cr4(void)
+{
+    return g_cr4;
+}
+
+void
+__write_cr4(uint64_t val)
+{
+    g_cr4 = val;
+}
+
+#define READ_SEGMENT(name, reg) \
+    uint16_t name(void) \
+    { \
+        uint16_t selector; \
+        __asm__ volatile("movw %%" reg ", %0" : "=r"(selector)); \
+        return selector; \
+    }
+
+READ_SEGMENT(__read_es, "es")
+READ_SEGMENT(__read_cs, "cs")
+READ_SEGMENT(__read_ss, "ss")
+READ_SEGMENT(__read_ds, "ds")
+READ_SEGMENT(__read_fs, "fs")
+READ_SEGMENT(__read_gs, "gs")
+
+uint16_t
+__read_tr(void)
+{
+    return 0;
+}
+
+uint16_t
+__read_ldtr(void)
+{
+    return 0;
+}
+
+uint64_t
+__read_rsp(void)
+{
+    uint64_t rsp;
+
+    __asm__ volatile("movq %%rsp, %0" : "=r"(rsp));
+    return rsp;
+}
+
+void
+__read_gdt(struct gdt_t *gdt)
+{
+    gdt->limit = sizeof(g_descriptor_table) - 1;
+    gdt->base = (uint64_t)g_descriptor_table;
+}
+
+void
+__read_idt(struct idt_t *idt)
+{
+    idt->limit = sizeof(g_descriptor_table) - 1;
+    idt->base = (uint64_t)g_descriptor_table;
+}
+
+void
+__outb(uint16_t val, uint16_t port)
+{
+    (void) val;
+    (void) port;
+}
+
+void
+__outw(uint16_t val, uint16_t port)
+{
+    (void) val;
+    (void) port;
+}
+
+uint8_t
+__inb(uint16_t port)
+{
+    (void) port;
+    return 0;
+}
+
+uint16_t
+__inw(uint16_t port)
+{
+    (void) port;
+    return 0;
+}
+
+/* ========================================================================== */
+/* Intel x64                                                                  */
+/* ========================================================================== */
+
+uint64_t
+__vmxon(void *vmxon_region)
+{
+    (void) vmxon_region;
+    return 1;
+}
+
+uint64_t
+__vmxoff(void)
+{
+    return 1;
+}
+
+uint64_t
+__vmclear(void *vmcs_region)
+{
+    (void) vmcs_region;
+    return 1;
+}
+
+uint64_t
+__vmptrld(void *vmcs_region)
+{
+    (void) vmcs_region;
+    return 1;
+}
+
+uint64_t
+__vmptrst(void *vmcs_region)
+{
+    (void) vmcs_region;
+    return 1;
+}
+
+uint64_t
+__vmwrite(uint64_t field, uint64_t val)
+{
+    (void) field;
+    (void) val;
+    return 1;
+}
+
+uint64_t
+__vmread(uint64_t field, uint64_t *val)
+{
+    (void) field;
+
+    *val = 0;
+    return 1;
+}
+
+uint64_t
+__vmlaunch(void)
+{
+    return 1;
+}
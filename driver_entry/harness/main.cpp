@@ -0,0 +1,273 @@
+//
+// Bareflank Hypervisor
+//
+// Copyright (C) 2015 Assured Information Security, Inc.
+// Author: Rian Quinn        <quinnr@ainfosec.com>
+// Author: Brendan Kerrigan  <kerriganb@ainfosec.com>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <common.h>
+#include <platform.h>
+#include <bfelf_loader.h>
+#include <debug_ring_interface.h>
+
+// -----------------------------------------------------------------------------
+// Overview
+// -----------------------------------------------------------------------------
+
+// The harness runs the driver's common code (common.c) in a normal process,
+// on top of a userspace platform layer (see platform.c), and times how long
+// it takes to add the modules, start the VMM (which includes relocating the
+// modules) and stop it again. Nothing is mocked inside of the driver or the
+// ELF loader, so this measures the same code paths that the driver runs.
+//
+// The modules are given as a module list, the same as with bfm, and
+// prelinked and compressed images work as well. Since the VMM is really
+// started, the real VMM modules need VT-x and ring 0. To run them from here,
+// use harness.modules (driver_entry/bin/native), which lists
+// libintrinsics_stub.so (see bfvmm/src/intrinsics/stub) in place of
+// libintrinsics.so. The stub is built with the harness. Without the cross
+// compiler, the rest of the VMM modules can be built with the native
+// toolchain instead:
+//
+//     make -C bfvmm/src/<module>/src cross CROSS_CC=gcc CROSS_CXX=g++ CROSS_LD="ld -e 0x1000"
+//
+// Modules that only export start_vmm / stop_vmm, such as the bfelf_loader
+// dummy modules, can be used as well.
+
+extern "C" void *g_drr;
+extern "C" struct bfelf_stats_t g_loader_stats;
+
+struct config
+{
+    uint64_t iterations;
+    uint64_t cpus;
+    bool dump;
+    std::string modules;
+
+    config() : iterations(10), cpus(DEFAULT_CPUS), dump(false) {}
+};
+
+struct timing
+{
+    uint64_t add;
+    uint64_t start;
+    uint64_t stop;
+    uint64_t init;
+    uint64_t load;
+    uint64_t relocate;
+};
+
+static void
+usage()
+{
+    std::cout << "Usage: bfharness [options] list_of_modules" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Loads, relocates, starts and stops the VMM in userspace, and times each step." << std::endl;
+    std::cout << std::endl;
+    std::cout << "  --iterations n        best of n runs (default: 10)" << std::endl;
+    std::cout << "  --cpus mask           start the VMM on this CPU, one bit only (default: 0x1)" << std::endl;
+    std::cout << "  --dump                print the VMM's debug ring after the first run" << std::endl;
+}
+
+static bool
+parse_args(int argc, const char *argv[], config &cfg)
+{
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--dump")
+            cfg.dump = true;
+        else if (arg == "--iterations" && i + 1 < argc)
+            cfg.iterations = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--cpus" && i + 1 < argc)
+            cfg.cpus = std::strtoull(argv[++i], nullptr, 0);
+        else if (cfg.modules.empty() && arg.compare(0, 2, "--") != 0)
+            cfg.modules = arg;
+        else
+            return false;
+    }
+
+    return cfg.iterations != 0 && cfg.cpus != 0 && cfg.modules.empty() == false;
+}
+
+static std::vector<std::string>
+read_module_list(const std::string &filename)
+{
+    std::string line;
+    std::vector<std::string> modules;
+    std::ifstream ifs(filename);
+
+    while (std::getline(ifs, line))
+    {
+        if (!line.empty())
+            modules.push_back(line);
+    }
+
+    return modules;
+}
+
+static bool
+read_file(const std::string &filename, std::vector<char> &contents)
+{
+    std::ifstream ifs(filename, std::ifstream::binary);
+
+    if (ifs.is_open() == false)
+        return false;
+
+    contents.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    return contents.empty() == false;
+}
+
+static void
+dump(void)
+{
+    auto drr = static_cast<debug_ring_resources *>(g_drr);
+    std::vector<char> rb(drr->len + 1, 0);
+
+    if (debug_ring_read(drr, rb.data(), rb.size()) < 0)
+    {
+        std::cerr << "error: failed to read the debug ring" << std::endl;
+        return;
+    }
+
+    std::cout << rb.data() << std::endl;
+}
+
+static bool
+run(const config &cfg, std::vector<std::vector<char>> &files, bool first, timing &t)
+{
+    int64_t ret;
+
+    if ((ret = common_init()) != BF_SUCCESS)
+    {
+        std::cerr << "error: common_init failed: " << ret << std::endl;
+        return false;
+    }
+
+    if ((ret = common_set_cpu_mask(cfg.cpus)) != BF_SUCCESS)
+    {
+        std::cerr << "error: common_set_cpu_mask failed: " << ret << std::endl;
+        common_fini();
+        return false;
+    }
+
+    auto t0 = platform_timestamp();
+
+    for (auto &file : files)
+    {
+        if ((ret = common_add_module(file.data(), file.size())) < BF_SUCCESS)
+        {
+            std::cerr << "error: common_add_module failed: " << ret << std::endl;
+            common_fini();
+            return false;
+        }
+    }
+
+    auto t1 = platform_timestamp();
+
+    if ((ret = common_start_vmm()) != BF_SUCCESS)
+    {
+        std::cerr << "error: common_start_vmm failed: " << ret << std::endl;
+        common_fini();
+        return false;
+    }
+
+    auto t2 = platform_timestamp();
+
+    // common_stop_vmm unloads the modules, which also clears the statistics
+
+    t.init = g_loader_stats.init_time;
+    t.load = g_loader_stats.load_time;
+    t.relocate = g_loader_stats.relocate_time;
+
+    if (first == true && cfg.dump == true)
+        dump();
+
+    common_stop_vmm();
+
+    auto t3 = platform_timestamp();
+
+    t.add = t1 - t0;
+    t.start = t2 - t1;
+    t.stop = t3 - t2;
+
+    common_fini();
+    return true;
+}
+
+int main(int argc, const char *argv[])
+{
+    config cfg;
+    timing best = {0};
+
+    if (parse_args(argc, argv, cfg) == false)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    auto modules = read_module_list(cfg.modules);
+    if (modules.empty() == true)
+    {
+        std::cerr << "error: the list of modules is empty or does not exist" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::vector<char>> files(modules.size());
+
+    for (auto i = 0U; i < modules.size(); i++)
+    {
+        if (read_file(modules[i], files[i]) == false)
+        {
+            std::cerr << "error: unable to read " << modules[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (auto i = 0U; i < cfg.iterations; i++)
+    {
+        timing t;
+
+        if (run(cfg, files, i == 0, t) == false)
+            return EXIT_FAILURE;
+
+        if (i == 0 || t.add + t.start < best.add + best.start)
+            best = t;
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << " modules     add us   (init us   load us)   start us   (reloc us)    stop us" << std::endl;
+    std::cout << std::setw(8) << modules.size()
+              << std::setw(11) << best.add / 1000.0
+              << std::setw(11) << best.init / 1000.0
+              << std::setw(10) << best.load / 1000.0
+              << std::setw(12) << best.start / 1000.0
+              << std::setw(12) << best.relocate / 1000.0
+              << std::setw(12) << best.stop / 1000.0 << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,268 @@
+/*
+ * Bareflank Hypervisor
+ *
+ * Copyright (C) 2015 Assured Information Security, Inc.
+ * Author: Rian Quinn        <quinnr@ainfosec.com>
+ * Author: Brendan Kerrigan  <kerriganb@ainfosec.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+
+#include <time.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <platform.h>
+#include <sys/mman.h>
+
+/*
+ * Userspace platform for the harness. Unlike the unit test platform, the
+ * memory handed out here is actually used by the VMM, so the pages given to
+ * common_init come from a real pool. There is no physical memory in a
+ * process, so each page's physical address is its virtual address.
+ */
+
+#ifndef HARNESS_POOL_PAGES
+#define HARNESS_POOL_PAGES 64
+#endif
+
+#define HARNESS_PAGE_SIZE 0x1000
+
+char *g_pool = 0;
+int g_pool_used[HARNESS_POOL_PAGES] = {0};
+
+void *
+platform_alloc(int64_t len)
+{
+    return malloc(len);
+}
+
+void *
+platform_alloc_exec(int64_t len)
+{
+    void *addr = mmap(0, len, PROT_READ | PROT_WRITE | PROT_EXEC,
+                      MAP_PRIVATE | MAP_ANON, -1, 0);
+
+    if (addr == MAP_FAILED)
+        return 0;
+
+    madvise(addr, len, MADV_HUGEPAGE);
+    return addr;
+}
+
+struct page_t
+platform_alloc_page(void)
+{
+    int i;
+    struct page_t pg = {0};
+
+    if (g_pool == 0)
+    {
+        if (posix_memalign((void **)&g_pool, HARNESS_PAGE_SIZE,
+                           HARNESS_POOL_PAGES * HARNESS_PAGE_SIZE) != 0)
+        {
+            g_pool = 0;
+            return pg;
+        }
+    }
+
+    for (i = 0; i < HARNESS_POOL_PAGES; i++)
+    {
+        if (g_pool_used[i] == 0)
+        {
+            g_pool_used[i] = 1;
+
+            pg.virt = g_pool + (i * HARNESS_PAGE_SIZE);
+            pg.phys = pg.virt;
+            pg.size = HARNESS_PAGE_SIZE;
+
+            return pg;
+        }
+    }
+
+    return pg;
+}
+
+void
+platform_free(void *addr)
+{
+    free(addr);
+}
+
+void
+platform_free_exec(void *addr, int64_t len)
+{
+    munmap(addr, len);
+}
+
+void
+platform_set_nx(void *addr, int64_t len)
+{
+    mprotect(addr, len, PROT_READ | PROT_WRITE);
+}
+
+void
+platform_free_page(struct page_t pg)
+{
+    char *virt = (char *)pg.virt;
+
+    if (g_pool == 0 || virt < g_pool)
+        return;
+
+    if (virt >= g_pool + (HARNESS_POOL_PAGES * HARNESS_PAGE_SIZE))
+        return;
+
+    g_pool_used[(virt - g_pool) / HARNESS_PAGE_SIZE] = 0;
+}
+
+/*
+ * platform_parallel uses one thread per CPU (up to num, and including the
+ * calling thread), and each thread takes the next index until there are
+ * none left.
+ */
+
+#ifndef HARNESS_MAX_THREADS
+#define HARNESS_MAX_THREADS 64
+#endif
+
+struct parallel_t
+{
+    int64_t num;
+    int64_t next;
+    platform_work_t func;
+    void *arg;
+};
+
+void *
+parallel_thread(void *arg)
+{
+    int64_t index;
+    struct parallel_t *p = (struct parallel_t *)arg;
+
+    while ((index = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED)) < p->num)
+        p->func(p->arg, index);
+
+    return 0;
+}
+
+void
+platform_parallel(int64_t num, platform_work_t func, void *arg)
+{
+    int64_t i;
+    int64_t num_threads;
+    pthread_t threads[HARNESS_MAX_THREADS];
+    struct parallel_t p = {num, 0, func, arg};
+
+    num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (num_threads > num)
+        num_threads = num;
+
+    if (num_threads > HARNESS_MAX_THREADS)
+        num_threads = HARNESS_MAX_THREADS;
+
+    for (i = 0; i < num_threads - 1; i++)
+    {
+        if (pthread_create(&threads[i], 0, parallel_thread, &p) != 0)
+            break;
+    }
+
+    num_threads = i;
+    parallel_thread(&p);
+
+    for (i = 0; i < num_threads; i++)
+        pthread_join(threads[i], 0);
+}
+
+/*
+ * platform_call_on_cpus uses one thread for each CPU, which is pinned to
+ * that CPU before func is called.
+ */
+
+struct cpu_call_t
+{
+    pthread_t thread;
+    int64_t cpu;
+    platform_work_t func;
+    void *arg;
+};
+
+void *
+cpu_call_thread(void *arg)
+{
+    cpu_set_t set;
+    struct cpu_call_t *cc = (struct cpu_call_t *)arg;
+
+    CPU_ZERO(&set);
+    CPU_SET(cc->cpu, &set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+        cc->func(cc->arg, cc->cpu);
+    else
+        cc->cpu = -1;
+
+    return 0;
+}
+
+uint64_t
+platform_call_on_cpus(uint64_t cpus, platform_work_t func, void *arg)
+{
+    int64_t i;
+    int64_t num;
+    int64_t num_cpus;
+    uint64_t called = 0;
+    struct cpu_call_t calls[HARNESS_MAX_THREADS];
+
+    num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (num_cpus > HARNESS_MAX_THREADS)
+        num_cpus = HARNESS_MAX_THREADS;
+
+    for (i = 0, num = 0; i < num_cpus; i++)
+    {
+        if ((cpus & (1ULL << i)) == 0)
+            continue;
+
+        calls[num].cpu = i;
+        calls[num].func = func;
+        calls[num].arg = arg;
+
+        if (pthread_create(&calls[num].thread, 0, cpu_call_thread, &calls[num]) == 0)
+            num++;
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        pthread_join(calls[i].thread, 0);
+
+        if (calls[i].cpu >= 0)
+            called |= 1ULL << calls[i].cpu;
+    }
+
+    return called;
+}
+
+uint64_t
+platform_timestamp(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -34,6 +34,7 @@ extern "C" {
 /* ========================================================================== */
 
 #define BF_SUCCESS 0
+#define BF_MODULE_ALREADY_ADDED 1
 #define BF_ERROR_INVALID_ARG -5001
 #define BF_ERROR_INVALID_INDEX -5002
 #define BF_ERROR_NO_MODULES_ADDED -5010
@@ -45,13 +46,42 @@ extern "C" {
 #define BF_ERROR_FAILED_TO_ALLOC_RB -5016
 #define BF_ERROR_FAILED_TO_DUMP_DR -5017
 #define BF_ERROR_OUT_OF_MEMORY -5018
+#define BF_ERROR_MIXED_PRELINKED_MODULES -5019
+#define BF_ERROR_VMM_NOT_STARTED -5020
+#define BF_ERROR_NO_SUCH_MODULE -5021
+#define BF_ERROR_NO_CPUS -5022
 #define BF_ERROR_UNKNOWN -5200
 
-#define MAX_NUM_MODULES 100
+#define MAX_NUM_CPUS 64
+#define ALL_CPUS 0xFFFFFFFFFFFFFFFFULL
+
+/*
+ * The VMM only has a single vcpu (and a single set of vmm resources) for
+ * now, so by default it is only started on CPU 0, and common_set_cpu_mask
+ * rejects masks with more than one CPU. Both can be changed to ALL_CPUS once
+ * start_vmm sets up a vcpu for the CPU it is called on.
+ */
+#define DEFAULT_CPUS 0x1ULL
+
+#define MODULE_ARENA_PAGE_SIZE 0x1000ULL
+#define MODULE_ARENA_LARGE_PAGE_SIZE 0x200000ULL
+
+/*
+ * The smallest arena the modules are placed in. More arenas are added if
+ * the modules do not fit, and a module that is bigger than this gets an
+ * arena of its own size.
+ */
+#ifndef MODULE_ARENA_SIZE
+#define MODULE_ARENA_SIZE (16 * MODULE_ARENA_LARGE_PAGE_SIZE)
+#endif
 
 #define VMM_STARTED 1
 #define VMM_STOPPED 0
 
+#define ENTRY_START_VMM 0
+#define ENTRY_STOP_VMM 1
+#define NUM_ENTRY_POINTS 2
+
 /* ========================================================================== */
 /* Common Functions                                                           */
 /* ========================================================================== */
@@ -85,20 +115,148 @@ common_fini(void);
  *
  * Add's a module into memory to be executed once start_vmm is run. This
  * function uses the platform functions to allocate memory for the executable.
- * The file that is provided should not be removed until after stop_vmm is
- * run. Removing the file from memory could cause a crash, as the start_vmm
- * function uses the file that is being added to search for symbols that are
- * needed, as well as the stop_vmm function. Once stop_vmm is run, it's safe
- * to remove the files. Also, this function cannot be run if the vmm has
- * already been started.
+ * Once the module has been loaded, the bits of the file that are still
+ * needed (the headers and section names) are copied, and everything else is
+ * used from the loaded executable, so the file that is provided can be
+ * removed as soon as this function returns. Also, this function cannot be
+ * run if the vmm has already been started.
+ *
+ * The file can also be a prelinked image (created by bfprelink), in which
+ * case it must be the only module that is added, as it already contains
+ * all of the modules, relocated against each other. The file can also be a
+ * compressed module (created by bfm --compress), which is decompressed one
+ * block at a time, and streamed into memory.
+ *
+ * If a module with the same contents has already been added, nothing is
+ * added, and BF_MODULE_ALREADY_ADDED is returned instead. For a compressed
+ * module, the contents are those of the decompressed module.
  *
  * @param file the file to add to memory
  * @param fsize the size of the file in bytes
- * @return BF_SUCCESS on success, negative error code on failure
+ * @return BF_SUCCESS on success, BF_MODULE_ALREADY_ADDED if the module
+ *     has already been added, negative error code on failure
  */
 int64_t
 common_add_module(char *file, int64_t fsize);
 
+/**
+ * Begin Adding a Module
+ *
+ * Instead of providing the entire module at once (see common_add_module),
+ * a module can be streamed in chunks, which are copied straight into the
+ * memory allocated for the executable. The module is given twice. First
+ * all of its chunks are hashed with common_add_module_hash, and
+ * common_add_module_check is called, which skips a module that has already
+ * been added before any memory is allocated for it. Then all of the chunks
+ * are added with common_add_module_chunk, and common_add_module_end must be
+ * called. The chunks can be freed as soon as they have been hashed or
+ * added. Only one module can be streamed at a time, and a prelinked image
+ * cannot be streamed.
+ *
+ * @param fsize the size of the module in bytes
+ * @return BF_SUCCESS on success, negative error code on failure
+ */
+int64_t
+common_add_module_begin(int64_t fsize);
+
+/**
+ * Hash a Module Chunk
+ *
+ * @param buf the next chunk of the module
+ * @param len the size of the chunk in bytes
+ * @return BF_SUCCESS on success, negative error code on failure
+ */
+int64_t
+common_add_module_hash(const char *buf, int64_t len);
+
+/**
+ * Check a Module
+ *
+ * Called once all of the module has been hashed. If a module with the
+ * same contents has already been added, nothing is allocated, and the
+ * module must not be streamed.
+ *
+ * @return BF_SUCCESS if the module's chunks can be added,
+ *     BF_MODULE_ALREADY_ADDED if the module has already been added,
+ *     negative error code on failure
+ */
+int64_t
+common_add_module_check(void);
+
+/**
+ * Add a Module Chunk
+ *
+ * @param buf the next chunk of the module
+ * @param len the size of the chunk in bytes
+ * @return BF_SUCCESS on success, negative error code on failure
+ */
+int64_t
+common_add_module_chunk(const char *buf, int64_t len);
+
+/**
+ * End Adding a Module
+ *
+ * @return BF_SUCCESS on success, negative error code on failure
+ */
+int64_t
+common_add_module_end(void);
+
+/**
+ * Load Module
+ *
+ * Adds a module to a running VMM. The module is relocated against the
+ * modules that the VMM is already made of (and can only use symbols that
+ * they define), after which its "register_module" entry point is called,
+ * if it has one. If the vmm has not been started, this is the same as
+ * common_add_module. Modules cannot be loaded into a prelinked image.
+ *
+ * If the module fails to be loaded, the VMM is left as it was, but the
+ * memory that was used for the module cannot be reused until the VMM is
+ * stopped.
+ *
+ * @param file the file to add to memory
+ * @param fsize the size of the file in bytes
+ * @return BF_SUCCESS on success, BF_MODULE_ALREADY_ADDED if the module
+ *     has already been added, negative error code on failure
+ */
+int64_t
+common_load_module(char *file, int64_t fsize);
+
+/**
+ * Replace Module
+ *
+ * Replaces a module of a running VMM with a new one. The module to replace
+ * is identified by its contents (i.e. old_file must be the same file that
+ * was added). Its "unregister_module" entry point is called first, which
+ * must make sure that nothing is executing the module, or can call into
+ * it, once it returns. The other modules are then bound to the new module,
+ * its "register_module" entry point is called, and the old module is
+ * freed. If any of this fails, the old module is put back.
+ *
+ * @param old_file the file that was added for the module to replace
+ * @param old_fsize the size of old_file in bytes
+ * @param file the file to replace the module with
+ * @param fsize the size of the file in bytes
+ * @return BF_SUCCESS on success, negative error code on failure
+ */
+int64_t
+common_replace_module(char *old_file, int64_t old_fsize, char *file, int64_t fsize);
+
+/**
+ * Set CPU Mask
+ *
+ * Sets the CPUs that the vmm is started on by common_start_vmm (bit n is
+ * CPU n, and only the first MAX_NUM_CPUS CPUs can be used). By default,
+ * the vmm is only started on CPU 0 (DEFAULT_CPUS). For now, the mask must
+ * have exactly one CPU set (see DEFAULT_CPUS), and it cannot be changed
+ * while the vmm is running.
+ *
+ * @param cpus the mask of CPUs to start the vmm on
+ * @return BF_SUCCESS on success, negative error code on failure
+ */
+int64_t
+common_set_cpu_mask(uint64_t cpus);
+
 /**
  * Start VMM
  *
@@ -108,6 +266,13 @@ common_add_module(char *file, int64_t fsize);
  * missing, this function will error out. If the vmm has already been started,
  * this function will also error out. Finally, the vmm must have
  * "_Z9start_vmmi" in one of the modules for the vmm to successfully start.
+ * The modules are relocated in parallel (see platform_parallel), and if more
+ * than one fails, the error from the first one that was added is returned.
+ *
+ * start_vmm is then run on each online CPU in the CPU mask (see
+ * common_set_cpu_mask) at the same time (see platform_call_on_cpus). If it
+ * fails on any of them, the vmm is stopped on the CPUs that it did start
+ * on, and the error from the lowest numbered CPU that failed is returned.
  *
  * @return BF_SUCCESS on success, negative error code on failure
  */
@@ -122,6 +287,8 @@ common_start_vmm(void);
  * this function. If the vmm has not already been started,
  * this function will also error out. Finally, the vmm must have
  * "_Z8stop_vmmi" in one of the modules for the vmm to successfully stop.
+ * stop_vmm is run on every CPU that the vmm was started on, at the same
+ * time.
  *
  * @return BF_SUCCESS on success, negative error code on failure
  */
@@ -44,7 +44,10 @@ platform_alloc(int64_t len);
 /**
  * Allocate Executable Memory
  *
- * Used by the common code to allocate executable virtual memory.
+ * Used by the common code to allocate the executable virtual memory that
+ * all of the modules are loaded into. The memory must be zeroed. len is
+ * always a multiple of 2MB, and where the platform allows it, the memory
+ * should be 2MB aligned and mapped using 2MB pages.
  *
  * @param len the size of virtual memory to be allocated in bytes.
  * @return a virtual address pointing to the newly allocated memory
@@ -86,6 +89,20 @@ platform_free(void *addr);
 void
 platform_free_exec(void *addr, int64_t len);
 
+/**
+ * Set Non-Executable
+ *
+ * Used by the common code to remove execute permissions from the parts of
+ * the executable memory that only contain data, once the modules have been
+ * relocated.
+ *
+ * @param addr a page aligned virtual address returned from
+ *     platform_alloc_exec, or within the memory it returned
+ * @param len the number of bytes (a multiple of the page size)
+ */
+void
+platform_set_nx(void *addr, int64_t len);
+
 /**
  * Free Page
  *
@@ -96,6 +113,60 @@ platform_free_exec(void *addr, int64_t len);
 void
 platform_free_page(struct page_t pg);
 
+/**
+ * Parallel Work
+ *
+ * A function given to platform_parallel, which is called once per index, or
+ * to platform_call_on_cpus, which calls it once per CPU (with the CPU as
+ * the index).
+ */
+typedef void (*platform_work_t)(void *arg, int64_t index);
+
+/**
+ * Run in Parallel
+ *
+ * Used by the common code to relocate the modules on more than one CPU.
+ * Calls func(arg, index) for every index from 0 to num - 1, and returns once
+ * every call has returned. The calls may run in any order, and at the same
+ * time on different CPUs. A platform that cannot run work in parallel may
+ * make the calls one after another.
+ *
+ * @param num the number of times to call func
+ * @param func the function to call
+ * @param arg passed to each call of func
+ */
+void
+platform_parallel(int64_t num, platform_work_t func, void *arg);
+
+/**
+ * Call on CPUs
+ *
+ * Used by the common code to start and stop the VMM on more than one CPU.
+ * Calls func(arg, cpu) on each online CPU whose bit is set in cpus (bit n
+ * is CPU n), and returns once every call has returned. Each call must run
+ * on the CPU that it is given, and cannot be preempted or moved to another
+ * CPU while it runs. The calls should run at the same time (e.g. using the
+ * platform's cross-call IPIs), so that the time it takes does not grow with
+ * the number of CPUs.
+ *
+ * @param cpus the mask of CPUs to call func on
+ * @param func the function to call
+ * @param arg passed to each call of func
+ * @return the mask of CPUs that func was called on
+ */
+uint64_t
+platform_call_on_cpus(uint64_t cpus, platform_work_t func, void *arg);
+
+/**
+ * Timestamp
+ *
+ * Used by the common code to time how long it takes to load the modules.
+ *
+ * @return the current value of a monotonic clock in nanoseconds
+ */
+uint64_t
+platform_timestamp(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,26 +4,36 @@
 #include <linux/uaccess.h>
 #include <linux/miscdevice.h>
 #include <linux/vmalloc.h>
-#include <linux/kallsyms.h>
-#include <linux/cpumask.h>
-#include <linux/sched.h>
+#include <linux/moduleparam.h>
 
 #include <debug.h>
 #include <common.h>
 #include <platform.h>
+#include <bfelf_loader.h>
 #include <driver_entry_interface.h>
 
+/* ========================================================================== */
+/* Macros                                                                     */
+/* ========================================================================== */
+
+#ifndef ADD_MODULE_CHUNK_SIZE
+#define ADD_MODULE_CHUNK_SIZE 0x10000
+#endif
+
 /* ========================================================================== */
 /* Global                                                                     */
 /* ========================================================================== */
 
 int32_t g_module_length = 0;
 
-int32_t g_num_files = 0;
-char *files[MAX_NUM_MODULES] = {0};
-
-typedef long (*set_affinity_fn)(pid_t, const struct cpumask *);
-set_affinity_fn set_cpu_affinity;
+/*
+ * The CPU that the VMM is started on (bit n is CPU n). By default, the VMM
+ * is started on CPU 0, e.g. use "insmod bareflank.ko cpu_mask=0x2" to start
+ * it on CPU 1 instead. Only one CPU can be given for now (see DEFAULT_CPUS).
+ */
+static ulong cpu_mask = DEFAULT_CPUS;
+module_param(cpu_mask, ulong, 0444);
+MODULE_PARM_DESC(cpu_mask, "CPU to start the VMM on, one bit only (default: CPU 0)");
 
 /* ========================================================================== */
 /* Misc Device                                                                */
@@ -44,17 +54,68 @@ dev_release(struct inode *inode, struct file *file)
 }
 
 int32_t
-ioctl_add_module(char *file)
+ioctl_add_whole_module(char *file)
 {
     char *buf;
     int32_t ret;
 
-    if (g_num_files >= MAX_NUM_MODULES)
+    /*
+     * A prelinked image is copied in one piece, as it is loaded with a
+     * single memcpy. So is a compressed module, which is much smaller than
+     * the module it contains, and is streamed into executable memory by
+     * common_add_module as it is decompressed. Once it has been added, the
+     * copy is no longer needed, so it is freed right away.
+     */
+
+    buf = platform_alloc(g_module_length);
+    if (buf == NULL)
     {
-        ALERT("IOCTL_ADD_MODULE: too many modules have been loaded\n");
+        ALERT("IOCTL_ADD_MODULE: failed to allocate memory for the module\n");
         return BF_IOCTL_ERROR_ADD_MODULE_FAILED;
     }
 
+    ret = copy_from_user(buf, file, g_module_length);
+    if (ret != 0)
+    {
+        ALERT("IOCTL_ADD_MODULE: failed to copy memory from userspace\n");
+        goto failed;
+    }
+
+    ret = common_add_module(buf, g_module_length);
+    if (ret < BF_SUCCESS)
+    {
+        ALERT("IOCTL_ADD_MODULE: failed to add module\n");
+        goto failed;
+    }
+
+    platform_free(buf);
+
+    if (ret == BF_MODULE_ALREADY_ADDED)
+    {
+        DEBUG("IOCTL_ADD_MODULE: module already added\n");
+        return BF_IOCTL_MODULE_ALREADY_ADDED;
+    }
+
+    DEBUG("IOCTL_ADD_MODULE: succeeded\n");
+    return BF_IOCTL_SUCCESS;
+
+failed:
+
+    platform_free(buf);
+
+    DEBUG("IOCTL_ADD_MODULE: failed\n");
+    return BF_IOCTL_ERROR_ADD_MODULE_FAILED;
+}
+
+int32_t
+ioctl_add_module(char *file)
+{
+    char *buf;
+    int32_t ret;
+    int32_t len;
+    int32_t offset;
+    struct bfelf_prelink_hdr hdr;
+
     /*
      * On Linux, we are not given a size for the IOCTL. Appearently
      * it is common practice to seperate this information into two
@@ -63,46 +124,234 @@ ioctl_add_module(char *file)
      * to send these IOCTLs in the correct order.
      *
      * Linux also does not copy userspace memory for use, so we need
-     * to do this ourselves. As a result, we alloc memory for the
-     * buffer that userspace is providing us so that we can copy this
-     * memory from userspace as needed.
+     * to do this ourselves. Rather than copying the entire module into
+     * the kernel, and then copying it again into executable memory, the
+     * module is copied in chunks that are streamed straight into
+     * executable memory by the ELF loader. The chunks are copied twice,
+     * as the module is hashed first, so that a module that has already
+     * been added is skipped before any memory is allocated for it.
      */
 
-    buf = platform_alloc(g_module_length);
+    if (g_module_length >= sizeof(hdr))
+    {
+        ret = copy_from_user(&hdr, file, sizeof(hdr));
+        if (ret != 0)
+        {
+            ALERT("IOCTL_ADD_MODULE: failed to copy memory from userspace\n");
+            return BF_IOCTL_ERROR_ADD_MODULE_FAILED;
+        }
+
+        if (bfelf_is_prelinked((char *)&hdr, sizeof(hdr)) == BFELF_TRUE ||
+            bfelf_is_compressed((char *)&hdr, sizeof(hdr)) == BFELF_TRUE)
+        {
+            return ioctl_add_whole_module(file);
+        }
+    }
+
+    buf = platform_alloc(ADD_MODULE_CHUNK_SIZE);
     if (buf == NULL)
     {
         ALERT("IOCTL_ADD_MODULE: failed to allocate memory for the module\n");
         return BF_IOCTL_ERROR_ADD_MODULE_FAILED;
     }
 
-    ret = copy_from_user(buf, file, g_module_length);
-    if (ret != 0)
+    ret = common_add_module_begin(g_module_length);
+    if (ret != BF_SUCCESS)
     {
-        ALERT("IOCTL_ADD_MODULE: failed to copy memory from userspace\n");
+        ALERT("IOCTL_ADD_MODULE: failed to add module\n");
         goto failed;
     }
 
-    ret = common_add_module(buf, g_module_length);
-    if (ret != BF_SUCCESS)
+    for (offset = 0; offset < g_module_length; offset += len)
+    {
+        len = g_module_length - offset;
+
+        if (len > ADD_MODULE_CHUNK_SIZE)
+            len = ADD_MODULE_CHUNK_SIZE;
+
+        ret = copy_from_user(buf, file + offset, len);
+        if (ret != 0)
+        {
+            ALERT("IOCTL_ADD_MODULE: failed to copy memory from userspace\n");
+            goto failed;
+        }
+
+        ret = common_add_module_hash(buf, len);
+        if (ret != BF_SUCCESS)
+        {
+            ALERT("IOCTL_ADD_MODULE: failed to add module\n");
+            goto failed;
+        }
+    }
+
+    ret = common_add_module_check();
+    if (ret < BF_SUCCESS)
+    {
+        ALERT("IOCTL_ADD_MODULE: failed to add module\n");
+        goto failed;
+    }
+
+    if (ret == BF_MODULE_ALREADY_ADDED)
+        goto done;
+
+    for (offset = 0; offset < g_module_length; offset += len)
+    {
+        len = g_module_length - offset;
+
+        if (len > ADD_MODULE_CHUNK_SIZE)
+            len = ADD_MODULE_CHUNK_SIZE;
+
+        ret = copy_from_user(buf, file + offset, len);
+        if (ret != 0)
+        {
+            ALERT("IOCTL_ADD_MODULE: failed to copy memory from userspace\n");
+            goto failed;
+        }
+
+        ret = common_add_module_chunk(buf, len);
+        if (ret != BF_SUCCESS)
+        {
+            ALERT("IOCTL_ADD_MODULE: failed to add module\n");
+            goto failed;
+        }
+    }
+
+    ret = common_add_module_end();
+    if (ret < BF_SUCCESS)
     {
         ALERT("IOCTL_ADD_MODULE: failed to add module\n");
         goto failed;
     }
 
-    files[g_num_files] = buf;
-    g_num_files++;
+done:
+
+    platform_free(buf);
+
+    if (ret == BF_MODULE_ALREADY_ADDED)
+    {
+        DEBUG("IOCTL_ADD_MODULE: module already added\n");
+        return BF_IOCTL_MODULE_ALREADY_ADDED;
+    }
 
     DEBUG("IOCTL_ADD_MODULE: succeeded\n");
     return BF_IOCTL_SUCCESS;
 
 failed:
 
-    vfree(buf);
+    platform_free(buf);
 
     DEBUG("IOCTL_ADD_MODULE: failed\n");
     return BF_IOCTL_ERROR_ADD_MODULE_FAILED;
 }
 
+int32_t
+ioctl_load_module(char *file)
+{
+    char *buf;
+    int32_t ret;
+
+    buf = platform_alloc(g_module_length);
+    if (buf == NULL)
+    {
+        ALERT("IOCTL_LOAD_MODULE: failed to allocate memory for the module\n");
+        return BF_IOCTL_ERROR_LOAD_MODULE_FAILED;
+    }
+
+    ret = copy_from_user(buf, file, g_module_length);
+    if (ret != 0)
+    {
+        ALERT("IOCTL_LOAD_MODULE: failed to copy memory from userspace\n");
+        goto failed;
+    }
+
+    ret = common_load_module(buf, g_module_length);
+    if (ret < BF_SUCCESS)
+    {
+        ALERT("IOCTL_LOAD_MODULE: failed to load module\n");
+        goto failed;
+    }
+
+    platform_free(buf);
+
+    if (ret == BF_MODULE_ALREADY_ADDED)
+    {
+        DEBUG("IOCTL_LOAD_MODULE: module already added\n");
+        return BF_IOCTL_MODULE_ALREADY_ADDED;
+    }
+
+    DEBUG("IOCTL_LOAD_MODULE: succeeded\n");
+    return BF_IOCTL_SUCCESS;
+
+failed:
+
+    platform_free(buf);
+
+    DEBUG("IOCTL_LOAD_MODULE: failed\n");
+    return BF_IOCTL_ERROR_LOAD_MODULE_FAILED;
+}
+
+int32_t
+ioctl_replace_module(struct bf_replace_module_t *arg)
+{
+    int32_t ret;
+    char *old_buf = NULL;
+    char *new_buf = NULL;
+    struct bf_replace_module_t rm;
+
+    ret = copy_from_user(&rm, arg, sizeof(rm));
+    if (ret != 0)
+    {
+        ALERT("IOCTL_REPLACE_MODULE: failed to copy memory from userspace\n");
+        return BF_IOCTL_ERROR_REPLACE_MODULE_FAILED;
+    }
+
+    if (rm.old_size <= 0 || rm.new_size <= 0)
+    {
+        ALERT("IOCTL_REPLACE_MODULE: invalid module sizes\n");
+        return BF_IOCTL_ERROR_REPLACE_MODULE_FAILED;
+    }
+
+    old_buf = platform_alloc(rm.old_size);
+    new_buf = platform_alloc(rm.new_size);
+
+    if (old_buf == NULL || new_buf == NULL)
+    {
+        ALERT("IOCTL_REPLACE_MODULE: failed to allocate memory for the modules\n");
+        goto failed;
+    }
+
+    if (copy_from_user(old_buf, rm.old_file, rm.old_size) != 0 ||
+        copy_from_user(new_buf, rm.new_file, rm.new_size) != 0)
+    {
+        ALERT("IOCTL_REPLACE_MODULE: failed to copy memory from userspace\n");
+        goto failed;
+    }
+
+    ret = common_replace_module(old_buf, rm.old_size, new_buf, rm.new_size);
+    if (ret != BF_SUCCESS)
+    {
+        ALERT("IOCTL_REPLACE_MODULE: failed to replace module: %d\n", ret);
+        goto failed;
+    }
+
+    platform_free(old_buf);
+    platform_free(new_buf);
+
+    DEBUG("IOCTL_REPLACE_MODULE: succeeded\n");
+    return BF_IOCTL_SUCCESS;
+
+failed:
+
+    if (old_buf != NULL)
+        platform_free(old_buf);
+
+    if (new_buf != NULL)
+        platform_free(new_buf);
+
+    DEBUG("IOCTL_REPLACE_MODULE: failed\n");
+    return BF_IOCTL_ERROR_REPLACE_MODULE_FAILED;
+}
+
 int32_t
 ioctl_add_module_length(int32_t len)
 {
@@ -131,18 +380,12 @@ ioctl_start_vmm(void)
 int32_t
 ioctl_stop_vmm(void)
 {
-    int i;
     int ret;
 
     ret = common_stop_vmm();
     if (ret != BF_SUCCESS)
         ALERT("IOCTL_STOP_VMM: failed to stop vmm: %d\n", ret);
 
-    for (i = 0; i < g_num_files; i++)
-        platform_free(files[i]);
-
-    g_num_files = 0;
-
     DEBUG("IOCTL_STOP_VMM: succeeded\n");
     return BF_IOCTL_SUCCESS;
 }
@@ -165,9 +408,6 @@ dev_unlocked_ioctl(struct file *file,
                    unsigned int cmd,
                    unsigned long arg)
 {
-    const struct cpumask *cpu0 = cpumask_of(0);
-    set_cpu_affinity(current->pid, cpu0);
-
     switch (cmd)
     {
         case IOCTL_ADD_MODULE:
@@ -176,6 +416,12 @@ dev_unlocked_ioctl(struct file *file,
         case IOCTL_ADD_MODULE_LENGTH:
             return ioctl_add_module_length((int32_t)arg);
 
+        case IOCTL_LOAD_MODULE:
+            return ioctl_load_module((char *)arg);
+
+        case IOCTL_REPLACE_MODULE:
+            return ioctl_replace_module((struct bf_replace_module_t *)arg);
+
         case IOCTL_START_VMM:
             return ioctl_start_vmm();
 
@@ -213,13 +459,6 @@ dev_init(void)
 {
     int ret;
 
-    set_cpu_affinity = (set_affinity_fn)kallsyms_lookup_name("sched_setaffinity");
-    if (set_cpu_affinity == NULL)
-    {
-        ALERT("Failed to locate sched_setaffinity, to avoid problems, not continuing to load bareflank\n");
-        return -1;
-    }
-
     if ((ret = misc_register(&bareflank_dev)) != 0)
     {
         ALERT("misc_register failed\n");
@@ -232,6 +471,12 @@ dev_init(void)
         return ret;
     }
 
+    if ((ret = common_set_cpu_mask(cpu_mask)) != 0)
+    {
+        ALERT("common_set_cpu_mask failed\n");
+        return ret;
+    }
+
     DEBUG("dev_init succeeded\n");
     return 0;
 }
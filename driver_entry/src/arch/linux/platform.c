@@ -23,9 +23,14 @@
 #include <platform.h>
 
 #include <debug.h>
+#include <linux/cpu.h>
+#include <linux/smp.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <asm/cacheflush.h>
 
 void *
 platform_alloc(int64_t len)
@@ -60,7 +65,15 @@ platform_alloc_exec(int64_t len)
         return NULL;
     }
 
-    addr = __vmalloc(len, GFP_KERNEL, PAGE_KERNEL_EXEC);
+    /*
+     * vmalloc decides on its own how the memory is mapped, so whether the
+     * module arena ends up being backed by 2MB pages is up to the kernel.
+     * The common code over allocates the arena by 2MB and starts it on a
+     * 2MB boundary, so that its code and data are not split across more
+     * large pages than needed when it is.
+     */
+
+    addr = __vmalloc(len, GFP_KERNEL | __GFP_ZERO, PAGE_KERNEL_EXEC);
 
     if (addr == NULL)
     {
@@ -107,6 +120,19 @@ platform_free_exec(void *addr, int64_t len)
     vfree(addr);
 }
 
+void
+platform_set_nx(void *addr, int64_t len)
+{
+    if (addr == NULL || len == 0)
+    {
+        ALERT("platform_set_nx: invalid arguments %p %lld\n", addr, len);
+        return;
+    }
+
+    if (set_memory_nx((unsigned long)addr, len / PAGE_SIZE) != 0)
+        ALERT("platform_set_nx: failed to set %p - %lld non-executable\n", addr, len);
+}
+
 void
 platform_free_page(struct page_t pg)
 {
@@ -115,3 +141,120 @@ platform_free_page(struct page_t pg)
 
     kfree(pg.virt);
 }
+
+struct parallel_work_t
+{
+    struct work_struct work;
+    platform_work_t func;
+    void *arg;
+    int64_t index;
+};
+
+void
+parallel_work(struct work_struct *work)
+{
+    struct parallel_work_t *pw = container_of(work, struct parallel_work_t, work);
+
+    pw->func(pw->arg, pw->index);
+}
+
+void
+platform_parallel(int64_t num, platform_work_t func, void *arg)
+{
+    int64_t i;
+    struct parallel_work_t *works;
+
+    if (num <= 0 || func == NULL)
+        return;
+
+    works = kcalloc(num, sizeof(struct parallel_work_t), GFP_KERNEL);
+
+    if (works == NULL)
+    {
+        ALERT("platform_parallel: failed to allocate work, running serially\n");
+
+        for (i = 0; i < num; i++)
+            func(arg, i);
+
+        return;
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        INIT_WORK(&works[i].work, parallel_work);
+
+        works[i].func = func;
+        works[i].arg = arg;
+        works[i].index = i;
+
+        queue_work(system_unbound_wq, &works[i].work);
+    }
+
+    for (i = 0; i < num; i++)
+        flush_work(&works[i].work);
+
+    kfree(works);
+}
+
+/*
+ * platform_call_on_cpus uses on_each_cpu_mask, which sends an IPI to each
+ * of the CPUs (and calls func on the current CPU, if it is one of them) and
+ * waits for all of them to return. func runs with interrupts disabled, and
+ * CPUs are not allowed to go offline until every call has returned.
+ */
+
+struct cpu_call_t
+{
+    platform_work_t func;
+    void *arg;
+};
+
+void
+cpu_call(void *info)
+{
+    struct cpu_call_t *cc = info;
+
+    cc->func(cc->arg, smp_processor_id());
+}
+
+uint64_t
+platform_call_on_cpus(uint64_t cpus, platform_work_t func, void *arg)
+{
+    int cpu;
+    uint64_t called = 0;
+    cpumask_var_t mask;
+    struct cpu_call_t cc = {func, arg};
+
+    if (func == NULL)
+        return 0;
+
+    if (!zalloc_cpumask_var(&mask, GFP_KERNEL))
+    {
+        ALERT("platform_call_on_cpus: failed to allocate cpu mask\n");
+        return 0;
+    }
+
+    get_online_cpus();
+
+    for_each_online_cpu(cpu)
+    {
+        if (cpu >= 64 || (cpus & (1ULL << cpu)) == 0)
+            continue;
+
+        cpumask_set_cpu(cpu, mask);
+        called |= 1ULL << cpu;
+    }
+
+    on_each_cpu_mask(mask, cpu_call, &cc, 1);
+
+    put_online_cpus();
+    free_cpumask_var(mask);
+
+    return called;
+}
+
+uint64_t
+platform_timestamp(void)
+{
+    return ktime_get_ns();
+}
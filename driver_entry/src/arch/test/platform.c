@@ -20,6 +20,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <time.h>
 #include <stdlib.h>
 #include <platform.h>
 #include <sys/mman.h>
@@ -61,7 +62,59 @@ platform_free_exec(void *addr, int64_t len)
     munmap(addr, len);
 }
 
+void
+platform_set_nx(void *addr, int64_t len)
+{
+    mprotect(addr, len, PROT_READ | PROT_WRITE);
+}
+
 void
 platform_free_page(struct page_t pg)
 {
 }
+
+void
+platform_parallel(int64_t num, platform_work_t func, void *arg)
+{
+    int64_t i;
+
+    for (i = 0; i < num; i++)
+        func(arg, i);
+}
+
+/*
+ * The unit tests pretend that there are TEST_NUM_CPUS CPUs online, and
+ * call func for each of them, one after another.
+ */
+
+#ifndef TEST_NUM_CPUS
+#define TEST_NUM_CPUS 4
+#endif
+
+uint64_t
+platform_call_on_cpus(uint64_t cpus, platform_work_t func, void *arg)
+{
+    int64_t i;
+    uint64_t called = 0;
+
+    for (i = 0; i < TEST_NUM_CPUS; i++)
+    {
+        if ((cpus & (1ULL << i)) == 0)
+            continue;
+
+        func(arg, i);
+        called |= 1ULL << i;
+    }
+
+    return called;
+}
+
+uint64_t
+platform_timestamp(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -38,6 +38,73 @@
 #define DEBUG_RING_SIZE (10 * 4096)
 #endif
 
+#define MODULE_REGISTER_SYMBOL "_Z15register_modulePv"
+#define MODULE_UNREGISTER_SYMBOL "_Z17unregister_modulePv"
+
+#define MODULE_HASH_SEED 0xCBF29CE484222325ULL
+#define MODULE_HASH_PRIME 0x9E3779B97F4A7C15ULL
+
+/* ========================================================================== */
+/* Types                                                                      */
+/* ========================================================================== */
+
+struct module_hash_t
+{
+    uint64_t hash;
+    uint64_t size;
+
+    uint64_t tail;
+    uint64_t tail_len;
+};
+
+/*
+ * The modules are placed in arenas of executable memory. mem and size are
+ * what was allocated, and base is the first 2MB boundary in it, where the
+ * arena's pages start. Each page has a bit in each of the bitmaps.
+ */
+struct module_arena_t
+{
+    char *mem;
+    uint64_t size;
+
+    char *base;
+    uint64_t pages;
+
+    uint64_t *used;
+    uint64_t *code;
+    uint64_t *nx;
+
+    struct module_arena_t *next;
+};
+
+/*
+ * Where a module was placed. The program headers are copied, as the pages
+ * have to be given back even if the module was never loaded.
+ */
+struct module_place_t
+{
+    struct module_arena_t *arena;
+    uint64_t base;
+    uint64_t size;
+    uint64_t phnum;
+    struct bfelf_phdr *phdrtab;
+};
+
+/*
+ * Everything that is kept for a module: its ELF file, the metadata that the
+ * file was detached into, the hash and size that identify it, and where it
+ * was placed. One of these is allocated for each module as it is added (see
+ * get_next_file), so there is no limit on the number of modules.
+ */
+struct module_t
+{
+    struct bfelf_file_t file;
+    void *meta;
+    uint64_t hash;
+    uint64_t size;
+    struct module_place_t place;
+};
+
 /* ========================================================================== */
 /* Global                                                                     */
 /* ========================================================================== */
@@ -48,9 +115,35 @@ void *g_drr = 0;
 struct vmm_resources_t g_vmmr = {0};
 
 uint64_t g_num_bfelf_files = 0;
-void *g_bfelf_execs[MAX_NUM_MODULES] = {0};
-uint64_t g_bfelf_sizes[MAX_NUM_MODULES] = {0};
-struct bfelf_file_t g_bfelf_files[MAX_NUM_MODULES] = {0};
+uint64_t g_max_modules = 0;
+struct module_t **g_modules = 0;
+
+struct module_arena_t *g_arenas = 0;
+
+struct bfelf_stream_t g_stream = {0};
+struct bfelf_lz4_t g_lz4 = {0};
+
+struct bfelf_loader_t g_loader = {0};
+struct bfelf_stats_t g_loader_stats = {0};
+char *g_symtabs = 0;
+
+struct module_hash_t g_stream_hash = {0};
+int64_t g_stream_size = 0;
+
+uint64_t g_prelinked = 0;
+struct bfelf_prelink_t g_prelink = {0};
+
+const char *g_entry_names[NUM_ENTRY_POINTS] =
+{
+    "_Z9start_vmmPv",
+    "_Z8stop_vmmPv"
+};
+
+entry_point_t g_entry_points[NUM_ENTRY_POINTS] = {0};
+
+uint64_t g_cpu_mask = DEFAULT_CPUS;
+uint64_t g_cpus_started = 0;
+int64_t g_cpu_results[MAX_NUM_CPUS] = {0};
 
 /* ========================================================================== */
 /* Helpers                                                                    */
@@ -74,140 +167,1451 @@ get_file(uint64_t index)
     if (index >= g_num_bfelf_files)
         return 0;
 
-    return &g_bfelf_files[index];
+    return &g_modules[index]->file;
+}
+
+/*
+ * Doubles the number of modules that g_modules can hold. The modules
+ * themselves are not moved, only the pointers to them.
+ */
+int64_t
+grow_modules(void)
+{
+    uint64_t i;
+    uint64_t max = g_max_modules == 0 ? 16 : g_max_modules * 2;
+    struct module_t **modules;
+
+    modules = platform_alloc(max * sizeof(struct module_t *));
+    if (modules == 0)
+        return BF_ERROR_OUT_OF_MEMORY;
+
+    for (i = 0; i < max; i++)
+        modules[i] = i < g_max_modules ? g_modules[i] : 0;
+
+    if (g_modules != 0)
+        platform_free(g_modules);
+
+    g_modules = modules;
+    g_max_modules = max;
+
+    return BF_SUCCESS;
 }
 
 struct bfelf_file_t *
 get_next_file(void)
 {
-    if (g_num_bfelf_files >= MAX_NUM_MODULES)
+    struct module_t *module;
+
+    if (g_num_bfelf_files == g_max_modules && grow_modules() != BF_SUCCESS)
+        return 0;
+
+    /*
+     * The modules are only allocated as they are actually added. A module
+     * that was allocated for a file that failed to be added is reused for
+     * the next one.
+     */
+
+    module = g_modules[g_num_bfelf_files];
+
+    if (module == 0)
+    {
+        module = platform_alloc(sizeof(struct module_t));
+        if (module == 0)
+            return 0;
+
+        module->meta = 0;
+        module->hash = 0;
+        module->size = 0;
+        module->place.arena = 0;
+        module->place.phdrtab = 0;
+
+        g_modules[g_num_bfelf_files] = module;
+    }
+
+    return &module->file;
+}
+
+uint64_t
+arena_test_page(uint64_t *bitmap, uint64_t page)
+{
+    return (bitmap[page / 64] >> (page % 64)) & 1;
+}
+
+void
+arena_set_pages(uint64_t *bitmap, uint64_t first, uint64_t last)
+{
+    uint64_t i;
+
+    for (i = first; i < last; i++)
+        bitmap[i / 64] |= 1ULL << (i % 64);
+}
+
+void
+arena_clear_pages(uint64_t *bitmap, uint64_t first, uint64_t last)
+{
+    uint64_t i;
+
+    for (i = first; i < last; i++)
+        bitmap[i / 64] &= ~(1ULL << (i % 64));
+}
+
+uint64_t
+arena_segment(struct bfelf_phdr *phdrtab, uint64_t index, uint64_t size,
+              uint64_t *first, uint64_t *last, uint64_t *exec)
+{
+    struct bfelf_phdr *phdr;
+
+    /*
+     * An image that does not come with program headers (i.e. a prelinked
+     * image) is placed as a single executable segment (phnum is 1).
+     */
+
+    if (phdrtab == 0)
+    {
+        *first = 0;
+        *last = (size + MODULE_ARENA_PAGE_SIZE - 1) / MODULE_ARENA_PAGE_SIZE;
+        *exec = 1;
+
+        return 1;
+    }
+
+    phdr = &phdrtab[index];
+
+    if (phdr->p_type != bfpt_load || phdr->p_memsz == 0)
+        return 0;
+
+    *first = phdr->p_vaddr / MODULE_ARENA_PAGE_SIZE;
+    *last = (phdr->p_vaddr + phdr->p_memsz + MODULE_ARENA_PAGE_SIZE - 1) / MODULE_ARENA_PAGE_SIZE;
+    *exec = (phdr->p_flags & bfpf_x) != 0 ? 1 : 0;
+
+    return 1;
+}
+
+uint64_t
+arena_conflict(struct module_arena_t *arena, uint64_t base,
+               struct bfelf_phdr *phdrtab, uint64_t phnum, uint64_t size)
+{
+    uint64_t i;
+    uint64_t page;
+    uint64_t exec;
+    uint64_t first;
+    uint64_t last;
+
+    for (i = 0; i < phnum; i++)
+    {
+        if (arena_segment(phdrtab, i, size, &first, &last, &exec) == 0)
+            continue;
+
+        for (page = base + first; page < base + last; page++)
+        {
+            if (arena_test_page(arena->used, page) != 0)
+                return page - first + 1;
+
+            if (exec != 0 && arena_test_page(arena->nx, page) != 0)
+                return page - first + 1;
+        }
+    }
+
+    return 0;
+}
+
+uint64_t
+arena_place(struct module_arena_t *arena, struct bfelf_phdr *phdrtab, uint64_t phnum, uint64_t size)
+{
+    uint64_t i;
+    uint64_t base;
+    uint64_t next;
+    uint64_t exec;
+    uint64_t first;
+    uint64_t last;
+    uint64_t pages = (size + MODULE_ARENA_PAGE_SIZE - 1) / MODULE_ARENA_PAGE_SIZE;
+
+    /*
+     * The modules are not simply placed one after another. A module is
+     * placed at the lowest page in the arena where none of its PT_LOAD
+     * segments overlap a page that is already used by another module, so
+     * the segments of a module end up in the holes between the segments of
+     * the modules that came before it. The distance between a module's code
+     * and its data is fixed by the linker, but with the large holes that a
+     * 2MB max page size leaves between the two, this packs the code of all
+     * of the modules together, followed by all of their data.
+     */
+
+    for (base = 0; base + pages <= arena->pages; base = next)
+    {
+        next = arena_conflict(arena, base, phdrtab, phnum, size);
+        if (next == 0)
+            break;
+    }
+
+    if (base + pages > arena->pages)
+        return arena->pages;
+
+    for (i = 0; i < phnum; i++)
+    {
+        if (arena_segment(phdrtab, i, size, &first, &last, &exec) == 0)
+            continue;
+
+        arena_set_pages(arena->used, base + first, base + last);
+
+        if (exec != 0)
+            arena_set_pages(arena->code, base + first, base + last);
+    }
+
+    return base;
+}
+
+/*
+ * Adds an arena that is big enough for a module of size bytes. Arenas are
+ * at least MODULE_ARENA_SIZE bytes, so that most module sets fit in a
+ * single arena, and a new one is only added once a module does not fit in
+ * the others. platform_alloc_exec only has to return page aligned memory,
+ * so an extra 2MB is allocated, and the arena starts at the first 2MB
+ * boundary in it, which is what lets it be mapped with 2MB pages.
+ */
+struct module_arena_t *
+arena_alloc(uint64_t size)
+{
+    uint64_t i;
+    uint64_t words;
+    struct module_arena_t *arena;
+    struct module_arena_t **last = &g_arenas;
+
+    size = (size + MODULE_ARENA_LARGE_PAGE_SIZE - 1) & ~(MODULE_ARENA_LARGE_PAGE_SIZE - 1);
+    if (size < MODULE_ARENA_SIZE)
+        size = MODULE_ARENA_SIZE;
+
+    words = size / MODULE_ARENA_PAGE_SIZE / 64;
+
+    /* The bitmaps are allocated along with the arena itself */
+
+    arena = platform_alloc(sizeof(struct module_arena_t) + 3 * words * sizeof(uint64_t));
+    if (arena == 0)
         return 0;
 
-    return &g_bfelf_files[g_num_bfelf_files];
+    arena->size = size + MODULE_ARENA_LARGE_PAGE_SIZE - MODULE_ARENA_PAGE_SIZE;
+    arena->mem = platform_alloc_exec(arena->size);
+    if (arena->mem == 0)
+    {
+        platform_free(arena);
+        return 0;
+    }
+
+    arena->used = (uint64_t *)(arena + 1);
+    arena->code = arena->used + words;
+    arena->nx = arena->code + words;
+
+    for (i = 0; i < 3 * words; i++)
+        arena->used[i] = 0;
+
+    arena->base = (char *)(((uint64_t)arena->mem + MODULE_ARENA_LARGE_PAGE_SIZE - 1) &
+                           ~(MODULE_ARENA_LARGE_PAGE_SIZE - 1));
+    arena->pages = size / MODULE_ARENA_PAGE_SIZE;
+    arena->next = 0;
+
+    while (*last != 0)
+        last = &(*last)->next;
+
+    *last = arena;
+
+    return arena;
+}
+
+/*
+ * Gives the pages of the file at index back to its arena. The pages are
+ * zeroed again, as the arena is expected to be zero wherever a module is
+ * placed, and a module may have been partly copied in before it failed.
+ */
+void
+arena_release(uint64_t index)
+{
+    uint64_t i;
+    uint64_t j;
+    uint64_t page;
+    uint64_t exec;
+    uint64_t first;
+    uint64_t last;
+    uint64_t *words;
+    struct module_place_t *place = &g_modules[index]->place;
+    struct module_arena_t *arena = place->arena;
+
+    if (arena == 0)
+        return;
+
+    for (i = 0; i < place->phnum; i++)
+    {
+        if (arena_segment(place->phdrtab, i, place->size, &first, &last, &exec) == 0)
+            continue;
+
+        for (page = place->base + first; page < place->base + last; page++)
+        {
+            words = (uint64_t *)(arena->base + (page * MODULE_ARENA_PAGE_SIZE));
+
+            for (j = 0; j < MODULE_ARENA_PAGE_SIZE / sizeof(uint64_t); j++)
+                words[j] = 0;
+        }
+
+        arena_clear_pages(arena->used, place->base + first, place->base + last);
+        arena_clear_pages(arena->code, place->base + first, place->base + last);
+    }
+
+    if (place->phdrtab != 0)
+        platform_free(place->phdrtab);
+
+    place->arena = 0;
+    place->phdrtab = 0;
 }
 
 void *
-add_elf_file(uint64_t size)
+add_elf_file(uint64_t size, struct bfelf_phdr *phdrtab, uint64_t phnum)
 {
-    void *exec;
+    uint64_t i;
+    uint64_t base;
     struct bfelf_file_t *file;
+    struct bfelf_phdr *phdrs = 0;
+    struct module_arena_t *next;
+    struct module_arena_t *arena = 0;
+    struct module_place_t *place;
+
+    if (size == 0)
+    {
+        ALERT("add_elf_file: invalid arg\n");
+        return 0;
+    }
+
+    file = get_next_file();
+    if (file == 0)
+    {
+        ALERT("add_elf_file: failed to get the next file to add\n");
+        return 0;
+    }
+
+    if (phdrtab == 0)
+        phnum = 1;
+
+    if (phdrtab != 0)
+    {
+        phdrs = platform_alloc(phnum * sizeof(struct bfelf_phdr));
+        if (phdrs == 0)
+        {
+            ALERT("add_elf_file: out of memory\n");
+            return 0;
+        }
+
+        for (i = 0; i < phnum; i++)
+            phdrs[i] = phdrtab[i];
+    }
+
+    /*
+     * All of the modules share the same arenas, instead of each module
+     * getting its own executable memory. A module is placed in the first
+     * arena that it fits in, and a new arena is only added if there is none.
+     */
+
+    for (next = g_arenas; next != 0; next = next->next)
+    {
+        base = arena_place(next, phdrs, phnum, size);
+        if (base != next->pages)
+        {
+            arena = next;
+            break;
+        }
+    }
+
+    if (arena == 0)
+    {
+        arena = arena_alloc(size);
+        if (arena == 0)
+        {
+            if (phdrs != 0)
+                platform_free(phdrs);
+
+            ALERT("add_elf_file: out of memory\n");
+            return 0;
+        }
+
+        base = arena_place(arena, phdrs, phnum, size);
+    }
+
+    place = &g_modules[g_num_bfelf_files]->place;
+    place->arena = arena;
+    place->base = base;
+    place->size = size;
+    place->phnum = phnum;
+    place->phdrtab = phdrs;
+
+    g_num_bfelf_files++;
+
+    return arena->base + (base * MODULE_ARENA_PAGE_SIZE);
+}
+
+struct bfelf_symcache_t *
+alloc_symcache(struct bfelf_file_t *bfelf_file, int64_t *num)
+{
+    struct bfelf_symcache_t *symcache = 0;
+
+    *num = bfelf_file->symnum;
+
+    if (*num > 0)
+        symcache = platform_alloc(*num * sizeof(struct bfelf_symcache_t));
+
+    if (symcache == 0)
+        *num = 0;
+
+    return symcache;
+}
+
+/*
+ * Gives the ELF loader a global symbol table that fits every module, and
+ * bfelf_file, if it is about to be hot loaded. Tables that are replaced
+ * are kept until the modules are removed (each one points to the one
+ * before it), as a module may still be looking up a symbol in one.
+ */
+int64_t
+alloc_symtab(struct bfelf_file_t *bfelf_file)
+{
+    int64_t ret;
+    int64_t size;
+    char **symtab = 0;
+
+    size = bfelf_loader_symtab_size(&g_loader, bfelf_file);
+    if (size < 0)
+        return size;
+
+    symtab = platform_alloc(sizeof(char *) + size);
+    if (symtab == 0)
+        return BF_ERROR_OUT_OF_MEMORY;
+
+    ret = bfelf_loader_set_symtab(&g_loader, (char *)(symtab + 1), size);
+    if (ret != BFELF_SUCCESS)
+    {
+        platform_free(symtab);
+        return ret;
+    }
+
+    *symtab = g_symtabs;
+    g_symtabs = (char *)symtab;
+
+    return BF_SUCCESS;
+}
+
+/*
+ * Relocates one module, and is run by platform_parallel, so each call uses
+ * its own symbol cache (one entry per symbol in the module). If the cache
+ * cannot be allocated, the module is still relocated, just without a cache.
+ */
+void
+relocate_elf_file(void *arg, int64_t index)
+{
+    int64_t num;
+    struct bfelf_symcache_t *symcache = 0;
+    struct bfelf_file_t *bfelf_file = get_file(index);
+
+    (void) arg;
+
+    if (bfelf_file == 0)
+        return;
+
+    symcache = alloc_symcache(bfelf_file, &num);
+
+    bfelf_loader_relocate_file(bfelf_file, symcache, num);
+
+    if (symcache != 0)
+        platform_free(symcache);
+}
+
+void
+protect_elf_files(void)
+{
+    uint64_t i = 0;
+    uint64_t first = 0;
+    struct module_arena_t *arena;
+
+    /*
+     * Once the modules have been relocated, every page of the arenas that
+     * does not contain code is made non-executable. Since the code of the
+     * modules is packed together, this is done in as few ranges as possible.
+     * The pages that were made non-executable are remembered, so that they
+     * are skipped when a module is loaded into a running VMM, and are never
+     * given to a module's code if they are freed.
+     */
+
+    for (arena = g_arenas; arena != 0; arena = arena->next)
+    {
+        for (i = 0; i < arena->pages;)
+        {
+            for (; i < arena->pages; i++)
+            {
+                if (arena_test_page(arena->used, i) != 0 && arena_test_page(arena->code, i) == 0 &&
+                    arena_test_page(arena->nx, i) == 0)
+                    break;
+            }
+
+            for (first = i; i < arena->pages; i++)
+            {
+                if (arena_test_page(arena->used, i) == 0 || arena_test_page(arena->code, i) != 0 ||
+                    arena_test_page(arena->nx, i) != 0)
+                    break;
+            }
+
+            if (i > first)
+            {
+                platform_set_nx(arena->base + (first * MODULE_ARENA_PAGE_SIZE), (i - first) * MODULE_ARENA_PAGE_SIZE);
+                arena_set_pages(arena->nx, first, i);
+            }
+        }
+    }
+}
+
+/*
+ * Gives a file that was added back to the arena. This is used when a module
+ * turns out to be a duplicate, fails to be loaded into a running VMM, or is
+ * replaced. The pages that it used are zeroed again, as the arena is
+ * expected to be zero wherever a module is placed, and the files that were
+ * added after it are moved down, so the files stay in the order they were
+ * added in.
+ */
+void
+release_elf_file(struct bfelf_file_t *bfelf_file)
+{
+    uint64_t index;
+    struct module_t *module;
+
+    for (index = 0; index < g_num_bfelf_files; index++)
+    {
+        if (&g_modules[index]->file == bfelf_file)
+            break;
+    }
+
+    if (bfelf_file == 0 || index == g_num_bfelf_files)
+        return;
+
+    module = g_modules[index];
+
+    arena_release(index);
+
+    if (module->meta != 0)
+        platform_free(module->meta);
+
+    for (; index + 1 < g_num_bfelf_files; index++)
+        g_modules[index] = g_modules[index + 1];
+
+    g_num_bfelf_files--;
+
+    /*
+     * The slot past the modules that are left either held the released
+     * module itself, or the last module, which was just moved down, so
+     * nothing is lost by storing the released module there for
+     * get_next_file to reuse.
+     */
+
+    module->meta = 0;
+    module->hash = 0;
+    module->size = 0;
+
+    g_modules[index] = module;
+}
+
+/*
+ * Drops the last file if it was added after num files, which is used when a
+ * module fails part way through being added to a running VMM. The file may
+ * not have been loaded, so its pages are given back using where it was
+ * placed, and not its program headers.
+ */
+void
+discard_elf_file(uint64_t num)
+{
+    struct module_t *module;
+
+    if (g_num_bfelf_files <= num)
+        return;
+
+    g_num_bfelf_files--;
+
+    arena_release(g_num_bfelf_files);
+
+    module = g_modules[g_num_bfelf_files];
+
+    if (module->meta != 0)
+        platform_free(module->meta);
+
+    module->meta = 0;
+    module->hash = 0;
+    module->size = 0;
+}
+
+/*
+ * Modules are identified by a 64bit hash of their contents (and their
+ * size), which is computed as the module is copied in, so the same module
+ * can be added more than once without being loaded more than once. The
+ * hash is not cryptographic, as only root can add modules to begin with.
+ */
+void
+module_hash_init(struct module_hash_t *mh)
+{
+    mh->hash = MODULE_HASH_SEED;
+    mh->size = 0;
+    mh->tail = 0;
+    mh->tail_len = 0;
+}
+
+void
+module_hash_update(struct module_hash_t *mh, const char *buf, uint64_t len)
+{
+    uint64_t i;
+    uint64_t word;
+
+    mh->size += len;
+
+    for (; mh->tail_len != 0 && mh->tail_len < 8 && len > 0; buf++, len--)
+        mh->tail |= (uint64_t)(unsigned char)buf[0] << (mh->tail_len++ * 8);
+
+    if (mh->tail_len == 8)
+    {
+        mh->hash = (mh->hash ^ mh->tail) * MODULE_HASH_PRIME;
+        mh->tail = 0;
+        mh->tail_len = 0;
+    }
+
+    for (; len >= 8; buf += 8, len -= 8)
+    {
+        word = 0;
+
+        for (i = 0; i < 8; i++)
+            word |= (uint64_t)(unsigned char)buf[i] << (i * 8);
+
+        mh->hash = (mh->hash ^ word) * MODULE_HASH_PRIME;
+    }
+
+    for (; len > 0; buf++, len--)
+        mh->tail |= (uint64_t)(unsigned char)buf[0] << (mh->tail_len++ * 8);
+}
+
+uint64_t
+module_hash_final(struct module_hash_t *mh)
+{
+    uint64_t hash = mh->hash;
+
+    if (mh->tail_len != 0)
+        hash = (hash ^ mh->tail) * MODULE_HASH_PRIME;
+
+    hash = (hash ^ mh->size) * MODULE_HASH_PRIME;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+struct bfelf_file_t *
+find_module(uint64_t hash, uint64_t size)
+{
+    uint64_t i;
+
+    for (i = 0; i < g_num_bfelf_files; i++)
+    {
+        if (g_modules[i]->hash == hash && g_modules[i]->size == size)
+            return &g_modules[i]->file;
+    }
+
+    return 0;
+}
+
+void
+record_module(uint64_t hash, uint64_t size)
+{
+    if (g_num_bfelf_files == 0)
+        return;
+
+    g_modules[g_num_bfelf_files - 1]->hash = hash;
+    g_modules[g_num_bfelf_files - 1]->size = size;
+}
+
+void
+remove_elf_files(void)
+{
+    int i;
+    struct bfelf_prelink_t prelink = {0};
+
+    for (i = 0; i < g_max_modules; i++)
+    {
+        struct module_t *module = g_modules[i];
+
+        if (module == 0)
+            continue;
+
+        if (i < g_num_bfelf_files && module->meta != 0)
+            platform_free(module->meta);
+
+        if (i < g_num_bfelf_files && module->place.phdrtab != 0)
+            platform_free(module->place.phdrtab);
+
+        platform_free(module);
+    }
+
+    if (g_modules != 0)
+        platform_free(g_modules);
+
+    g_modules = 0;
+    g_max_modules = 0;
+
+    while (g_arenas != 0)
+    {
+        struct module_arena_t *arena = g_arenas;
+
+        g_arenas = arena->next;
+
+        platform_free_exec(arena->mem, arena->size);
+        platform_free(arena);
+    }
+
+    while (g_symtabs != 0)
+    {
+        char *symtab = g_symtabs;
+
+        g_symtabs = *(char **)symtab;
+        platform_free(symtab);
+    }
+
+    g_num_bfelf_files = 0;
+
+    bfelf_stats_init(&g_loader_stats, platform_timestamp);
+
+    g_prelinked = 0;
+    g_prelink = prelink;
+
+    for (i = 0; i < NUM_ENTRY_POINTS; i++)
+        g_entry_points[i] = 0;
+}
+
+int64_t
+detach_elf_file(struct bfelf_file_t *bfelf_file)
+{
+    int ret;
+    int msize;
+    void *meta;
+
+    msize = bfelf_file_detach_size(bfelf_file);
+    if (msize < BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to get the module's detach size %d - %s\n", msize, bfelf_error(msize));
+        return msize;
+    }
+
+    meta = platform_alloc(msize);
+    if (meta == 0)
+    {
+        ALERT("add_module: out of memory\n");
+        return BF_ERROR_OUT_OF_MEMORY;
+    }
+
+    ret = bfelf_file_detach(bfelf_file, meta, msize);
+    if (ret != BFELF_SUCCESS)
+    {
+        platform_free(meta);
+
+        ALERT("add_module: failed to detach the elf module: %d - %s\n", ret, bfelf_error(ret));
+        return ret;
+    }
+
+    if (g_modules[g_num_bfelf_files - 1]->meta != 0)
+        platform_free(g_modules[g_num_bfelf_files - 1]->meta);
+
+    g_modules[g_num_bfelf_files - 1]->meta = meta;
+
+    return BF_SUCCESS;
+}
+
+int64_t
+add_prelinked_module(char *file, int64_t fsize)
+{
+    int ret;
+    int size;
+    void *exec;
+    void *meta;
+
+    if (g_num_bfelf_files != 0)
+    {
+        ALERT("add_module: a prelinked image must be the only module\n");
+        return BF_ERROR_MIXED_PRELINKED_MODULES;
+    }
+
+    ret = bfelf_prelink_init(file, fsize, &g_prelink);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to initialize prelinked image: %d - %s\n", ret, bfelf_error(ret));
+        return ret;
+    }
+
+    size = bfelf_prelink_exec_size(&g_prelink);
+    if (size < BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to get the prelinked image's exec size %d - %s\n", size, bfelf_error(size));
+        return size;
+    }
+
+    exec = add_elf_file(size, 0, 0);
+    if (exec == 0)
+    {
+        ALERT("add_module: failed to add prelinked image\n");
+        return BF_ERROR_FAILED_TO_ADD_FILE;
+    }
+
+    ret = bfelf_prelink_load(&g_prelink, exec, size);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to load the prelinked image: %d - %s\n", ret, bfelf_error(ret));
+        return ret;
+    }
+
+    size = bfelf_prelink_detach_size(&g_prelink);
+    if (size < BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to get the prelinked image's detach size %d - %s\n", size, bfelf_error(size));
+        return size;
+    }
+
+    meta = platform_alloc(size);
+    if (meta == 0)
+    {
+        ALERT("add_module: out of memory\n");
+        return BF_ERROR_OUT_OF_MEMORY;
+    }
+
+    g_modules[g_num_bfelf_files - 1]->meta = meta;
+
+    ret = bfelf_prelink_detach(&g_prelink, meta, size);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to detach the prelinked image: %d - %s\n", ret, bfelf_error(ret));
+        return ret;
+    }
+
+    g_prelinked = 1;
+
+    return BF_SUCCESS;
+}
+
+int64_t
+add_stream_buffers(void)
+{
+    int ret;
+    int esize;
+    int msize;
+    void *exec;
+    void *meta;
+    struct bfelf64_ehdr *ehdr;
+    struct bfelf_phdr *phdrtab;
+
+    esize = bfelf_stream_exec_size(&g_stream);
+    if (esize < BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to get the module's exec size %d - %s\n", esize, bfelf_error(esize));
+        return esize;
+    }
+
+    msize = bfelf_stream_meta_size(&g_stream);
+    if (msize < BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to get the module's meta size %d - %s\n", msize, bfelf_error(msize));
+        return msize;
+    }
+
+    meta = platform_alloc(msize);
+    if (meta == 0)
+    {
+        ALERT("add_module: out of memory\n");
+        return BF_ERROR_OUT_OF_MEMORY;
+    }
+
+    ehdr = (struct bfelf64_ehdr *)g_stream.head;
+    phdrtab = (struct bfelf_phdr *)(g_stream.head + ehdr->e_phoff);
+
+    exec = add_elf_file(esize, phdrtab, ehdr->e_phnum);
+    if (exec == 0)
+    {
+        platform_free(meta);
+
+        ALERT("add_module: failed to add file\n");
+        return BF_ERROR_FAILED_TO_ADD_FILE;
+    }
+
+    g_modules[g_num_bfelf_files - 1]->meta = meta;
+    g_stream.ef->zeroed = BFELF_TRUE;
+
+    ret = bfelf_stream_set_buffers(&g_stream, exec, esize, meta, msize);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to set the stream's buffers: %d - %s\n", ret, bfelf_error(ret));
+        return ret;
+    }
+
+    return BF_SUCCESS;
+}
+
+/*
+ * A streamed module is hashed before any of it is placed in the arena, so
+ * a module that has already been added is skipped without allocating
+ * anything for it. stream_module_begin starts hashing the module, and once
+ * all of it has been hashed, stream_module_check looks for a duplicate and
+ * only then gets the file that the module is streamed into.
+ */
+int64_t
+stream_module_begin(int64_t fsize)
+{
+    if (fsize <= 0)
+    {
+        ALERT("add_module: invalid arguments\n");
+        return BF_ERROR_INVALID_ARG;
+    }
+
+    if (g_prelinked == 1)
+    {
+        ALERT("add_module: a prelinked image must be the only module\n");
+        return BF_ERROR_MIXED_PRELINKED_MODULES;
+    }
+
+    module_hash_init(&g_stream_hash);
+    g_stream_size = fsize;
+
+    return BF_SUCCESS;
+}
+
+int64_t
+stream_module_check(void)
+{
+    int ret;
+    struct bfelf_file_t *bfelf_file;
+
+    if (g_stream_size <= 0 || g_stream_hash.size != (uint64_t)g_stream_size)
+    {
+        ALERT("add_module: the module has not been hashed\n");
+        return BF_ERROR_INVALID_ARG;
+    }
+
+    if (find_module(module_hash_final(&g_stream_hash), g_stream_hash.size) != 0)
+    {
+        DEBUG("add_module: module already added, skipping\n");
+        return BF_MODULE_ALREADY_ADDED;
+    }
+
+    bfelf_file = get_next_file();
+    if (bfelf_file == 0)
+    {
+        ALERT("add_module: out of memory\n");
+        return BF_ERROR_OUT_OF_MEMORY;
+    }
+
+    ret = bfelf_stream_init(&g_stream, bfelf_file, g_stream_size);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to initialize elf stream: %d - %s\n", ret, bfelf_error(ret));
+        return ret;
+    }
+
+    return BF_SUCCESS;
+}
+
+int64_t
+add_compressed_module(char *file, int64_t fsize)
+{
+    int ret;
+    int len;
+    char *buf;
+
+    ret = bfelf_lz4_init(&g_lz4, file, fsize);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to initialize compressed module: %d - %s\n", ret, bfelf_error(ret));
+        return ret;
+    }
+
+    /*
+     * The module is decompressed one block at a time, and each block is
+     * streamed into the ELF loader, so only the PT_LOAD segments are ever
+     * decompressed into executable memory. This is done twice, as the
+     * module is hashed first (the hash is of the decompressed module, so
+     * it matches the module being added uncompressed), and a duplicate is
+     * skipped before it is placed in the arena.
+     */
+
+    ret = stream_module_begin(bfelf_lz4_size(&g_lz4));
+    if (ret != BF_SUCCESS)
+        return ret;
+
+    while ((len = bfelf_lz4_read(&g_lz4, &buf)) > 0)
+        module_hash_update(&g_stream_hash, buf, len);
+
+    if (len < BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to decompress the module: %d - %s\n", len, bfelf_error(len));
+        return len;
+    }
+
+    ret = stream_module_check();
+    if (ret != BF_SUCCESS)
+        return ret;
+
+    ret = bfelf_lz4_init(&g_lz4, file, fsize);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to initialize compressed module: %d - %s\n", ret, bfelf_error(ret));
+        return ret;
+    }
+
+    while ((len = bfelf_lz4_read(&g_lz4, &buf)) > 0)
+    {
+        ret = common_add_module_chunk(buf, len);
+        if (ret != BF_SUCCESS)
+            return ret;
+    }
+
+    if (len < BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to decompress the module: %d - %s\n", len, bfelf_error(len));
+        return len;
+    }
+
+    return common_add_module_end();
+}
+
+int64_t
+add_module(char *file, int64_t fsize)
+{
+    int ret;
+    int size;
+    void *exec;
+    uint64_t hash;
+    struct module_hash_t mh;
+    struct bfelf_file_t *bfelf_file;
+
+    if (bfelf_is_compressed(file, fsize) == BFELF_TRUE)
+        return add_compressed_module(file, fsize);
+
+    module_hash_init(&mh);
+    module_hash_update(&mh, file, fsize);
+
+    hash = module_hash_final(&mh);
+    if (find_module(hash, fsize) != 0)
+    {
+        DEBUG("add_module: module already added, skipping\n");
+        return BF_MODULE_ALREADY_ADDED;
+    }
+
+    bfelf_file = get_next_file();
+    if (bfelf_file == 0)
+    {
+        ALERT("add_module: out of memory\n");
+        return BF_ERROR_OUT_OF_MEMORY;
+    }
+
+    if (bfelf_is_prelinked(file, fsize) == BFELF_TRUE)
+    {
+        ret = add_prelinked_module(file, fsize);
+        if (ret != BF_SUCCESS)
+            return ret;
+
+        record_module(hash, fsize);
+        return BF_SUCCESS;
+    }
+
+    if (g_prelinked == 1)
+    {
+        ALERT("add_module: a prelinked image must be the only module\n");
+        return BF_ERROR_MIXED_PRELINKED_MODULES;
+    }
+
+    ret = bfelf_file_init(file, fsize, bfelf_file);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to initialize elf file: %d - %s\n", ret, bfelf_error(ret));
+        return ret;
+    }
+
+    size = bfelf_total_exec_size(bfelf_file);
+    if (size < BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to get the module's exec size %d - %s\n", size, bfelf_error(size));
+        return size;
+    }
+
+    exec = add_elf_file(size, bfelf_file->phdrtab, bfelf_file->ehdr->e_phnum);
+    if (exec == 0)
+    {
+        ALERT("add_module: failed to add file: %d\n", ret);
+        return BF_ERROR_FAILED_TO_ADD_FILE;
+    }
+
+    bfelf_file->zeroed = BFELF_TRUE;
+
+    ret = bfelf_file_load(bfelf_file, exec, size);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("add_module: failed to load the elf module: %d - %s\n", ret, bfelf_error(ret));
+        return ret;
+    }
+
+    ret = detach_elf_file(bfelf_file);
+    if (ret != BF_SUCCESS)
+        return ret;
+
+    record_module(hash, fsize);
+    return BF_SUCCESS;
+}
+
+int64_t
+symbol_length(const char *sym)
+{
+    int64_t len = 0;
+
+    if (sym == 0)
+        return 0;
+
+    while (sym[len] != '\0')
+        len++;
+
+    return len;
+}
+
+int64_t
+resolve_symbol(const char *sym, void **entry)
+{
+    int ret = 0;
+    struct e_string_t entry_str = {0};
+    struct bfelf_file_t *bfelf_file = 0;
+
+    entry_str.buf = sym;
+    entry_str.len = symbol_length(sym);
+
+    if (g_prelinked == 1)
+    {
+        ret = bfelf_prelink_resolve_symbol(&g_prelink, &entry_str, entry);
+    }
+    else
+    {
+        bfelf_file = get_file(0);
+        if (bfelf_file == 0)
+        {
+            ALERT("resolve_symbol: failed because no modules were loaded\n");
+            return BF_ERROR_NO_MODULES_ADDED;
+        }
+
+        ret = bfelf_resolve_symbol(bfelf_file, &entry_str, entry);
+    }
+
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("start_vmm: failed to resolve entry point: %d - %s\n", ret, bfelf_error(ret));
+        return ret;
+    }
+
+    return BF_SUCCESS;
+}
+
+int64_t
+call_entry_point(const char *sym, entry_point_t entry_point, void *arg)
+{
+    void *ret;
+
+    /* Only used by DEBUG, which is empty outside of the kernel */
+    (void) sym;
+
+    if ((ret = entry_point(arg)) == VMM_SUCCESS)
+    {
+        DEBUG("\n");
+        DEBUG("%s executed successfully:\n", sym);
+        DEBUG("    - exit code: %ld\n", (long)ret);
+        DEBUG("\n");
+
+        return BF_SUCCESS;
+    }
+
+    DEBUG("\n");
+    DEBUG("%s failed:\n", sym);
+    DEBUG("    - exit code: %ld\n", (long)ret);
+    DEBUG("\n");
+
+    return BF_ERROR_FAILED_TO_EXECUTE_SYMBOL;
+}
+
+/*
+ * The entry points that the driver calls (see g_entry_names) are resolved
+ * once, when the VMM is started, so that calling into the VMM afterwards
+ * never has to search the symbol tables. They are forgotten when the
+ * modules are removed.
+ */
+int64_t
+resolve_entry_points(void)
+{
+    int i;
+    int64_t ret;
+    void *entry = 0;
+
+    for (i = 0; i < NUM_ENTRY_POINTS; i++)
+    {
+        ret = resolve_symbol(g_entry_names[i], &entry);
+        if (ret != BF_SUCCESS)
+            return ret;
+
+        g_entry_points[i] = (entry_point_t)entry;
+    }
+
+    return BF_SUCCESS;
+}
+
+int64_t
+execute_entry(uint64_t index, void *arg)
+{
+    if (index >= NUM_ENTRY_POINTS)
+    {
+        ALERT("execute_entry: invalid arguments\n");
+        return BF_ERROR_INVALID_INDEX;
+    }
+
+    if (g_entry_points[index] == 0)
+    {
+        ALERT("execute_entry: %s has not been resolved\n", g_entry_names[index]);
+        return BF_ERROR_FAILED_TO_EXECUTE_SYMBOL;
+    }
+
+    return call_entry_point(g_entry_names[index], g_entry_points[index], arg);
+}
+
+/*
+ * The vmm is started and stopped on every CPU at the same time (see
+ * platform_call_on_cpus). Each CPU only writes its own result, and the
+ * results are collected once all of the CPUs have returned.
+ */
+void
+start_vmm_on_cpu(void *arg, int64_t cpu)
+{
+    g_cpu_results[cpu] = execute_entry(ENTRY_START_VMM, arg);
+}
+
+void
+stop_vmm_on_cpu(void *arg, int64_t cpu)
+{
+    g_cpu_results[cpu] = execute_entry(ENTRY_STOP_VMM, arg);
+}
+
+void
+clear_cpu_results(void)
+{
+    int i;
+
+    for (i = 0; i < MAX_NUM_CPUS; i++)
+        g_cpu_results[i] = BF_ERROR_UNKNOWN;
+}
+
+int64_t
+start_vmm_on_cpus(uint64_t cpus)
+{
+    int i;
+    int64_t ret = BF_SUCCESS;
 
-    if (size == 0)
-    {
-        ALERT("add_elf_file: invalid arg\n");
-        return 0;
-    }
+    clear_cpu_results();
 
-    file = get_next_file();
-    if (file == 0)
+    cpus = platform_call_on_cpus(cpus, start_vmm_on_cpu, get_vmmr());
+    if (cpus == 0)
     {
-        ALERT("add_elf_file: failed to get the next file to add\n");
-        return 0;
+        ALERT("start_vmm: none of the cpus in the cpu mask are online\n");
+        return BF_ERROR_NO_CPUS;
     }
 
-    exec = platform_alloc_exec(size);
-    if (exec == 0)
+    for (i = 0; i < MAX_NUM_CPUS; i++)
     {
-        ALERT("add_elf_file: out of memory\n");
-        return 0;
-    }
+        if ((cpus & (1ULL << i)) == 0)
+            continue;
 
-    g_bfelf_execs[g_num_bfelf_files] = exec;
-    g_bfelf_sizes[g_num_bfelf_files] = size;
+        if (g_cpu_results[i] == BF_SUCCESS)
+        {
+            g_cpus_started |= 1ULL << i;
+            continue;
+        }
 
-    g_num_bfelf_files++;
+        ALERT("start_vmm: failed to start the vmm on cpu %d: %d\n", i, (int)g_cpu_results[i]);
+
+        if (ret == BF_SUCCESS)
+            ret = g_cpu_results[i];
+    }
 
-    return exec;
+    return ret;
 }
 
 void
-remove_elf_files(void)
+stop_vmm_on_cpus(void)
 {
     int i;
-    struct bfelf_file_t file = {0};
+    uint64_t cpus;
 
-    for (i = 0; i < g_num_bfelf_files; i++)
+    if (g_cpus_started == 0)
+        return;
+
+    clear_cpu_results();
+
+    cpus = platform_call_on_cpus(g_cpus_started, stop_vmm_on_cpu, 0);
+
+    for (i = 0; i < MAX_NUM_CPUS; i++)
     {
-        platform_free_exec(g_bfelf_execs[i], g_bfelf_sizes[i]);
+        if ((g_cpus_started & (1ULL << i)) == 0)
+            continue;
 
-        g_bfelf_execs[i] = 0;
-        g_bfelf_sizes[i] = 0;
-        g_bfelf_files[i] = file;
+        if ((cpus & (1ULL << i)) == 0)
+            ALERT("stop_vmm: cpu %d is no longer online\n", i);
+        else if (g_cpu_results[i] != BF_SUCCESS)
+            ALERT("stop_vmm: failed to stop the vmm on cpu %d: %d\n", i, (int)g_cpu_results[i]);
     }
 
-    g_num_bfelf_files = 0;
+    g_cpus_started = 0;
 }
 
+/*
+ * Modules that are loaded into a running VMM can define a registration
+ * entry point (and one to unregister it, called before it is replaced).
+ * These are looked up in the module itself, as every module uses the same
+ * names, and a module that does not define one simply does not need it.
+ */
 int64_t
-symbol_length(const char *sym)
+execute_module_entry(struct bfelf_file_t *bfelf_file, const char *sym)
 {
-    int64_t len = 0;
+    int ret;
+    struct bfelf_sym *entry = 0;
+    struct e_string_t entry_str = {0};
 
-    if (sym == 0)
-        return 0;
+    entry_str.buf = sym;
+    entry_str.len = symbol_length(sym);
 
-    while (sym[len] != '\0')
-        len++;
+    ret = bfelf_symbol_by_name(bfelf_file, &entry_str, &entry);
+    if (ret == BFELF_ERROR_NO_SUCH_SYMBOL || (ret == BFELF_SUCCESS && entry->st_value == 0))
+        return BF_SUCCESS;
 
-    return len;
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("execute_module_entry: failed to find %s: %d - %s\n", sym, ret, bfelf_error(ret));
+        return ret;
+    }
+
+    return call_entry_point(sym, (entry_point_t)(bfelf_file->exec + entry->st_value), 0);
 }
 
+/*
+ * Relocates a module that was just added against the modules that the
+ * running VMM is made of, and registers it. If this fails, the module is
+ * removed again.
+ */
 int64_t
-execute_symbol(const char *sym, void *arg)
+link_module(struct bfelf_file_t *bfelf_file)
 {
-    int ret = 0;
-    void *entry = 0;
-    struct e_string_t entry_str = {0};
-    struct bfelf_file_t *bfelf_file = 0;
+    int ret;
+    int64_t num;
+    struct bfelf_symcache_t *symcache = 0;
 
-    entry_str.buf = sym;
-    entry_str.len = symbol_length(sym);
+    ret = alloc_symtab(bfelf_file);
+    if (ret != BF_SUCCESS)
+    {
+        ALERT("load_module: failed to allocate the symbol table: %d\n", ret);
+        release_elf_file(bfelf_file);
+        return ret;
+    }
 
-    if (sym == 0)
+    symcache = alloc_symcache(bfelf_file, &num);
+
+    ret = bfelf_loader_add_relocated(&g_loader, bfelf_file, symcache, num);
+
+    if (symcache != 0)
+        platform_free(symcache);
+
+    if (ret != BFELF_SUCCESS)
     {
-        ALERT("execute_symbol: invalid arguments\n");
-        return BF_ERROR_INVALID_ARG;
+        ALERT("load_module: failed to relocate the module: %d - %s\n", ret, bfelf_error(ret));
+        release_elf_file(bfelf_file);
+        return ret;
     }
 
-    bfelf_file = get_file(0);
-    if (bfelf_file == 0)
+    protect_elf_files();
+
+    ret = execute_module_entry(bfelf_file, MODULE_REGISTER_SYMBOL);
+    if (ret != BF_SUCCESS)
     {
-        ALERT("execute_symbol: failed because no modules were loaded\n");
-        return BF_ERROR_NO_MODULES_ADDED;
+        ALERT("load_module: failed to register the module: %d\n", ret);
+
+        if (alloc_symtab(0) != BF_SUCCESS || bfelf_loader_remove(&g_loader, bfelf_file) != BFELF_SUCCESS)
+        {
+            ALERT("load_module: failed to remove the module\n");
+            return ret;
+        }
+
+        release_elf_file(bfelf_file);
+        return ret;
     }
 
-    ret = bfelf_resolve_symbol(bfelf_file, &entry_str, &entry);
-    if (ret != BFELF_SUCCESS)
+    return BF_SUCCESS;
+}
+
+/*
+ * Swaps a module of the running VMM for a new one that was just added. The
+ * old module is unregistered first, which must quiesce it (i.e. once it
+ * returns, nothing can be executing the module, or about to call into
+ * it), as every other module is then bound to the new module, and the old
+ * module is freed. If the new module cannot be swapped in, the old module
+ * is registered again, and the new module is removed.
+ */
+int64_t
+swap_module(struct bfelf_file_t *old_file, struct bfelf_file_t *new_file)
+{
+    int ret;
+    int64_t num;
+    struct bfelf_symcache_t *symcache = 0;
+
+    ret = execute_module_entry(old_file, MODULE_UNREGISTER_SYMBOL);
+    if (ret != BF_SUCCESS)
     {
-        ALERT("start_vmm: failed to resolve entry point: %d - %s\n", ret, bfelf_error(ret));
+        ALERT("replace_module: failed to unregister the old module: %d\n", ret);
+        release_elf_file(new_file);
         return ret;
     }
-    else
+
+    ret = alloc_symtab(new_file);
+    if (ret == BF_SUCCESS)
     {
-        void *ret;
-        entry_point_t entry_point = (entry_point_t)entry;
+        symcache = alloc_symcache(new_file, &num);
 
-        if ((ret = entry_point(arg)) == VMM_SUCCESS)
-        {
-            DEBUG("\n");
-            DEBUG("%s executed successfully:\n", sym);
-            DEBUG("    - exit code: %ld\n", (long)ret);
-            DEBUG("\n");
+        ret = bfelf_loader_replace(&g_loader, old_file, new_file, symcache, num);
 
-            return BF_SUCCESS;
-        }
-        else
-        {
-            DEBUG("\n");
-            DEBUG("%s failed:\n", sym);
-            DEBUG("    - exit code: %ld\n", (long)ret);
-            DEBUG("\n");
+        if (symcache != 0)
+            platform_free(symcache);
+    }
+
+    if (ret == BFELF_SUCCESS)
+    {
+        protect_elf_files();
 
-            return BF_ERROR_FAILED_TO_EXECUTE_SYMBOL;
+        ret = execute_module_entry(new_file, MODULE_REGISTER_SYMBOL);
+        if (ret != BF_SUCCESS)
+        {
+            ALERT("replace_module: failed to register the new module: %d\n", ret);
+
+            if (alloc_symtab(old_file) != BF_SUCCESS ||
+                bfelf_loader_replace(&g_loader, new_file, old_file, 0, 0) != BFELF_SUCCESS)
+            {
+                ALERT("replace_module: failed to swap the old module back in\n");
+                return ret;
+            }
         }
     }
+    else
+    {
+        ALERT("replace_module: failed to relocate the new module: %d - %s\n", ret, bfelf_error(ret));
+    }
+
+    if (ret != BF_SUCCESS)
+    {
+        execute_module_entry(old_file, MODULE_REGISTER_SYMBOL);
+        release_elf_file(new_file);
+        return ret;
+    }
 
-    return BF_ERROR_UNKNOWN;
+    release_elf_file(old_file);
+
+    return resolve_entry_points();
 }
 
 /* ========================================================================== */
@@ -223,6 +1627,8 @@ common_init(void)
     if (vmmr == 0)
         return BF_ERROR_INVALID_ARG;
 
+    bfelf_stats_init(&g_loader_stats, platform_timestamp);
+
     if (g_drr == 0)
     {
         g_drr = platform_alloc(DEBUG_RING_SIZE);
@@ -283,11 +1689,6 @@ common_fini(void)
 int64_t
 common_add_module(char *file, int64_t fsize)
 {
-    int ret;
-    int size;
-    void *exec;
-    struct bfelf_file_t *bfelf_file;
-
     if (file == 0 || fsize == 0)
     {
         ALERT("add_module: invalid arguments\n");
@@ -300,41 +1701,206 @@ common_add_module(char *file, int64_t fsize)
         return BF_ERROR_VMM_ALREADY_STARTED;
     }
 
-    bfelf_file = get_next_file();
-    if (bfelf_file == 0)
+    return add_module(file, fsize);
+}
+
+int64_t
+common_add_module_begin(int64_t fsize)
+{
+    if (vmm_status() == VMM_STARTED)
     {
-        ALERT("add_module: failed to get the next file to add\n");
-        return BF_ERROR_MAX_MODULES_REACHED;
+        ALERT("add_module: vmm already running\n");
+        return BF_ERROR_VMM_ALREADY_STARTED;
     }
 
-    ret = bfelf_file_init(file, fsize, bfelf_file);
+    return stream_module_begin(fsize);
+}
+
+int64_t
+common_add_module_hash(const char *buf, int64_t len)
+{
+    if (buf == 0 || len <= 0)
+    {
+        ALERT("add_module: invalid arguments\n");
+        return BF_ERROR_INVALID_ARG;
+    }
+
+    module_hash_update(&g_stream_hash, buf, len);
+
+    return BF_SUCCESS;
+}
+
+int64_t
+common_add_module_check(void)
+{
+    return stream_module_check();
+}
+
+int64_t
+common_add_module_chunk(const char *buf, int64_t len)
+{
+    int ret;
+
+    if (buf == 0 || len <= 0)
+    {
+        ALERT("add_module: invalid arguments\n");
+        return BF_ERROR_INVALID_ARG;
+    }
+
+    while (len > 0)
+    {
+        ret = bfelf_stream_write(&g_stream, buf, len);
+        if (ret < BFELF_SUCCESS)
+        {
+            ALERT("add_module: failed to stream the elf module: %d - %s\n", ret, bfelf_error(ret));
+            return ret;
+        }
+
+        if (ret == 0)
+        {
+            ret = add_stream_buffers();
+            if (ret != BF_SUCCESS)
+                return ret;
+
+            continue;
+        }
+
+        buf += ret;
+        len -= ret;
+    }
+
+    return BF_SUCCESS;
+}
+
+int64_t
+common_add_module_end(void)
+{
+    int ret;
+
+    ret = bfelf_stream_finish(&g_stream);
     if (ret != BFELF_SUCCESS)
     {
-        ALERT("add_module: failed to initialize elf file: %d - %s\n", ret, bfelf_error(ret));
+        ALERT("add_module: failed to load the elf module: %d - %s\n", ret, bfelf_error(ret));
         return ret;
     }
 
-    size = bfelf_total_exec_size(bfelf_file);
-    if (ret < BFELF_SUCCESS)
+    ret = detach_elf_file(g_stream.ef);
+    if (ret != BF_SUCCESS)
+        return ret;
+
+    record_module(module_hash_final(&g_stream_hash), g_stream_hash.size);
+    return BF_SUCCESS;
+}
+
+int64_t
+common_load_module(char *file, int64_t fsize)
+{
+    int ret;
+    uint64_t num;
+
+    if (file == 0 || fsize == 0)
     {
-        ALERT("add_module: failed to get the module's exec size %d - %s\n", size, bfelf_error(size));
+        ALERT("load_module: invalid arguments\n");
+        return BF_ERROR_INVALID_ARG;
+    }
+
+    if (vmm_status() != VMM_STARTED)
+        return common_add_module(file, fsize);
+
+    if (g_prelinked == 1 || bfelf_is_prelinked(file, fsize) == BFELF_TRUE)
+    {
+        ALERT("load_module: modules cannot be loaded with a prelinked image\n");
+        return BF_ERROR_MIXED_PRELINKED_MODULES;
+    }
+
+    num = g_num_bfelf_files;
+
+    ret = add_module(file, fsize);
+    if (ret != BF_SUCCESS)
+    {
+        discard_elf_file(num);
         return ret;
     }
 
-    exec = add_elf_file(size);
-    if (exec == 0)
+    return link_module(get_file(g_num_bfelf_files - 1));
+}
+
+int64_t
+common_replace_module(char *old_file, int64_t old_fsize, char *file, int64_t fsize)
+{
+    int ret;
+    uint64_t num;
+    struct module_hash_t mh;
+    struct bfelf_file_t *old_bfelf_file;
+
+    if (old_file == 0 || old_fsize == 0 || file == 0 || fsize == 0)
     {
-        ALERT("add_module: failed to add file: %d\n", ret);
-        return BF_ERROR_FAILED_TO_ADD_FILE;
+        ALERT("replace_module: invalid arguments\n");
+        return BF_ERROR_INVALID_ARG;
     }
 
-    ret = bfelf_file_load(bfelf_file, exec, size);
-    if (ret != BFELF_SUCCESS)
+    if (vmm_status() != VMM_STARTED)
     {
-        ALERT("add_module: failed to load the elf module: %d - %s\n", ret, bfelf_error(ret));
+        ALERT("replace_module: vmm not running\n");
+        return BF_ERROR_VMM_NOT_STARTED;
+    }
+
+    if (g_prelinked == 1 || bfelf_is_prelinked(file, fsize) == BFELF_TRUE)
+    {
+        ALERT("replace_module: modules cannot be replaced in a prelinked image\n");
+        return BF_ERROR_MIXED_PRELINKED_MODULES;
+    }
+
+    module_hash_init(&mh);
+    module_hash_update(&mh, old_file, old_fsize);
+
+    old_bfelf_file = find_module(module_hash_final(&mh), old_fsize);
+    if (old_bfelf_file == 0)
+    {
+        ALERT("replace_module: the module to replace has not been added\n");
+        return BF_ERROR_NO_SUCH_MODULE;
+    }
+
+    num = g_num_bfelf_files;
+
+    ret = add_module(file, fsize);
+    if (ret != BF_SUCCESS)
+    {
+        discard_elf_file(num);
         return ret;
     }
 
+    return swap_module(old_bfelf_file, get_file(g_num_bfelf_files - 1));
+}
+
+int64_t
+common_set_cpu_mask(uint64_t cpus)
+{
+    if (cpus == 0)
+    {
+        ALERT("set_cpu_mask: invalid arguments\n");
+        return BF_ERROR_INVALID_ARG;
+    }
+
+    /*
+     * start_vmm always uses vcpu 0 and the same vmm resources, so running it
+     * on more than one CPU at the same time would corrupt them (see
+     * DEFAULT_CPUS). Until start_vmm is per-CPU safe, only one CPU is allowed.
+     */
+
+    if ((cpus & (cpus - 1)) != 0)
+    {
+        ALERT("set_cpu_mask: the vmm can only be started on one CPU\n");
+        return BF_ERROR_INVALID_ARG;
+    }
+
+    if (vmm_status() == VMM_STARTED)
+    {
+        ALERT("set_cpu_mask: failed because the vmm is running\n");
+        return BF_ERROR_VMM_ALREADY_STARTED;
+    }
+
+    g_cpu_mask = cpus;
     return BF_SUCCESS;
 }
 
@@ -343,22 +1909,28 @@ common_start_vmm(void)
 {
     int i = 0;
     int ret = 0;
-    struct bfelf_loader_t loader = {0};
     struct bfelf_file_t *bfelf_file = 0;
 
     if (vmm_status() == VMM_STARTED)
         return BF_SUCCESS;
 
-    ret = bfelf_loader_init(&loader);
+    if (g_prelinked == 1)
+        goto execute;
+
+    ret = bfelf_loader_init(&g_loader);
     if (ret != BFELF_SUCCESS)
     {
         ALERT("start_vmm: failed to initialize the elf loader: %d - %s\n", ret, bfelf_error(ret));
         goto failure;
     }
 
+#ifdef ENABLE_BFELF_LAZY_BINDING
+    g_loader.lazy = BFELF_TRUE;
+#endif
+
     while ((bfelf_file = get_file(i++)) != 0)
     {
-        ret = bfelf_loader_add(&loader, bfelf_file);
+        ret = bfelf_loader_add(&g_loader, bfelf_file);
         if (ret != BFELF_SUCCESS)
         {
             ALERT("start_vmm: failed to add elf file to the elf loader: %d - %s\n", ret, bfelf_error(ret));
@@ -366,19 +1938,59 @@ common_start_vmm(void)
         }
     }
 
-    ret = bfelf_loader_relocate(&loader);
+    ret = alloc_symtab(0);
+    if (ret != BF_SUCCESS)
+    {
+        ALERT("start_vmm: failed to allocate the symbol table: %d\n", ret);
+        goto failure;
+    }
+
+    ret = bfelf_loader_relocate_begin(&g_loader);
+    if (ret != BFELF_SUCCESS)
+    {
+        ALERT("start_vmm: failed to relocate the elf loader: %d - %s\n", ret, bfelf_error(ret));
+        goto failure;
+    }
+
+    platform_parallel(g_num_bfelf_files, relocate_elf_file, 0);
+
+    ret = bfelf_loader_relocate_end(&g_loader);
     if (ret != BFELF_SUCCESS)
     {
         ALERT("start_vmm: failed to relocate the elf loader: %d - %s\n", ret, bfelf_error(ret));
         goto failure;
     }
 
+    protect_elf_files();
+
+    DEBUG("start_vmm: loaded %llu modules: init %llu ns, load %llu ns (%llu bytes), "
+          "relocate %llu ns (%llu relocs, %llu lookups, %llu strcmps)\n",
+          g_num_bfelf_files,
+          g_loader_stats.init_time,
+          g_loader_stats.load_time,
+          g_loader_stats.bytes_copied + g_loader_stats.bytes_zeroed,
+          g_loader_stats.relocate_time,
+          g_loader_stats.relocs_relative + g_loader_stats.relocs_relr +
+          g_loader_stats.relocs_64 + g_loader_stats.relocs_glob_dat +
+          g_loader_stats.relocs_jump_slot + g_loader_stats.relocs_irelative,
+          g_loader_stats.lookups,
+          g_loader_stats.strcmps);
+
+execute:
+
+    ret = resolve_entry_points();
+    if (ret != BF_SUCCESS)
+    {
+        ALERT("start_vmm: failed to resolve the entry points: %d\n", ret);
+        goto failure;
+    }
+
     g_vmm_status = VMM_STARTED;
 
-    ret = execute_symbol("_Z9start_vmmPv", get_vmmr());
+    ret = start_vmm_on_cpus(g_cpu_mask);
     if (ret != BF_SUCCESS)
     {
-        ALERT("start_vmm: failed to execute symbol: %d\n", ret);
+        ALERT("start_vmm: failed to start the vmm on every cpu: %d\n", ret);
         goto failure;
     }
 
@@ -393,14 +2005,8 @@ failure:
 int64_t
 common_stop_vmm(void)
 {
-    int ret;
-
     if (vmm_status() == VMM_STARTED)
-    {
-        ret = execute_symbol("_Z8stop_vmmPv", 0);
-        if (ret != BFELF_SUCCESS)
-            ALERT("stop_vmm: failed to execute symbol: %d\n", ret);
-    }
+        stop_vmm_on_cpus();
 
     remove_elf_files();
 
@@ -150,21 +150,68 @@ driver_entry_ut::list()
     this->test_common_add_module_elf_file_total_exec_failed();
     this->test_common_add_module_add_elf_file_failed();
     this->test_common_add_module_elf_file_load_failed();
+    this->test_common_add_module_elf_file_detach_failed();
     this->test_common_add_module_add_success();
+    this->test_common_add_module_add_and_free_success();
+    this->test_common_add_module_prelink_init_failed();
+    this->test_common_add_module_prelink_load_failed();
+    this->test_common_add_module_prelink_detach_failed();
+    this->test_common_add_module_prelink_after_module();
+    this->test_common_add_module_prelink_success();
+    this->test_common_add_module_duplicate();
+    this->test_common_add_module_begin_invalid_file_size();
+    this->test_common_add_module_begin_status_already_running();
+    this->test_common_add_module_hash_invalid_file();
+    this->test_common_add_module_check_not_hashed();
+    this->test_common_add_module_check_stream_init_failed();
+    this->test_common_add_module_chunk_invalid_file();
+    this->test_common_add_module_chunk_invalid_module();
+    this->test_common_add_module_stream_success();
+    this->test_common_add_module_stream_duplicate();
+    this->test_common_add_module_compressed_init_failed();
+    this->test_common_add_module_compressed_read_failed();
+    this->test_common_add_module_compressed_success();
+    this->test_common_add_module_compressed_duplicate();
+
+    this->test_common_load_module_invalid_file();
+    this->test_common_load_module_invalid_file_size();
+    this->test_common_load_module_not_started();
+    this->test_common_load_module_already_added();
+    this->test_common_load_module_relocate_failed();
+    this->test_common_load_module_register_failed();
+    this->test_common_load_module_success();
+
+    this->test_common_replace_module_invalid_args();
+    this->test_common_replace_module_not_started();
+    this->test_common_replace_module_no_such_module();
+    this->test_common_replace_module_unregister_failed();
+    this->test_common_replace_module_relocate_failed();
+    this->test_common_replace_module_success();
 
     this->test_common_start_already_started();
     this->test_common_start_init_loader_failed();
     this->test_common_start_loader_add_failed();
+    this->test_common_start_loader_symtab_failed();
+    this->test_common_start_loader_relocate_begin_failed();
+    this->test_common_start_loader_relocate_file_failed();
     this->test_common_start_loader_relocate_failed();
-    this->test_common_start_execute_symbol_failed();
+    this->test_common_start_execute_entry_failed();
+    this->test_common_start_resolve_entry_points_failed();
     this->test_common_start_get_vmmr_failed();
     this->test_common_start_success();
     this->test_common_start_success_multiple_times();
+    this->test_common_start_loader_stats();
+    this->test_common_start_default_cpus();
+    this->test_common_start_all_cpus();
+    this->test_common_start_cpu_mask();
+    this->test_common_start_no_cpus();
+    this->test_common_start_cpu_failed();
 
     this->test_common_stop_already_stopped();
-    this->test_common_stop_execute_symbol_failed();
+    this->test_common_stop_execute_entry_failed();
     this->test_common_stop_success();
     this->test_common_stop_success_multiple_times();
+    this->test_common_stop_all_cpus();
 
     this->test_common_dump_platform_alloc_failed();
     this->test_common_dump_debug_ring_read_failed();
@@ -175,7 +222,9 @@ driver_entry_ut::list()
     this->test_helper_get_vmmr();
     this->test_helper_get_file_invalid_index();
     this->test_helper_get_file_success();
-    this->test_helper_get_next_file_too_man_files();
+    this->test_helper_get_next_file_many_files();
+    this->test_helper_get_next_file_alloc_failed();
+    this->test_helper_get_next_file_reused();
     this->test_helper_get_next_file_success();
     this->test_helper_add_elf_file_invalid_size();
     this->test_helper_add_elf_file_();
@@ -183,11 +232,20 @@ driver_entry_ut::list()
     this->test_helper_add_elf_file_platform_alloc_exec_failed();
     this->test_helper_add_elf_file_success();
     this->test_helper_add_elf_file_success_multiple_times();
+    this->test_helper_add_elf_file_aligned();
+    this->test_helper_add_elf_file_arena_grows();
+    this->test_helper_add_elf_file_interleaved();
+    this->test_helper_protect_elf_files();
+    this->test_helper_discard_elf_file();
+    this->test_helper_relocate_elf_file_invalid_index();
+    this->test_helper_relocate_elf_file_platform_alloc_failed();
+    this->test_helper_alloc_symtab_platform_alloc_failed();
     this->test_helper_symbol_length_null_symbol();
     this->test_helper_symbol_length_success();
-    this->test_helper_execute_symbol_invalid_arg();
-    this->test_helper_execute_symbol_get_file_failed();
-    this->test_helper_execute_symbol_resolve_symbol_failed();
+    this->test_helper_resolve_entry_points_get_file_failed();
+    this->test_helper_resolve_entry_points_resolve_symbol_failed();
+    this->test_helper_execute_entry_invalid_index();
+    this->test_helper_execute_entry_not_resolved();
 
     return true;
 }
@@ -23,6 +23,7 @@
 #define TEST_H
 
 #include <unittest.h>
+#include <functional>
 
 class driver_entry_ut : public unittest
 {
@@ -57,21 +58,68 @@ private:
     void test_common_add_module_elf_file_total_exec_failed();
     void test_common_add_module_add_elf_file_failed();
     void test_common_add_module_elf_file_load_failed();
+    void test_common_add_module_elf_file_detach_failed();
     void test_common_add_module_add_success();
+    void test_common_add_module_add_and_free_success();
+    void test_common_add_module_prelink_init_failed();
+    void test_common_add_module_prelink_load_failed();
+    void test_common_add_module_prelink_detach_failed();
+    void test_common_add_module_prelink_after_module();
+    void test_common_add_module_prelink_success();
+    void test_common_add_module_duplicate();
+    void test_common_add_module_begin_invalid_file_size();
+    void test_common_add_module_begin_status_already_running();
+    void test_common_add_module_hash_invalid_file();
+    void test_common_add_module_check_not_hashed();
+    void test_common_add_module_check_stream_init_failed();
+    void test_common_add_module_chunk_invalid_file();
+    void test_common_add_module_chunk_invalid_module();
+    void test_common_add_module_stream_success();
+    void test_common_add_module_stream_duplicate();
+    void test_common_add_module_compressed_init_failed();
+    void test_common_add_module_compressed_read_failed();
+    void test_common_add_module_compressed_success();
+    void test_common_add_module_compressed_duplicate();
+
+    void test_common_load_module_invalid_file();
+    void test_common_load_module_invalid_file_size();
+    void test_common_load_module_not_started();
+    void test_common_load_module_already_added();
+    void test_common_load_module_relocate_failed();
+    void test_common_load_module_register_failed();
+    void test_common_load_module_success();
+
+    void test_common_replace_module_invalid_args();
+    void test_common_replace_module_not_started();
+    void test_common_replace_module_no_such_module();
+    void test_common_replace_module_unregister_failed();
+    void test_common_replace_module_relocate_failed();
+    void test_common_replace_module_success();
 
     void test_common_start_already_started();
     void test_common_start_init_loader_failed();
     void test_common_start_loader_add_failed();
+    void test_common_start_loader_symtab_failed();
+    void test_common_start_loader_relocate_begin_failed();
+    void test_common_start_loader_relocate_file_failed();
     void test_common_start_loader_relocate_failed();
-    void test_common_start_execute_symbol_failed();
+    void test_common_start_execute_entry_failed();
+    void test_common_start_resolve_entry_points_failed();
     void test_common_start_get_vmmr_failed();
     void test_common_start_success();
     void test_common_start_success_multiple_times();
+    void test_common_start_loader_stats();
+    void test_common_start_default_cpus();
+    void test_common_start_all_cpus();
+    void test_common_start_cpu_mask();
+    void test_common_start_no_cpus();
+    void test_common_start_cpu_failed();
 
     void test_common_stop_already_stopped();
-    void test_common_stop_execute_symbol_failed();
+    void test_common_stop_execute_entry_failed();
     void test_common_stop_success();
     void test_common_stop_success_multiple_times();
+    void test_common_stop_all_cpus();
 
     void test_common_dump_platform_alloc_failed();
     void test_common_dump_debug_ring_read_failed();
@@ -82,7 +130,9 @@ private:
     void test_helper_get_vmmr();
     void test_helper_get_file_invalid_index();
     void test_helper_get_file_success();
-    void test_helper_get_next_file_too_man_files();
+    void test_helper_get_next_file_many_files();
+    void test_helper_get_next_file_alloc_failed();
+    void test_helper_get_next_file_reused();
     void test_helper_get_next_file_success();
     void test_helper_add_elf_file_invalid_size();
     void test_helper_add_elf_file_();
@@ -90,11 +140,22 @@ private:
     void test_helper_add_elf_file_platform_alloc_exec_failed();
     void test_helper_add_elf_file_success();
     void test_helper_add_elf_file_success_multiple_times();
+    void test_helper_add_elf_file_aligned();
+    void test_helper_add_elf_file_arena_grows();
+    void test_helper_add_elf_file_interleaved();
+    void test_helper_protect_elf_files();
+    void test_helper_discard_elf_file();
+    void test_helper_relocate_elf_file_invalid_index();
+    void test_helper_relocate_elf_file_platform_alloc_failed();
+    void test_helper_alloc_symtab_platform_alloc_failed();
     void test_helper_symbol_length_null_symbol();
     void test_helper_symbol_length_success();
-    void test_helper_execute_symbol_invalid_arg();
-    void test_helper_execute_symbol_get_file_failed();
-    void test_helper_execute_symbol_resolve_symbol_failed();
+    void test_helper_resolve_entry_points_get_file_failed();
+    void test_helper_resolve_entry_points_resolve_symbol_failed();
+    void test_helper_execute_entry_invalid_index();
+    void test_helper_execute_entry_not_resolved();
+
+    void start_with_dummies(const std::function<int64_t(char *, int32_t)> &add);
 
 private:
 
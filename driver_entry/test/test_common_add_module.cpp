@@ -21,6 +21,8 @@
 
 #include <test.h>
 
+#include <vector>
+
 #include <common.h>
 #include <platform.h>
 #include <bfelf_loader.h>
@@ -37,7 +39,48 @@ extern "C"
 {
     uint64_t vmm_status(void);
     struct bfelf_file_t *get_next_file(void);
-    void *add_elf_file(uint64_t size);
+    void *add_elf_file(uint64_t size, struct bfelf_phdr *phdrtab, uint64_t phnum);
+
+    extern uint64_t g_num_bfelf_files;
+}
+
+// =============================================================================
+// Helpers
+// =============================================================================
+
+static std::vector<char>
+compress_raw(const char *file, int32_t fsize)
+{
+    struct bfelf_lz4_hdr hdr = {BFELF_LZ4_MAGIC, BFELF_LZ4_VERSION, (bfelf64_xword)fsize, 0x1000};
+    std::vector<char> contents((char *)&hdr, (char *)&hdr + sizeof(hdr));
+
+    for (auto offset = 0; offset < fsize; offset += 0x1000)
+    {
+        bfelf64_word size = std::min(0x1000, fsize - offset);
+        bfelf64_word block = size | BFELF_LZ4_BLOCK_RAW;
+
+        contents.insert(contents.end(), (char *)&block, (char *)&block + sizeof(block));
+        contents.insert(contents.end(), file + offset, file + offset + size);
+    }
+
+    return contents;
+}
+
+// Adds dummy1, dummy2 and dummy3 with add (which is how each test gets the
+// modules to the driver entry), and checks that the VMM can then be started
+// and stopped.
+
+void
+driver_entry_ut::start_with_dummies(const std::function<int64_t(char *, int32_t)> &add)
+{
+    char *files[3] = {m_dummy1, m_dummy2, m_dummy3};
+    int32_t fsizes[3] = {m_dummy1_length, m_dummy2_length, m_dummy3_length};
+
+    for (auto i = 0; i < 3; i++)
+        EXPECT_TRUE(add(files[i], fsizes[i]) == BF_SUCCESS);
+
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
 }
 
 // =============================================================================
@@ -88,7 +131,7 @@ driver_entry_ut::test_common_add_module_get_next_file_failed()
 
     RUN_UNITTEST_WITH_MOCKS(mocks, [&]
     {
-        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_ERROR_MAX_MODULES_REACHED);
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_ERROR_OUT_OF_MEMORY);
     });
 }
 
@@ -144,6 +187,21 @@ driver_entry_ut::test_common_add_module_elf_file_load_failed()
     });
 }
 
+void
+driver_entry_ut::test_common_add_module_elf_file_detach_failed()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(bfelf_file_detach).Return(-1);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == -1);
+    });
+
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
 void
 driver_entry_ut::test_common_add_module_add_success()
 {
@@ -152,3 +210,298 @@ driver_entry_ut::test_common_add_module_add_success()
     EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
     EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
 }
+
+void
+driver_entry_ut::test_common_add_module_add_and_free_success()
+{
+    start_with_dummies([&](char *file, int32_t fsize) -> int64_t
+    {
+        auto copy = new char[fsize];
+        memcpy(copy, file, fsize);
+
+        auto ret = common_add_module(copy, fsize);
+
+        memset(copy, 0, fsize);
+        delete[] copy;
+
+        return ret;
+    });
+}
+
+void
+driver_entry_ut::test_common_add_module_prelink_init_failed()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(bfelf_is_prelinked).Return(BFELF_TRUE);
+    mocks.OnCallFunc(bfelf_prelink_init).Return(-1);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == -1);
+    });
+}
+
+void
+driver_entry_ut::test_common_add_module_prelink_load_failed()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(bfelf_is_prelinked).Return(BFELF_TRUE);
+    mocks.OnCallFunc(bfelf_prelink_init).Return(BFELF_SUCCESS);
+    mocks.OnCallFunc(bfelf_prelink_exec_size).Return(0x1000);
+    mocks.OnCallFunc(bfelf_prelink_load).Return(-1);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == -1);
+    });
+
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_add_module_prelink_detach_failed()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(bfelf_is_prelinked).Return(BFELF_TRUE);
+    mocks.OnCallFunc(bfelf_prelink_init).Return(BFELF_SUCCESS);
+    mocks.OnCallFunc(bfelf_prelink_exec_size).Return(0x1000);
+    mocks.OnCallFunc(bfelf_prelink_load).Return(BFELF_SUCCESS);
+    mocks.OnCallFunc(bfelf_prelink_detach_size).Return(0x100);
+    mocks.OnCallFunc(bfelf_prelink_detach).Return(-1);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == -1);
+    });
+
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_add_module_prelink_after_module()
+{
+    MockRepository mocks;
+
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+
+    mocks.OnCallFunc(bfelf_is_prelinked).Return(BFELF_TRUE);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_ERROR_MIXED_PRELINKED_MODULES);
+    });
+
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_add_module_prelink_success()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(bfelf_is_prelinked).Return(BFELF_TRUE);
+    mocks.OnCallFunc(bfelf_prelink_init).Return(BFELF_SUCCESS);
+    mocks.OnCallFunc(bfelf_prelink_exec_size).Return(0x1000);
+    mocks.OnCallFunc(bfelf_prelink_load).Return(BFELF_SUCCESS);
+    mocks.OnCallFunc(bfelf_prelink_detach_size).Return(0x100);
+    mocks.OnCallFunc(bfelf_prelink_detach).Return(BFELF_SUCCESS);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_ERROR_MIXED_PRELINKED_MODULES);
+    });
+
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_add_module_duplicate()
+{
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_MODULE_ALREADY_ADDED);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_MODULE_ALREADY_ADDED);
+    EXPECT_TRUE(g_num_bfelf_files == 3);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_add_module_begin_invalid_file_size()
+{
+    EXPECT_TRUE(common_add_module_begin(0) == BF_ERROR_INVALID_ARG);
+}
+
+void
+driver_entry_ut::test_common_add_module_begin_status_already_running()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(vmm_status).Return(VMM_STARTED);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module_begin(m_dummy1_length) == BF_ERROR_VMM_ALREADY_STARTED);
+    });
+}
+
+void
+driver_entry_ut::test_common_add_module_hash_invalid_file()
+{
+    EXPECT_TRUE(common_add_module_hash(NULL, 0x1000) == BF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(common_add_module_hash(m_dummy1, 0) == BF_ERROR_INVALID_ARG);
+}
+
+void
+driver_entry_ut::test_common_add_module_check_not_hashed()
+{
+    EXPECT_TRUE(common_add_module_begin(m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module_hash(m_dummy1, m_dummy1_length - 1) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module_check() == BF_ERROR_INVALID_ARG);
+}
+
+void
+driver_entry_ut::test_common_add_module_check_stream_init_failed()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(bfelf_stream_init).Return(-1);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module_begin(m_dummy1_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module_hash(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module_check() == -1);
+    });
+}
+
+void
+driver_entry_ut::test_common_add_module_chunk_invalid_file()
+{
+    EXPECT_TRUE(common_add_module_chunk(NULL, 0x1000) == BF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(common_add_module_chunk(m_dummy1, 0) == BF_ERROR_INVALID_ARG);
+}
+
+void
+driver_entry_ut::test_common_add_module_chunk_invalid_module()
+{
+    char buf[0x100] = {0};
+
+    EXPECT_TRUE(common_add_module_begin(sizeof(buf)) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module_hash(buf, sizeof(buf)) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module_check() == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module_chunk(buf, sizeof(buf)) == BFELF_ERROR_INVALID_EI_MAG0);
+}
+
+void
+driver_entry_ut::test_common_add_module_stream_success()
+{
+    start_with_dummies([&](char *file, int32_t fsize) -> int64_t
+    {
+        EXPECT_TRUE(common_add_module_begin(fsize) == BF_SUCCESS);
+
+        for (auto offset = 0; offset < fsize; offset += 0x1000)
+        {
+            auto len = std::min(0x1000, fsize - offset);
+            EXPECT_TRUE(common_add_module_hash(file + offset, len) == BF_SUCCESS);
+        }
+
+        EXPECT_TRUE(common_add_module_check() == BF_SUCCESS);
+
+        for (auto offset = 0; offset < fsize; offset += 0x1000)
+        {
+            auto len = std::min(0x1000, fsize - offset);
+            EXPECT_TRUE(common_add_module_chunk(file + offset, len) == BF_SUCCESS);
+        }
+
+        return common_add_module_end();
+    });
+}
+
+void
+driver_entry_ut::test_common_add_module_stream_duplicate()
+{
+    MockRepository mocks;
+
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+
+    mocks.NeverCallFunc(bfelf_stream_init);
+    mocks.NeverCallFunc(platform_alloc_exec);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module_begin(m_dummy1_length) == BF_SUCCESS);
+
+        for (auto offset = 0; offset < m_dummy1_length; offset += 0x777)
+        {
+            auto len = std::min(0x777, m_dummy1_length - offset);
+            EXPECT_TRUE(common_add_module_hash(m_dummy1 + offset, len) == BF_SUCCESS);
+        }
+
+        EXPECT_TRUE(common_add_module_check() == BF_MODULE_ALREADY_ADDED);
+    });
+
+    EXPECT_TRUE(g_num_bfelf_files == 1);
+
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_add_module_compressed_init_failed()
+{
+    MockRepository mocks;
+    auto file = compress_raw(m_dummy1, m_dummy1_length);
+
+    mocks.OnCallFunc(bfelf_lz4_init).Return(-1);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(file.data(), file.size()) == -1);
+    });
+}
+
+void
+driver_entry_ut::test_common_add_module_compressed_read_failed()
+{
+    auto file = compress_raw(m_dummy1, m_dummy1_length);
+
+    EXPECT_TRUE(common_add_module(file.data(), file.size() - 1) == BFELF_ERROR_INVALID_COMPRESSED);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_add_module_compressed_success()
+{
+    start_with_dummies([&](char *file, int32_t fsize) -> int64_t
+    {
+        auto compressed = compress_raw(file, fsize);
+        return common_add_module(compressed.data(), compressed.size());
+    });
+}
+
+void
+driver_entry_ut::test_common_add_module_compressed_duplicate()
+{
+    MockRepository mocks;
+    auto file = compress_raw(m_dummy1, m_dummy1_length);
+
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+
+    mocks.NeverCallFunc(bfelf_stream_init);
+    mocks.NeverCallFunc(platform_alloc_exec);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(file.data(), file.size()) == BF_MODULE_ALREADY_ADDED);
+    });
+
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
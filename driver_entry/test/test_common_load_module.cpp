@@ -0,0 +1,162 @@
+//
+// Bareflank Hypervisor
+//
+// Copyright (C) 2015 Assured Information Security, Inc.
+// Author: Rian Quinn        <quinnr@ainfosec.com>
+// Author: Brendan Kerrigan  <kerriganb@ainfosec.com>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <test.h>
+
+#include <vector>
+
+#include <common.h>
+#include <platform.h>
+#include <bfelf_loader.h>
+
+// =============================================================================
+// Expose Private Functions
+// =============================================================================
+
+// In order to mock some of the C functions, we need to expose them. These are
+// private, so there is no need to test these functions, but we do need access
+// to them to mock them up to test the public functions.
+
+extern "C"
+{
+    int64_t execute_entry(uint64_t index, void *arg);
+    int64_t resolve_entry_points(void);
+    int64_t execute_module_entry(struct bfelf_file_t *bfelf_file, const char *sym);
+
+    extern uint64_t g_num_bfelf_files;
+}
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+void
+driver_entry_ut::test_common_load_module_invalid_file()
+{
+    EXPECT_TRUE(common_load_module(0, m_dummy1_length) == BF_ERROR_INVALID_ARG);
+}
+
+void
+driver_entry_ut::test_common_load_module_invalid_file_size()
+{
+    EXPECT_TRUE(common_load_module(m_dummy1, 0) == BF_ERROR_INVALID_ARG);
+}
+
+void
+driver_entry_ut::test_common_load_module_not_started()
+{
+    EXPECT_TRUE(common_load_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_load_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_load_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_load_module_already_added()
+{
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(common_load_module(m_dummy2, m_dummy2_length) == BF_MODULE_ALREADY_ADDED);
+    EXPECT_TRUE(g_num_bfelf_files == 3);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_load_module_relocate_failed()
+{
+    // A copy of a module that is already loaded (with a different hash)
+    // defines the same symbols, and fails to be relocated.
+
+    std::vector<char> copy(m_dummy1, m_dummy1 + m_dummy1_length);
+    copy.resize(m_dummy1_length + 0x10);
+
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(common_load_module(copy.data(), copy.size()) < BF_SUCCESS);
+    EXPECT_TRUE(g_num_bfelf_files == 3);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_load_module_register_failed()
+{
+    // The VMM is started without the module that defines its entry points,
+    // so that the module can be loaded once the VMM has been started.
+
+    {
+        MockRepository mocks;
+
+        mocks.OnCallFunc(resolve_entry_points).Return(BF_SUCCESS);
+        mocks.OnCallFunc(execute_entry).Return(BF_SUCCESS);
+
+        RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+        {
+            EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+            EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+            EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+        });
+    }
+
+    {
+        MockRepository mocks;
+
+        mocks.OnCallFunc(execute_module_entry).Return(-1);
+
+        RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+        {
+            EXPECT_TRUE(common_load_module(m_dummy3, m_dummy3_length) == -1);
+            EXPECT_TRUE(g_num_bfelf_files == 2);
+        });
+    }
+
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_load_module_success()
+{
+    // The VMM is started without the module that defines its entry points,
+    // so that the module can be loaded once the VMM has been started.
+
+    {
+        MockRepository mocks;
+
+        mocks.OnCallFunc(resolve_entry_points).Return(BF_SUCCESS);
+        mocks.OnCallFunc(execute_entry).Return(BF_SUCCESS);
+
+        RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+        {
+            EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+            EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+            EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+        });
+    }
+
+    EXPECT_TRUE(common_load_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(g_num_bfelf_files == 3);
+    EXPECT_TRUE(resolve_entry_points() == BF_SUCCESS);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
@@ -0,0 +1,149 @@
+//
+// Bareflank Hypervisor
+//
+// Copyright (C) 2015 Assured Information Security, Inc.
+// Author: Rian Quinn        <quinnr@ainfosec.com>
+// Author: Brendan Kerrigan  <kerriganb@ainfosec.com>
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+#include <test.h>
+
+#include <vector>
+
+#include <common.h>
+#include <platform.h>
+#include <bfelf_loader.h>
+
+// =============================================================================
+// Expose Private Functions
+// =============================================================================
+
+// In order to mock some of the C functions, we need to expose them. These are
+// private, so there is no need to test these functions, but we do need access
+// to them to mock them up to test the public functions.
+
+extern "C"
+{
+    uint64_t vmm_status(void);
+    int64_t resolve_entry_points(void);
+    int64_t execute_module_entry(struct bfelf_file_t *bfelf_file, const char *sym);
+
+    extern uint64_t g_num_bfelf_files;
+}
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+void
+driver_entry_ut::test_common_replace_module_invalid_args()
+{
+    EXPECT_TRUE(common_replace_module(0, m_dummy2_length, m_dummy2, m_dummy2_length) == BF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(common_replace_module(m_dummy2, 0, m_dummy2, m_dummy2_length) == BF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(common_replace_module(m_dummy2, m_dummy2_length, 0, m_dummy2_length) == BF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(common_replace_module(m_dummy2, m_dummy2_length, m_dummy2, 0) == BF_ERROR_INVALID_ARG);
+}
+
+void
+driver_entry_ut::test_common_replace_module_not_started()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(vmm_status).Return(VMM_STOPPED);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_replace_module(m_dummy2, m_dummy2_length, m_dummy2, m_dummy2_length) == BF_ERROR_VMM_NOT_STARTED);
+    });
+}
+
+void
+driver_entry_ut::test_common_replace_module_no_such_module()
+{
+    std::vector<char> copy(m_dummy2, m_dummy2 + m_dummy2_length);
+    copy.resize(m_dummy2_length + 0x10);
+
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(common_replace_module(copy.data(), copy.size(), m_dummy2, m_dummy2_length) == BF_ERROR_NO_SUCH_MODULE);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_replace_module_unregister_failed()
+{
+    std::vector<char> copy(m_dummy2, m_dummy2 + m_dummy2_length);
+    copy.resize(m_dummy2_length + 0x10);
+
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+
+    {
+        MockRepository mocks;
+
+        mocks.OnCallFunc(execute_module_entry).Return(-1);
+
+        RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+        {
+            EXPECT_TRUE(common_replace_module(m_dummy2, m_dummy2_length, copy.data(), copy.size()) == -1);
+            EXPECT_TRUE(g_num_bfelf_files == 3);
+        });
+    }
+
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_replace_module_relocate_failed()
+{
+    // Replacing dummy2 with a copy of dummy1 leaves dummy1's symbols
+    // defined twice, and dummy2's not defined at all, so the copy cannot be
+    // swapped in, and dummy2 is put back.
+
+    std::vector<char> copy(m_dummy1, m_dummy1 + m_dummy1_length);
+    copy.resize(m_dummy1_length + 0x10);
+
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(common_replace_module(m_dummy2, m_dummy2_length, copy.data(), copy.size()) < BF_SUCCESS);
+    EXPECT_TRUE(g_num_bfelf_files == 3);
+    EXPECT_TRUE(resolve_entry_points() == BF_SUCCESS);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_replace_module_success()
+{
+    std::vector<char> copy(m_dummy2, m_dummy2 + m_dummy2_length);
+    copy.resize(m_dummy2_length + 0x10);
+
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(common_replace_module(m_dummy2, m_dummy2_length, copy.data(), copy.size()) == BF_SUCCESS);
+    EXPECT_TRUE(g_num_bfelf_files == 3);
+    EXPECT_TRUE(common_replace_module(m_dummy2, m_dummy2_length, copy.data(), copy.size()) == BF_ERROR_NO_SUCH_MODULE);
+    EXPECT_TRUE(common_replace_module(copy.data(), copy.size(), m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(g_num_bfelf_files == 3);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
@@ -37,8 +37,13 @@ extern "C"
 {
     uint64_t vmm_status(void);
     struct bfelf_file_t *elf_file(uint64_t index);
-    int64_t execute_symbol(const char *sym);
+    int64_t execute_entry(uint64_t index, void *arg);
+    int64_t resolve_entry_points(void);
     struct vmm_resources_t *get_vmmr(void);
+
+    extern struct bfelf_stats_t g_loader_stats;
+    extern uint64_t g_cpus_started;
+    extern uint64_t g_cpu_mask;
 }
 
 // =============================================================================
@@ -88,12 +93,63 @@ driver_entry_ut::test_common_start_loader_add_failed()
     });
 }
 
+void
+driver_entry_ut::test_common_start_loader_symtab_failed()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(bfelf_loader_set_symtab).Return(-1);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_start_vmm() == -1);
+        EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+    });
+}
+
+void
+driver_entry_ut::test_common_start_loader_relocate_begin_failed()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(bfelf_loader_relocate_begin).Return(-1);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_start_vmm() == -1);
+        EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+    });
+}
+
+void
+driver_entry_ut::test_common_start_loader_relocate_file_failed()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(bfelf_loader_relocate_file).Return(-1);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_start_vmm() == BFELF_ERROR_NOT_RELOCATED);
+        EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+    });
+}
+
 void
 driver_entry_ut::test_common_start_loader_relocate_failed()
 {
     MockRepository mocks;
 
-    mocks.OnCallFunc(bfelf_loader_relocate).Return(-1);
+    mocks.OnCallFunc(bfelf_loader_relocate_end).Return(-1);
 
     RUN_UNITTEST_WITH_MOCKS(mocks, [&]
     {
@@ -106,11 +162,29 @@ driver_entry_ut::test_common_start_loader_relocate_failed()
 }
 
 void
-driver_entry_ut::test_common_start_execute_symbol_failed()
+driver_entry_ut::test_common_start_execute_entry_failed()
 {
     MockRepository mocks;
 
-    mocks.OnCallFunc(execute_symbol).Return(-1);
+    mocks.OnCallFunc(execute_entry).Return(-1);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_start_vmm() == -1);
+        EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+    });
+}
+
+void
+driver_entry_ut::test_common_start_resolve_entry_points_failed()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(resolve_entry_points).Return(-1);
+    mocks.NeverCallFunc(execute_entry);
 
     RUN_UNITTEST_WITH_MOCKS(mocks, [&]
     {
@@ -160,3 +234,119 @@ driver_entry_ut::test_common_start_success_multiple_times()
     EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
     EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
 }
+
+void
+driver_entry_ut::test_common_start_loader_stats()
+{
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(g_loader_stats.timestamp == platform_timestamp);
+    EXPECT_TRUE(g_loader_stats.bytes_copied > 0);
+    EXPECT_TRUE(g_loader_stats.lookups > 0);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(g_loader_stats.bytes_copied == 0);
+    EXPECT_TRUE(g_loader_stats.lookups == 0);
+}
+
+void
+driver_entry_ut::test_common_start_default_cpus()
+{
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(g_cpus_started == DEFAULT_CPUS);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(g_cpus_started == 0);
+}
+
+void
+driver_entry_ut::test_common_start_all_cpus()
+{
+    // common_set_cpu_mask only takes one CPU until start_vmm is per-CPU
+    // safe, so the mask is set directly to test starting on more than one.
+
+    EXPECT_TRUE(common_set_cpu_mask(ALL_CPUS) == BF_ERROR_INVALID_ARG);
+    g_cpu_mask = ALL_CPUS;
+
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(g_cpus_started == 0xF);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(g_cpus_started == 0);
+    EXPECT_TRUE(common_set_cpu_mask(DEFAULT_CPUS) == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_start_cpu_mask()
+{
+    EXPECT_TRUE(common_set_cpu_mask(0x5) == BF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(g_cpu_mask == DEFAULT_CPUS);
+    EXPECT_TRUE(common_set_cpu_mask(0x4) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(g_cpus_started == 0x4);
+    EXPECT_TRUE(common_set_cpu_mask(0x1) == BF_ERROR_VMM_ALREADY_STARTED);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(g_cpus_started == 0);
+    EXPECT_TRUE(common_set_cpu_mask(0) == BF_ERROR_INVALID_ARG);
+    EXPECT_TRUE(common_set_cpu_mask(DEFAULT_CPUS) == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_start_no_cpus()
+{
+    EXPECT_TRUE(common_set_cpu_mask(0x100) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+    EXPECT_TRUE(common_start_vmm() == BF_ERROR_NO_CPUS);
+    EXPECT_TRUE(g_cpus_started == 0);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+    EXPECT_TRUE(common_set_cpu_mask(DEFAULT_CPUS) == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_common_start_cpu_failed()
+{
+    MockRepository mocks;
+
+    auto starts = 0;
+    auto stops = 0;
+
+    // The test platform calls the CPUs in order, so CPU 2 fails, and the
+    // VMM has to be stopped on the other three.
+
+    mocks.OnCallFunc(execute_entry).Do([&](uint64_t index, void *arg) -> int64_t
+    {
+        if (index == ENTRY_STOP_VMM)
+        {
+            stops++;
+            return BF_SUCCESS;
+        }
+
+        starts++;
+        return starts == 3 ? -1 : BF_SUCCESS;
+    });
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        g_cpu_mask = ALL_CPUS;
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_start_vmm() == -1);
+        EXPECT_TRUE(starts == 4);
+        EXPECT_TRUE(stops == 3);
+        EXPECT_TRUE(g_cpus_started == 0);
+        EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+        EXPECT_TRUE(stops == 3);
+        EXPECT_TRUE(common_set_cpu_mask(DEFAULT_CPUS) == BF_SUCCESS);
+    });
+}
@@ -36,7 +36,9 @@
 extern "C"
 {
     uint64_t vmm_status(void);
-    int64_t execute_symbol(const char *sym);
+    int64_t execute_entry(uint64_t index, void *arg);
+
+    extern uint64_t g_cpu_mask;
 }
 
 // =============================================================================
@@ -57,12 +59,12 @@ driver_entry_ut::test_common_stop_already_stopped()
 }
 
 void
-driver_entry_ut::test_common_stop_execute_symbol_failed()
+driver_entry_ut::test_common_stop_execute_entry_failed()
 {
     MockRepository mocks;
 
     mocks.OnCallFunc(vmm_status).Return(VMM_STARTED);
-    mocks.OnCallFunc(execute_symbol).Return(-1);
+    mocks.OnCallFunc(execute_entry).Return(-1);
 
     RUN_UNITTEST_WITH_MOCKS(mocks, [&]
     {
@@ -83,3 +85,34 @@ driver_entry_ut::test_common_stop_success_multiple_times()
     EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
     EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
 }
+
+void
+driver_entry_ut::test_common_stop_all_cpus()
+{
+    MockRepository mocks;
+
+    auto stops = 0;
+
+    mocks.OnCallFunc(execute_entry).Do([&](uint64_t index, void *arg) -> int64_t
+    {
+        if (index == ENTRY_STOP_VMM)
+            stops++;
+
+        return BF_SUCCESS;
+    });
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        g_cpu_mask = ALL_CPUS;
+        EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy2, m_dummy2_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_add_module(m_dummy3, m_dummy3_length) == BF_SUCCESS);
+        EXPECT_TRUE(common_start_vmm() == BF_SUCCESS);
+        EXPECT_TRUE(stops == 0);
+        EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+        EXPECT_TRUE(stops == 4);
+        EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+        EXPECT_TRUE(stops == 4);
+        EXPECT_TRUE(common_set_cpu_mask(DEFAULT_CPUS) == BF_SUCCESS);
+    });
+}
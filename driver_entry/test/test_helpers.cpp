@@ -39,10 +39,15 @@ extern "C"
     struct vmm_resources_t *get_vmmr(void);
     struct bfelf_file_t *get_file(uint64_t index);
     struct bfelf_file_t *get_next_file(void);
-    void *add_elf_file(uint64_t size);
+    void *add_elf_file(uint64_t size, struct bfelf_phdr *phdrtab, uint64_t phnum);
     void remove_elf_files(void);
+    void protect_elf_files(void);
+    void discard_elf_file(uint64_t num);
+    void relocate_elf_file(void *arg, int64_t index);
+    int64_t alloc_symtab(struct bfelf_file_t *bfelf_file);
     int64_t symbol_length(const char *sym);
-    int64_t execute_symbol(const char *sym, void *arg);
+    int64_t resolve_entry_points(void);
+    int64_t execute_entry(uint64_t index, void *arg);
 }
 
 // =============================================================================
@@ -83,12 +88,36 @@ driver_entry_ut::test_helper_get_file_success()
 }
 
 void
-driver_entry_ut::test_helper_get_next_file_too_man_files()
+driver_entry_ut::test_helper_get_next_file_many_files()
 {
-    for (auto i = 0; i < MAX_NUM_MODULES; i++)
-        common_add_module(m_dummy1, m_dummy1_length);
+    for (auto i = 0; i < 150; i++)
+        EXPECT_TRUE(add_elf_file(0x1000, 0, 0) != 0);
 
-    EXPECT_TRUE(get_next_file() == 0);
+    EXPECT_TRUE(get_file(149) != 0);
+    EXPECT_TRUE(get_next_file() != 0);
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_helper_get_next_file_alloc_failed()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(platform_alloc).Return(0);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(get_next_file() == 0);
+    });
+}
+
+void
+driver_entry_ut::test_helper_get_next_file_reused()
+{
+    auto file = get_next_file();
+
+    EXPECT_TRUE(file != 0);
+    EXPECT_TRUE(get_next_file() == file);
     EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
 }
 
@@ -102,13 +131,13 @@ driver_entry_ut::test_helper_get_next_file_success()
 void
 driver_entry_ut::test_helper_add_elf_file_invalid_size()
 {
-    EXPECT_TRUE(add_elf_file(0) == 0);
+    EXPECT_TRUE(add_elf_file(0, 0, 0) == 0);
 }
 
 void
 driver_entry_ut::test_helper_add_elf_file_()
 {
-    EXPECT_TRUE(add_elf_file(0) == 0);
+    EXPECT_TRUE(add_elf_file(0, 0, 0) == 0);
 }
 
 void
@@ -120,7 +149,7 @@ driver_entry_ut::test_helper_add_elf_file_get_next_file_failed()
 
     RUN_UNITTEST_WITH_MOCKS(mocks, [&]
     {
-        EXPECT_TRUE(add_elf_file(100) == 0);
+        EXPECT_TRUE(add_elf_file(100, 0, 0) == 0);
     });
 }
 
@@ -133,46 +162,194 @@ driver_entry_ut::test_helper_add_elf_file_platform_alloc_exec_failed()
 
     RUN_UNITTEST_WITH_MOCKS(mocks, [&]
     {
-        EXPECT_TRUE(add_elf_file(100) == 0);
+        EXPECT_TRUE(add_elf_file(100, 0, 0) == 0);
     });
 }
 
 void
 driver_entry_ut::test_helper_add_elf_file_success()
 {
-    EXPECT_TRUE(add_elf_file(100) != 0);
+    EXPECT_TRUE(add_elf_file(100, 0, 0) != 0);
     remove_elf_files();
 }
 
 void
 driver_entry_ut::test_helper_add_elf_file_success_multiple_times()
 {
-    EXPECT_TRUE(add_elf_file(100) != 0);
-    EXPECT_TRUE(add_elf_file(100) != 0);
-    EXPECT_TRUE(add_elf_file(100) != 0);
+    EXPECT_TRUE(add_elf_file(100, 0, 0) != 0);
+    EXPECT_TRUE(add_elf_file(100, 0, 0) != 0);
+    EXPECT_TRUE(add_elf_file(100, 0, 0) != 0);
     remove_elf_files();
 }
 
+static void
+init_module_phdrs(struct bfelf_phdr *phdrs)
+{
+    struct bfelf_phdr phdr = {0};
+
+    phdrs[0] = phdr;
+    phdrs[0].p_type = bfpt_load;
+    phdrs[0].p_flags = bfpf_r | bfpf_x;
+    phdrs[0].p_vaddr = 0;
+    phdrs[0].p_memsz = 0x1000;
+
+    phdrs[1] = phdr;
+    phdrs[1].p_type = bfpt_load;
+    phdrs[1].p_flags = bfpf_r | bfpf_w;
+    phdrs[1].p_vaddr = 0x200000;
+    phdrs[1].p_memsz = 0x800;
+}
+
 void
-driver_entry_ut::test_helper_symbol_length_null_symbol()
+driver_entry_ut::test_helper_add_elf_file_aligned()
 {
-    EXPECT_TRUE(symbol_length(NULL) == 0);
+    auto exec = reinterpret_cast<uintptr_t>(add_elf_file(100, 0, 0));
+
+    EXPECT_TRUE(exec != 0);
+    EXPECT_TRUE((exec & (MODULE_ARENA_LARGE_PAGE_SIZE - 1)) == 0);
+
+    remove_elf_files();
 }
 
 void
-driver_entry_ut::test_helper_symbol_length_success()
+driver_entry_ut::test_helper_add_elf_file_arena_grows()
 {
-    EXPECT_TRUE(symbol_length("hello world") == 11);
+    auto exec1 = reinterpret_cast<uintptr_t>(add_elf_file(MODULE_ARENA_SIZE, 0, 0));
+    auto exec2 = reinterpret_cast<uintptr_t>(add_elf_file(100, 0, 0));
+    auto exec3 = reinterpret_cast<uintptr_t>(add_elf_file(MODULE_ARENA_SIZE + 1, 0, 0));
+
+    EXPECT_TRUE(exec1 != 0);
+    EXPECT_TRUE(exec2 != 0);
+    EXPECT_TRUE(exec3 != 0);
+    EXPECT_TRUE(exec2 != exec1);
+    EXPECT_TRUE((exec2 & (MODULE_ARENA_LARGE_PAGE_SIZE - 1)) == 0);
+    EXPECT_TRUE((exec3 & (MODULE_ARENA_LARGE_PAGE_SIZE - 1)) == 0);
+
+    remove_elf_files();
+}
+
+void
+driver_entry_ut::test_helper_discard_elf_file()
+{
+    struct bfelf_phdr phdrs[2];
+    init_module_phdrs(phdrs);
+
+    auto exec1 = static_cast<char *>(add_elf_file(0x200800, phdrs, 2));
+    auto exec2 = static_cast<char *>(add_elf_file(0x200800, phdrs, 2));
+
+    EXPECT_TRUE(exec1 != 0);
+    EXPECT_TRUE(exec2 == exec1 + 0x1000);
+
+    exec2[0] = 1;
+    discard_elf_file(1);
+
+    auto exec3 = static_cast<char *>(add_elf_file(0x200800, phdrs, 2));
+
+    EXPECT_TRUE(exec3 == exec2);
+    EXPECT_TRUE(exec3[0] == 0);
+
+    remove_elf_files();
 }
 
 void
-driver_entry_ut::test_helper_execute_symbol_invalid_arg()
+driver_entry_ut::test_helper_add_elf_file_interleaved()
 {
-    EXPECT_TRUE(execute_symbol(NULL, 0) == BF_ERROR_INVALID_ARG);
+    struct bfelf_phdr phdrs[2];
+    init_module_phdrs(phdrs);
+
+    auto exec1 = static_cast<char *>(add_elf_file(0x200800, phdrs, 2));
+    auto exec2 = static_cast<char *>(add_elf_file(0x200800, phdrs, 2));
+    auto exec3 = static_cast<char *>(add_elf_file(100, 0, 0));
+
+    EXPECT_TRUE(exec1 != 0);
+    EXPECT_TRUE(exec2 == exec1 + 0x1000);
+    EXPECT_TRUE(exec3 == exec1 + 0x2000);
+
+    remove_elf_files();
 }
 
 void
-driver_entry_ut::test_helper_execute_symbol_get_file_failed()
+driver_entry_ut::test_helper_protect_elf_files()
+{
+    MockRepository mocks;
+    struct bfelf_phdr phdrs[2];
+    init_module_phdrs(phdrs);
+
+    auto exec1 = static_cast<char *>(add_elf_file(0x200800, phdrs, 2));
+    auto exec2 = static_cast<char *>(add_elf_file(0x200800, phdrs, 2));
+
+    EXPECT_TRUE(exec1 != 0);
+    EXPECT_TRUE(exec2 != 0);
+
+    mocks.ExpectCallFunc(platform_set_nx).With(exec1 + 0x200000, 0x2000);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        protect_elf_files();
+    });
+
+    remove_elf_files();
+}
+
+void
+driver_entry_ut::test_helper_relocate_elf_file_invalid_index()
+{
+    MockRepository mocks;
+
+    mocks.NeverCallFunc(bfelf_loader_relocate_file);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        relocate_elf_file(0, 0);
+    });
+}
+
+void
+driver_entry_ut::test_helper_relocate_elf_file_platform_alloc_failed()
+{
+    MockRepository mocks;
+
+    EXPECT_TRUE(common_add_module(m_dummy1, m_dummy1_length) == BF_SUCCESS);
+
+    mocks.OnCallFunc(platform_alloc).Return(0);
+    mocks.ExpectCallFunc(bfelf_loader_relocate_file).With(get_file(0), static_cast<struct bfelf_symcache_t *>(0), 0).Return(BFELF_SUCCESS);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        relocate_elf_file(0, 0);
+    });
+
+    EXPECT_TRUE(common_stop_vmm() == BF_SUCCESS);
+}
+
+void
+driver_entry_ut::test_helper_alloc_symtab_platform_alloc_failed()
+{
+    MockRepository mocks;
+
+    mocks.OnCallFunc(platform_alloc).Return(0);
+    mocks.NeverCallFunc(bfelf_loader_set_symtab);
+
+    RUN_UNITTEST_WITH_MOCKS(mocks, [&]
+    {
+        EXPECT_TRUE(alloc_symtab(0) == BF_ERROR_OUT_OF_MEMORY);
+    });
+}
+
+void
+driver_entry_ut::test_helper_symbol_length_null_symbol()
+{
+    EXPECT_TRUE(symbol_length(NULL) == 0);
+}
+
+void
+driver_entry_ut::test_helper_symbol_length_success()
+{
+    EXPECT_TRUE(symbol_length("hello world") == 11);
+}
+
+void
+driver_entry_ut::test_helper_resolve_entry_points_get_file_failed()
 {
     MockRepository mocks;
 
@@ -180,12 +357,12 @@ driver_entry_ut::test_helper_execute_symbol_get_file_failed()
 
     RUN_UNITTEST_WITH_MOCKS(mocks, [&]
     {
-        EXPECT_TRUE(execute_symbol("sym", 0) == BF_ERROR_NO_MODULES_ADDED);
+        EXPECT_TRUE(resolve_entry_points() == BF_ERROR_NO_MODULES_ADDED);
     });
 }
 
 void
-driver_entry_ut::test_helper_execute_symbol_resolve_symbol_failed()
+driver_entry_ut::test_helper_resolve_entry_points_resolve_symbol_failed()
 {
     MockRepository mocks;
 
@@ -194,6 +371,19 @@ driver_entry_ut::test_helper_execute_symbol_resolve_symbol_failed()
 
     RUN_UNITTEST_WITH_MOCKS(mocks, [&]
     {
-        EXPECT_TRUE(execute_symbol("sym", 0) == -1);
+        EXPECT_TRUE(resolve_entry_points() == -1);
+        EXPECT_TRUE(execute_entry(ENTRY_START_VMM, 0) == BF_ERROR_FAILED_TO_EXECUTE_SYMBOL);
     });
 }
+
+void
+driver_entry_ut::test_helper_execute_entry_invalid_index()
+{
+    EXPECT_TRUE(execute_entry(NUM_ENTRY_POINTS, 0) == BF_ERROR_INVALID_INDEX);
+}
+
+void
+driver_entry_ut::test_helper_execute_entry_not_resolved()
+{
+    EXPECT_TRUE(execute_entry(ENTRY_STOP_VMM, 0) == BF_ERROR_FAILED_TO_EXECUTE_SYMBOL);
+}
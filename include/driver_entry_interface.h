@@ -32,11 +32,29 @@ extern "C" {
 /* ========================================================================== */
 
 #define BF_IOCTL_SUCCESS 0
+#define BF_IOCTL_MODULE_ALREADY_ADDED 1
 #define BF_IOCTL_ERROR_ADD_MODULE_FAILED -10001
 #define BF_IOCTL_ERROR_ADD_MODULE_LENGTH_FAILED -10002
 #define BF_IOCTL_ERROR_START_VMM_FAILED -10003
 #define BF_IOCTL_ERROR_STOP_VMM_FAILED -10004
 #define BF_IOCTL_ERROR_DUMP_VMM_FAILED -10004
+#define BF_IOCTL_ERROR_LOAD_MODULE_FAILED -10005
+#define BF_IOCTL_ERROR_REPLACE_MODULE_FAILED -10006
+
+/*
+ * Replace Module Arguments
+ *
+ * Passed to IOCTL_REPLACE_MODULE. The old module is the file that was added
+ * for the module to replace, and is only used to identify it.
+ */
+struct bf_replace_module_t
+{
+    const char *old_file;
+    int64_t old_size;
+
+    const char *new_file;
+    int64_t new_size;
+};
 
 /* ========================================================================== */
 /* Linux Interfaces                                                           */
@@ -58,7 +76,9 @@ extern "C" {
  * This IOCTL instructs the driver entry point to add a module. Note that this
  * cannot be called while the vmm is running. Prior to calling this IOCTL,
  * you must call IOCTL_ADD_MODULE_LENGTH, to inform the driver entry point what
- * the size of the module is.
+ * the size of the module is. If a module with the same contents has already
+ * been added, nothing is added, and BF_IOCTL_MODULE_ALREADY_ADDED is
+ * returned.
  *
  * @param arg character buffer containing the module to add
  */
@@ -74,6 +94,30 @@ extern "C" {
  */
 #define IOCTL_ADD_MODULE_LENGTH _IOR(BAREFLANK_MAJOR, 101, char *)
 
+/**
+ * Load Module
+ *
+ * This IOCTL instructs the driver entry point to load a module into the
+ * running vmm (if the vmm is not running, this is the same as
+ * IOCTL_ADD_MODULE). Prior to calling this IOCTL, you must call
+ * IOCTL_ADD_MODULE_LENGTH, to inform the driver entry point what the size
+ * of the module is.
+ *
+ * @param arg character buffer containing the module to load
+ */
+#define IOCTL_LOAD_MODULE _IOR(BAREFLANK_MAJOR, 102, char *)
+
+/**
+ * Replace Module
+ *
+ * This IOCTL instructs the driver entry point to replace a module of the
+ * running vmm with a new one. Note that this can only be called while the
+ * vmm is running.
+ *
+ * @param arg pointer to a struct bf_replace_module_t
+ */
+#define IOCTL_REPLACE_MODULE _IOR(BAREFLANK_MAJOR, 103, struct bf_replace_module_t *)
+
 /**
  * Start VMM
  *
@@ -40,6 +40,19 @@
 #define VMM_ERROR_VMM_START_FAILED ((void *)-20)
 #define VMM_ERROR_VMM_STOP_FAILED ((void *)-30)
 
+/**
+ * VMM Export
+ *
+ * The VMM can be built as a single module with hidden visibility (see
+ * bfvmm/src/monolithic). The entry points below are marked with this macro
+ * so that they are still exported, and can be resolved by the driver entry.
+ */
+#if defined(__GNUC__)
+#define VMM_EXPORT __attribute__((visibility("default")))
+#else
+#define VMM_EXPORT
+#endif
+
 /**
  * Entry Point
  *
@@ -84,10 +97,14 @@ struct vmm_resources_t
  * starting C++ code, and thus, this entry point might not be usable if a
  * normal C compiler is being used that does not mangle the name properly.
  *
+ * It is called once on each CPU that the VMM is started on, from that CPU,
+ * and the CPUs call it at the same time (with interrupts disabled on most
+ * platforms), so it must only start the VMM on the CPU it is running on.
+ *
  * @param arg pointer to vmm_resources struct
  * @return VMM_SUCCESS on success, negative error code on failure
  */
-void *
+VMM_EXPORT void *
 start_vmm(void *arg);
 
 /**
@@ -98,10 +115,44 @@ start_vmm(void *arg);
  * starting C++ code, and thus, this entry point might not be usable if a
  * normal C compiler is being used that does not mangle the name properly.
  *
+ * Like start_vmm, it is called on each CPU that the VMM was started on, at
+ * the same time.
+ *
  * @param arg currently unused (set to 0)
  * @return VMM_SUCCESS on success, negative error code on failure
  */
-void *
+VMM_EXPORT void *
 stop_vmm(void *arg);
 
+/**
+ * Register Module
+ *
+ * This is the prototype for the function that is called by the driver
+ * entry once a module has been loaded into a running VMM (or has replaced
+ * another module), and is looked up in the module itself. A module does not
+ * have to define this function. Since every module uses the same name, it
+ * should not be exported by more than one module of the VMM that is
+ * started (e.g. define it in a module that is only ever loaded).
+ *
+ * @param arg currently unused (set to 0)
+ * @return VMM_SUCCESS on success, negative error code on failure
+ */
+VMM_EXPORT void *
+register_module(void *arg);
+
+/**
+ * Unregister Module
+ *
+ * This is the prototype for the function that is called by the driver
+ * entry before a module of a running VMM is replaced. Once this function
+ * returns, nothing can be executing the module, or be about to call into
+ * it, as the module is freed once it has been replaced. If this function
+ * fails, the module is not replaced.
+ *
+ * @param arg currently unused (set to 0)
+ * @return VMM_SUCCESS on success, negative error code on failure
+ */
+VMM_EXPORT void *
+unregister_module(void *arg);
+
 #endif